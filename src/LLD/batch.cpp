@@ -0,0 +1,108 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#include <LLD/templates/batch.h>
+
+namespace LLD
+{
+
+    /* Default Constructor. */
+    WriteBatch::WriteBatch()
+    : ssArena   (SER_LLD, DATABASE_VERSION)
+    , ssScratch (SER_LLD, DATABASE_VERSION)
+    , vEntries  ( )
+    {
+    }
+
+
+    /* Get the entries, in the order they were added. */
+    const std::vector<BatchEntry>& WriteBatch::Entries() const
+    {
+        return vEntries;
+    }
+
+
+    /* Get the serialized entries, in the format of a transaction journal. */
+    const std::vector<uint8_t>& WriteBatch::Arena() const
+    {
+        return ssArena.Bytes();
+    }
+
+
+    /* Get the key of an entry. */
+    std::vector<uint8_t> WriteBatch::Key(const BatchEntry& entry) const
+    {
+        const std::vector<uint8_t>& vArena = ssArena.Bytes();
+
+        return std::vector<uint8_t>(vArena.begin() + entry.nKeyBegin, vArena.begin() + entry.nKeyBegin + entry.nKeySize);
+    }
+
+
+    /* Get the record or index of an entry. */
+    std::vector<uint8_t> WriteBatch::Data(const BatchEntry& entry) const
+    {
+        const std::vector<uint8_t>& vArena = ssArena.Bytes();
+
+        return std::vector<uint8_t>(vArena.begin() + entry.nDataBegin, vArena.begin() + entry.nDataBegin + entry.nDataSize);
+    }
+
+
+    /* Get the entries in the batch. */
+    uint32_t WriteBatch::Count() const
+    {
+        return static_cast<uint32_t>(vEntries.size());
+    }
+
+
+    /* Check if the batch has no entries. */
+    bool WriteBatch::Empty() const
+    {
+        return vEntries.empty();
+    }
+
+
+    /* Remove every entry, keeping the memory of the arena for the next batch. */
+    void WriteBatch::Clear()
+    {
+        ssArena.clear();
+        vEntries.clear();
+    }
+
+
+    /* Add the scratch bytes to the arena as a byte vector. */
+    uint32_t WriteBatch::Append()
+    {
+        /* The same bytes as serializing the scratch as a vector, without copying it into one. */
+        WriteCompactSize(ssArena, ssScratch.size());
+
+        const uint32_t nBegin = static_cast<uint32_t>(ssArena.size());
+        ssArena.write((char*)ssScratch.data(), ssScratch.size());
+
+        return nBegin;
+    }
+
+
+    /* Add the entry for the key and data just appended. */
+    void WriteBatch::Add(const uint8_t nType, const uint32_t nKeyBegin, const uint32_t nKeySize,
+                         const uint32_t nDataBegin, const uint32_t nDataSize)
+    {
+        BatchEntry entry;
+        entry.nType      = nType;
+        entry.nKeyBegin  = nKeyBegin;
+        entry.nKeySize   = nKeySize;
+        entry.nDataBegin = nDataBegin;
+        entry.nDataSize  = nDataSize;
+
+        vEntries.push_back(entry);
+    }
+}
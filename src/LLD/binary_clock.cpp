@@ -0,0 +1,396 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+____________________________________________________________________________________________*/
+
+#include <LLD/cache/binary_clock.h>
+#include <LLD/cache/ghost.h>
+#include <LLD/templates/key.h>
+#include <LLD/hash/xxh3.h>
+
+#include <Util/include/mutex.h>
+
+#include <limits>
+
+namespace LLD
+{
+    /*  Node to hold the binary data of a CLOCK ring slot. */
+    struct ClockNode
+    {
+    public:
+
+        /** Store the key as 64-bit hash, the same as the binary LRU. **/
+        uint64_t hashKey;
+
+        /** The data in the binary node, shared with readers viewing it in place. **/
+        std::shared_ptr<const std::vector<uint8_t>> pData;
+
+        /** Set on every hit, cleared as the hand passes to give a second chance. **/
+        bool fVisited;
+
+        /** Reserved nodes are never evicted. **/
+        bool fReserved;
+
+        /** Default constructor **/
+        ClockNode()
+        : hashKey   (0)
+        , pData     ( )
+        , fVisited  (false)
+        , fReserved (false)
+        {
+        }
+
+
+        /** Memory accounted to this node, including its index entry. **/
+        uint32_t Cost() const
+        {
+            return static_cast<uint32_t>((pData ? pData->size() : 0) + sizeof(ClockNode) + 32);
+        }
+
+
+        /** Check if node is in null state. **/
+        bool IsNull() const
+        {
+            return hashKey == 0;
+        }
+
+
+        /** Set node into null state. **/
+        void SetNull()
+        {
+            hashKey   = 0;
+            fVisited  = false;
+            fReserved = false;
+
+            pData.reset();
+        }
+    };
+
+
+    /*  One independently locked part of the cache. */
+    struct ClockShard
+    {
+    public:
+
+        /** Mutex for thread concurrency. **/
+        std::mutex MUTEX;
+
+        /** The Maximum Size of this shard. **/
+        uint64_t MAX_SHARD_SIZE;
+
+        /** The current size of this shard. **/
+        uint64_t nCurrentSize;
+
+        /** The ring position of each key hash. **/
+        std::unordered_map<uint64_t, uint32_t> mapIndex;
+
+        /** The ring of nodes the clock hand sweeps. **/
+        std::vector<ClockNode> vRing;
+
+        /** Positions in the ring freed by removal, reused before growing. **/
+        std::vector<uint32_t> vFree;
+
+        /** The current position of the clock hand. **/
+        uint32_t nHand;
+
+        /** The keys evicted recently, to count the hits more memory would give. **/
+        GhostList ghosts;
+
+        /** Constructor **/
+        ClockShard(const uint64_t nMaxSizeIn)
+        : MUTEX          ( )
+        , MAX_SHARD_SIZE (nMaxSizeIn)
+        , nCurrentSize   (0)
+        , mapIndex       ( )
+        , vRing          ( )
+        , vFree          ( )
+        , nHand          (0)
+        , ghosts         ( )
+        {
+        }
+
+
+        /** Find the node of a key hash, nullptr if not cached. **/
+        ClockNode* Find(const uint64_t hashKey)
+        {
+            auto it = mapIndex.find(hashKey);
+            if(it == mapIndex.end())
+                return nullptr;
+
+            return &vRing[it->second];
+        }
+
+
+        /** Release a node's memory and ring position. **/
+        void Release(const uint32_t nPos)
+        {
+            ClockNode& node = vRing[nPos];
+
+            nCurrentSize -= node.Cost();
+            mapIndex.erase(node.hashKey);
+            vFree.push_back(nPos);
+
+            node.SetNull();
+        }
+
+
+        /** Sweep the hand to the first unvisited node and evict it, never evicting nSkip. **/
+        bool Evict(const uint32_t nSkip)
+        {
+            /* Two passes clear every visited flag, so anything evictable is found. */
+            const uint64_t nSteps = vRing.size() * 2;
+            for(uint64_t n = 0; n < nSteps; ++n)
+            {
+                const uint32_t nPos = nHand;
+                nHand = (nHand + 1) % vRing.size();
+
+                /* Skip empty, reserved and newly added nodes. */
+                ClockNode& node = vRing[nPos];
+                if(node.IsNull() || node.fReserved || nPos == nSkip)
+                    continue;
+
+                /* Give visited nodes a second chance. */
+                if(node.fVisited)
+                {
+                    node.fVisited = false;
+                    continue;
+                }
+
+                /* Remember the key, sized for the ring as it is now. */
+                ghosts.Fit(vRing.size());
+                ghosts.Record(node.hashKey);
+
+                Release(nPos);
+                return true;
+            }
+
+            return false;
+        }
+    };
+
+
+    /** Cache Size Constructor **/
+    BinaryCLOCK::BinaryCLOCK(const uint32_t nCacheSizeIn)
+    : MAX_CACHE_SIZE (nCacheSizeIn)
+    , vShards        (CACHE_SHARDS, nullptr)
+    {
+        for(auto& pshard : vShards)
+            pshard = new ClockShard(MAX_CACHE_SIZE.load() / CACHE_SHARDS);
+    }
+
+
+    /** Class Destructor. **/
+    BinaryCLOCK::~BinaryCLOCK()
+    {
+        for(auto& pshard : vShards)
+            delete pshard;
+    }
+
+
+    /*  Check if data exists. */
+    bool BinaryCLOCK::Has(const std::vector<uint8_t>& vKey) const
+    {
+        const uint64_t hashKey = XXH64(&vKey[0], vKey.size(), 0);
+
+        ClockShard* pshard = shard(hashKey);
+        LOCK(pshard->MUTEX);
+
+        return pshard->Find(hashKey) != nullptr;
+    }
+
+
+    /*  Get the data by index */
+    bool BinaryCLOCK::Get(const std::vector<uint8_t>& vKey, std::vector<uint8_t>& vData)
+    {
+        const uint64_t hashKey = XXH64(&vKey[0], vKey.size(), 0);
+
+        ClockShard* pshard = shard(hashKey);
+        LOCK(pshard->MUTEX);
+
+        /* Check for data. */
+        ClockNode* pthis = pshard->Find(hashKey);
+        if(pthis == nullptr)
+        {
+            pshard->ghosts.Check(hashKey);
+            return false;
+        }
+
+        /* Get the data. */
+        vData = *pthis->pData;
+
+        /* Mark as visited, the only write a hit makes. */
+        pthis->fVisited = true;
+
+        return true;
+    }
+
+
+    /*  Get a shared handle to the cached data, without copying it. */
+    bool BinaryCLOCK::Get(const std::vector<uint8_t>& vKey, std::shared_ptr<const std::vector<uint8_t>>& pData)
+    {
+        const uint64_t hashKey = XXH64(&vKey[0], vKey.size(), 0);
+
+        ClockShard* pshard = shard(hashKey);
+        LOCK(pshard->MUTEX);
+
+        /* Check for data. */
+        ClockNode* pthis = pshard->Find(hashKey);
+        if(pthis == nullptr)
+        {
+            pshard->ghosts.Check(hashKey);
+            return false;
+        }
+
+        /* Share the data, a later Put replaces the handle instead of writing through it. */
+        pData = pthis->pData;
+
+        /* Mark as visited, the only write a hit makes. */
+        pthis->fVisited = true;
+
+        return true;
+    }
+
+
+    /*  Add data in the Pool. */
+    void BinaryCLOCK::Put(const SectorKey& key, const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData, bool fReserve)
+    {
+        const uint64_t hashKey = XXH64(&vKey[0], vKey.size(), 0);
+
+        ClockShard* pshard = shard(hashKey);
+        LOCK(pshard->MUTEX);
+
+        /* Update in place if already cached. */
+        uint32_t nPos = 0;
+        auto it = pshard->mapIndex.find(hashKey);
+        if(it != pshard->mapIndex.end())
+        {
+            nPos = it->second;
+
+            ClockNode& node = pshard->vRing[nPos];
+            pshard->nCurrentSize -= node.Cost();
+
+            node.pData    = std::make_shared<const std::vector<uint8_t>>(vData);
+            node.fVisited = true;
+        }
+        else
+        {
+            /* Reuse a free ring position, or grow the ring. */
+            if(!pshard->vFree.empty())
+            {
+                nPos = pshard->vFree.back();
+                pshard->vFree.pop_back();
+            }
+            else
+            {
+                nPos = static_cast<uint32_t>(pshard->vRing.size());
+                pshard->vRing.emplace_back();
+            }
+
+            /* New nodes start unvisited, so one-hit records leave first. */
+            ClockNode& node = pshard->vRing[nPos];
+            node.hashKey = hashKey;
+            node.pData   = std::make_shared<const std::vector<uint8_t>>(vData);
+
+            pshard->mapIndex[hashKey] = nPos;
+        }
+
+        pshard->vRing[nPos].fReserved = fReserve;
+        pshard->nCurrentSize += pshard->vRing[nPos].Cost();
+
+        /* Evict until the shard fits again. */
+        while(pshard->nCurrentSize > pshard->MAX_SHARD_SIZE)
+        {
+            if(!pshard->Evict(nPos))
+                break;
+        }
+    }
+
+
+    /*  Reserve this item in the cache permanently if true, unreserve if false. */
+    void BinaryCLOCK::Reserve(const std::vector<uint8_t>& vKey, bool fReserve)
+    {
+        const uint64_t hashKey = XXH64(&vKey[0], vKey.size(), 0);
+
+        ClockShard* pshard = shard(hashKey);
+        LOCK(pshard->MUTEX);
+
+        ClockNode* pthis = pshard->Find(hashKey);
+        if(pthis != nullptr)
+            pthis->fReserved = fReserve;
+    }
+
+
+    /*  Force Remove Object by Index. */
+    bool BinaryCLOCK::Remove(const std::vector<uint8_t>& vKey)
+    {
+        const uint64_t hashKey = XXH64(&vKey[0], vKey.size(), 0);
+
+        ClockShard* pshard = shard(hashKey);
+        LOCK(pshard->MUTEX);
+
+        /* Get the ring position. */
+        auto it = pshard->mapIndex.find(hashKey);
+        if(it == pshard->mapIndex.end())
+            return false;
+
+        pshard->Release(it->second);
+
+        return true;
+    }
+
+
+    /*  Change the maximum size of the cache, evicting down to it if smaller. */
+    void BinaryCLOCK::Resize(const uint64_t nCacheSizeIn)
+    {
+        MAX_CACHE_SIZE = nCacheSizeIn;
+
+        for(auto& pshard : vShards)
+        {
+            LOCK(pshard->MUTEX);
+
+            /* Evict until the shard fits again, no node is new. */
+            pshard->MAX_SHARD_SIZE = nCacheSizeIn / CACHE_SHARDS;
+            while(pshard->nCurrentSize > pshard->MAX_SHARD_SIZE)
+            {
+                if(!pshard->Evict(std::numeric_limits<uint32_t>::max()))
+                    break;
+            }
+        }
+    }
+
+
+    /*  Get the maximum size of the cache. */
+    uint64_t BinaryCLOCK::Capacity() const
+    {
+        return MAX_CACHE_SIZE.load();
+    }
+
+
+    /*  Get the misses on keys evicted recently. */
+    uint64_t BinaryCLOCK::Ghosts() const
+    {
+        uint64_t nHits = 0;
+        for(const auto& pshard : vShards)
+        {
+            LOCK(pshard->MUTEX);
+            nHits += pshard->ghosts.Hits();
+        }
+
+        return nHits;
+    }
+
+
+    /*  Find the shard a key hash belongs to. */
+    ClockShard* BinaryCLOCK::shard(const uint64_t hashKey) const
+    {
+        /* Use the high bits, the index map buckets by the low bits. */
+        return vShards[(hashKey >> 32) % CACHE_SHARDS];
+    }
+}
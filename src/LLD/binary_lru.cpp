@@ -18,8 +18,15 @@ ________________________________________________________________________________
 #include <Util/include/debug.h>
 #include <Util/include/hex.h>
 
+#include <algorithm>
+
 namespace LLD
 {
+
+    /* The memory of each bucket, for its node slot, index and ghost. */
+    const uint32_t BUCKET_SIZE = 24;
+
+
     /*  Node to hold the binary data of the double linked list. */
     struct BinaryNode
     {
@@ -32,14 +39,18 @@ namespace LLD
         /** Store the key as 64-bit hash, since we have checksum to verify against too. **/
         uint64_t hashKey;
 
+        /** The sector index the node is slotted by, kept to rebuild the buckets. **/
+        uint64_t nIndex;
+
         /** The data in the binary node. **/
         std::vector<uint8_t> vData;
 
         /** Default constructor **/
-        BinaryNode(const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vDataIn)
+        BinaryNode(const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vDataIn, const uint64_t nIndexIn)
         : pprev   (nullptr)
         , pnext   (nullptr)
         , hashKey (XXH64(&vKey[0], vKey.size(), 0))
+        , nIndex  (nIndexIn)
         , vData   (vDataIn)
         {
         }
@@ -81,13 +92,15 @@ namespace LLD
     BinaryLRU::BinaryLRU(const uint32_t nCacheSizeIn)
     : MAX_CACHE_SIZE    (nCacheSizeIn)
     , MAX_CACHE_BUCKETS (nCacheSizeIn / 128)
-    , nCurrentSize      (MAX_CACHE_BUCKETS * 16)
+    , nCurrentSize      (MAX_CACHE_BUCKETS * BUCKET_SIZE)
     , MUTEX             ( )
     , hashmap           (MAX_CACHE_BUCKETS, nullptr)
     , indexes           (MAX_CACHE_BUCKETS, 0)
     , pfirst            (nullptr)
     , plast             (nullptr)
+    , ghosts            ( )
     {
+        ghosts.Fit(MAX_CACHE_BUCKETS);
     }
 
 
@@ -145,26 +158,26 @@ namespace LLD
         /* Check for data. */
         uint64_t& nIndex  = indexes[bucket(vKey)];
         if(nIndex == 0)
-            return false;
+            return miss(vKey);
 
         /* Get the binary node. */
         BinaryNode* pthis = hashmap[slot(nIndex)];
         if(pthis == nullptr)
         {
             nIndex = 0; //reset by reference
-            return false;
+            return miss(vKey);
         }
 
         /* Check for null state. */
         if(pthis->IsNull())
         {
             nIndex = 0; //reset by reference
-            return false;
+            return miss(vKey);
         }
 
         /* Check the keys are correct. */
         if(pthis->hashKey != XXH64(&vKey[0], vKey.size(), 0))
-            return false;
+            return miss(vKey);
 
         /* Get the data. */
         vData = pthis->vData;
@@ -176,6 +189,20 @@ namespace LLD
     }
 
 
+    /*  Get a shared handle to the cached data. */
+    bool BinaryLRU::Get(const std::vector<uint8_t>& vKey, std::shared_ptr<const std::vector<uint8_t>>& pData)
+    {
+        /* Copy out under the lock, since the node's data is overwritten in place. */
+        std::vector<uint8_t> vData;
+        if(!Get(vKey, vData))
+            return false;
+
+        pData = std::make_shared<const std::vector<uint8_t>>(std::move(vData));
+
+        return true;
+    }
+
+
     /*  Add data in the Pool. */
     void BinaryLRU::Put(const SectorKey& key, const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData, bool fReserve)
     {
@@ -213,11 +240,13 @@ namespace LLD
             {
                 /* Erase data on collision. */
                 nCurrentSize -= static_cast<uint32_t>(hashmap[nSlot]->vData.size());
+                ghosts.Record(hashmap[nSlot]->hashKey);
                 hashmap[nSlot]->Erase();
             }
 
             /* Set new values. */
             hashmap[nSlot]->hashKey = XXH64(&vKey[0], vKey.size(), 0);
+            hashmap[nSlot]->nIndex  = nIndex;
             hashmap[nSlot]->vData   = vData;
 
             /* Move to front of list. */
@@ -226,7 +255,7 @@ namespace LLD
         else
         {
             /* Add cache node to objects map. */
-            hashmap[nSlot] = new BinaryNode(vKey, vData);;
+            hashmap[nSlot] = new BinaryNode(vKey, vData, nIndex);
             move_to_front(hashmap[nSlot]);
 
             /* Account for the node's memory size. */
@@ -234,33 +263,7 @@ namespace LLD
         }
 
         /* Remove the last node if cache too large. */
-        while(nCurrentSize > MAX_CACHE_SIZE)
-        {
-            /* Get last pointer. */
-            BinaryNode* pnode = plast;
-            if(!pnode || pnode->IsNull())
-                break;
-
-            /* Set the new links. */
-            plast = plast->pprev;
-            if (plast)
-                plast->pnext = nullptr;
-
-            /* Reset the memory linking. */
-            pnode->pprev = nullptr;
-            pnode->pnext = nullptr;
-
-            /* Reduce memory size. */
-            nCurrentSize -= static_cast<uint32_t>(pnode->vData.size());
-
-            /* Calculate the buckets for the node being deleted */
-            uint32_t  nBucket = pnode->Bucket(MAX_CACHE_BUCKETS);
-            uint64_t& nRemove = indexes[nBucket];
-
-            /* Reset the slot. */
-            hashmap[slot(nRemove)]->SetNull();
-            nRemove                = 0;
-        }
+        evict();
 
         nCurrentSize += static_cast<uint32_t>(vData.size());
     }
@@ -294,17 +297,153 @@ namespace LLD
         BinaryNode* pthis = hashmap[nSlot];
         remove_node(pthis);
 
+        /* Free the memory, the node itself stays in its slot. */
+        nCurrentSize  -= static_cast<uint32_t>(pthis->vData.size());
+        nIndex         = 0; //reset by reference
+
         /* Set to null state. */
         hashmap[nSlot]->SetNull();
 
-        /* Free the memory. */
-        nCurrentSize  -= static_cast<uint32_t>(pthis->vData.size() + 48);
-        nIndex         = 0; //reset by reference
-
         return true;
     }
 
 
+    /*  Change the maximum size of the cache, evicting down to it if smaller. */
+    void BinaryLRU::Resize(const uint64_t nCacheSizeIn)
+    {
+        LOCK(MUTEX);
+
+        MAX_CACHE_SIZE = nCacheSizeIn;
+
+        /* Keep the buckets if the size doesn't change them. */
+        const uint32_t nBuckets = static_cast<uint32_t>(std::max(nCacheSizeIn / 128, uint64_t(1)));
+        if(nBuckets == MAX_CACHE_BUCKETS)
+        {
+            evict();
+            return;
+        }
+
+        /* Free the nodes of empty slots, they aren't in the list. */
+        for(auto& pnode : hashmap)
+            if(pnode != nullptr && pnode->IsNull())
+                delete pnode;
+
+        std::vector<BinaryNode*> vSlots(nBuckets, nullptr);
+        std::vector<uint64_t> vIndexes(nBuckets, 0);
+
+        ghosts.Fit(nBuckets);
+
+        /* Slot the nodes from most to least recent, dropping any that collide with a more recent one. */
+        BinaryNode* pnext  = nullptr;
+        BinaryNode* pfront = nullptr;
+        BinaryNode* pback  = nullptr;
+
+        nCurrentSize = uint64_t(nBuckets) * BUCKET_SIZE;
+        for(BinaryNode* pthis = pfirst; pthis != nullptr; pthis = pnext)
+        {
+            pnext = pthis->pnext;
+
+            const uint32_t nSlot   = static_cast<uint32_t>(pthis->nIndex % nBuckets);
+            const uint32_t nBucket = pthis->Bucket(nBuckets);
+            if(vSlots[nSlot] != nullptr || vIndexes[nBucket] != 0)
+            {
+                ghosts.Record(pthis->hashKey);
+                delete pthis;
+
+                continue;
+            }
+
+            vSlots[nSlot]     = pthis;
+            vIndexes[nBucket] = pthis->nIndex;
+
+            /* Link in the same order behind the nodes kept so far. */
+            pthis->pprev = pback;
+            pthis->pnext = nullptr;
+            if(pback)
+                pback->pnext = pthis;
+            else
+                pfront = pthis;
+
+            pback = pthis;
+
+            nCurrentSize += sizeof(BinaryNode) + pthis->vData.size();
+        }
+
+        MAX_CACHE_BUCKETS = nBuckets;
+        hashmap.swap(vSlots);
+        indexes.swap(vIndexes);
+
+        pfirst = pfront;
+        plast  = pback;
+
+        /* Evict down to the new size, now the size counts only the nodes kept. */
+        evict();
+    }
+
+
+    /*  Get the maximum size of the cache. */
+    uint64_t BinaryLRU::Capacity() const
+    {
+        LOCK(MUTEX);
+
+        return MAX_CACHE_SIZE;
+    }
+
+
+    /*  Get the misses on keys evicted recently. */
+    uint64_t BinaryLRU::Ghosts() const
+    {
+        LOCK(MUTEX);
+
+        return ghosts.Hits();
+    }
+
+
+    /*  Remove the least recently used nodes until the cache fits its maximum size. */
+    void BinaryLRU::evict()
+    {
+        while(nCurrentSize > MAX_CACHE_SIZE)
+        {
+            /* Get last pointer. */
+            BinaryNode* pnode = plast;
+            if(!pnode || pnode->IsNull())
+                break;
+
+            /* Set the new links. */
+            plast = plast->pprev;
+            if(plast)
+                plast->pnext = nullptr;
+            else
+                pfirst = nullptr;
+
+            /* Reset the memory linking. */
+            pnode->pprev = nullptr;
+            pnode->pnext = nullptr;
+
+            /* Reduce memory size. */
+            nCurrentSize -= static_cast<uint32_t>(pnode->vData.size());
+
+            /* Reset the index of the node's bucket if it still points to the node. */
+            uint64_t& nRemove = indexes[pnode->Bucket(MAX_CACHE_BUCKETS)];
+            if(nRemove == pnode->nIndex)
+                nRemove = 0;
+
+            /* Remember the key, a miss on it is a hit more memory would have given. */
+            ghosts.Record(pnode->hashKey);
+            pnode->SetNull();
+        }
+    }
+
+
+    /*  Count a miss against the keys evicted recently. */
+    bool BinaryLRU::miss(const std::vector<uint8_t>& vKey)
+    {
+        ghosts.Check(XXH64(&vKey[0], vKey.size(), 0));
+
+        return false;
+    }
+
+
     /*  Find a bucket for checksum key management. */
     uint32_t BinaryLRU::slot(const uint64_t nIndex) const
     {
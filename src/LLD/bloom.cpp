@@ -0,0 +1,138 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#include <LLD/templates/bloom.h>
+#include <LLD/hash/xxh3.h>
+
+#include <Util/include/debug.h>
+
+#include <algorithm>
+#include <fstream>
+
+namespace LLD
+{
+
+    /* Constructor */
+    BloomFilter::BloomFilter(const uint64_t nBitsIn, const uint32_t nHashesIn)
+    : vBits   ((std::max(nBitsIn, uint64_t(64)) + 63) / 64)
+    , nBits   (vBits.size() * 64)
+    , nHashes (nHashesIn)
+    {
+    }
+
+
+    /* Add a key to the filter. */
+    void BloomFilter::Insert(const std::vector<uint8_t>& vKey)
+    {
+        Insert(&vKey[0], vKey.size());
+    }
+
+
+    /* Add a key to the filter from a raw buffer. */
+    void BloomFilter::Insert(const uint8_t* pBegin, const uint64_t nSize)
+    {
+        /* Double hashing from the two halves of a 128-bit hash. */
+        const XXH128_hash_t hash = XXH3_128bits(pBegin, nSize);
+        const uint64_t nDelta    = hash.high64 | 1;
+
+        /* Set the bits for each hash function. */
+        uint64_t nHash = hash.low64;
+        for(uint32_t n = 0; n < nHashes; ++n, nHash += nDelta)
+        {
+            const uint64_t nBit = nHash % nBits;
+            vBits[nBit >> 6].fetch_or(uint64_t(1) << (nBit & 63), std::memory_order_relaxed);
+        }
+    }
+
+
+    /* Check if a key may be in the filter. */
+    bool BloomFilter::Has(const std::vector<uint8_t>& vKey) const
+    {
+        /* Double hashing from the two halves of a 128-bit hash. */
+        const XXH128_hash_t hash = XXH3_128bits(&vKey[0], vKey.size());
+        const uint64_t nDelta    = hash.high64 | 1;
+
+        /* Any unset bit means the key was never inserted. */
+        uint64_t nHash = hash.low64;
+        for(uint32_t n = 0; n < nHashes; ++n, nHash += nDelta)
+        {
+            const uint64_t nBit = nHash % nBits;
+            if(!(vBits[nBit >> 6].load(std::memory_order_relaxed) & (uint64_t(1) << (nBit & 63))))
+                return false;
+        }
+
+        return true;
+    }
+
+
+    /* Remove all keys from the filter. */
+    void BloomFilter::Clear()
+    {
+        for(auto& nWord : vBits)
+            nWord.store(0, std::memory_order_relaxed);
+    }
+
+
+    /* Read the filter from disk. */
+    bool BloomFilter::Load(const std::string& strPath, const uint64_t nValidator)
+    {
+        /* Open the filter file. */
+        std::ifstream stream(strPath, std::ios::in | std::ios::binary);
+        if(!stream)
+            return false;
+
+        /* Check the filter was written with the same parameters, for the data as it is now. */
+        uint64_t nBitsDisk = 0;
+        uint32_t nHashesDisk = 0;
+        uint64_t nValidatorDisk = 0;
+        stream.read((char*)&nBitsDisk, sizeof(nBitsDisk));
+        stream.read((char*)&nHashesDisk, sizeof(nHashesDisk));
+        stream.read((char*)&nValidatorDisk, sizeof(nValidatorDisk));
+        if(!stream || nBitsDisk != nBits || nHashesDisk != nHashes || nValidatorDisk != nValidator)
+            return false;
+
+        /* Read the bit array. */
+        std::vector<uint64_t> vWords(vBits.size(), 0);
+        if(!stream.read((char*)&vWords[0], vWords.size() * sizeof(uint64_t)))
+            return false;
+
+        /* Copy the words into the filter. */
+        for(uint64_t n = 0; n < vWords.size(); ++n)
+            vBits[n].store(vWords[n], std::memory_order_relaxed);
+
+        return true;
+    }
+
+
+    /* Write the filter to disk. */
+    bool BloomFilter::Save(const std::string& strPath, const uint64_t nValidator) const
+    {
+        /* Open the filter file. */
+        std::ofstream stream(strPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!stream)
+            return debug::error(FUNCTION, "failed to open ", strPath);
+
+        /* Copy the words out of the filter. */
+        std::vector<uint64_t> vWords(vBits.size(), 0);
+        for(uint64_t n = 0; n < vWords.size(); ++n)
+            vWords[n] = vBits[n].load(std::memory_order_relaxed);
+
+        /* Write the parameters and bit array. */
+        stream.write((char*)&nBits, sizeof(nBits));
+        stream.write((char*)&nHashes, sizeof(nHashes));
+        stream.write((char*)&nValidator, sizeof(nValidator));
+        stream.write((char*)&vWords[0], vWords.size() * sizeof(uint64_t));
+
+        return static_cast<bool>(stream);
+    }
+}
@@ -0,0 +1,204 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#include <LLD/include/budget.h>
+
+#include <Util/include/debug.h>
+#include <Util/include/mutex.h>
+
+#include <chrono>
+#include <cstdlib>
+
+namespace LLD
+{
+
+    /* The budget shared by the databases. */
+    CacheBudget* pCacheBudget = nullptr;
+
+
+    /* Constructor. */
+    CacheBudget::CacheBudget(const uint64_t nBudgetIn, const uint32_t nIntervalIn)
+    : MUTEX           ( )
+    , CONDITION       ( )
+    , nBudget         (nBudgetIn)
+    , nInterval       (nIntervalIn)
+    , mapPools        ( )
+    , nNextPool       (0)
+    , nMoved          (0)
+    , fStop           (false)
+    , RebalanceThread ( )
+    {
+        if(nInterval > 0)
+            RebalanceThread = std::thread(std::bind(&CacheBudget::Rebalancer, this));
+    }
+
+
+    /* Default Destructor. */
+    CacheBudget::~CacheBudget()
+    {
+        {
+            LOCK(MUTEX);
+            fStop = true;
+        }
+        CONDITION.notify_all();
+
+        if(RebalanceThread.joinable())
+            RebalanceThread.join();
+    }
+
+
+    /* Add a cache pool to share the budget. */
+    uint32_t CacheBudget::Register(const std::string& strName, const uint64_t nCapacity,
+                                   const std::function<void(uint64_t)>& fnResize, const std::function<uint64_t()>& fnGhosts)
+    {
+        LOCK(MUTEX);
+
+        Pool pool;
+        pool.strName     = strName;
+        pool.nCapacity   = nCapacity;
+        pool.nMinimum    = std::min(nCapacity, MIN_CACHE_BUDGET_SIZE);
+        pool.nLastGhosts = fnGhosts();
+        pool.nGhosts     = 0;
+        pool.fnResize    = fnResize;
+        pool.fnGhosts    = fnGhosts;
+
+        mapPools[nNextPool] = pool;
+
+        return nNextPool++;
+    }
+
+
+    /* Remove a cache pool, its memory goes back to the budget. */
+    void CacheBudget::Unregister(const uint32_t nPool)
+    {
+        LOCK(MUTEX);
+
+        mapPools.erase(nPool);
+    }
+
+
+    /* Run a pass, moving memory to the pool with the highest marginal hit rate. */
+    void CacheBudget::Rebalance()
+    {
+        LOCK(MUTEX);
+
+        if(mapPools.empty())
+            return;
+
+        /* Take the misses on evicted keys since the last pass, and the memory given out. */
+        uint64_t nTotal = 0;
+        for(auto& entry : mapPools)
+        {
+            Pool& pool = entry.second;
+
+            const uint64_t nGhosts = pool.fnGhosts();
+            pool.nGhosts     = nGhosts - pool.nLastGhosts;
+            pool.nLastGhosts = nGhosts;
+
+            nTotal += pool.nCapacity;
+        }
+
+        /* Find the pool that would gain the most from memory, and the one that would lose the least. */
+        Pool* pHot  = nullptr;
+        Pool* pCold = nullptr;
+        for(auto& entry : mapPools)
+        {
+            Pool& pool = entry.second;
+            if(pool.nGhosts > 0 && (!pHot || pool.Rate() > pHot->Rate()))
+                pHot = &pool;
+        }
+
+        for(auto& entry : mapPools)
+        {
+            Pool& pool = entry.second;
+            if(&pool != pHot && pool.nCapacity > pool.nMinimum && (!pCold || pool.Rate() < pCold->Rate()))
+                pCold = &pool;
+        }
+
+        const uint64_t nStep = std::max(nBudget / CACHE_BUDGET_STEPS, uint64_t(1));
+
+        /* Pools that started with more than the budget give it back from the coldest first. */
+        if(nTotal > nBudget)
+        {
+            Pool* pShrink = pCold ? pCold : pHot;
+            if(pShrink && pShrink->nCapacity > pShrink->nMinimum)
+                Move(*pShrink, -static_cast<int64_t>(std::min(std::min(nStep, nTotal - nBudget), pShrink->nCapacity - pShrink->nMinimum)));
+
+            return;
+        }
+
+        /* Nothing would gain from more memory. */
+        if(!pHot)
+            return;
+
+        /* Hand out the budget not given to any pool yet. */
+        if(nTotal < nBudget)
+        {
+            Move(*pHot, static_cast<int64_t>(std::min(nStep, nBudget - nTotal)));
+            return;
+        }
+
+        /* Move a step from the coldest pool, if the hottest gains enough more to be worth the churn. */
+        if(pCold && pCold->Rate() * 2 < pHot->Rate())
+        {
+            const uint64_t nBytes = std::min(nStep, pCold->nCapacity - pCold->nMinimum);
+
+            debug::log(2, FUNCTION, "moving ", nBytes / 1024, " Kb from ", pCold->strName, " to ", pHot->strName,
+                " | ", pCold->nGhosts, " to ", pHot->nGhosts, " misses on evicted keys");
+
+            /* Shrink before growing, to stay inside the budget. */
+            Move(*pCold, -static_cast<int64_t>(nBytes));
+            Move(*pHot,   static_cast<int64_t>(nBytes));
+        }
+    }
+
+
+    /* Get the memory shared by the pools. */
+    uint64_t CacheBudget::Budget() const
+    {
+        return nBudget;
+    }
+
+
+    /* Run a pass every interval until stopped. */
+    void CacheBudget::Rebalancer()
+    {
+        while(!fStop.load())
+        {
+            {
+                std::unique_lock<std::mutex> CONDITION_LOCK(MUTEX);
+                CONDITION.wait_for(CONDITION_LOCK, std::chrono::seconds(nInterval), [this]{ return fStop.load(); });
+            }
+
+            if(fStop.load())
+                return;
+
+            Rebalance();
+        }
+    }
+
+
+    /* Give memory to a pool, or take it if negative. */
+    void CacheBudget::Move(Pool& pool, const int64_t nBytes)
+    {
+        if(nBytes == 0)
+            return;
+
+        pool.nCapacity = static_cast<uint64_t>(static_cast<int64_t>(pool.nCapacity) + nBytes);
+        pool.fnResize(pool.nCapacity);
+
+        nMoved += static_cast<uint64_t>(std::abs(nBytes));
+
+        debug::log(3, FUNCTION, pool.strName, " cache now ", pool.nCapacity / 1024, " Kb | ", nMoved / 1024, " Kb moved in total");
+    }
+}
@@ -0,0 +1,274 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#include <LLD/templates/bulk.h>
+#include <LLD/include/version.h>
+#include <LLD/hash/xxh3.h>
+
+#include <Util/include/debug.h>
+
+namespace LLD
+{
+
+    /* The frame types of a bulk file. */
+    const uint8_t BULK_HEADER  = 0;
+    const uint8_t BULK_BLOCK   = 1;
+    const uint8_t BULK_TRAILER = 2;
+
+
+    /* The largest frame a reader will take, a block holds at least one record of any size. */
+    const uint32_t MAX_BULK_FRAME_SIZE = 1024 * 1024 * 1024; //1 GB Max Frame
+
+
+    /* The first string of every bulk file. */
+    const std::string BULK_MAGIC = "LLD-BULK";
+
+
+    /* Constructor */
+    BulkWriter::BulkWriter(const std::string& strPath)
+    : stream        (strPath, std::ios::out | std::ios::binary | std::ios::trunc)
+    , ssBlock       (SER_LLD, DATABASE_VERSION)
+    , nBlockRecords (0)
+    , nRecords      (0)
+    , nBlocks       (0)
+    {
+    }
+
+
+    /* Write the header, with the shape of the keychain the keys are read from. */
+    bool BulkWriter::Header(const std::string& strKeychain, const uint32_t nBuckets)
+    {
+        if(!stream.is_open())
+            return debug::error(FUNCTION, "bulk file is not open");
+
+        DataStream ssHeader(SER_LLD, DATABASE_VERSION);
+        ssHeader << BULK_HEADER << BULK_MAGIC << uint32_t(DATABASE_VERSION) << strKeychain << nBuckets;
+
+        return WriteFrame(ssHeader.Bytes());
+    }
+
+
+    /* Add a record, writing a block once enough are gathered. */
+    bool BulkWriter::Add(const BulkRecord& record)
+    {
+        ssBlock << record.nBucket << record.nLength << record.vKey << uint8_t(record.fKeychain ? 1 : 0) << record.vData;
+        ++nBlockRecords;
+
+        if(ssBlock.size() >= BULK_BLOCK_SIZE)
+            return WriteBlock();
+
+        return true;
+    }
+
+
+    /* Write the last block and the trailer, and close the file. */
+    bool BulkWriter::Close()
+    {
+        if(nBlockRecords > 0 && !WriteBlock())
+            return false;
+
+        DataStream ssTrailer(SER_LLD, DATABASE_VERSION);
+        ssTrailer << BULK_TRAILER << nRecords << nBlocks;
+
+        if(!WriteFrame(ssTrailer.Bytes()))
+            return false;
+
+        stream.flush();
+        if(!stream)
+            return debug::error(FUNCTION, "failed to flush bulk file");
+
+        stream.close();
+
+        return true;
+    }
+
+
+    /* Get the records written. */
+    uint64_t BulkWriter::Records() const
+    {
+        return nRecords;
+    }
+
+
+    /* Write a header, block or trailer with its size and checksum. */
+    bool BulkWriter::WriteFrame(const std::vector<uint8_t>& vPayload)
+    {
+        const uint32_t nSize     = static_cast<uint32_t>(vPayload.size());
+        const uint64_t nChecksum = XXH3_64bits(&vPayload[0], vPayload.size());
+
+        stream.write((char*)&nSize, sizeof(nSize));
+        stream.write((char*)&vPayload[0], vPayload.size());
+        stream.write((char*)&nChecksum, sizeof(nChecksum));
+
+        if(!stream)
+            return debug::error(FUNCTION, "failed to write frame of ", nSize, " bytes");
+
+        return true;
+    }
+
+
+    /* Write the records gathered so far as a block. */
+    bool BulkWriter::WriteBlock()
+    {
+        DataStream ssFrame(SER_LLD, DATABASE_VERSION);
+        ssFrame << BULK_BLOCK << nBlockRecords;
+        ssFrame.write((char*)ssBlock.data(), ssBlock.size());
+
+        if(!WriteFrame(ssFrame.Bytes()))
+            return false;
+
+        nRecords += nBlockRecords;
+        ++nBlocks;
+
+        ssBlock.clear();
+        nBlockRecords = 0;
+
+        return true;
+    }
+
+
+    /* Constructor */
+    BulkReader::BulkReader(const std::string& strPath)
+    : stream   (strPath, std::ios::in | std::ios::binary)
+    , nRecords (0)
+    , nBlocks  (0)
+    {
+    }
+
+
+    /* Read the header. */
+    bool BulkReader::Header(std::string& strKeychain, uint32_t& nBuckets)
+    {
+        if(!stream.is_open())
+            return debug::error(FUNCTION, "bulk file is not open");
+
+        std::vector<uint8_t> vPayload;
+        if(!ReadFrame(vPayload))
+            return false;
+
+        try
+        {
+            const DataStream ssHeader(vPayload, SER_LLD, DATABASE_VERSION);
+
+            uint8_t nType = 0;
+            std::string strMagic;
+            uint32_t nVersion = 0;
+            ssHeader >> nType >> strMagic >> nVersion >> strKeychain >> nBuckets;
+
+            if(nType != BULK_HEADER || strMagic != BULK_MAGIC)
+                return debug::error(FUNCTION, "not a bulk file");
+
+            if(nVersion != DATABASE_VERSION)
+                return debug::error(FUNCTION, "bulk file version ", nVersion, " is not ", DATABASE_VERSION);
+        }
+        catch(const std::exception& e)
+        {
+            return debug::error(FUNCTION, "malformed header: ", e.what());
+        }
+
+        return true;
+    }
+
+
+    /* Read the next block of records. */
+    bool BulkReader::Next(std::vector<BulkRecord>& vRecords, bool &fEnd)
+    {
+        vRecords.clear();
+        fEnd = false;
+
+        std::vector<uint8_t> vPayload;
+        if(!ReadFrame(vPayload))
+            return false;
+
+        try
+        {
+            const DataStream ssFrame(vPayload, SER_LLD, DATABASE_VERSION);
+
+            uint8_t nType = 0;
+            ssFrame >> nType;
+
+            /* The trailer has to account for every block before it, or blocks went missing. */
+            if(nType == BULK_TRAILER)
+            {
+                uint64_t nRecordsIn = 0;
+                uint64_t nBlocksIn  = 0;
+                ssFrame >> nRecordsIn >> nBlocksIn;
+
+                if(nRecordsIn != nRecords || nBlocksIn != nBlocks)
+                    return debug::error(FUNCTION, "trailer counts ", nRecordsIn, " records in ", nBlocksIn,
+                        " blocks, read ", nRecords, " in ", nBlocks);
+
+                fEnd = true;
+                return true;
+            }
+
+            if(nType != BULK_BLOCK)
+                return debug::error(FUNCTION, "unknown frame type ", uint32_t(nType));
+
+            uint32_t nCount = 0;
+            ssFrame >> nCount;
+
+            vRecords.resize(nCount);
+            for(auto& record : vRecords)
+            {
+                uint8_t fKeychain = 0;
+                ssFrame >> record.nBucket >> record.nLength >> record.vKey >> fKeychain >> record.vData;
+
+                record.fKeychain = (fKeychain != 0);
+            }
+
+            if(!ssFrame.End())
+                return debug::error(FUNCTION, "block has bytes past its ", nCount, " records");
+        }
+        catch(const std::exception& e)
+        {
+            vRecords.clear();
+            return debug::error(FUNCTION, "malformed block: ", e.what());
+        }
+
+        nRecords += vRecords.size();
+        ++nBlocks;
+
+        return true;
+    }
+
+
+    /* Get the records read. */
+    uint64_t BulkReader::Records() const
+    {
+        return nRecords;
+    }
+
+
+    /* Read a header, block or trailer and check its checksum. */
+    bool BulkReader::ReadFrame(std::vector<uint8_t>& vPayload)
+    {
+        uint32_t nSize = 0;
+        if(!stream.read((char*)&nSize, sizeof(nSize)))
+            return debug::error(FUNCTION, "bulk file ends before its trailer");
+
+        if(nSize == 0 || nSize > MAX_BULK_FRAME_SIZE)
+            return debug::error(FUNCTION, "frame size ", nSize, " out of range");
+
+        vPayload.resize(nSize);
+
+        uint64_t nChecksum = 0;
+        if(!stream.read((char*)&vPayload[0], nSize) || !stream.read((char*)&nChecksum, sizeof(nChecksum)))
+            return debug::error(FUNCTION, "frame of ", nSize, " bytes is cut short");
+
+        if(XXH3_64bits(&vPayload[0], nSize) != nChecksum)
+            return debug::error(FUNCTION, "frame checksum mismatch at block ", nBlocks);
+
+        return true;
+    }
+}
@@ -0,0 +1,217 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLD_CACHE_BINARY_CLOCK_H
+#define NEXUS_LLD_CACHE_BINARY_CLOCK_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace LLD
+{
+    class SectorKey;
+
+
+    /** ClockNode
+     *
+     *  Node to hold the binary data of a CLOCK ring slot.
+     *
+     **/
+    struct ClockNode;
+
+
+    /** ClockShard
+     *
+     *  One independently locked part of the cache.
+     *
+     **/
+    struct ClockShard;
+
+
+    /** BinaryCLOCK
+    *
+    *   CLOCK - Second chance approximation of LRU.
+    *   Same contract as BinaryLRU, but a hit only sets the visited flag of
+    *   its node instead of relinking a list, and the cache is split into
+    *   shards by key hash that each have their own lock. Readers of
+    *   different keys rarely contend, and readers never reorder anything.
+    *   This class has no types, all objects are in binary forms.
+    *
+    **/
+    class BinaryCLOCK
+    {
+        /* The Maximum Size of the Cache. */
+        std::atomic<uint64_t> MAX_CACHE_SIZE;
+
+
+        /* The shards of the cache, each with their own lock and ring. */
+        std::vector<ClockShard*> vShards;
+
+
+    public:
+
+
+        /** The total shards keys are spread over. **/
+        static const uint32_t CACHE_SHARDS = 16;
+
+
+        /** Default Constructor. **/
+        BinaryCLOCK()                                    = delete;
+
+
+        /** Copy Constructor. **/
+        BinaryCLOCK(const BinaryCLOCK& cache)            = delete;
+
+
+        /** Move Constructor. **/
+        BinaryCLOCK(BinaryCLOCK&& cache)                 = delete;
+
+
+        /** Copy assignment. **/
+        BinaryCLOCK& operator=(const BinaryCLOCK& cache) = delete;
+
+
+        /** Move assignment. **/
+        BinaryCLOCK& operator=(BinaryCLOCK&& cache)      = delete;
+
+
+        /** Class Destructor. **/
+        ~BinaryCLOCK();
+
+
+        /** Cache Size Constructor
+         *
+         *  @param[in] nCacheSizeIn The maximum size of this Cache Pool
+         *
+         **/
+        BinaryCLOCK(const uint32_t nCacheSizeIn);
+
+
+        /** Has
+         *
+         *  Check if data exists.
+         *
+         *  @param[in] vKey The binary data of the key.
+         *
+         *  @return True/False whether pool contains data by index.
+         *
+         **/
+        bool Has(const std::vector<uint8_t>& vKey) const;
+
+
+        /** Get
+         *
+         *  Get the data by index
+         *
+         *  @param[in] vKey The binary data of the key.
+         *  @param[out] vData The binary data of the cached record.
+         *
+         *  @return True if object was found, false if none found by index.
+         *
+         **/
+        bool Get(const std::vector<uint8_t>& vKey, std::vector<uint8_t>& vData);
+
+
+        /** Get
+         *
+         *  Get a shared handle to the cached data, without copying it.
+         *
+         *  @param[in] vKey The binary data of the key.
+         *  @param[out] pData The shared binary data of the cached record.
+         *
+         *  @return True if object was found, false if none found by index.
+         *
+         **/
+        bool Get(const std::vector<uint8_t>& vKey, std::shared_ptr<const std::vector<uint8_t>>& pData);
+
+
+        /** Put
+         *
+         *  Add data in the Pool
+         *
+         *  @param[in] key The sector key of the record, unused by this cache.
+         *  @param[in] vKey The key in binary form.
+         *  @param[in] vData The input data in binary form.
+         *  @param[in] fReserve Flag for if item should be saved from cache eviction.
+         *
+         **/
+        void Put(const SectorKey& key, const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData, bool fReserve = false);
+
+
+        /** Reserve
+         *
+         *  Reserve this item in the cache permanently if true, unreserve if false
+         *
+         *  @param[in] vKey The key to flag as reserved true/false
+         *  @param[in] fReserve If this object is to be reserved for disk.
+         *
+         **/
+        void Reserve(const std::vector<uint8_t>& vKey, bool fReserve = true);
+
+
+        /** Remove
+         *
+         *  Force Remove Object by Index
+         *
+         *  @param[in] vKey Binary Data of the Key
+         *
+         *  @return True on successful removal, false if it fails
+         *
+         **/
+        bool Remove(const std::vector<uint8_t>& vKey);
+
+
+        /** Resize
+         *
+         *  Change the maximum size of the cache, evicting down to it if smaller.
+         *
+         *  @param[in] nCacheSizeIn The new maximum size in bytes.
+         *
+         **/
+        void Resize(const uint64_t nCacheSizeIn);
+
+
+        /** Capacity
+         *
+         *  Get the maximum size of the cache.
+         *
+         **/
+        uint64_t Capacity() const;
+
+
+        /** Ghosts
+         *
+         *  Get the misses on keys evicted recently, the hits more memory would have given.
+         *
+         **/
+        uint64_t Ghosts() const;
+
+
+    private:
+
+        /** Shard
+         *
+         *  Find the shard a key hash belongs to.
+         *
+         *  @param[in] hashKey The 64-bit hash of the key.
+         *
+         **/
+        ClockShard* shard(const uint64_t hashKey) const;
+    };
+}
+
+#endif
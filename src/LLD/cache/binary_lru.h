@@ -14,6 +14,9 @@ ________________________________________________________________________________
 #ifndef NEXUS_LLD_CACHE_BINARY_LRU_H
 #define NEXUS_LLD_CACHE_BINARY_LRU_H
 
+#include <LLD/cache/ghost.h>
+
+#include <memory>
 #include <mutex>
 #include <cstdint>
 #include <vector>
@@ -43,7 +46,7 @@ namespace LLD
     class BinaryLRU
     {
         /* The Maximum Size of the Cache. */
-        uint32_t MAX_CACHE_SIZE;
+        uint64_t MAX_CACHE_SIZE;
 
 
         /* The total buckets available. */
@@ -51,7 +54,7 @@ namespace LLD
 
 
         /* The current size of the pool. */
-        uint32_t nCurrentSize;
+        uint64_t nCurrentSize;
 
 
         /* Mutex for thread concurrency. */
@@ -74,6 +77,10 @@ namespace LLD
         BinaryNode* plast;
 
 
+        /* The keys evicted recently, to count the hits more memory would give. */
+        GhostList ghosts;
+
+
     public:
 
 
@@ -134,6 +141,20 @@ namespace LLD
         bool Get(const std::vector<uint8_t>& vKey, std::vector<uint8_t>& vData);
 
 
+        /** Get
+         *
+         *  Get a shared handle to the cached data. The list nodes own their
+         *  data, so this copies it once into the handle.
+         *
+         *  @param[in] vKey The binary data of the key.
+         *  @param[out] pData The shared binary data of the cached record.
+         *
+         *  @return True if object was found, false if none found by index.
+         *
+         **/
+        bool Get(const std::vector<uint8_t>& vKey, std::shared_ptr<const std::vector<uint8_t>>& pData);
+
+
         /** Put
          *
          *  Add data in the Pool
@@ -169,8 +190,56 @@ namespace LLD
         bool Remove(const std::vector<uint8_t>& vKey);
 
 
+        /** Resize
+         *
+         *  Change the maximum size of the cache, evicting down to it if smaller.
+         *  The buckets are rebuilt for the new size, keeping the most recent
+         *  records that still fit.
+         *
+         *  @param[in] nCacheSizeIn The new maximum size in bytes.
+         *
+         **/
+        void Resize(const uint64_t nCacheSizeIn);
+
+
+        /** Capacity
+         *
+         *  Get the maximum size of the cache.
+         *
+         **/
+        uint64_t Capacity() const;
+
+
+        /** Ghosts
+         *
+         *  Get the misses on keys evicted recently, the hits more memory would have given.
+         *
+         **/
+        uint64_t Ghosts() const;
+
+
     private:
 
+        /** Evict
+         *
+         *  Remove the least recently used nodes until the cache fits its maximum size.
+         *
+         **/
+        void evict();
+
+
+        /** Miss
+         *
+         *  Count a miss against the keys evicted recently.
+         *
+         *  @param[in] vKey The key that missed.
+         *
+         *  @return Always false, for the caller to return.
+         *
+         **/
+        bool miss(const std::vector<uint8_t>& vKey);
+
+
         /** RemoveNode
          *
          *  Remove a node from the double linked list.
@@ -0,0 +1,119 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLD_CACHE_GHOST_H
+#define NEXUS_LLD_CACHE_GHOST_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace LLD
+{
+
+    /** GhostList
+     *
+     *  Remembers the key hashes a cache evicted, with none of their data.
+     *
+     *  A miss on a key that is still remembered is a hit the cache would have
+     *  had with more memory. The list is direct mapped and about as long as the
+     *  cache holds entries, so the hits it counts are roughly those a cache of
+     *  twice the size would add. Not thread safe, the cache locks around it.
+     *
+     **/
+    class GhostList
+    {
+        /** The key hashes evicted, by slot. **/
+        std::vector<uint64_t> vGhosts;
+
+
+        /** The misses on evicted keys. **/
+        uint64_t nHits;
+
+
+    public:
+
+        /** The fewest slots a list keeps. **/
+        static const uint32_t MIN_GHOST_SLOTS = 64;
+
+
+        /** Default Constructor. **/
+        GhostList()
+        : vGhosts (MIN_GHOST_SLOTS, 0)
+        , nHits   (0)
+        {
+        }
+
+
+        /** Fit
+         *
+         *  Size the list for the entries of its cache. The list is cleared if
+         *  its size changes by more than half, otherwise left as it is.
+         *
+         *  @param[in] nEntries The entries the cache holds.
+         *
+         **/
+        void Fit(const uint64_t nEntries)
+        {
+            const uint64_t nSlots = std::max(nEntries, uint64_t(MIN_GHOST_SLOTS));
+            if(nSlots > vGhosts.size() / 2 && nSlots < vGhosts.size() * 2)
+                return;
+
+            std::vector<uint64_t>(nSlots, 0).swap(vGhosts);
+        }
+
+
+        /** Record
+         *
+         *  Remember an evicted key.
+         *
+         *  @param[in] hashKey The 64-bit hash of the key.
+         *
+         **/
+        void Record(const uint64_t hashKey)
+        {
+            vGhosts[hashKey % vGhosts.size()] = hashKey;
+        }
+
+
+        /** Check
+         *
+         *  Count a miss that would have been a hit, forgetting the key.
+         *
+         *  @param[in] hashKey The 64-bit hash of the key missed.
+         *
+         **/
+        void Check(const uint64_t hashKey)
+        {
+            uint64_t& nSlot = vGhosts[hashKey % vGhosts.size()];
+            if(nSlot != hashKey || hashKey == 0)
+                return;
+
+            nSlot = 0;
+            ++nHits;
+        }
+
+
+        /** Hits
+         *
+         *  Get the misses on evicted keys.
+         *
+         **/
+        uint64_t Hits() const
+        {
+            return nHits;
+        }
+    };
+}
+
+#endif
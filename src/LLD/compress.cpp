@@ -0,0 +1,94 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#include <LLD/include/compress.h>
+#include <LLD/compress/lz4.h>
+
+#include <algorithm>
+
+namespace LLD
+{
+
+    /* The bytes in front of an LZ4 block, the type and the original size. */
+    const uint32_t LZ4_HEADER_SIZE = 5;
+
+
+    /*  Encode a record for a compressed database. */
+    void Compress(const std::vector<uint8_t>& vData, std::vector<uint8_t>& vCompressed)
+    {
+        const uint32_t nSize = static_cast<uint32_t>(vData.size());
+
+        /* Compress into a buffer large enough for the worst case. */
+        if(nSize > 0 && nSize <= LZ4_MAX_INPUT_SIZE)
+        {
+            vCompressed.resize(LZ4_HEADER_SIZE + LZ4_compressBound(nSize));
+
+            const int nCompressed = LZ4_compress_default((const char*)&vData[0], (char*)&vCompressed[LZ4_HEADER_SIZE],
+                                                         nSize, static_cast<int>(vCompressed.size() - LZ4_HEADER_SIZE));
+
+            /* Keep the block only if it is smaller than storing the record raw. */
+            if(nCompressed > 0 && LZ4_HEADER_SIZE + nCompressed < nSize + 1)
+            {
+                vCompressed[0] = COMPRESSION::LZ4;
+                vCompressed[1] = static_cast<uint8_t>(nSize);
+                vCompressed[2] = static_cast<uint8_t>(nSize >> 8);
+                vCompressed[3] = static_cast<uint8_t>(nSize >> 16);
+                vCompressed[4] = static_cast<uint8_t>(nSize >> 24);
+
+                vCompressed.resize(LZ4_HEADER_SIZE + nCompressed);
+                return;
+            }
+        }
+
+        /* Store the record as it is. */
+        vCompressed.resize(nSize + 1);
+        vCompressed[0] = COMPRESSION::RAW;
+
+        std::copy(vData.begin(), vData.end(), vCompressed.begin() + 1);
+    }
+
+
+    /*  Decode a record of a compressed database. */
+    bool Decompress(const std::vector<uint8_t>& vCompressed, std::vector<uint8_t>& vData)
+    {
+        if(vCompressed.empty())
+            return false;
+
+        /* Raw records follow the type byte. */
+        if(vCompressed[0] == COMPRESSION::RAW)
+        {
+            vData.assign(vCompressed.begin() + 1, vCompressed.end());
+            return true;
+        }
+
+        /* Anything else has to be a whole LZ4 header. */
+        if(vCompressed[0] != COMPRESSION::LZ4 || vCompressed.size() < LZ4_HEADER_SIZE)
+            return false;
+
+        const uint32_t nSize = uint32_t(vCompressed[1])
+                             | uint32_t(vCompressed[2]) << 8
+                             | uint32_t(vCompressed[3]) << 16
+                             | uint32_t(vCompressed[4]) << 24;
+
+        /* A damaged size can't ask for more than LZ4 could have compressed. */
+        if(nSize == 0 || nSize > LZ4_MAX_INPUT_SIZE)
+            return false;
+
+        vData.resize(nSize);
+
+        const int nDecompressed = LZ4_decompress_safe((const char*)&vCompressed[LZ4_HEADER_SIZE], (char*)&vData[0],
+                                                      static_cast<int>(vCompressed.size() - LZ4_HEADER_SIZE), static_cast<int>(nSize));
+
+        return nDecompressed == static_cast<int>(nSize);
+    }
+}
@@ -0,0 +1,100 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#include <LLD/types/event.h>
+
+#include <algorithm>
+#include <limits>
+
+
+namespace LLD
+{
+
+    /** The Database Constructor. To determine file location and the Bytes per Record. **/
+    EventDB::EventDB(const uint8_t nFlagsIn, const uint32_t nBucketsIn, const uint32_t nCacheIn)
+    : SectorDatabase(std::string("_EVENT")
+    , nFlagsIn
+    , nBucketsIn
+    , nCacheIn)
+    {
+    }
+
+
+    /* Default Destructor */
+    EventDB::~EventDB()
+    {
+    }
+
+
+    /* Writes an event's transaction hash to the index. */
+    bool EventDB::WriteEvent(const uint256_t& hashAddress, const uint32_t nSequence, const uint512_t& hashTx)
+    {
+        /* Keep track of the first event indexed, as the index only begins when it is enabled. */
+        if(!Exists(std::make_pair(std::string("first"), hashAddress))
+        && !Write(std::make_pair(std::string("first"), hashAddress), nSequence))
+            return false;
+
+        return Write(std::make_pair(std::make_pair(std::string("event"), hashAddress), SequenceKey(nSequence)), hashTx, "event");
+    }
+
+
+    /* Erases an event from the index. */
+    bool EventDB::EraseEvent(const uint256_t& hashAddress, const uint32_t nSequence)
+    {
+        /* Events from before the index was enabled were never indexed. */
+        uint32_t nFirst = 0;
+        if(!ReadFirst(hashAddress, nFirst) || nSequence < nFirst)
+            return true;
+
+        /* Erase the first event marker once nothing is left indexed. */
+        if(nFirst == nSequence && !Erase(std::make_pair(std::string("first"), hashAddress)))
+            return false;
+
+        return Erase(std::make_pair(std::make_pair(std::string("event"), hashAddress), SequenceKey(nSequence)));
+    }
+
+
+    /* Reads the first sequence number indexed for an address. */
+    bool EventDB::ReadFirst(const uint256_t& hashAddress, uint32_t &nFirst)
+    {
+        return Read(std::make_pair(std::string("first"), hashAddress), nFirst);
+    }
+
+
+    /* Reads the transaction hashes of the events from sequence nBegin up to but not including nEnd. */
+    bool EventDB::ReadEvents(const uint256_t& hashAddress, const uint32_t nBegin, const uint32_t nEnd,
+                             std::vector<uint512_t> &vHashes)
+    {
+        /* Check for an empty range. */
+        if(nBegin >= nEnd)
+            return false;
+
+        return RangeRead(std::make_pair(std::make_pair(std::string("event"), hashAddress), SequenceKey(nBegin)),
+                         std::make_pair(std::make_pair(std::string("event"), hashAddress), SequenceKey(nEnd)),
+                         vHashes, std::min(nEnd - nBegin, uint32_t(std::numeric_limits<int32_t>::max())));
+    }
+
+
+    /* Get the big-endian bytes of a sequence number. */
+    std::vector<uint8_t> EventDB::SequenceKey(const uint32_t nSequence)
+    {
+        return std::vector<uint8_t>
+        {
+            static_cast<uint8_t>(nSequence >> 24),
+            static_cast<uint8_t>(nSequence >> 16),
+            static_cast<uint8_t>(nSequence >> 8),
+            static_cast<uint8_t>(nSequence)
+        };
+    }
+
+}
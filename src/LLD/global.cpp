@@ -12,9 +12,16 @@
 ____________________________________________________________________________________________*/
 
 #include <LLD/include/global.h>
+#include <LLD/templates/journal.h>
 
 #include <TAO/Ledger/include/enum.h> //for internal flags
 
+#include <Util/include/args.h>
+#include <Util/include/filesystem.h>
+#include <Util/include/signals.h>
+
+#include <atomic>
+
 namespace LLD
 {
     /* The LLD global instance pointers. */
@@ -28,62 +35,125 @@ namespace LLD
     TrustDB*      Trust;
     LegacyDB*     Legacy;
 
+    /* The optional ordered event index. */
+    EventDB*      Event = nullptr;
+
+
+    /* The write-ahead log shared by all instances, so a commit costs one fsync. */
+    Journal*      pJournal = nullptr;
+
+
+    /* Set once the write-ahead log fails, after which nothing more is committed. */
+    std::atomic<bool> fJournalFailed(false);
+
 
     /*  Initialize the global LLD instances. */
-    void Initialize()
+    bool Initialize()
     {
         debug::log(0, FUNCTION, "Initializing LLD");
 
-        /* Create the contract database instance. */
-        uint32_t nContractCacheSize = config::GetArg("-contractcache", 1);
-        Contract = new ContractDB(
-                        FLAGS::CREATE | FLAGS::FORCE,
-                        77773,
-                        nContractCacheSize * 1024 * 1024);
+        /* Share one cache budget between the databases if given, their cache sizes are then where they start. */
+        const uint64_t nCacheBudget = config::GetArg("-lldcachebudget", 0);
+        if(nCacheBudget > 0)
+            pCacheBudget = new CacheBudget(nCacheBudget * 1024 * 1024, config::GetArg("-lldcacheinterval", 10));
 
-        /* Create the contract database instance. */
-        uint32_t nRegisterCacheSize = config::GetArg("-registercache", 2);
-        Register = new RegisterDB(
-                        FLAGS::CREATE | FLAGS::FORCE,
-                        77773,
-                        nRegisterCacheSize * 1024 * 1024);
+        /* Memory map the sector files for lock-free reads if enabled. Mapped databases only reclaim space by compacting. */
+        uint8_t nMapped = config::GetBoolArg("-lldmmap", false) ? FLAGS::MAPPED : 0;
+        if(nMapped && !config::GetBoolArg("-lldcompact", true))
+        {
+            debug::error(FUNCTION, "-lldmmap needs -lldcompact, the databases would grow without bound. Reading through the file streams.");
+            nMapped = 0;
+        }
 
-        /* Create the ledger database instance. */
-        uint32_t nLedgerCacheSize = config::GetArg("-ledgercache", 2);
-        Ledger    = new LedgerDB(
-                        FLAGS::CREATE | FLAGS::FORCE,
-                        config::fClient.load() ? 77773 : (256 * 256 * 64),
-                        nLedgerCacheSize * 1024 * 1024);
+        /* Open the databases, which refuse to open sector files written with other encoding flags. */
+        try
+        {
+            /* Create the contract database instance. */
+            uint32_t nContractCacheSize = config::GetArg("-contractcache", 1);
+            Contract = new ContractDB(
+                            FLAGS::CREATE | FLAGS::FORCE | nMapped,
+                            77773,
+                            nContractCacheSize * 1024 * 1024);
+
+            /* Create the contract database instance. */
+            uint32_t nRegisterCacheSize = config::GetArg("-registercache", 2);
+            Register = new RegisterDB(
+                            FLAGS::CREATE | FLAGS::FORCE | nMapped,
+                            77773,
+                            nRegisterCacheSize * 1024 * 1024);
+
+            /* Create the ledger database instance. */
+            uint32_t nLedgerCacheSize = config::GetArg("-ledgercache", 2);
+            Ledger    = new LedgerDB(
+                            FLAGS::CREATE | FLAGS::FORCE | nMapped,
+                            config::fClient.load() ? 77773 : (256 * 256 * 64),
+                            nLedgerCacheSize * 1024 * 1024);
+
+
+            /* Create the legacy database instance. */
+            uint32_t nLegacyCacheSize = config::GetArg("-legacycache", 1);
+            Legacy = new LegacyDB(
+                            FLAGS::CREATE | FLAGS::FORCE | nMapped,
+                            config::fClient.load() ? 77773 : 256 * 256 * 64,
+                            nLegacyCacheSize * 1024 * 1024);
+
+
+            /* Create the trust database instance. */
+            Trust  = new TrustDB(
+                            FLAGS::CREATE | FLAGS::FORCE);
+
+
+            /* Create the local database instance. */
+            Local    = new LocalDB(
+                            FLAGS::CREATE | FLAGS::FORCE);
+
+
+            /* Create the ordered event index if enabled, it only covers events from when it was enabled. */
+            if(config::GetBoolArg("-eventindex", false) && !config::fClient.load())
+            {
+                Event    = new EventDB(
+                                FLAGS::CREATE | FLAGS::FORCE | nMapped);
+            }
+
+
+            if(config::fClient.load())
+            {
+                /* Create new client database if enabled. */
+                Client    = new ClientDB(
+                                FLAGS::CREATE | FLAGS::FORCE,
+                                77773);
+            }
+        }
+        catch(const std::exception& e)
+        {
+            return debug::error(FUNCTION, e.what());
+        }
 
 
-        /* Create the legacy database instance. */
-        uint32_t nLegacyCacheSize = config::GetArg("-legacycache", 1);
-        Legacy = new LegacyDB(
-                        FLAGS::CREATE | FLAGS::FORCE,
-                        config::fClient.load() ? 77773 : 256 * 256 * 64,
-                        nLegacyCacheSize * 1024 * 1024);
+        /* Create the shared write-ahead log. */
+        pJournal = new Journal(debug::safe_printstr(config::GetDataDir(), "journal.dat"));
 
+        /* Handle database recovery mode. */
+        TxnRecovery();
 
-        /* Create the trust database instance. */
-        Trust  = new TrustDB(
-                        FLAGS::CREATE | FLAGS::FORCE);
+        /* Load the chain databases from bulk files if asked to, a node can't start on a partial import. */
+        if(config::mapArgs.count("-lldimport") && !Import(config::GetArg("-lldimport", "")))
+            return debug::error(FUNCTION, "-lldimport failed, remove the partially imported databases before starting again");
 
+        /* Write the chain databases to bulk files if asked to, and stop there as the export is all that was wanted. */
+        if(config::mapArgs.count("-lldexport"))
+        {
+            const std::string strExport = config::GetArg("-lldexport", "");
+            if(!Export(strExport))
+                return debug::error(FUNCTION, "-lldexport failed, the files in ", strExport, " are incomplete");
 
-        /* Create the local database instance. */
-        Local    = new LocalDB(
-                        FLAGS::CREATE | FLAGS::FORCE);
-        
+            debug::log(0, FUNCTION, ANSI_COLOR_BRIGHT_GREEN, "Exported LLD to ", strExport, ", shutting down", ANSI_COLOR_RESET);
 
-        if(config::fClient.load())
-        {
-            /* Create new client database if enabled. */
-            Client    = new ClientDB(
-                            FLAGS::CREATE | FLAGS::FORCE,
-                            77773);
+            config::fShutdown.store(true);
+            SHUTDOWN.notify_all();
         }
 
-        /* Handle database recovery mode. */
-        TxnRecovery();
+        return true;
     }
 
 
@@ -145,12 +215,160 @@ namespace LLD
             debug::log(2, FUNCTION, "Shutting down TrustDB");
             delete Trust;
         }
+
+
+        /* Cleanup the event database. */
+        if(Event)
+        {
+            debug::log(2, FUNCTION, "Shutting down EventDB");
+            delete Event;
+        }
+
+        /* Cleanup the write-ahead log. */
+        if(pJournal)
+        {
+            delete pJournal;
+            pJournal = nullptr;
+        }
+
+        /* Cleanup the cache budget, once every database has left it. */
+        if(pCacheBudget)
+        {
+            delete pCacheBudget;
+            pCacheBudget = nullptr;
+        }
+    }
+
+
+    /*  Write the chain databases to bulk files in a directory. */
+    bool Export(const std::string& strDir)
+    {
+        if(!filesystem::create_directories(strDir + "/") && !filesystem::exists(strDir))
+            return debug::error(FUNCTION, "failed to create ", strDir);
+
+        debug::log(0, FUNCTION, "Exporting LLD to ", strDir);
+
+        /* The local and client databases belong to this node, and the event index only covers what it has seen, so they aren't exported. */
+        bool fSuccess = true;
+        if(Contract && !Contract->Export(strDir + "/contract.lldbulk"))
+            fSuccess = false;
+
+        if(Register && !Register->Export(strDir + "/register.lldbulk"))
+            fSuccess = false;
+
+        if(Ledger && !Ledger->Export(strDir + "/ledger.lldbulk"))
+            fSuccess = false;
+
+        if(Legacy && !Legacy->Export(strDir + "/legacy.lldbulk"))
+            fSuccess = false;
+
+        if(Trust && !Trust->Export(strDir + "/trust.lldbulk"))
+            fSuccess = false;
+
+        return fSuccess;
+    }
+
+
+    /*  Load the chain databases from bulk files written by Export. */
+    bool Import(const std::string& strDir)
+    {
+        debug::log(0, FUNCTION, "Importing LLD from ", strDir);
+
+        /* Use more keychain writers than a flush does, an import has nothing else to do. */
+        const uint32_t nThreads = static_cast<uint32_t>(std::max(config::GetArg("-lldimportthreads", 4), int64_t(1)));
+
+        /* Stop at the first database that fails, the rest would be loaded on top of a broken chain. */
+        if(Contract && !Contract->Import(strDir + "/contract.lldbulk", nThreads))
+            return debug::error(FUNCTION, "failed to import ", strDir, "/contract.lldbulk");
+
+        if(Register && !Register->Import(strDir + "/register.lldbulk", nThreads))
+            return debug::error(FUNCTION, "failed to import ", strDir, "/register.lldbulk");
+
+        if(Ledger && !Ledger->Import(strDir + "/ledger.lldbulk", nThreads))
+            return debug::error(FUNCTION, "failed to import ", strDir, "/ledger.lldbulk");
+
+        if(Legacy && !Legacy->Import(strDir + "/legacy.lldbulk", nThreads))
+            return debug::error(FUNCTION, "failed to import ", strDir, "/legacy.lldbulk");
+
+        if(Trust && !Trust->Import(strDir + "/trust.lldbulk", nThreads))
+            return debug::error(FUNCTION, "failed to import ", strDir, "/trust.lldbulk");
+
+        return true;
     }
 
 
     /* Check the transactions for recovery. */
     void TxnRecovery()
     {
+        /* Check the shared write-ahead log for a complete commit group. */
+        std::map<std::string, std::vector<uint8_t>> mapJournals;
+        if(pJournal && pJournal->Recover(mapJournals))
+        {
+            debug::log(0, FUNCTION, "write-ahead log is complete for ", mapJournals.size(), " databases, recovering...");
+
+            /* Rebuild the transactions of every database in the group. */
+            if(Contract)
+                Contract->TxnRecovery(mapJournals);
+
+            if(Register)
+                Register->TxnRecovery(mapJournals);
+
+            if(Ledger)
+                Ledger->TxnRecovery(mapJournals);
+
+            if(Local)
+                Local->TxnRecovery(mapJournals);
+
+            if(Client)
+                Client->TxnRecovery(mapJournals);
+
+            if(Trust)
+                Trust->TxnRecovery(mapJournals);
+
+            if(Event)
+                Event->TxnRecovery(mapJournals);
+
+            if(Legacy)
+                Legacy->TxnRecovery(mapJournals);
+
+            /* Apply the transactions, databases not in the group have none to commit. */
+            if(Contract)
+                Contract->TxnCommit();
+
+            if(Register)
+                Register->TxnCommit();
+
+            if(Ledger)
+                Ledger->TxnCommit();
+
+            if(Local)
+                Local->TxnCommit();
+
+            if(Client)
+                Client->TxnCommit();
+
+            if(Trust)
+                Trust->TxnCommit();
+
+            if(Event)
+                Event->TxnCommit();
+
+            if(Legacy)
+                Legacy->TxnCommit();
+
+            /* The group is applied, so the log can be cleared. */
+            pJournal->Clear();
+
+            /* Release the transactions. */
+            TxnAbort();
+
+            return;
+        }
+
+        /* Clear any partial group, it was never acknowledged as committed. */
+        if(pJournal)
+            pJournal->Clear();
+
         /* Flag to determine if there are any failures. */
         bool fRecovery = true;
 
@@ -178,6 +396,10 @@ namespace LLD
         if(Trust && !Trust->TxnRecovery())
             fRecovery = false;
 
+        /* Check the event DB journal. */
+        if(Event && !Event->TxnRecovery())
+            fRecovery = false;
+
         /* Check the ledger DB journal. */
         if(Legacy && !Legacy->TxnRecovery())
             fRecovery = false;
@@ -211,6 +433,10 @@ namespace LLD
             if(Trust)
                 Trust->TxnCommit();
 
+            /* Commit the event DB transaction. */
+            if(Event)
+                Event->TxnCommit();
+
             /* Commit the legacy DB transaction. */
             if(Legacy)
                 Legacy->TxnCommit();
@@ -264,6 +490,10 @@ namespace LLD
         if(Trust)
             Trust->TxnBegin();
 
+        /* Start the event DB transaction. */
+        if(Event)
+            Event->TxnBegin();
+
         /* Start the legacy DB transaction. */
         if(Legacy)
             Legacy->TxnBegin();
@@ -313,6 +543,10 @@ namespace LLD
         if(Trust)
             Trust->TxnRelease();
 
+        /* Abort the event DB transaction. */
+        if(Event)
+            Event->TxnRelease();
+
         /* Abort the legacy DB transaction. */
         if(Legacy)
             Legacy->TxnRelease();
@@ -320,7 +554,7 @@ namespace LLD
 
 
     /* Global handler for all LLD instances. */
-    void TxnCommit(const uint8_t nFlags)
+    bool TxnCommit(const uint8_t nFlags)
     {
         /* Commit the contract DB transaction. */
         if(Contract)
@@ -336,36 +570,62 @@ namespace LLD
 
         /* Handle memory commits if in memory mode. */
         if(nFlags == TAO::Ledger::FLAGS::MEMPOOL)
-            return;
+            return true;
+
+        /* Don't write on top of a group that was dropped, the databases would no longer follow the chain. */
+        if(fJournalFailed.load())
+        {
+            TxnAbort(nFlags);
+
+            return debug::error(FUNCTION, "write-ahead log failed earlier, refusing to commit while shutting down");
+        }
 
         /* Set a checkpoint for contract DB. */
         if(Contract)
-            Contract->TxnCheckpoint();
+            pJournal ? Contract->TxnCheckpoint(*pJournal) : Contract->TxnCheckpoint();
 
         /* Set a checkpoint for register DB. */
         if(Register)
-            Register->TxnCheckpoint();
+            pJournal ? Register->TxnCheckpoint(*pJournal) : Register->TxnCheckpoint();
 
         /* Set a checkpoint for ledger DB. */
         if(Ledger)
-            Ledger->TxnCheckpoint();
+            pJournal ? Ledger->TxnCheckpoint(*pJournal) : Ledger->TxnCheckpoint();
 
         /* Set a checkpoint for local DB. */
         if(Local)
-            Local->TxnCheckpoint();
+            pJournal ? Local->TxnCheckpoint(*pJournal) : Local->TxnCheckpoint();
 
         /* Set a checkpoint for client DB. */
         if(Client)
-            Client->TxnCheckpoint();
+            pJournal ? Client->TxnCheckpoint(*pJournal) : Client->TxnCheckpoint();
 
         /* Set a checkpoint for trust DB. */
         if(Trust)
-            Trust->TxnCheckpoint();
+            pJournal ? Trust->TxnCheckpoint(*pJournal) : Trust->TxnCheckpoint();
+
+        /* Set a checkpoint for event DB. */
+        if(Event)
+            pJournal ? Event->TxnCheckpoint(*pJournal) : Event->TxnCheckpoint();
 
         /* Set a checkpoint for legacy DB. */
         if(Legacy)
-            Legacy->TxnCheckpoint();
+            pJournal ? Legacy->TxnCheckpoint(*pJournal) : Legacy->TxnCheckpoint();
+
+        /* Write the group to disk with a single fsync before applying it. */
+        if(pJournal && !pJournal->Commit())
+        {
+            /* Leave nothing of the group in the log to recover, and drop it from every database without applying it. */
+            pJournal->Clear();
+            TxnAbort(nFlags);
+
+            /* The memory states are committed already and can't be rolled back, so shut down to restart from the disk. */
+            fJournalFailed.store(true);
+            config::fShutdown.store(true);
+            SHUTDOWN.notify_all();
 
+            return debug::error(FUNCTION, "failed to write the write-ahead log, transaction aborted. Shutting down.");
+        }
 
         /* Commit contract DB transaction. */
         if(Contract)
@@ -391,10 +651,18 @@ namespace LLD
         if(Trust)
             Trust->TxnCommit();
 
+        /* Commit the event DB transaction. */
+        if(Event)
+            Event->TxnCommit();
+
         /* Commit the legacy DB transaction. */
         if(Legacy)
             Legacy->TxnCommit();
 
+        /* All databases are updated, so the log is no longer needed. */
+        if(pJournal)
+            pJournal->Clear();
+
 
         /* Abort the contract DB transaction. */
         if(Contract)
@@ -420,8 +688,14 @@ namespace LLD
         if(Trust)
             Trust->TxnRelease();
 
+        /* Abort the event DB transaction. */
+        if(Event)
+            Event->TxnRelease();
+
         /* Abort the legacy DB transaction. */
         if(Legacy)
             Legacy->TxnRelease();
+
+        return true;
     }
 }
@@ -21,23 +21,44 @@ ________________________________________________________________________________
 #include <Util/include/debug.h>
 #include <Util/include/hex.h>
 
+#include <algorithm>
 #include <iomanip>
+#include <set>
+
+#include <sys/stat.h>
 
 namespace LLD
 {
 
+    /* Get the length of a key of nLength bytes once compressed to nMaxSize, the same as CompressKey. */
+    static uint64_t CompressedLength(uint64_t nLength, const uint64_t nMaxSize)
+    {
+        while(nLength > nMaxSize)
+            nLength = std::max(nLength >> 1, nMaxSize);
+
+        return nLength;
+    }
+
+
     /* The Database Constructor. To determine file location and the Bytes per Record. */
     BinaryHashMap::BinaryHashMap(const std::string& strBaseLocationIn, const uint8_t nFlagsIn, const uint64_t nBucketsIn)
-    : KEY_MUTEX              ( )
+    : FILE_MUTEX             ( )
     , strBaseLocation        (strBaseLocationIn)
     , fileCache              (new TemplateLRU<uint16_t, std::fstream*>(8))
     , pindex                 (nullptr)
     , hashmap                (nBucketsIn)
+    , vFilters               ( )
+    , vFiltersDirty          ( )
+    , vFilterValidators      ( )
+    , vMaps                  ( )
+    , pFiles                 (nullptr)
+    , vFileLists             ( )
     , HASHMAP_TOTAL_BUCKETS  (nBucketsIn)
     , HASHMAP_MAX_KEY_SIZE   (32)
     , HASHMAP_KEY_ALLOCATION (static_cast<uint16_t>(HASHMAP_MAX_KEY_SIZE + 13))
     , nFlags                 (nFlagsIn)
     , RECORD_MUTEX           (1024)
+    , pProbes                (nullptr)
     {
         Initialize();
     }
@@ -45,16 +66,23 @@ namespace LLD
 
     /* Copy Constructor */
     BinaryHashMap::BinaryHashMap(const BinaryHashMap& map)
-    : KEY_MUTEX              ( )
+    : FILE_MUTEX             ( )
     , strBaseLocation        (map.strBaseLocation)
     , fileCache              (map.fileCache)
     , pindex                 (map.pindex)
     , hashmap                (map.hashmap)
+    , vFilters               ( )
+    , vFiltersDirty          ( )
+    , vFilterValidators      ( )
+    , vMaps                  ( )
+    , pFiles                 (nullptr)
+    , vFileLists             ( )
     , HASHMAP_TOTAL_BUCKETS  (map.HASHMAP_TOTAL_BUCKETS)
     , HASHMAP_MAX_KEY_SIZE   (map.HASHMAP_MAX_KEY_SIZE)
     , HASHMAP_KEY_ALLOCATION (map.HASHMAP_KEY_ALLOCATION)
     , nFlags                 (map.nFlags)
     , RECORD_MUTEX           (map.RECORD_MUTEX.size())
+    , pProbes                (map.pProbes)
     {
         Initialize();
     }
@@ -62,16 +90,23 @@ namespace LLD
 
     /* Move Constructor */
     BinaryHashMap::BinaryHashMap(BinaryHashMap&& map)
-    : KEY_MUTEX              ( )
+    : FILE_MUTEX             ( )
     , strBaseLocation        (std::move(map.strBaseLocation))
     , fileCache              (std::move(map.fileCache))
     , pindex                 (std::move(map.pindex))
     , hashmap                (std::move(map.hashmap))
+    , vFilters               ( )
+    , vFiltersDirty          ( )
+    , vFilterValidators      ( )
+    , vMaps                  ( )
+    , pFiles                 (nullptr)
+    , vFileLists             ( )
     , HASHMAP_TOTAL_BUCKETS  (std::move(map.HASHMAP_TOTAL_BUCKETS))
     , HASHMAP_MAX_KEY_SIZE   (std::move(map.HASHMAP_MAX_KEY_SIZE))
     , HASHMAP_KEY_ALLOCATION (std::move(map.HASHMAP_KEY_ALLOCATION))
     , nFlags                 (std::move(map.nFlags))
     , RECORD_MUTEX           (map.RECORD_MUTEX.size())
+    , pProbes                (map.pProbes)
     {
         Initialize();
     }
@@ -88,6 +123,7 @@ namespace LLD
         HASHMAP_MAX_KEY_SIZE   = map.HASHMAP_MAX_KEY_SIZE;
         HASHMAP_KEY_ALLOCATION = map.HASHMAP_KEY_ALLOCATION;
         nFlags                 = map.nFlags;
+        pProbes                = map.pProbes;
 
         Initialize();
 
@@ -106,6 +142,7 @@ namespace LLD
         HASHMAP_MAX_KEY_SIZE   = std::move(map.HASHMAP_MAX_KEY_SIZE);
         HASHMAP_KEY_ALLOCATION = std::move(map.HASHMAP_KEY_ALLOCATION);
         nFlags                 = std::move(map.nFlags);
+        pProbes                = map.pProbes;
 
         Initialize();
 
@@ -121,6 +158,27 @@ namespace LLD
 
         if(pindex)
             delete pindex;
+
+        /* Save the filters that changed or whose files did, so they don't need to be rebuilt on next start. */
+        for(uint32_t nFile = 0; nFile < vFilters.size(); ++nFile)
+        {
+            if(!vFilters[nFile])
+                continue;
+
+            const uint64_t nValidator = FilterValidator(nFile);
+            if(vFiltersDirty[nFile] || nValidator != vFilterValidators[nFile])
+                vFilters[nFile]->Save(debug::safe_printstr(strBaseLocation, "_filter.", std::setfill('0'), std::setw(5), nFile), nValidator);
+
+            delete vFilters[nFile];
+        }
+
+        /* Release the hashmap file mappings. */
+        for(auto& pmap : vMaps)
+            delete pmap;
+
+        /* Release the lists published for reads. */
+        for(auto& plist : vFileLists)
+            delete plist;
     }
 
 
@@ -202,6 +260,19 @@ namespace LLD
             debug::log(0, FUNCTION, "Loaded Disk Index of ", vIndex.size(), " bytes and ", nTotalKeys, " keys");
         }
 
+        /* Clear any filters from a previous initialization. */
+        for(auto& pfilter : vFilters)
+            delete pfilter;
+
+        vFilters.clear();
+        vFiltersDirty.clear();
+        vFilterValidators.clear();
+
+        /* Load the filters for every hashmap file in use. */
+        uint16_t nFiles = std::max(uint16_t(1), *std::max_element(hashmap.begin(), hashmap.end()));
+        for(uint16_t nFile = 0; nFile < nFiles; ++nFile)
+            LoadFilter(nFile);
+
         /* Build the first hashmap index file if it doesn't exist. */
         std::string file = debug::safe_printstr(strBaseLocation, "_hashmap.", std::setfill('0'), std::setw(5), 0u);
         if(!filesystem::exists(file))
@@ -218,6 +289,16 @@ namespace LLD
             debug::log(0, FUNCTION, "Generated Disk Hash Map 0 of ", vSpace.size(), " bytes");
         }
 
+        /* Clear any mappings from a previous initialization. */
+        for(auto& pmap : vMaps)
+            delete pmap;
+
+        vMaps.clear();
+
+        /* Map every hashmap file in use for reads. */
+        for(uint16_t nFile = 0; nFile < nFiles; ++nFile)
+            MapFile(nFile);
+
         /* Create the stream index object. */
         pindex = new std::fstream(index, std::ios::in | std::ios::out | std::ios::binary);
 
@@ -226,14 +307,322 @@ namespace LLD
     }
 
 
+    /* Load the bloom filter for a hashmap file. */
+    void BinaryHashMap::LoadFilter(const uint16_t nFile, const bool fCreated)
+    {
+        /* Create the filter with one byte per bucket. */
+        BloomFilter* pfilter = new BloomFilter(uint64_t(HASHMAP_TOTAL_BUCKETS) * 8);
+
+        /* Add the filter to the list. */
+        if(vFilters.size() <= nFile)
+        {
+            vFilters.resize(nFile + 1, nullptr);
+            vFiltersDirty.resize(nFile + 1, false);
+            vFilterValidators.resize(nFile + 1, 0);
+        }
+
+        vFilters[nFile] = pfilter;
+        Publish();
+
+        /* A new hashmap file has no keys to read. */
+        if(fCreated)
+        {
+            vFiltersDirty[nFile] = true;
+            return;
+        }
+
+        /* Check for the filter on disk, saved for the hashmap file as it is now. */
+        vFilterValidators[nFile] = FilterValidator(nFile);
+        if(pfilter->Load(debug::safe_printstr(strBaseLocation, "_filter.", std::setfill('0'), std::setw(5), nFile), vFilterValidators[nFile]))
+            return;
+
+        /* Open the hashmap file to rebuild the filter from. */
+        std::ifstream stream(debug::safe_printstr(strBaseLocation, "_hashmap.", std::setfill('0'), std::setw(5), nFile), std::ios::in | std::ios::binary);
+        if(!stream)
+            return;
+
+        /* Read the hashmap file sequentially in chunks of buckets. */
+        uint32_t nTotalKeys = 0;
+        std::vector<uint8_t> vBuffer(HASHMAP_KEY_ALLOCATION * 65536);
+        while(stream)
+        {
+            stream.read((char*)&vBuffer[0], vBuffer.size());
+
+            /* Add every key that is not empty. */
+            const uint64_t nRead = stream.gcount();
+            for(uint64_t nPos = 0; nPos + HASHMAP_KEY_ALLOCATION <= nRead; nPos += HASHMAP_KEY_ALLOCATION)
+            {
+                /* Skip over empty buckets. */
+                if(vBuffer[nPos] == STATE::EMPTY)
+                    continue;
+
+                /* Get the key length, compressed the same way as CompressKey. */
+                const uint64_t nLength = CompressedLength(vBuffer[nPos + 1] | (vBuffer[nPos + 2] << 8), HASHMAP_MAX_KEY_SIZE);
+
+                /* Add the compressed key to the filter. */
+                pfilter->Insert(&vBuffer[nPos + 13], nLength);
+                ++nTotalKeys;
+            }
+        }
+
+        /* Save the rebuilt filter. */
+        vFiltersDirty[nFile] = true;
+
+        /* Debug output showing rebuilding of the filter. */
+        if(nTotalKeys > 0)
+            debug::log(0, FUNCTION, "Rebuilt Filter ", nFile, " with ", nTotalKeys, " keys");
+    }
+
+
+    /* Get the state of a hashmap file that its saved filter is checked against. */
+    uint64_t BinaryHashMap::FilterValidator(const uint16_t nFile) const
+    {
+        /* A key added past the last file of its bucket moves the bucket to this file. */
+        uint64_t vState[4] = { 0, 0, 0, 0 };
+        for(const auto& nFiles : hashmap)
+        {
+            if(nFiles > nFile)
+                ++vState[0];
+        }
+
+        /* A key written into a slot the bucket has already changes the file. */
+        struct stat statbuf;
+        if(stat(debug::safe_printstr(strBaseLocation, "_hashmap.", std::setfill('0'), std::setw(5), nFile).c_str(), &statbuf) == 0)
+        {
+            vState[1] = static_cast<uint64_t>(statbuf.st_size);
+            vState[2] = static_cast<uint64_t>(statbuf.st_mtime);
+#ifdef __linux__
+            vState[3] = static_cast<uint64_t>(statbuf.st_mtim.tv_nsec);
+#endif
+        }
+
+        return XXH64(vState, sizeof(vState), 0);
+    }
+
+
+    /* Add a key to the bloom filter of a hashmap file. */
+    void BinaryHashMap::InsertFilter(const uint16_t nFile, const std::vector<uint8_t>& vKeyCompressed)
+    {
+        LOCK(FILE_MUTEX);
+
+        /* Create the filter if this is a new hashmap file. */
+        if(vFilters.size() <= nFile || vFilters[nFile] == nullptr)
+            LoadFilter(nFile);
+
+        /* Remove the saved filter on first change, so a crash triggers a rebuild. */
+        if(!vFiltersDirty[nFile])
+        {
+            filesystem::remove(debug::safe_printstr(strBaseLocation, "_filter.", std::setfill('0'), std::setw(5), nFile));
+            vFiltersDirty[nFile] = true;
+        }
+
+        vFilters[nFile]->Insert(vKeyCompressed);
+    }
+
+
+    /* Check the bloom filter of a hashmap file for a key. */
+    bool BinaryHashMap::CheckFilter(const uint16_t nFile, const std::vector<uint8_t>& vKeyCompressed)
+    {
+        /* Get the filter from the published list, filters are not freed until the hashmap is destroyed. */
+        BloomFilter* pfilter = nullptr;
+
+        const FileList* plist = pFiles.load();
+        if(plist && nFile < plist->vFilters.size())
+            pfilter = plist->vFilters[nFile];
+
+        /* Files without a filter always need to be read. */
+        if(!pfilter)
+            return true;
+
+        return pfilter->Has(vKeyCompressed);
+    }
+
+
+    /* Get the file stream of a hashmap file from the LRU, opening it if needed. */
+    std::fstream* BinaryHashMap::GetStream(const uint16_t nFile)
+    {
+        /* Find the file stream for LRU cache. */
+        std::fstream* pstream;
+        if(!fileCache->Get(nFile, pstream))
+        {
+            std::string filename = debug::safe_printstr(strBaseLocation, "_hashmap.", std::setfill('0'), std::setw(5), nFile);
+
+            /* Set the new stream pointer. */
+            pstream = new std::fstream(filename, std::ios::in | std::ios::out | std::ios::binary);
+            if(!pstream->is_open())
+            {
+                delete pstream;
+
+                debug::error(FUNCTION, "couldn't create hashmap object at: ", filename, " (", strerror(errno), ")");
+                return nullptr;
+            }
+
+            /* If file not found add to LRU cache. */
+            fileCache->Put(nFile, pstream);
+        }
+
+        return pstream;
+    }
+
+
+    /* Map a hashmap file into memory. */
+    void BinaryHashMap::MapFile(const uint16_t nFile)
+    {
+        /* Make room for the new file. */
+        if(vMaps.size() <= nFile)
+            vMaps.resize(nFile + 1, nullptr);
+
+        /* Check if the file is already mapped. */
+        if(vMaps[nFile])
+            return;
+
+        vMaps[nFile] = new MemoryMap(debug::safe_printstr(strBaseLocation, "_hashmap.", std::setfill('0'), std::setw(5), nFile));
+        Publish();
+    }
+
+
+    /* Publish the current filters and mappings for reads without the file lock. */
+    void BinaryHashMap::Publish()
+    {
+        FileList* plist = new FileList();
+        plist->vFilters = vFilters;
+        plist->vMaps    = vMaps;
+
+        vFileLists.push_back(plist);
+        pFiles.store(plist);
+    }
+
+
+    /* Read a bucket from a hashmap file. */
+    bool BinaryHashMap::ReadBucket(const uint16_t nFile, const uint32_t nBucket, std::vector<uint8_t>& vBucket)
+    {
+        /* Get the file binary position. */
+        const uint64_t nFilePos = uint64_t(nBucket) * HASHMAP_KEY_ALLOCATION;
+
+        /* Get the mapping from the published list, mappings are not freed until the hashmap is destroyed. */
+        MemoryMap* pmap = nullptr;
+
+        const FileList* plist = pFiles.load();
+        if(plist && nFile < plist->vMaps.size())
+            pmap = plist->vMaps[nFile];
+
+        /* Read from the mapping without holding the file lock. */
+        if(pmap && pmap->Read(nFilePos, vBucket))
+            return true;
+
+        /* Fall back to the file stream when the file isn't mapped. */
+        LOCK(FILE_MUTEX);
+
+        std::fstream* pstream = GetStream(nFile);
+        if(!pstream)
+            return false;
+
+        /* Seek to the hashmap index in file. */
+        pstream->seekg(nFilePos, std::ios::beg);
+
+        /* Read the bucket binary data from file stream */
+        if(!pstream->read((char*) &vBucket[0], vBucket.size()))
+        {
+            pstream->clear();
+            return false;
+        }
+
+        return true;
+    }
+
+
+    /* Read every layer of a bucket and find its live keys. */
+    bool BinaryHashMap::ReadLive(const uint32_t nBucket, std::vector< std::vector<uint8_t> >& vSlots,
+                                 std::vector<bool>& vLive, std::vector<SectorKey>& vKeys)
+    {
+        /* Read every layer of the bucket. */
+        const uint16_t nLayers = hashmap[nBucket];
+        vSlots.assign(nLayers, std::vector<uint8_t>(HASHMAP_KEY_ALLOCATION, 0));
+        for(uint16_t i = 0; i < nLayers; ++i)
+        {
+            if(!ReadBucket(i, nBucket, vSlots[i]))
+                return debug::error(FUNCTION, "failed to read bucket ", nBucket, " from hashmap ", i);
+        }
+
+        /* Find the live slots, a key is live in the highest layer it is ready in since lookups go top down. */
+        vLive.assign(nLayers, false);
+        std::set< std::vector<uint8_t> > setSeen;
+        for(int32_t i = nLayers - 1; i >= 0; --i)
+        {
+            const std::vector<uint8_t>& vSlot = vSlots[i];
+
+            /* Skip over empty slots. */
+            if(vSlot[0] == STATE::EMPTY)
+                continue;
+
+            /* Get the compressed key of the slot. */
+            const uint64_t nLength = CompressedLength(vSlot[1] | (vSlot[2] << 8), HASHMAP_MAX_KEY_SIZE);
+            std::vector<uint8_t> vKeyCompressed(vSlot.begin() + 13, vSlot.begin() + 13 + nLength);
+
+            /* Older copies of a key are stale. */
+            if(vSlot[0] == STATE::READY && !setSeen.insert(vKeyCompressed).second)
+                continue;
+
+            vLive[i] = true;
+
+            /* Add to the live keys. */
+            DataStream ssKey(vSlot, SER_LLD, DATABASE_VERSION);
+            SectorKey cKey;
+            ssKey >> cKey;
+
+            cKey.vKey = vKeyCompressed;
+            vKeys.push_back(cKey);
+        }
+
+        return true;
+    }
+
+
+    /* Write data to the start of a bucket in a hashmap file. */
+    bool BinaryHashMap::WriteBucket(const uint16_t nFile, const uint32_t nBucket, const std::vector<uint8_t>& vData)
+    {
+        LOCK(FILE_MUTEX);
+
+        std::fstream* pstream = GetStream(nFile);
+        if(!pstream)
+            return false;
+
+        /* Handle the disk writing operations. */
+        pstream->seekp(uint64_t(nBucket) * HASHMAP_KEY_ALLOCATION, std::ios::beg);
+        pstream->write((char*)&vData[0], vData.size());
+        pstream->flush();
+
+        return true;
+    }
+
+
+    /* Write the layer count of a bucket to the disk index. */
+    void BinaryHashMap::WriteIndex(const uint32_t nBucket)
+    {
+        LOCK(FILE_MUTEX);
+
+        /* Seek to the index position. */
+        pindex->seekp((nBucket * 2), std::ios::beg);
+
+        /* Get the bucket data. */
+        const uint16_t nIndex = hashmap[nBucket];
+        std::vector<uint8_t> vBucket((uint8_t*)&nIndex, (uint8_t*)&nIndex + 2);
+
+        /* Write the index into hashmap. */
+        pindex->write((char*)&vBucket[0], vBucket.size());
+        pindex->flush();
+    }
+
+
     /* Read a key index from the disk hashmaps. */
     bool BinaryHashMap::Get(const std::vector<uint8_t>& vKey, SectorKey &cKey)
     {
-        LOCK(KEY_MUTEX);
-
         /* Get the assigned bucket for the hashmap. */
         uint32_t nBucket = GetBucket(vKey);
 
+        /* Lock the stripe this bucket belongs to. */
+        LOCK(RECORD_MUTEX[nBucket % RECORD_MUTEX.size()]);
+
         /* Get the file binary position. */
         uint32_t nFilePos = nBucket * HASHMAP_KEY_ALLOCATION;
 
@@ -246,31 +635,17 @@ namespace LLD
 
         /* Reverse iterate the linked file list from hashmap to get most recent keys first. */
         std::vector<uint8_t> vBucket(HASHMAP_KEY_ALLOCATION, 0);
+        uint32_t nProbes = 0;
         for(int16_t i = hashmap[nBucket] - 1; i >= 0; --i)
         {
-            /* Find the file stream for LRU cache. */
-            std::fstream *pstream;
-            if(!fileCache->Get(i, pstream))
-            {
-                /* Set the new stream pointer. */
-                std::string filename = debug::safe_printstr(strBaseLocation, "_hashmap.", std::setfill('0'), std::setw(5), i);
+            /* Skip files that the filter says don't have the key. */
+            if(!CheckFilter(i, vKeyCompressed))
+                continue;
 
-                pstream = new std::fstream(filename, std::ios::in | std::ios::out | std::ios::binary);
-                if(!pstream->is_open())
-                {
-                    delete pstream;
-                    continue;
-                }
-
-                /* If file not found add to LRU cache. */
-                fileCache->Put(i, pstream);
-            }
-
-            /* Seek to the hashmap index in file. */
-            pstream->seekg(nFilePos, std::ios::beg);
-
-            /* Read the bucket binary data from file stream */
-            pstream->read((char*) &vBucket[0], vBucket.size());
+            /* Read the bucket binary data from the file. */
+            ++nProbes;
+            if(!ReadBucket(i, nBucket, vBucket))
+                continue;
 
             /* Check if this bucket has the key */
             if(std::equal(vBucket.begin() + 13, vBucket.begin() + 13 + vKeyCompressed.size(), vKeyCompressed.begin()))
@@ -295,21 +670,57 @@ namespace LLD
                         " | Sector Start: ", cKey.nSectorStart, "\n",
                         HexStr(vKeyCompressed.begin(), vKeyCompressed.end(), true));
 
+                if(pProbes)
+                    pProbes->Record(nProbes);
+
                 return true;
             }
         }
 
+        if(pProbes)
+            pProbes->Record(nProbes);
+
         return false;
     }
 
 
+    /* Add the probe depth of each Get to a database's metrics. */
+    void BinaryHashMap::Instrument(Metrics& metrics)
+    {
+        pProbes = metrics.Distribution("keychain_probes", "Hashmap buckets read by each keychain lookup.");
+    }
+
+
     /* Write a key to the disk hashmaps. */
     bool BinaryHashMap::Put(const SectorKey& cKey)
     {
-        LOCK(KEY_MUTEX);
-
         /* Get the assigned bucket for the hashmap. */
-        uint32_t nBucket = GetBucket(cKey.vKey);
+        const uint32_t nBucket = GetBucket(cKey.vKey);
+
+        return WriteKey(nBucket, cKey);
+    }
+
+
+    /* Write a key as read by CompactBucket into the same bucket. */
+    bool BinaryHashMap::PutBucket(const uint32_t nBucket, const uint32_t nTotal, const SectorKey& cKey)
+    {
+        /* A key read from a keychain with as many buckets goes in the bucket it came from. */
+        if(nTotal == HASHMAP_TOTAL_BUCKETS && nBucket < HASHMAP_TOTAL_BUCKETS)
+            return WriteKey(nBucket, cKey);
+
+        /* Otherwise the key has to be whole to be hashed again. */
+        if(cKey.nLength != cKey.vKey.size())
+            return debug::error(FUNCTION, "compressed key needs ", nTotal, " buckets, keychain has ", HASHMAP_TOTAL_BUCKETS);
+
+        return Put(cKey);
+    }
+
+
+    /* Write a key into a bucket of the disk hashmaps. */
+    bool BinaryHashMap::WriteKey(const uint32_t nBucket, const SectorKey& cKey)
+    {
+        /* Lock the stripe this bucket belongs to. */
+        LOCK(RECORD_MUTEX[nBucket % RECORD_MUTEX.size()]);
 
         /* Get the file binary position. */
         uint32_t nFilePos = nBucket * HASHMAP_KEY_ALLOCATION;
@@ -325,34 +736,16 @@ namespace LLD
             std::vector<uint8_t> vBucket(HASHMAP_KEY_ALLOCATION, 0);
             for(int16_t i = hashmap[nBucket] - 1; i >= 0; --i)
             {
-                /* Find the file stream for LRU cache. */
-                std::fstream* pstream;
-                if(!fileCache->Get(i, pstream))
-                {
-                    std::string filename = debug::safe_printstr(strBaseLocation, "_hashmap.", std::setfill('0'), std::setw(5), i);
-
-                    /* Set the new stream pointer. */
-                    pstream = new std::fstream(filename, std::ios::in | std::ios::out | std::ios::binary);
-                    if(!pstream->is_open())
-                    {
-                        delete pstream;
-                        return debug::error(FUNCTION, "couldn't create hashmap object at: ",
-                            filename, " (", strerror(errno), ")");
-                    }
-
-                    /* If file not found add to LRU cache. */
-                    fileCache->Put(i, pstream);
-                }
-
-                /* Seek to the hashmap index in file. */
-                pstream->seekg (nFilePos, std::ios::beg);
-
-                /* Read the bucket binary data from file stream */
-                pstream->read((char*) &vBucket[0], vBucket.size());
+                /* Read the bucket binary data from the file. */
+                if(!ReadBucket(i, nBucket, vBucket))
+                    return debug::error(FUNCTION, "failed to read bucket ", nBucket, " from hashmap ", i);
 
                 /* Check if this bucket has the key or is in an empty state. */
                 if(vBucket[0] == STATE::EMPTY || std::equal(vBucket.begin() + 13, vBucket.begin() + 13 + vKeyCompressed.size(), vKeyCompressed.begin()))
                 {
+                    /* Add the key to the filter before it reaches disk. */
+                    InsertFilter(i, vKeyCompressed);
+
                     /* Serialize the key and return if found. */
                     DataStream ssKey(SER_LLD, DATABASE_VERSION);
                     ssKey << cKey;
@@ -360,31 +753,9 @@ namespace LLD
                     /* Serialize the key into the end of the vector. */
                     ssKey.write((char*)&vKeyCompressed[0], vKeyCompressed.size());
 
-                    /* Find the file stream for LRU cache. */
-                    std::fstream* pstream;
-                    if(!fileCache->Get(i, pstream))
-                    {
-                        std::string filename = debug::safe_printstr(strBaseLocation, "_hashmap.", std::setfill('0'), std::setw(5), i);
-
-                        /* Set the new stream pointer. */
-                        pstream = new std::fstream(filename, std::ios::in | std::ios::out | std::ios::binary);
-                        if(!pstream->is_open())
-                        {
-                            delete pstream;
-                            return debug::error(FUNCTION, "couldn't create hashmap object at: ",
-                                filename, " (", strerror(errno), ")");
-                        }
-
-                        /* If file not found add to LRU cache. */
-                        fileCache->Put(i, pstream);
-                    }
-
-
                     /* Handle the disk writing operations. */
-                    pstream->seekp (nFilePos, std::ios::beg);
-                    pstream->write((char*)&ssKey.Bytes()[0], ssKey.size());
-                    pstream->flush();
-
+                    if(!WriteBucket(i, nBucket, ssKey.Bytes()))
+                        return false;
 
                     /* Debug Output of Sector Key Information. */
                     if(config::nVerbose >= 4)
@@ -404,24 +775,38 @@ namespace LLD
         }
 
         /* Create a new disk hashmap object in linked list if it doesn't exist. */
-        std::string file = debug::safe_printstr(strBaseLocation, "_hashmap.", std::setfill('0'), std::setw(5), hashmap[nBucket]);
-        if(!filesystem::exists(file))
         {
-            /* Blank vector to write empty space in new disk file. */
-            std::vector<uint8_t> vSpace(HASHMAP_KEY_ALLOCATION, 0);
+            LOCK(FILE_MUTEX);
 
-            /* Write the blank data to the new file handle. */
-            std::ofstream stream(file, std::ios::out | std::ios::binary | std::ios::app);
-            if(!stream)
-                return debug::error(FUNCTION, strerror(errno));
+            std::string file = debug::safe_printstr(strBaseLocation, "_hashmap.", std::setfill('0'), std::setw(5), hashmap[nBucket]);
+            if(!filesystem::exists(file))
+            {
+                /* Start the filter of the new file empty rather than reading it back. */
+                if(vFilters.size() <= hashmap[nBucket] || vFilters[hashmap[nBucket]] == nullptr)
+                    LoadFilter(hashmap[nBucket], true);
 
-            for(uint32_t i = 0; i < HASHMAP_TOTAL_BUCKETS; ++i)
-                stream.write((char*)&vSpace[0], vSpace.size());
+                /* Blank vector to write empty space in new disk file. */
+                std::vector<uint8_t> vSpace(HASHMAP_KEY_ALLOCATION, 0);
 
-            //stream.flush();
-            stream.close();
+                /* Write the blank data to the new file handle. */
+                std::ofstream stream(file, std::ios::out | std::ios::binary | std::ios::app);
+                if(!stream)
+                    return debug::error(FUNCTION, strerror(errno));
+
+                for(uint32_t i = 0; i < HASHMAP_TOTAL_BUCKETS; ++i)
+                    stream.write((char*)&vSpace[0], vSpace.size());
+
+                //stream.flush();
+                stream.close();
+            }
+
+            /* Map the file now that it is at its full size. */
+            MapFile(hashmap[nBucket]);
         }
 
+        /* Add the key to the filter before it reaches disk. */
+        InsertFilter(hashmap[nBucket], vKeyCompressed);
+
         /* Read the State and Size of Sector Header. */
         DataStream ssKey(SER_LLD, DATABASE_VERSION);
         ssKey << cKey;
@@ -429,39 +814,13 @@ namespace LLD
         /* Serialize the key into the end of the vector. */
         ssKey.write((char*)&vKeyCompressed[0], vKeyCompressed.size());
 
-        /* Find the file stream for LRU cache. */
-        std::fstream* pstream;
-        if(!fileCache->Get(hashmap[nBucket], pstream))
-        {
-            /* Set the new stream pointer. */
-            pstream = new std::fstream(file, std::ios::in | std::ios::out | std::ios::binary);
-            if(!pstream->is_open())
-            {
-                delete pstream;
-                return debug::error(FUNCTION, "Failed to generate file object");
-            }
-
-            /* If not in cache, add to the LRU. */
-            fileCache->Put(hashmap[nBucket], pstream);
-        }
-
         /* Flush the key file to disk. */
-        pstream->seekp (nFilePos, std::ios::beg);
-        pstream->write((char*)&ssKey.Bytes()[0], ssKey.size());
-        pstream->flush();
-
-        /* Seek to the index position. */
-        pindex->seekp((nBucket * 2), std::ios::beg);
+        if(!WriteBucket(hashmap[nBucket], nBucket, ssKey.Bytes()))
+            return debug::error(FUNCTION, "Failed to generate file object");
 
         /* Write the index to disk. */
-        uint16_t nIndex = ++hashmap[nBucket];
-
-        /* Get the bucket data. */
-        std::vector<uint8_t> vBucket((uint8_t*)&nIndex, (uint8_t*)&nIndex + 2);
-
-        /* Write the index into hashmap. */
-        pindex->write((char*)&vBucket[0], vBucket.size());
-        pindex->flush();
+        ++hashmap[nBucket];
+        WriteIndex(nBucket);
 
         /* Debug Output of Sector Key Information. */
         if(config::nVerbose >= 4)
@@ -483,6 +842,8 @@ namespace LLD
     /* Flush all buffers to disk if using ACID transaction. */
     void BinaryHashMap::Flush()
     {
+        LOCK(FILE_MUTEX);
+
         /* Flush the index files. */
         pindex->flush();
 
@@ -503,11 +864,12 @@ namespace LLD
      *  TODO: This should be optimized further. */
     bool BinaryHashMap::Erase(const std::vector<uint8_t> &vKey)
     {
-        LOCK(KEY_MUTEX);
-
         /* Get the assigned bucket for the hashmap. */
         uint32_t nBucket = GetBucket(vKey);
 
+        /* Lock the stripe this bucket belongs to. */
+        LOCK(RECORD_MUTEX[nBucket % RECORD_MUTEX.size()]);
+
         /* Get the file binary position. */
         uint32_t nFilePos = nBucket * HASHMAP_KEY_ALLOCATION;
 
@@ -519,24 +881,13 @@ namespace LLD
         std::vector<uint8_t> vBucket(HASHMAP_KEY_ALLOCATION, 0);
         for(int16_t i = hashmap[nBucket] - 1; i >= 0; --i)
         {
-            /* Find the file stream for LRU cache. */
-            std::fstream* pstream;
-            if(!fileCache->Get(i, pstream))
-            {
-                /* Set the new stream pointer. */
-                pstream = new std::fstream(
-                  debug::safe_printstr(strBaseLocation, "_hashmap.", std::setfill('0'), std::setw(5), i),
-                  std::ios::in | std::ios::out | std::ios::binary);
-
-                /* If file not found add to LRU cache. */
-                fileCache->Put(i, pstream);
-            }
+            /* Skip files that the filter says don't have the key. */
+            if(!CheckFilter(i, vKeyCompressed))
+                continue;
 
-            /* Seek to the hashmap index in file. */
-            pstream->seekg (nFilePos, std::ios::beg);
-
-            /* Read the bucket binary data from file stream */
-            pstream->read((char*) &vBucket[0], vBucket.size());
+            /* Read the bucket binary data from the file. */
+            if(!ReadBucket(i, nBucket, vBucket))
+                continue;
 
             /* Check if this bucket has the key */
             if(std::equal(vBucket.begin() + 13, vBucket.begin() + 13 + vKeyCompressed.size(), vKeyCompressed.begin()))
@@ -546,13 +897,10 @@ namespace LLD
                 SectorKey cKey;
                 ssKey >> cKey;
 
-                /* Seek to the hashmap index in file. */
-                pstream->seekp (nFilePos, std::ios::beg);
-
-                /* Read the bucket binary data from file stream */
+                /* Write an empty bucket over the key. */
                 std::vector<uint8_t> vEmpty(HASHMAP_KEY_ALLOCATION, 0);
-                pstream->write((char*) &vEmpty[0], vEmpty.size());
-                pstream->flush();
+                if(!WriteBucket(i, nBucket, vEmpty))
+                    return false;
 
                 /* Debug Output of Sector Key Information. */
                 if(config::nVerbose >= 4)
@@ -577,11 +925,12 @@ namespace LLD
     /* Restore an index in the hashmap if it is found. */
     bool BinaryHashMap::Restore(const std::vector<uint8_t> &vKey)
     {
-        LOCK(KEY_MUTEX);
-
         /* Get the assigned bucket for the hashmap. */
         uint32_t nBucket = GetBucket(vKey);
 
+        /* Lock the stripe this bucket belongs to. */
+        LOCK(RECORD_MUTEX[nBucket % RECORD_MUTEX.size()]);
+
         /* Get the file binary position. */
         uint32_t nFilePos = nBucket * HASHMAP_KEY_ALLOCATION;
 
@@ -593,24 +942,13 @@ namespace LLD
         std::vector<uint8_t> vBucket(HASHMAP_KEY_ALLOCATION, 0);
         for(int16_t i = hashmap[nBucket] - 1; i >= 0; --i)
         {
-            /* Find the file stream for LRU cache. */
-            std::fstream* pstream;
-            if(!fileCache->Get(i, pstream))
-            {
-                /* Set the new stream pointer. */
-                pstream = new std::fstream(
-                  debug::safe_printstr(strBaseLocation, "_hashmap.", std::setfill('0'), std::setw(5), i),
-                  std::ios::in | std::ios::out | std::ios::binary);
+            /* Skip files that the filter says don't have the key. */
+            if(!CheckFilter(i, vKeyCompressed))
+                continue;
 
-                /* If file not found add to LRU cache. */
-                fileCache->Put(i, pstream);
-            }
-
-            /* Seek to the hashmap index in file. */
-            pstream->seekg (nFilePos, std::ios::beg);
-
-            /* Read the bucket binary data from file stream */
-            pstream->read((char*) &vBucket[0], vBucket.size());
+            /* Read the bucket binary data from the file. */
+            if(!ReadBucket(i, nBucket, vBucket))
+                continue;
 
             /* Check if this bucket has the key */
             if(std::equal(vBucket.begin() + 13, vBucket.begin() + 13 + vKeyCompressed.size(), vKeyCompressed.begin()))
@@ -624,13 +962,10 @@ namespace LLD
                 if(cKey.Ready())
                     return true;
 
-                /* Seek to the hashmap index in file. */
-                pstream->seekp (nFilePos, std::ios::beg);
-
-                /* Read the bucket binary data from file stream */
+                /* Write the ready state over the key state. */
                 std::vector<uint8_t> vReady(STATE::READY);
-                pstream->write((char*) &vReady[0], vReady.size());
-                pstream->flush();
+                if(!WriteBucket(i, nBucket, vReady))
+                    return false;
 
                 /* Debug Output of Sector Key Information. */
                 if(config::nVerbose >= 4)
@@ -650,4 +985,151 @@ namespace LLD
 
         return false;
     }
+
+
+    /* Get the total buckets of the hashmap. */
+    uint32_t BinaryHashMap::TotalBuckets() const
+    {
+        return HASHMAP_TOTAL_BUCKETS;
+    }
+
+
+    /* Get the number of hashmap files a lookup in a bucket may read. */
+    uint16_t BinaryHashMap::Depth(const uint32_t nBucket) const
+    {
+        LOCK(RECORD_MUTEX[nBucket % RECORD_MUTEX.size()]);
+
+        return hashmap[nBucket];
+    }
+
+
+    /* Read the live keys of a bucket without writing to the keychain. */
+    bool BinaryHashMap::ScanBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys)
+    {
+        /* Lock the stripe this bucket belongs to. */
+        LOCK(RECORD_MUTEX[nBucket % RECORD_MUTEX.size()]);
+
+        std::vector< std::vector<uint8_t> > vSlots;
+        std::vector<bool> vLive;
+        return ReadLive(nBucket, vSlots, vLive, vKeys);
+    }
+
+
+    /* Collapse the layers of a bucket. */
+    bool BinaryHashMap::CompactBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys)
+    {
+        /* Lock the stripe this bucket belongs to. */
+        LOCK(RECORD_MUTEX[nBucket % RECORD_MUTEX.size()]);
+
+        /* Read every layer of the bucket. */
+        std::vector< std::vector<uint8_t> > vSlots;
+        std::vector<bool> vLive;
+        if(!ReadLive(nBucket, vSlots, vLive, vKeys))
+            return false;
+
+        const uint16_t nLayers = static_cast<uint16_t>(vSlots.size());
+
+        /* Lookups pass over keys that aren't ready, so keep the whole bucket as it is. */
+        bool fCompact = true;
+        for(const auto& vSlot : vSlots)
+        {
+            if(vSlot[0] != STATE::EMPTY && vSlot[0] != STATE::READY)
+                fCompact = false;
+        }
+
+        /* Get the layers needed to hold the live keys. */
+        const uint16_t nLive = static_cast<uint16_t>(std::count(vLive.begin(), vLive.end(), true));
+        if(!fCompact || nLive == nLayers)
+            return true;
+
+        /* Clear the stale slots first, a newer copy of each is above it. */
+        const std::vector<uint8_t> vEmpty(HASHMAP_KEY_ALLOCATION, 0);
+        for(uint16_t i = 0; i < nLayers; ++i)
+        {
+            if(vLive[i] || vSlots[i][0] == STATE::EMPTY)
+                continue;
+
+            if(!WriteBucket(i, nBucket, vEmpty))
+                return false;
+
+            vSlots[i][0] = STATE::EMPTY;
+        }
+
+        /* Move the live keys above the new depth into the empty slots below it. */
+        uint16_t nEmpty = 0;
+        for(uint16_t i = nLive; i < nLayers; ++i)
+        {
+            if(!vLive[i])
+                continue;
+
+            /* Find the next empty slot below the new depth. */
+            while(vLive[nEmpty])
+                ++nEmpty;
+
+            /* Write the key to its new slot before clearing the old one. */
+            const uint64_t nLength = CompressedLength(vSlots[i][1] | (vSlots[i][2] << 8), HASHMAP_MAX_KEY_SIZE);
+            InsertFilter(nEmpty, std::vector<uint8_t>(vSlots[i].begin() + 13, vSlots[i].begin() + 13 + nLength));
+
+            if(!WriteBucket(nEmpty, nBucket, vSlots[i]))
+                return false;
+
+            if(!WriteBucket(i, nBucket, vEmpty))
+                return false;
+
+            vLive[nEmpty] = true;
+            vLive[i]      = false;
+        }
+
+        /* Lookups now stop at the new depth. */
+        hashmap[nBucket] = nLive;
+        WriteIndex(nBucket);
+
+        return true;
+    }
+
+
+    /* Point a key at a new sector location. */
+    bool BinaryHashMap::Relocate(const uint32_t nBucket, const SectorKey& cKey, const uint16_t nSectorFile, const uint32_t nSectorStart)
+    {
+        /* Lock the stripe this bucket belongs to. */
+        LOCK(RECORD_MUTEX[nBucket % RECORD_MUTEX.size()]);
+
+        /* Find the highest copy of the key, the one that lookups see. */
+        std::vector<uint8_t> vBucket(HASHMAP_KEY_ALLOCATION, 0);
+        for(int16_t i = hashmap[nBucket] - 1; i >= 0; --i)
+        {
+            /* Skip files that the filter says don't have the key. */
+            if(!CheckFilter(i, cKey.vKey))
+                continue;
+
+            /* Read the bucket binary data from the file. */
+            if(!ReadBucket(i, nBucket, vBucket))
+                continue;
+
+            /* Check if this bucket has the key. */
+            if(vBucket[0] != STATE::READY || !std::equal(cKey.vKey.begin(), cKey.vKey.end(), vBucket.begin() + 13))
+                continue;
+
+            /* Check the key wasn't updated since it was read. */
+            DataStream ssKey(vBucket, SER_LLD, DATABASE_VERSION);
+            SectorKey cCurrent;
+            ssKey >> cCurrent;
+
+            if(cCurrent.nSectorFile != cKey.nSectorFile || cCurrent.nSectorStart != cKey.nSectorStart
+            || cCurrent.nSectorSize != cKey.nSectorSize)
+                return true;
+
+            /* Write the new location over the key header, leaving the key itself. */
+            cCurrent.nSectorFile  = nSectorFile;
+            cCurrent.nSectorStart = nSectorStart;
+
+            DataStream ssHeader(SER_LLD, DATABASE_VERSION);
+            ssHeader << cCurrent;
+
+            return WriteBucket(i, nBucket, ssHeader.Bytes());
+        }
+
+        /* The key was erased since. */
+        return true;
+    }
 }
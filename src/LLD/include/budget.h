@@ -0,0 +1,221 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLD_INCLUDE_BUDGET_H
+#define NEXUS_LLD_INCLUDE_BUDGET_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace LLD
+{
+
+    /* The share of the budget moved between cache pools in one pass. */
+    const uint32_t CACHE_BUDGET_STEPS = 32;
+
+
+    /* The least memory the budget leaves a cache pool. */
+    const uint64_t MIN_CACHE_BUDGET_SIZE = 1024 * 1024; //1 MB Min Pool
+
+
+    /** CacheBudget
+     *
+     *  Shares one memory budget between the cache pools of every database.
+     *
+     *  Each pool starts at the size its database asked for and reports the
+     *  misses on keys it evicted recently. Those are the hits it would have
+     *  had with more memory, so per byte of the pool they are its marginal
+     *  hit rate. Every pass hands unused budget to the pool with the highest
+     *  rate, and once the budget is spent moves a step from the pool with the
+     *  lowest rate to the highest when it is at least twice as high.
+     *
+     **/
+    class CacheBudget
+    {
+        /** Pool
+         *
+         *  A cache pool sharing the budget.
+         *
+         **/
+        struct Pool
+        {
+            /** The name of the database. **/
+            std::string strName;
+
+            /** The memory the pool has now. **/
+            uint64_t nCapacity;
+
+            /** The least memory the pool is left with. **/
+            uint64_t nMinimum;
+
+            /** The misses on evicted keys at the last pass. **/
+            uint64_t nLastGhosts;
+
+            /** The misses on evicted keys since the last pass. **/
+            uint64_t nGhosts;
+
+            /** Sets the memory of the pool. **/
+            std::function<void(uint64_t)> fnResize;
+
+            /** Reads the misses on evicted keys. **/
+            std::function<uint64_t()> fnGhosts;
+
+
+            /** The misses on evicted keys since the last pass, per megabyte of the pool. **/
+            double Rate() const
+            {
+                return nGhosts * 1048576.0 / std::max(nCapacity, uint64_t(1));
+            }
+        };
+
+
+        /** Mutex for the pools. **/
+        mutable std::mutex MUTEX;
+
+
+        /** Condition to wake the rebalancer to stop. **/
+        std::condition_variable CONDITION;
+
+
+        /** The memory shared by the pools. **/
+        const uint64_t nBudget;
+
+
+        /** The seconds between passes, 0 to only rebalance when asked. **/
+        const uint32_t nInterval;
+
+
+        /** The pools, by the identifier they registered with. **/
+        std::map<uint32_t, Pool> mapPools;
+
+
+        /** The identifier of the next pool. **/
+        uint32_t nNextPool;
+
+
+        /** The bytes moved between pools. **/
+        uint64_t nMoved;
+
+
+        /** Flag to stop the rebalancer. **/
+        std::atomic<bool> fStop;
+
+
+        /** Thread running a pass every interval. **/
+        std::thread RebalanceThread;
+
+
+        /** Rebalancer
+         *
+         *  Run a pass every interval until stopped.
+         *
+         **/
+        void Rebalancer();
+
+
+        /** Move
+         *
+         *  Give memory to a pool, or take it if negative.
+         *
+         *  @param[in] pool The pool to resize.
+         *  @param[in] nBytes The bytes to add or remove.
+         *
+         **/
+        void Move(Pool& pool, const int64_t nBytes);
+
+
+    public:
+
+        /** Default Constructor. **/
+        CacheBudget() = delete;
+
+
+        /** Constructor. Starts the rebalancer if there is an interval.
+         *
+         *  @param[in] nBudgetIn The memory shared by the pools.
+         *  @param[in] nIntervalIn The seconds between passes, 0 to only rebalance when asked.
+         *
+         **/
+        CacheBudget(const uint64_t nBudgetIn, const uint32_t nIntervalIn);
+
+
+        /** Copy Constructor. **/
+        CacheBudget(const CacheBudget& budget)            = delete;
+
+
+        /** Copy Assignment. **/
+        CacheBudget& operator=(const CacheBudget& budget) = delete;
+
+
+        /** Default Destructor. Stops the rebalancer, the pools have to be removed first. **/
+        ~CacheBudget();
+
+
+        /** Register
+         *
+         *  Add a cache pool to share the budget.
+         *
+         *  @param[in] strName The name of the database.
+         *  @param[in] nCapacity The memory the pool starts with.
+         *  @param[in] fnResize Sets the memory of the pool, called under the budget lock.
+         *  @param[in] fnGhosts Reads the misses on evicted keys of the pool.
+         *
+         *  @return The identifier to remove the pool with.
+         *
+         **/
+        uint32_t Register(const std::string& strName, const uint64_t nCapacity,
+                          const std::function<void(uint64_t)>& fnResize, const std::function<uint64_t()>& fnGhosts);
+
+
+        /** Unregister
+         *
+         *  Remove a cache pool, its memory goes back to the budget. The pool is
+         *  never resized once this returns.
+         *
+         *  @param[in] nPool The identifier the pool registered with.
+         *
+         **/
+        void Unregister(const uint32_t nPool);
+
+
+        /** Rebalance
+         *
+         *  Run a pass, moving memory to the pool with the highest marginal hit rate.
+         *
+         **/
+        void Rebalance();
+
+
+        /** Budget
+         *
+         *  Get the memory shared by the pools.
+         *
+         **/
+        uint64_t Budget() const;
+    };
+
+
+    /** The budget shared by the databases, nullptr if each keeps its own size.
+     *  Set before the databases are built and deleted after they are gone. **/
+    extern CacheBudget* pCacheBudget;
+}
+
+#endif
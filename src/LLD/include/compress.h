@@ -0,0 +1,63 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLD_INCLUDE_COMPRESS_H
+#define NEXUS_LLD_INCLUDE_COMPRESS_H
+
+#include <cstdint>
+#include <vector>
+
+namespace LLD
+{
+
+    /** COMPRESSION
+     *
+     *  The first byte of a record in a compressed database.
+     *
+     **/
+    enum COMPRESSION
+    {
+        RAW           = 0,
+        LZ4           = 1
+    };
+
+
+    /** Compress
+     *
+     *  Encode a record for a compressed database. Records that LZ4 shrinks are
+     *  stored as the LZ4 byte, the original size as 4 bytes little endian, and
+     *  the LZ4 block. Anything else is stored as the RAW byte and the record.
+     *
+     *  @param[in] vData The record to encode.
+     *  @param[out] vCompressed The encoded record.
+     *
+     **/
+    void Compress(const std::vector<uint8_t>& vData, std::vector<uint8_t>& vCompressed);
+
+
+    /** Decompress
+     *
+     *  Decode a record of a compressed database.
+     *
+     *  @param[in] vCompressed The encoded record.
+     *  @param[out] vData The original record.
+     *
+     *  @return True if the record decoded, false if it is damaged.
+     *
+     **/
+    bool Decompress(const std::vector<uint8_t>& vCompressed, std::vector<uint8_t>& vData);
+
+}
+
+#endif
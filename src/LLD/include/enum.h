@@ -25,11 +25,14 @@ namespace LLD
      **/
     enum FLAGS
     {
+        CHECKSUM      = (1 << 0),
         APPEND        = (1 << 1),
         READONLY      = (1 << 2),
         CREATE        = (1 << 3),
         WRITE         = (1 << 4),
-        FORCE         = (1 << 5)
+        FORCE         = (1 << 5),
+        MAPPED        = (1 << 6),
+        COMPRESS      = (1 << 7)
     };
 
 
@@ -45,6 +48,20 @@ namespace LLD
         TRANSACTION     = 2
     };
 
+
+    /** BATCH
+     *
+     *  Entry types of a write batch.
+     *
+     **/
+    enum BATCH
+    {
+        RECORD        = 0,
+        KEYCHAIN      = 1,
+        ERASE         = 2,
+        INDEX         = 3
+    };
+
 }
 
 #endif
@@ -22,6 +22,7 @@ ________________________________________________________________________________
 #include <LLD/types/legacy.h>
 #include <LLD/types/trust.h>
 #include <LLD/types/contract.h>
+#include <LLD/types/event.h>
 
 namespace LLD
 {
@@ -36,13 +37,19 @@ namespace LLD
     extern TrustDB*      Trust;
     extern LegacyDB*     Legacy;
 
+    //for the optional ordered event index
+    extern EventDB*      Event;
+
 
     /** Initialize
      *
-     *  Initialize the global LLD instances.
+     *  Initialize the global LLD instances, then import or export them if asked to.
+     *  Shuts down once an export is written.
+     *
+     *  @return False if an import or export failed.
      *
      **/
-    void Initialize();
+    bool Initialize();
 
 
     /** Shutdown
@@ -53,6 +60,32 @@ namespace LLD
     void Shutdown();
 
 
+    /** Export
+     *
+     *  Write the chain databases to bulk files in a directory, one file per
+     *  database, for a new node to load with Import.
+     *
+     *  @param[in] strDir The directory to write the files to.
+     *
+     *  @return True if every database was exported.
+     *
+     **/
+    bool Export(const std::string& strDir);
+
+
+    /** Import
+     *
+     *  Load the chain databases from bulk files written by Export, in place
+     *  of connecting every block. The databases have to be empty.
+     *
+     *  @param[in] strDir The directory to read the files from.
+     *
+     *  @return True if every database was imported.
+     *
+     **/
+    bool Import(const std::string& strDir);
+
+
     /** TxnRecover
      *
      *  Check the transactions for recovery.
@@ -79,10 +112,14 @@ namespace LLD
 
     /** Txn Commit
      *
-     *  Global handler for all LLD instances.
+     *  Global handler for all LLD instances. If the write-ahead log can't
+     *  be written, the transaction is aborted and the node shuts down, as
+     *  the memory states committed with it can't be rolled back.
+     *
+     *  @return False if the transaction wasn't written to disk.
      *
      */
-    void TxnCommit(const uint8_t nFlags = 0);
+    bool TxnCommit(const uint8_t nFlags = 0);
 }
 
 #endif
@@ -0,0 +1,325 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLD_INCLUDE_METRICS_H
+#define NEXUS_LLD_INCLUDE_METRICS_H
+
+#include <Util/include/json.h>
+#include <Util/include/runtime.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace LLD
+{
+
+    /** Histogram
+     *
+     *  Lock free histogram of unsigned values, for latencies and probe depths.
+     *
+     *  Values are counted in log linear buckets, eight to each power of two,
+     *  so any quantile read back is within 12.5% of the recorded value.
+     *
+     **/
+    class Histogram
+    {
+    public:
+
+        /** The bits of each value below its highest bit that choose its bucket. **/
+        static const uint32_t SUB_BITS = 3;
+
+
+        /** The total buckets, enough for any 64-bit value. **/
+        static const uint32_t TOTAL_BUCKETS = (64 - SUB_BITS + 1) << SUB_BITS;
+
+
+    private:
+
+        /** The count of values in each bucket. **/
+        std::atomic<uint64_t> vBuckets[TOTAL_BUCKETS];
+
+
+        /** The count of all values. **/
+        std::atomic<uint64_t> nCount;
+
+
+        /** The sum of all values. **/
+        std::atomic<uint64_t> nSum;
+
+
+    public:
+
+        /** Default Constructor. **/
+        Histogram();
+
+
+        /** Copy Constructor. **/
+        Histogram(const Histogram& histogram)            = delete;
+
+
+        /** Copy Assignment. **/
+        Histogram& operator=(const Histogram& histogram) = delete;
+
+
+        /** Record
+         *
+         *  Count a value. Safe from any thread.
+         *
+         *  @param[in] nValue The value to count.
+         *
+         **/
+        void Record(const uint64_t nValue);
+
+
+        /** Count
+         *
+         *  Get the count of all values.
+         *
+         **/
+        uint64_t Count() const;
+
+
+        /** Sum
+         *
+         *  Get the sum of all values.
+         *
+         **/
+        uint64_t Sum() const;
+
+
+        /** Quantile
+         *
+         *  Get the value that the given share of values are at or below.
+         *
+         *  @param[in] dQuantile The share of values, from 0 to 1.
+         *
+         *  @return The upper bound of the bucket holding the quantile, 0 if empty.
+         *
+         **/
+        uint64_t Quantile(const double dQuantile) const;
+
+    };
+
+
+    /** LatencyTimer
+     *
+     *  Records the nanoseconds from its construction to its destruction, so
+     *  every return of a function is timed.
+     *
+     **/
+    class LatencyTimer
+    {
+        /** The histogram to record into. **/
+        Histogram* pHistogram;
+
+
+        /** The timer started on construction. **/
+        runtime::timer timer;
+
+
+    public:
+
+        /** Default Constructor. **/
+        LatencyTimer() = delete;
+
+
+        /** Constructor. Starts the timer.
+         *
+         *  @param[in] pHistogramIn The histogram to record into.
+         *
+         **/
+        LatencyTimer(Histogram* pHistogramIn)
+        : pHistogram (pHistogramIn)
+        , timer      ( )
+        {
+            timer.Start();
+        }
+
+
+        /** Default Destructor. Records the time elapsed. **/
+        ~LatencyTimer()
+        {
+            pHistogram->Record(timer.ElapsedNanoseconds());
+        }
+    };
+
+
+    /** Metrics
+     *
+     *  Registry of the counters, gauges and histograms of one database.
+     *
+     *  Counters and gauges are read through a function when the registry is
+     *  dumped, so the owner keeps updating its own atomics. Histograms are
+     *  owned by the registry. Every registry is listed globally for as long
+     *  as it exists, so all databases can be dumped at once.
+     *
+     **/
+    class Metrics
+    {
+        /** Mutex for the values of this registry. **/
+        mutable std::mutex MUTEX;
+
+
+        /** The name of the database, used as the database label. **/
+        std::string strName;
+
+
+        /** Value
+         *
+         *  A counter or gauge, read when dumped.
+         *
+         **/
+        struct Value
+        {
+            /** The description of the value. **/
+            std::string strHelp;
+
+            /** True for a gauge, false for a counter that only grows. **/
+            bool fGauge;
+
+            /** Reads the current value. **/
+            std::function<uint64_t()> fnValue;
+        };
+
+
+        /** Scaled
+         *
+         *  A histogram, with the scale from recorded to reported units.
+         *
+         **/
+        struct Scaled
+        {
+            /** The description of the histogram. **/
+            std::string strHelp;
+
+            /** The reported unit per recorded unit. **/
+            double dScale;
+
+            /** The histogram. **/
+            Histogram* pHistogram;
+        };
+
+
+        /** The counters and gauges, by key. **/
+        std::map<std::string, Value> mapValues;
+
+
+        /** The histograms, by key. **/
+        std::map<std::string, Scaled> mapHistograms;
+
+
+    public:
+
+        /** Default Constructor. **/
+        Metrics() = delete;
+
+
+        /** Constructor. Lists the registry globally.
+         *
+         *  @param[in] strNameIn The name of the database.
+         *
+         **/
+        Metrics(const std::string& strNameIn);
+
+
+        /** Copy Constructor. **/
+        Metrics(const Metrics& metrics)            = delete;
+
+
+        /** Copy Assignment. **/
+        Metrics& operator=(const Metrics& metrics) = delete;
+
+
+        /** Default Destructor. Removes the registry from the global list. **/
+        ~Metrics();
+
+
+        /** Counter
+         *
+         *  Add a value that only grows.
+         *
+         *  @param[in] strKey The key of the value, lower case with underscores.
+         *  @param[in] strHelp The description of the value.
+         *  @param[in] fnValue Reads the current value.
+         *
+         **/
+        void Counter(const std::string& strKey, const std::string& strHelp, const std::function<uint64_t()>& fnValue);
+
+
+        /** Gauge
+         *
+         *  Add a value that goes up and down.
+         *
+         *  @param[in] strKey The key of the value, lower case with underscores.
+         *  @param[in] strHelp The description of the value.
+         *  @param[in] fnValue Reads the current value.
+         *
+         **/
+        void Gauge(const std::string& strKey, const std::string& strHelp, const std::function<uint64_t()>& fnValue);
+
+
+        /** Distribution
+         *
+         *  Add a histogram, or get it if the key is already added.
+         *
+         *  @param[in] strKey The key of the histogram, lower case with underscores.
+         *  @param[in] strHelp The description of the histogram.
+         *  @param[in] dScale The reported unit per recorded unit, 1e-9 to report nanoseconds as seconds.
+         *
+         *  @return The histogram, owned by the registry.
+         *
+         **/
+        Histogram* Distribution(const std::string& strKey, const std::string& strHelp, const double dScale = 1.0);
+
+
+        /** Name
+         *
+         *  Get the name of the database.
+         *
+         **/
+        const std::string& Name() const;
+
+
+        /** ToJSON
+         *
+         *  Dump the values of this registry, with the count, sum, p50, p99 and p999 of each histogram.
+         *
+         **/
+        json::json ToJSON() const;
+
+
+        /** DumpJSON
+         *
+         *  Dump every registry, by database name.
+         *
+         **/
+        static json::json DumpJSON();
+
+
+        /** DumpPrometheus
+         *
+         *  Dump every registry in the Prometheus text format, with histograms as summaries.
+         *
+         **/
+        static std::string DumpPrometheus();
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,167 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#include <LLD/templates/journal.h>
+#include <LLD/include/version.h>
+#include <LLD/hash/xxh3.h>
+
+#include <Util/include/debug.h>
+#include <Util/include/mutex.h>
+#include <Util/include/runtime.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace LLD
+{
+
+    /* Constructor */
+    Journal::Journal(const std::string& strPathIn)
+    : MUTEX        ( )
+    , strPath      (strPathIn)
+    , ssGroup      (SER_LLD, DATABASE_VERSION)
+    , nSyncs       (0)
+    , metrics      ("journal")
+    , pSyncLatency (nullptr)
+    {
+        metrics.Counter("syncs_total", "Syncs of the write-ahead log to disk.", [this]{ return nSyncs.load(); });
+        pSyncLatency = metrics.Distribution("sync_seconds", "Time taken to write and sync a commit group.", 1e-9);
+    }
+
+
+    /* Add a database's transaction journal to the current group. */
+    void Journal::Append(const std::string& strName, const std::vector<uint8_t>& vJournal)
+    {
+        LOCK(MUTEX);
+
+        ssGroup << strName << vJournal;
+    }
+
+
+    /* Write the current group to the log with its commit marker, and sync it to disk. */
+    bool Journal::Commit()
+    {
+        LOCK(MUTEX);
+
+        /* Add the commit marker with a checksum of the group. */
+        const uint64_t nChecksum = XXH3_64bits((uint8_t*)ssGroup.data(), ssGroup.size());
+        ssGroup << std::string("commit") << nChecksum;
+
+        runtime::timer timer;
+        timer.Start();
+
+        /* Open the log, it only ever holds the group being committed. */
+        FILE* file = fopen(strPath.c_str(), "wb");
+        if(!file)
+        {
+            ssGroup.clear();
+            return debug::error(FUNCTION, "failed to open ", strPath, " (", strerror(errno), ")");
+        }
+
+        /* Write the whole group at once. */
+        const std::vector<uint8_t>& vBytes = ssGroup.Bytes();
+        bool fSuccess = (fwrite(&vBytes[0], 1, vBytes.size(), file) == vBytes.size() && fflush(file) == 0);
+
+        /* Sync the group to disk, this is the only sync for every database in the group. */
+    #ifdef WIN32
+        fSuccess = fSuccess && (_commit(_fileno(file)) == 0);
+    #else
+        fSuccess = fSuccess && (fsync(fileno(file)) == 0);
+    #endif
+
+        fclose(file);
+
+        ++nSyncs;
+        pSyncLatency->Record(timer.ElapsedNanoseconds());
+
+        /* Start the next group. */
+        ssGroup.clear();
+
+        if(!fSuccess)
+            return debug::error(FUNCTION, "failed to sync ", strPath, " (", strerror(errno), ")");
+
+        return true;
+    }
+
+
+    /* Read the committed group from the log, if there is one. */
+    bool Journal::Recover(std::map<std::string, std::vector<uint8_t>>& mapJournals)
+    {
+        LOCK(MUTEX);
+
+        /* Read the whole log. */
+        std::ifstream stream(strPath, std::ios::in | std::ios::binary);
+        if(!stream.is_open())
+            return false;
+
+        std::vector<uint8_t> vBuffer((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        if(vBuffer.empty())
+            return false;
+
+        debug::log(0, FUNCTION, "write-ahead log detected of ", vBuffer.size(), " bytes");
+
+        /* Read database journals until the commit marker. */
+        const DataStream ssLog(vBuffer, SER_LLD, DATABASE_VERSION);
+        try
+        {
+            while(!ssLog.End())
+            {
+                /* Get the binary position of this entry for the checksum. */
+                uint64_t nPos = ssLog.GetPos();
+
+                /* Read the database name. */
+                std::string strName;
+                ssLog >> strName;
+
+                /* Check the commit marker against the checksum of the group. */
+                if(strName == "commit")
+                {
+                    uint64_t nChecksum = 0;
+                    ssLog >> nChecksum;
+
+                    if(XXH3_64bits(&vBuffer[0], nPos) != nChecksum)
+                        return debug::error(FUNCTION, "write-ahead log checksum mismatch");
+
+                    return true;
+                }
+
+                /* Read the database journal. */
+                ssLog >> mapJournals[strName];
+            }
+        }
+        catch(const std::exception& e)
+        {
+            return debug::error(FUNCTION, "write-ahead log is incomplete: ", e.what());
+        }
+
+        return debug::error(FUNCTION, "write-ahead log never reached commit");
+    }
+
+
+    /* Empty the log once its group has been applied to the databases. */
+    void Journal::Clear()
+    {
+        LOCK(MUTEX);
+
+        std::ofstream stream(strPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        stream.close();
+    }
+}
@@ -17,8 +17,11 @@ ________________________________________________________________________________
 
 #include <LLD/keychain/keychain.h>
 #include <LLD/cache/template_lru.h>
+#include <LLD/templates/bloom.h>
+#include <LLD/templates/mmap.h>
 #include <LLD/include/enum.h>
 
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <fstream>
@@ -41,8 +44,8 @@ namespace LLD
     {
     protected:
 
-        /** Mutex for Thread Synchronization. **/
-        mutable std::mutex KEY_MUTEX;
+        /** Mutex for the file streams, index stream and file lists. **/
+        mutable std::mutex FILE_MUTEX;
 
 
         /** The string to hold the database location. **/
@@ -61,6 +64,43 @@ namespace LLD
         std::vector<uint16_t> hashmap;
 
 
+        /** Bloom filters of the keys held in each hashmap file. **/
+        std::vector<BloomFilter*> vFilters;
+
+
+        /** Flags for filters that have changed since they were saved to disk. **/
+        std::vector<bool> vFiltersDirty;
+
+
+        /** The state of each hashmap file its filter was loaded for. **/
+        std::vector<uint64_t> vFilterValidators;
+
+
+        /** Read only mappings of each hashmap file, for reads without the file lock. **/
+        std::vector<MemoryMap*> vMaps;
+
+
+        /** FileList
+         *
+         *  The filters and mappings of the hashmap files, published whole so
+         *  reads find them without taking the file lock.
+         *
+         **/
+        struct FileList
+        {
+            std::vector<BloomFilter*> vFilters;
+            std::vector<MemoryMap*>   vMaps;
+        };
+
+
+        /** The current filters and mappings, replaced each time a file is added. **/
+        std::atomic<const FileList*> pFiles;
+
+
+        /** Every list published, freed with the hashmap since a read may still be on an old one. **/
+        std::vector<const FileList*> vFileLists;
+
+
         /** The Maximum buckets allowed in the hashmap. */
         uint32_t HASHMAP_TOTAL_BUCKETS;
 
@@ -77,13 +117,26 @@ namespace LLD
         uint8_t nFlags;
 
 
-        /* The key level locking hashmap. */
+        /** Striped bucket locks, a bucket is guarded by RECORD_MUTEX[nBucket % size]. **/
         mutable std::vector<std::mutex> RECORD_MUTEX;
 
 
+        /** The buckets read by each Get, nullptr until instrumented. **/
+        Histogram* pProbes;
+
+
     public:
 
 
+        /** Name
+         *
+         *  Returns a string for the name of this type of keychain, as written
+         *  to bulk files. It must not change once keys are written with it.
+         *
+         **/
+        static std::string Name() { return "BinaryHashMap"; }
+
+
         /** Default Constructor. **/
         BinaryHashMap() = delete;
 
@@ -144,6 +197,160 @@ namespace LLD
         void Initialize();
 
 
+        /** LoadFilter
+         *
+         *  Load the bloom filter for a hashmap file, rebuilding it from the
+         *  hashmap file if it is missing on disk or was saved for the file as
+         *  it was before something else wrote to it.
+         *
+         *  @param[in] nFile The hashmap file to load filter for.
+         *  @param[in] fCreated True if the hashmap file was just created, so it has no keys to load.
+         *
+         **/
+        void LoadFilter(const uint16_t nFile, const bool fCreated = false);
+
+
+        /** FilterValidator
+         *
+         *  Get the state of a hashmap file that its saved filter is checked
+         *  against: the buckets reaching the file, and its size and time of
+         *  last change.
+         *
+         *  @param[in] nFile The hashmap file to get the state of.
+         *
+         *  @return The hash of the state of the file.
+         *
+         **/
+        uint64_t FilterValidator(const uint16_t nFile) const;
+
+
+        /** InsertFilter
+         *
+         *  Add a key to the bloom filter of a hashmap file. The filter on disk
+         *  is removed on first change so that it is rebuilt after a crash.
+         *
+         *  @param[in] nFile The hashmap file the key is written to.
+         *  @param[in] vKeyCompressed The compressed key to add.
+         *
+         **/
+        void InsertFilter(const uint16_t nFile, const std::vector<uint8_t>& vKeyCompressed);
+
+
+        /** CheckFilter
+         *
+         *  Check the bloom filter of a hashmap file for a key.
+         *
+         *  @param[in] nFile The hashmap file to check.
+         *  @param[in] vKeyCompressed The compressed key to check for.
+         *
+         *  @return False if the file definitely doesn't have the key.
+         *
+         **/
+        bool CheckFilter(const uint16_t nFile, const std::vector<uint8_t>& vKeyCompressed);
+
+
+        /** GetStream
+         *
+         *  Get the file stream of a hashmap file from the LRU, opening it if needed.
+         *  FILE_MUTEX must be held by the caller.
+         *
+         *  @param[in] nFile The hashmap file to get stream for.
+         *
+         *  @return The file stream, or nullptr if it failed to open.
+         *
+         **/
+        std::fstream* GetStream(const uint16_t nFile);
+
+
+        /** MapFile
+         *
+         *  Map a hashmap file into memory. Hashmap files never change size once
+         *  created, so the mapping is kept until the hashmap is destroyed.
+         *  FILE_MUTEX must be held by the caller.
+         *
+         *  @param[in] nFile The hashmap file to map.
+         *
+         **/
+        void MapFile(const uint16_t nFile);
+
+
+        /** Publish
+         *
+         *  Publish the current filters and mappings for reads without the
+         *  file lock. FILE_MUTEX must be held by the caller.
+         *
+         **/
+        void Publish();
+
+
+        /** ReadBucket
+         *
+         *  Read a bucket from a hashmap file. The bucket's RECORD_MUTEX must be held.
+         *
+         *  @param[in] nFile The hashmap file to read from.
+         *  @param[in] nBucket The bucket to read.
+         *  @param[out] vBucket The buffer to read into, sized to the key allocation.
+         *
+         *  @return True if the bucket was read.
+         *
+         **/
+        bool ReadBucket(const uint16_t nFile, const uint32_t nBucket, std::vector<uint8_t>& vBucket);
+
+
+        /** ReadLive
+         *
+         *  Read every layer of a bucket and find its live keys. The bucket's RECORD_MUTEX must be held.
+         *
+         *  @param[in] nBucket The bucket to read.
+         *  @param[out] vSlots The bucket as read from each hashmap file.
+         *  @param[out] vLive True for each layer holding a live key.
+         *  @param[out] vKeys The live keys of the bucket, with vKey set to the compressed key.
+         *
+         *  @return True if every layer was read.
+         *
+         **/
+        bool ReadLive(const uint32_t nBucket, std::vector< std::vector<uint8_t> >& vSlots,
+                      std::vector<bool>& vLive, std::vector<SectorKey>& vKeys);
+
+
+        /** WriteBucket
+         *
+         *  Write data to the start of a bucket in a hashmap file. The bucket's RECORD_MUTEX must be held.
+         *
+         *  @param[in] nFile The hashmap file to write to.
+         *  @param[in] nBucket The bucket to write.
+         *  @param[in] vData The data to write.
+         *
+         *  @return True if the bucket was written.
+         *
+         **/
+        bool WriteBucket(const uint16_t nFile, const uint32_t nBucket, const std::vector<uint8_t>& vData);
+
+
+        /** WriteKey
+         *
+         *  Write a key into a bucket of the disk hashmaps, over the key's last
+         *  slot or into the first empty one.
+         *
+         *  @param[in] nBucket The bucket to write the key to.
+         *  @param[in] cKey The key object to write.
+         *
+         *  @return True if the key was written, false otherwise.
+         *
+         **/
+        bool WriteKey(const uint32_t nBucket, const SectorKey& cKey);
+
+
+        /** WriteIndex
+         *
+         *  Write the layer count of a bucket to the disk index. The bucket's RECORD_MUTEX must be held.
+         *
+         *  @param[in] nBucket The bucket to write the index of.
+         *
+         **/
+        void WriteIndex(const uint32_t nBucket);
+
+
         /** Get
          *
          *  Read a key index from the disk hashmaps.
@@ -157,6 +364,16 @@ namespace LLD
         bool Get(const std::vector<uint8_t>& vKey, SectorKey &cKey);
 
 
+        /** Instrument
+         *
+         *  Add the probe depth of each Get to a database's metrics.
+         *
+         *  @param[in] metrics The metrics of the database the keychain belongs to.
+         *
+         **/
+        void Instrument(Metrics& metrics);
+
+
         /** Put
          *
          *  Write a key to the disk hashmaps.
@@ -169,6 +386,22 @@ namespace LLD
         bool Put(const SectorKey& cKey);
 
 
+        /** PutBucket
+         *
+         *  Write a key as read by CompactBucket into the same bucket. Keys longer
+         *  than the maximum are compressed, and their bucket can't be found from
+         *  them again, so they need a keychain with as many buckets.
+         *
+         *  @param[in] nBucket The bucket the key was read from.
+         *  @param[in] nTotal The buckets of the keychain it was read from.
+         *  @param[in] cKey The key object to write.
+         *
+         *  @return True if the key was written, false otherwise.
+         *
+         **/
+        bool PutBucket(const uint32_t nBucket, const uint32_t nTotal, const SectorKey& cKey);
+
+
         /** Flush
          *
          *  Flush all buffers to disk if using ACID transaction.
@@ -200,6 +433,70 @@ namespace LLD
          *
          **/
         bool Erase(const std::vector<uint8_t> &vKey);
+
+
+        /** TotalBuckets
+         *
+         *  Get the total buckets of the hashmap.
+         *
+         **/
+        uint32_t TotalBuckets() const;
+
+
+        /** Depth
+         *
+         *  Get the number of hashmap files a lookup in a bucket may read.
+         *
+         *  @param[in] nBucket The bucket to get depth of.
+         *
+         **/
+        uint16_t Depth(const uint32_t nBucket) const;
+
+
+        /** ScanBucket
+         *
+         *  Read the live keys of a bucket, as CompactBucket does, without writing to the keychain.
+         *
+         *  @param[in] nBucket The bucket to read.
+         *  @param[out] vKeys The live keys of the bucket, with vKey set to the compressed key.
+         *
+         *  @return True if the bucket was read.
+         *
+         **/
+        bool ScanBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys);
+
+
+        /** CompactBucket
+         *
+         *  Collapse the layers of a bucket. Stale copies of keys that are shadowed
+         *  by a newer copy are cleared, and the live keys are moved down into the
+         *  lowest hashmap files so that lookups read fewer files. Each key is
+         *  written to its new slot before its old slot is cleared, so a crash
+         *  at any point leaves every key readable.
+         *
+         *  @param[in] nBucket The bucket to compact.
+         *  @param[out] vKeys The live keys of the bucket, with vKey set to the compressed key.
+         *
+         *  @return True if the bucket was read and compacted.
+         *
+         **/
+        bool CompactBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys);
+
+
+        /** Relocate
+         *
+         *  Point a key at a new sector location, if it still points at the
+         *  location it had when it was read by CompactBucket.
+         *
+         *  @param[in] nBucket The bucket the key is in.
+         *  @param[in] cKey The key as read by CompactBucket.
+         *  @param[in] nSectorFile The sector file the record was moved to.
+         *  @param[in] nSectorStart The position in the sector file the record was moved to.
+         *
+         *  @return True if the key no longer points at its old location, false if it couldn't be written.
+         *
+         **/
+        bool Relocate(const uint32_t nBucket, const SectorKey& cKey, const uint16_t nSectorFile, const uint32_t nSectorStart);
     };
 }
 
@@ -16,6 +16,11 @@ ________________________________________________________________________________
 #define NEXUS_LLD_KEYCHAIN_KEYCHAIN_H
 
 #include <LLD/templates/key.h>
+#include <LLD/include/metrics.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
 
 namespace LLD
 {
@@ -89,6 +94,87 @@ namespace LLD
          *
          **/
         virtual bool Erase(const std::vector<uint8_t>& vKey) = 0;
+
+
+        /** Range
+         *
+         *  Read the keys from vBegin up to but not including vEnd, in key order.
+         *  Keychains that don't keep their keys in order have no ranges.
+         *
+         *  @param[in] vBegin The first key to read.
+         *  @param[in] vEnd The key to stop before, empty to read to the end.
+         *  @param[out] vKeys The keys read, with vKey set.
+         *  @param[in] nLimit The most keys to read.
+         *
+         *  @return True if any keys were read.
+         *
+         **/
+        virtual bool Range(const std::vector<uint8_t>& /*vBegin*/, const std::vector<uint8_t>& /*vEnd*/,
+                           std::vector<SectorKey>& /*vKeys*/, const uint32_t /*nLimit*/)
+        {
+            return false;
+        }
+
+
+        /** BatchGet
+         *
+         *  Read many keys from the keychain. Keychains that can look keys
+         *  up in parallel override this, the rest read them one at a time.
+         *
+         *  @param[in] vKeys The binary data of the keys.
+         *  @param[out] vSectors The keys found are added, with the index into vKeys of each.
+         *
+         *  @return The number of keys found.
+         *
+         **/
+        virtual uint32_t BatchGet(const std::vector< std::vector<uint8_t> >& vKeys,
+                                  std::vector< std::pair<SectorKey, uint32_t> >& vSectors)
+        {
+            uint32_t nFound = 0;
+            for(uint32_t n = 0; n < vKeys.size(); ++n)
+            {
+                SectorKey cKey;
+                if(!Get(vKeys[n], cKey))
+                    continue;
+
+                vSectors.push_back(std::make_pair(cKey, n));
+                ++nFound;
+            }
+
+            return nFound;
+        }
+
+
+        /** Instrument
+         *
+         *  Add the histograms of this keychain to a database's metrics.
+         *  Keychains with nothing to measure add nothing.
+         *
+         *  @param[in] metrics The metrics of the database the keychain belongs to.
+         *
+         **/
+        virtual void Instrument(Metrics& /*metrics*/)
+        {
+        }
+
+
+        /** PutBucket
+         *
+         *  Write a key as read by CompactBucket from another keychain of the
+         *  same type back into the bucket it was read from. Keychains that find
+         *  a key's bucket from the key they store write it as any other key.
+         *
+         *  @param[in] nBucket The bucket the key was read from.
+         *  @param[in] nTotal The buckets of the keychain it was read from.
+         *  @param[in] cKey The key object to write.
+         *
+         *  @return True if the key was written, false otherwise.
+         *
+         **/
+        virtual bool PutBucket(const uint32_t /*nBucket*/, const uint32_t /*nTotal*/, const SectorKey& cKey)
+        {
+            return Put(cKey);
+        }
     };
 }
 
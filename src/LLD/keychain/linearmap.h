@@ -0,0 +1,448 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLD_KEYCHAIN_LINEARMAP_H
+#define NEXUS_LLD_KEYCHAIN_LINEARMAP_H
+
+#include <LLD/keychain/keychain.h>
+#include <LLD/include/enum.h>
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace LLD
+{
+
+    /* The key slots in each bucket page. */
+    const uint32_t LINEARMAP_BUCKET_SLOTS = 8;
+
+
+    /* The largest key stored, longer keys are kept as their first bytes and a hash of the whole key. */
+    const uint32_t LINEARMAP_MAX_KEY_SIZE = 32;
+
+
+    /* The bytes of a key slot, the sector key header and the compressed key. */
+    const uint32_t LINEARMAP_SLOT_SIZE = 13 + LINEARMAP_MAX_KEY_SIZE;
+
+
+    /* The bytes of a bucket page, the next overflow page and the slots. */
+    const uint32_t LINEARMAP_PAGE_SIZE = 4 + LINEARMAP_BUCKET_SLOTS * LINEARMAP_SLOT_SIZE;
+
+
+    /* The share of slots in use before the next bucket is split. */
+    const uint32_t LINEARMAP_LOAD_PERCENT = 75;
+
+
+    /** BinaryLinearMap
+     *
+     *  This class is responsible for managing the keys to the sector database in a
+     *  linear hash table that grows one bucket at a time.
+     *
+     *  Each bucket is a page of a few key slots. When the keys pass the load factor,
+     *  the bucket at the split pointer is split in two: its keys are rehashed with
+     *  twice the table size, and the ones that move go to a new bucket page added at
+     *  the end of the file. The split pointer walks the table once per doubling, so
+     *  no bucket is ever more than one split behind and a lookup reads one page, or
+     *  one page and a short overflow chain for a bucket that is waiting its turn.
+     *
+     *  Overflow pages freed by splits and compaction are kept on a free list and
+     *  reused, so the files only grow with the keys they hold.
+     *
+     **/
+    class BinaryLinearMap : public Keychain
+    {
+    protected:
+
+        /** Mutex for the file streams, the overflow pages and the table metadata on disk. **/
+        mutable std::mutex FILE_MUTEX;
+
+
+        /** Mutex so only one bucket splits at a time. **/
+        std::mutex SPLIT_MUTEX;
+
+
+        /** Striped bucket locks, a bucket is guarded by RECORD_MUTEX[nBucket % size]. **/
+        mutable std::vector<std::mutex> RECORD_MUTEX;
+
+
+        /** The string to hold the database location. **/
+        std::string strBaseLocation;
+
+
+        /** The stream of the bucket pages, by bucket. **/
+        std::fstream* pPrimary;
+
+
+        /** The stream of the overflow pages. **/
+        std::fstream* pOverflow;
+
+
+        /** The stream of the table metadata. **/
+        std::fstream* pMeta;
+
+
+        /** The buckets of the table before its first split. **/
+        uint32_t nInitial;
+
+
+        /** The doublings of the table and the next bucket to split, as (level << 32) | split. **/
+        std::atomic<uint64_t> nTable;
+
+
+        /** The overflow pages allocated. **/
+        uint32_t nOverflow;
+
+
+        /** The first free overflow page plus one, 0 if none are free. **/
+        uint32_t nFreeHead;
+
+
+        /** The keys held, used for the load factor. **/
+        std::atomic<uint64_t> nKeys;
+
+
+        /** The keychain flags. **/
+        uint8_t nFlags;
+
+
+        /** The pages read by each Get, nullptr until instrumented. **/
+        Histogram* pProbes;
+
+
+    public:
+
+
+        /** Name
+         *
+         *  Returns a string for the name of this type of keychain, as written
+         *  to bulk files. It must not change once keys are written with it.
+         *
+         **/
+        static std::string Name() { return "BinaryLinearMap"; }
+
+
+        /** Default Constructor. **/
+        BinaryLinearMap() = delete;
+
+
+        /** The Database Constructor. The buckets before the first split hold about nBucketsIn keys. **/
+        BinaryLinearMap(const std::string& strBaseLocationIn, const uint8_t nFlagsIn = FLAGS::APPEND, const uint64_t nBucketsIn = 256 * 256 * 64);
+
+
+        /** Copy Constructor **/
+        BinaryLinearMap(const BinaryLinearMap& map) = delete;
+
+
+        /** Move Constructor **/
+        BinaryLinearMap(BinaryLinearMap&& map) = delete;
+
+
+        /** Copy Assignment Operator **/
+        BinaryLinearMap& operator=(const BinaryLinearMap& map) = delete;
+
+
+        /** Move Assignment Operator **/
+        BinaryLinearMap& operator=(BinaryLinearMap&& map) = delete;
+
+
+        /** Default Destructor **/
+        virtual ~BinaryLinearMap();
+
+
+        /** Initialize
+         *
+         *  Open the page files and load the table metadata, creating them if needed.
+         *
+         **/
+        void Initialize();
+
+
+        /** Get
+         *
+         *  Read a key from the keychain.
+         *
+         *  @param[in] vKey The binary data of key.
+         *  @param[out] cKey The key object to return.
+         *
+         *  @return True if the key was found, false otherwise.
+         *
+         **/
+        bool Get(const std::vector<uint8_t>& vKey, SectorKey &cKey);
+
+
+        /** Put
+         *
+         *  Write a key to the keychain, splitting the next bucket if the table is over its load factor.
+         *
+         *  @param[in] cKey The key object to write.
+         *
+         *  @return True if the key was written, false otherwise.
+         *
+         **/
+        bool Put(const SectorKey& cKey);
+
+
+        /** Flush
+         *
+         *  Flush the page files and the table metadata to disk.
+         *
+         **/
+        void Flush();
+
+
+        /** Restore
+         *
+         *  Restore an erased key from keychain, if its slot hasn't been reused.
+         *
+         *  @param[in] vKey the key to restore.
+         *
+         *  @return True if the key was restored.
+         *
+         **/
+        bool Restore(const std::vector<uint8_t>& vKey);
+
+
+        /** Erase
+         *
+         *  Erase a key from the keychain
+         *
+         *  @param[in] vKey the key to erase.
+         *
+         *  @return True if the key was erased, false otherwise.
+         *
+         **/
+        bool Erase(const std::vector<uint8_t>& vKey);
+
+
+        /** TotalBuckets
+         *
+         *  Get the total buckets of the table, which grows as buckets are split.
+         *
+         **/
+        uint32_t TotalBuckets() const;
+
+
+        /** Depth
+         *
+         *  Get the number of pages a lookup in a bucket may read.
+         *
+         *  @param[in] nBucket The bucket to get depth of.
+         *
+         **/
+        uint16_t Depth(const uint32_t nBucket) const;
+
+
+        /** ScanBucket
+         *
+         *  Read the keys of a bucket, as CompactBucket does, without writing to the keychain.
+         *
+         *  @param[in] nBucket The bucket to read.
+         *  @param[out] vKeys The keys of the bucket, with the compressed key as vKey.
+         *
+         *  @return True if the bucket was read.
+         *
+         **/
+        bool ScanBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys);
+
+
+        /** CompactBucket
+         *
+         *  Pack the keys of a bucket into the fewest pages, freeing the rest of its overflow chain.
+         *
+         *  @param[in] nBucket The bucket to compact.
+         *  @param[out] vKeys The keys of the bucket, with the compressed key as vKey.
+         *
+         *  @return True if the bucket was read.
+         *
+         **/
+        bool CompactBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys);
+
+
+        /** Relocate
+         *
+         *  Point a key at a new sector location, if it still points at the
+         *  location it had when it was read by CompactBucket. The key is found
+         *  by its hash, since its bucket may have split since it was read.
+         *
+         *  @param[in] nBucket The bucket the key was in.
+         *  @param[in] cKey The key as read by CompactBucket.
+         *  @param[in] nSectorFile The sector file the record was moved to.
+         *  @param[in] nSectorStart The position in the sector file the record was moved to.
+         *
+         *  @return True if the key no longer points at its old location, false if it couldn't be written.
+         *
+         **/
+        bool Relocate(const uint32_t nBucket, const SectorKey& cKey, const uint16_t nSectorFile, const uint32_t nSectorStart);
+
+
+        /** Instrument
+         *
+         *  Add the pages read by each Get to a database's metrics.
+         *
+         *  @param[in] metrics The metrics of the database the keychain belongs to.
+         *
+         **/
+        void Instrument(Metrics& metrics);
+
+
+    private:
+
+        /** Address
+         *
+         *  Get the bucket a key hash belongs to for a table state.
+         *
+         *  @param[in] nHash The hash of the compressed key.
+         *  @param[in] nState The table state, as (level << 32) | split.
+         *
+         **/
+        uint32_t Address(const uint64_t nHash, const uint64_t nState) const;
+
+
+        /** LockBucket
+         *
+         *  Find the bucket of a key hash and lock it, retrying if a split moves the key first.
+         *
+         *  @param[in] nHash The hash of the compressed key.
+         *  @param[out] nBucket The bucket locked.
+         *
+         *  @return The lock of the bucket.
+         *
+         **/
+        std::unique_lock<std::mutex> LockBucket(const uint64_t nHash, uint32_t &nBucket) const;
+
+
+        /** ReadChain
+         *
+         *  Read the pages of a bucket, stopping at the page a key is found in. A bucket's lock must be held.
+         *
+         *  @param[in] nBucket The bucket to read.
+         *  @param[out] vPages The pages read, the bucket page first.
+         *  @param[out] vChain The overflow page of each page after the first.
+         *  @param[in] vKeyCompressed Stop at the first page holding this key, empty to read every page.
+         *
+         *  @return True if every page needed was read.
+         *
+         **/
+        bool ReadChain(const uint32_t nBucket, std::vector< std::vector<uint8_t> >& vPages,
+                       std::vector<uint32_t>& vChain, const std::vector<uint8_t>& vKeyCompressed = std::vector<uint8_t>()) const;
+
+
+        /** LiveSlots
+         *
+         *  Get the slots of a bucket's pages that are in use, leaving out copies
+         *  left behind by a split that was cut short. A bucket's lock must be held.
+         *
+         *  @param[in] nBucket The bucket the pages were read from.
+         *  @param[in] vPages The pages of the bucket.
+         *  @param[out] vSlots The slots in use.
+         *  @param[out] vKeys The keys of the slots in use, with the compressed key as vKey.
+         *
+         *  @return The number of stale copies left out.
+         *
+         **/
+        uint32_t LiveSlots(const uint32_t nBucket, const std::vector< std::vector<uint8_t> >& vPages,
+                           std::vector< std::vector<uint8_t> >& vSlots, std::vector<SectorKey>& vKeys) const;
+
+
+        /** ReadPage
+         *
+         *  Read a bucket or overflow page.
+         *
+         *  @param[in] fOverflow True to read an overflow page, false for a bucket page.
+         *  @param[in] nPage The bucket or overflow page number.
+         *  @param[out] vPage The page read, zeroed if past the end of the file.
+         *
+         *  @return True if the page was read.
+         *
+         **/
+        bool ReadPage(const bool fOverflow, const uint32_t nPage, std::vector<uint8_t>& vPage) const;
+
+
+        /** WritePage
+         *
+         *  Write data to a bucket or overflow page, at an offset into the page.
+         *
+         *  @param[in] fOverflow True to write an overflow page, false for a bucket page.
+         *  @param[in] nPage The bucket or overflow page number.
+         *  @param[in] nOffset The offset into the page.
+         *  @param[in] pData The data to write.
+         *  @param[in] nSize The bytes to write.
+         *
+         *  @return True if the data was written.
+         *
+         **/
+        bool WritePage(const bool fOverflow, const uint32_t nPage, const uint32_t nOffset, const uint8_t* pData, const uint32_t nSize);
+
+
+        /** WriteChain
+         *
+         *  Pack slots into a chain of pages from the front, reusing the chain's
+         *  overflow pages and freeing the ones left over.
+         *
+         *  @param[in] nBucket The bucket page the chain starts at.
+         *  @param[in] vChain The overflow pages of the chain, extended if more are needed.
+         *  @param[in] vSlots The slots to write.
+         *
+         *  @return True if the chain was written.
+         *
+         **/
+        bool WriteChain(const uint32_t nBucket, std::vector<uint32_t> vChain, const std::vector< std::vector<uint8_t> >& vSlots);
+
+
+        /** AllocatePage
+         *
+         *  Take an overflow page from the free list, or add one to the end of the file.
+         *
+         *  @param[out] nPage The overflow page number.
+         *
+         *  @return True if a page was allocated.
+         *
+         **/
+        bool AllocatePage(uint32_t &nPage);
+
+
+        /** FreePage
+         *
+         *  Add an overflow page to the free list.
+         *
+         *  @param[in] nPage The overflow page number.
+         *
+         **/
+        void FreePage(const uint32_t nPage);
+
+
+        /** WriteMeta
+         *
+         *  Write the table metadata in place. FILE_MUTEX must be held.
+         *
+         **/
+        void WriteMeta();
+
+
+        /** Split
+         *
+         *  Split the bucket at the split pointer, moving the keys that rehash to the new bucket.
+         *
+         *  @return True if the bucket was split.
+         *
+         **/
+        bool Split();
+    };
+}
+
+#endif
@@ -0,0 +1,375 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLD_KEYCHAIN_ORDEREDMAP_H
+#define NEXUS_LLD_KEYCHAIN_ORDEREDMAP_H
+
+#include <LLD/keychain/keychain.h>
+#include <LLD/include/enum.h>
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace LLD
+{
+
+    /* The bytes of keys held in memory before they are written to a sorted run. */
+    const uint32_t ORDEREDMAP_MAX_MEMORY = 1024 * 1024 * 4; //4 MB Memory Table
+
+
+    /* The most sorted runs kept before they are all merged into one. */
+    const uint32_t ORDEREDMAP_MAX_RUNS = 16;
+
+
+    /* The keys between two entries of a run's sparse index. */
+    const uint32_t ORDEREDMAP_INDEX_INTERVAL = 32;
+
+
+    /** OrderedRun
+     *
+     *  One immutable sorted file of keys.
+     *
+     **/
+    struct OrderedRun;
+
+
+    /** BinaryOrderedMap
+     *
+     *  This class is responsible for managing the keys to the sector database in key order.
+     *
+     *  It is a log structured merge tree. New keys go into a sorted memory table, which
+     *  is backed by an append only log so it survives restarts. When the memory table is
+     *  full it is written out as an immutable sorted run, and runs of similar size are
+     *  merged together so lookups only read a few of them. Erased keys are kept as empty
+     *  entries until a merge reaches the oldest run.
+     *
+     *  Keys are ordered by their serialized bytes, so every key sharing a serialized
+     *  prefix can be read with one sequential scan. Integers serialize little endian,
+     *  so they group under a prefix but don't sort by value.
+     *
+     **/
+    class BinaryOrderedMap : public Keychain
+    {
+    protected:
+
+        /** Mutex for the memory table, the log and the run list. **/
+        mutable std::mutex KEY_MUTEX;
+
+
+        /** Mutex so only one merge writes at a time. **/
+        std::mutex MERGE_MUTEX;
+
+
+        /** The string to hold the database location. **/
+        std::string strBaseLocation;
+
+
+        /** The newest keys, by binary key. **/
+        std::map<std::vector<uint8_t>, SectorKey> mapMemory;
+
+
+        /** The bytes of keys in the memory table. **/
+        uint64_t nMemoryBytes;
+
+
+        /** The sorted runs, oldest first. **/
+        std::vector< std::shared_ptr<OrderedRun> > vRuns;
+
+
+        /** The file number of the next run written. **/
+        uint32_t nNextRun;
+
+
+        /** The log of keys in the memory table. **/
+        std::ofstream* pLog;
+
+
+        /** The keychain flags. **/
+        uint8_t nFlags;
+
+
+    public:
+
+
+        /** Name
+         *
+         *  Returns a string for the name of this type of keychain, as written
+         *  to bulk files. It must not change once keys are written with it.
+         *
+         **/
+        static std::string Name() { return "BinaryOrderedMap"; }
+
+
+        /** Default Constructor. **/
+        BinaryOrderedMap() = delete;
+
+
+        /** The Database Constructor. The bucket count is unused, to match the hashed keychains. **/
+        BinaryOrderedMap(const std::string& strBaseLocationIn, const uint8_t nFlagsIn = FLAGS::APPEND, const uint64_t nBucketsIn = 0);
+
+
+        /** Copy Constructor **/
+        BinaryOrderedMap(const BinaryOrderedMap& map) = delete;
+
+
+        /** Move Constructor **/
+        BinaryOrderedMap(BinaryOrderedMap&& map) = delete;
+
+
+        /** Copy Assignment Operator **/
+        BinaryOrderedMap& operator=(const BinaryOrderedMap& map) = delete;
+
+
+        /** Move Assignment Operator **/
+        BinaryOrderedMap& operator=(BinaryOrderedMap&& map) = delete;
+
+
+        /** Default Destructor **/
+        virtual ~BinaryOrderedMap();
+
+
+        /** Initialize
+         *
+         *  Load the sorted runs and replay the log into the memory table.
+         *
+         **/
+        void Initialize();
+
+
+        /** Get
+         *
+         *  Read a key from the keychain.
+         *
+         *  @param[in] vKey The binary data of key.
+         *  @param[out] cKey The key object to return.
+         *
+         *  @return True if the key was found, false otherwise.
+         *
+         **/
+        bool Get(const std::vector<uint8_t>& vKey, SectorKey &cKey);
+
+
+        /** Put
+         *
+         *  Write a key to the keychain.
+         *
+         *  @param[in] cKey The key object to write.
+         *
+         *  @return True if the key was written, false otherwise.
+         *
+         **/
+        bool Put(const SectorKey& cKey);
+
+
+        /** Flush
+         *
+         *  Flush the log to disk.
+         *
+         **/
+        void Flush();
+
+
+        /** Restore
+         *
+         *  Restore an erased key from keychain, if no merge has dropped it yet.
+         *
+         *  @param[in] vKey the key to restore.
+         *
+         *  @return True if the key was restored.
+         *
+         **/
+        bool Restore(const std::vector<uint8_t>& vKey);
+
+
+        /** Erase
+         *
+         *  Erase a key from the keychain
+         *
+         *  @param[in] vKey the key to erase.
+         *
+         *  @return True if the key was erased, false otherwise.
+         *
+         **/
+        bool Erase(const std::vector<uint8_t>& vKey);
+
+
+        /** Range
+         *
+         *  Read the keys from vBegin up to but not including vEnd, in key order.
+         *
+         *  @param[in] vBegin The first key to read.
+         *  @param[in] vEnd The key to stop before, empty to read to the end.
+         *  @param[out] vKeys The keys read, with vKey set.
+         *  @param[in] nLimit The most keys to read.
+         *
+         *  @return True if any keys were read.
+         *
+         **/
+        bool Range(const std::vector<uint8_t>& vBegin, const std::vector<uint8_t>& vEnd,
+                   std::vector<SectorKey>& vKeys, const uint32_t nLimit);
+
+
+        /** TotalBuckets
+         *
+         *  Get the total buckets of the keychain, the whole tree is one bucket.
+         *
+         **/
+        uint32_t TotalBuckets() const;
+
+
+        /** Depth
+         *
+         *  Get the number of runs and memory tables a lookup may read.
+         *
+         *  @param[in] nBucket The bucket to get depth of.
+         *
+         **/
+        uint16_t Depth(const uint32_t nBucket) const;
+
+
+        /** ScanBucket
+         *
+         *  Read the live keys of the tree in key order, without merging any runs.
+         *
+         *  @param[in] nBucket The bucket to read, the tree is one bucket.
+         *  @param[out] vKeys The live keys of the tree.
+         *
+         *  @return True if the tree was read.
+         *
+         **/
+        bool ScanBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys);
+
+
+        /** CompactBucket
+         *
+         *  Write out the memory table and merge every run into one, dropping erased keys.
+         *
+         *  @param[in] nBucket The bucket to compact.
+         *  @param[out] vKeys The live keys of the tree.
+         *
+         *  @return True if the tree was merged.
+         *
+         **/
+        bool CompactBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys);
+
+
+        /** Relocate
+         *
+         *  Point a key at a new sector location, if it still points at the
+         *  location it had when it was read by CompactBucket.
+         *
+         *  @param[in] nBucket The bucket the key is in.
+         *  @param[in] cKey The key as read by CompactBucket.
+         *  @param[in] nSectorFile The sector file the record was moved to.
+         *  @param[in] nSectorStart The position in the sector file the record was moved to.
+         *
+         *  @return True if the key no longer points at its old location, false if it couldn't be written.
+         *
+         **/
+        bool Relocate(const uint32_t nBucket, const SectorKey& cKey, const uint16_t nSectorFile, const uint32_t nSectorStart);
+
+
+    private:
+
+        /** Find
+         *
+         *  Find the newest entry of a key, including erased ones. KEY_MUTEX must be held.
+         *
+         *  @param[in] vKey The binary data of key.
+         *  @param[out] cKey The newest entry of the key.
+         *
+         *  @return True if the key has an entry.
+         *
+         **/
+        bool Find(const std::vector<uint8_t>& vKey, SectorKey& cKey) const;
+
+
+        /** Append
+         *
+         *  Write an entry to the log and memory table. KEY_MUTEX must be held.
+         *
+         *  @param[in] cKey The entry to write.
+         *
+         *  @return True if the log was written.
+         *
+         **/
+        bool Append(const SectorKey& cKey);
+
+
+        /** FlushMemory
+         *
+         *  Write the memory table out as a new run and clear the log. KEY_MUTEX must be held.
+         *
+         *  @return True if the run was written.
+         *
+         **/
+        bool FlushMemory();
+
+
+        /** Merge
+         *
+         *  Merge the newest runs into one. Runs are read and written without KEY_MUTEX,
+         *  then swapped in under it.
+         *
+         *  @param[in] fAll Merge every run, or only the newest runs of similar size.
+         *
+         *  @return True if the runs were merged.
+         *
+         **/
+        bool Merge(const bool fAll);
+
+
+        /** WriteRun
+         *
+         *  Write a sorted run file, and load it.
+         *
+         *  @param[in] nFile The file number of the run.
+         *  @param[in] fnNext Gives the next entry in key order, false after the last.
+         *
+         *  @return The loaded run, nullptr if it couldn't be written.
+         *
+         **/
+        std::shared_ptr<OrderedRun> WriteRun(const uint32_t nFile, const std::function<bool(SectorKey&)>& fnNext);
+
+
+        /** LoadRun
+         *
+         *  Map a sorted run file and read its sparse index.
+         *
+         *  @param[in] nFile The file number of the run.
+         *
+         *  @return The loaded run, nullptr if it is missing or damaged.
+         *
+         **/
+        std::shared_ptr<OrderedRun> LoadRun(const uint32_t nFile);
+
+
+        /** WriteManifest
+         *
+         *  Replace the list of live runs on disk in one rename. KEY_MUTEX must be held.
+         *
+         *  @return True if the list was written.
+         *
+         **/
+        bool WriteManifest();
+    };
+}
+
+#endif
@@ -15,177 +15,211 @@ ________________________________________________________________________________
 #ifndef NEXUS_LLD_TEMPLATES_SHARD_HASHMAP_H
 #define NEXUS_LLD_TEMPLATES_SHARD_HASHMAP_H
 
-#include <LLD/templates/key.h>
-#include <LLD/cache/template_lru.h>
+#include <LLD/keychain/keychain.h>
+#include <LLD/keychain/hashmap.h>
+#include <LLD/keychain/linearmap.h>
 #include <LLD/include/enum.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <string>
-#include <fstream>
+#include <thread>
 #include <vector>
-#include <mutex>
 
-//TODO: Abstract base class for all keychains
 namespace LLD
 {
 
+    /* The number of shards a new sharded keychain is split into, unless -lldshards is set. */
+    const uint32_t DEFAULT_KEYCHAIN_SHARDS = 4;
+
+
+    /* The least keys in a batch before its lookups are spread over threads. */
+    const uint32_t MIN_PARALLEL_KEYS = 64;
+
+
     /** ShardHashMap
      *
      *  This class is responsible for managing the keys to the sector database.
      *
-     *  It contains a Binary Hash Map with a minimum complexity of O(1).
-     *  It uses a linked file list based on index to iterate trhough files and binary Positions
-     *  when there is a collision that is found.
+     *  It splits the keys by hash over a number of binary hash maps, each with
+     *  its own directory, locks and file handles, so keys of different shards
+     *  never contend. Shard directories are spread over every -lldsharddir given
+     *  when the keychain is created, to put them on separate disks, and are
+     *  remembered in the _shards file so later runs find them again.
      *
      **/
-    class ShardHashMap
+    class ShardHashMap : public Keychain
     {
     protected:
 
-        /** Mutex for Thread Synchronization. **/
-        mutable std::mutex KEY_MUTEX;
-
-
         /** The string to hold the database location. **/
         std::string strBaseLocation;
 
 
-        /** Keychain stream object. **/
-        TemplateLRU<std::pair<uint16_t, uint16_t>, std::fstream*>* fileCache;
+        /** The directory of each shard. **/
+        std::vector<std::string> vLocations;
 
 
-        /** Disk index shard LRU cache **/
-        TemplateLRU<uint16_t, std::vector<uint16_t>*>* diskShards;
+        /** The hash maps of each shard. **/
+        std::vector<BinaryHashMap*> vShards;
 
 
-        /** Keychain index stream. **/
-        TemplateLRU<uint16_t, std::fstream*>* indexCache;
+        /** The total buckets of every shard. **/
+        uint64_t HASHMAP_TOTAL_BUCKETS;
 
 
-        /** The Maximum buckets allowed in the hashmap. */
-        uint32_t HASHMAP_TOTAL_BUCKETS;
+        /** The buckets of each shard. **/
+        uint32_t nShardBuckets;
 
 
-        /** The Maximum shards allowed in the hashmap. */
-        uint32_t HASHMAP_TOTAL_SHARDS;
+        /** The keychain flags. **/
+        uint8_t nFlags;
 
 
-        /** The Maximum key size for static key sectors. **/
-        uint16_t HASHMAP_MAX_KEY_SIZE;
+        /** Mutex for the lookups waiting for a batch thread. **/
+        std::mutex BATCH_MUTEX;
 
 
-        /** The total space that a key consumes. */
-        uint16_t HASHMAP_KEY_ALLOCATION;
+        /** Condition to wake the batch threads. **/
+        std::condition_variable BATCH_CONDITION;
 
 
-        /** The keychain flags. **/
-        uint8_t nFlags;
+        /** The lookups of each shard of a batch waiting for a batch thread. **/
+        std::deque< std::function<void()> > queueLookups;
+
+
+        /** The threads that look up the shards of a batch, one for each shard but the first. **/
+        std::vector<std::thread> vBatchThreads;
 
 
-        /* The key level locking hashmap. */
-        mutable std::vector<std::mutex> RECORD_MUTEX;
+        /** Flag to stop the batch threads. **/
+        std::atomic<bool> fBatchStop;
 
 
     public:
 
 
-        /** The Database Constructor. To determine file location and the Bytes per Record. **/
+        /** Name
+         *
+         *  Returns a string for the name of this type of keychain, as written
+         *  to bulk files. It must not change once keys are written with it.
+         *
+         **/
+        static std::string Name() { return "ShardHashMap"; }
+
+
+        /** Default Constructor. **/
+        ShardHashMap() = delete;
+
+
+        /** The Database Constructor. The buckets are split evenly over the shards. **/
         ShardHashMap(const std::string& strBaseLocationIn, const uint8_t nFlagsIn = FLAGS::APPEND,
-            const uint64_t nBucketsIn = 256 * 256 * 64, const uint32_t nShardsIn = 4);
+            const uint64_t nBucketsIn = 256 * 256 * 64);
+
+
+        /** Copy Constructor **/
+        ShardHashMap(const ShardHashMap& map) = delete;
+
+
+        /** Move Constructor **/
+        ShardHashMap(ShardHashMap&& map) = delete;
 
 
         /** Copy Assignment Operator **/
-        ShardHashMap& operator=(const ShardHashMap& map);
+        ShardHashMap& operator=(const ShardHashMap& map) = delete;
 
 
-        /** Copy Constructor **/
-        ShardHashMap(const ShardHashMap& map);
+        /** Move Assignment Operator **/
+        ShardHashMap& operator=(ShardHashMap&& map) = delete;
 
 
         /** Default Destructor **/
-        ~ShardHashMap();
+        virtual ~ShardHashMap();
 
 
-        /** CompressKey
-         *
-         *  Compresses a given key until it matches size criteria.
-         *  This function is one way and efficient for reducing key sizes.
+        /** Initialize
          *
-         *  @param[out] vData The binary data of key to compress.
-         *  @param[in] nSize The desired size of key after compression.
+         *  Read or create the list of shard directories, and open every shard.
          *
          **/
-        void CompressKey(std::vector<uint8_t>& vData, uint16_t nSize = 32);
+        void Initialize();
 
 
-        /** GetBucket
+        /** Get
          *
-         *  Calculates a bucket to be used for the hashmap allocation.
+         *  Read a key index from the shard it hashes to.
          *
-         *  @param[in] vKey The key object to calculate with.
-         *  @param[in] nShard The shard assigned to hashmap object.
+         *  @param[in] vKey The binary data of key.
+         *  @param[out] cKey The key object to return.
          *
-         *  @return The bucket assigned to the key.
+         *  @return True if the key was found, false otherwise.
          *
          **/
-        uint32_t GetBucket(const std::vector<uint8_t>& vKey, uint32_t& nShard);
+        bool Get(const std::vector<uint8_t>& vKey, SectorKey &cKey);
 
 
-        /** LoadShardIndex
+        /** BatchGet
+         *
+         *  Read many keys, with the keys of each shard looked up on a batch thread
+         *  while the first shard's are looked up on the calling thread.
          *
-         *  Loads a disk index containing shard data into memory.
+         *  @param[in] vKeys The binary data of the keys.
+         *  @param[out] vSectors The keys found are added, with the index into vKeys of each.
          *
-         *  @param[in] The shard to load index for.
+         *  @return The number of keys found.
          *
          **/
-        void LoadShardIndex(const uint32_t nShard);
+        uint32_t BatchGet(const std::vector< std::vector<uint8_t> >& vKeys,
+                          std::vector< std::pair<SectorKey, uint32_t> >& vSectors);
 
 
-        /** Initialize
+        /** Instrument
+         *
+         *  Add the probe depth of every shard to a database's metrics, as one histogram.
          *
-         *  Initialize the binary hash map keychain.
+         *  @param[in] metrics The metrics of the database the keychain belongs to.
          *
          **/
-        void Initialize();
+        void Instrument(Metrics& metrics);
 
 
-        /** Get
+        /** Put
          *
-         *  Read a key index from the disk hashmaps.
+         *  Write a key to the shard it hashes to.
          *
-         *  @param[in] vKey The binary data of key.
-         *  @param[out] cKey The key object to return.
+         *  @param[in] cKey The key object to write.
          *
-         *  @return True if the key was found, false otherwise.
+         *  @return True if the key was written, false otherwise.
          *
          **/
-        bool Get(const std::vector<uint8_t>& vKey, SectorKey &cKey);
+        bool Put(const SectorKey& cKey);
 
 
-        /** Get
+        /** PutBucket
          *
-         *  Read a key index from the disk hashmaps.
-         *  This method iterates all maps to find all keys.
+         *  Write a key as read by CompactBucket into the same bucket of the
+         *  shards, numbered as in TotalBuckets.
          *
-         *  @param[in] vKey The binary data of the key.
-         *  @param[out] vKeys The list of keys to return.
+         *  @param[in] nBucket The bucket the key was read from.
+         *  @param[in] nTotal The buckets of the keychain it was read from.
+         *  @param[in] cKey The key object to write.
          *
-         *  @return True if the key was found, false otherwise.
+         *  @return True if the key was written, false otherwise.
          *
          **/
-        bool Get(const std::vector<uint8_t>& vKey, std::vector<SectorKey>& vKeys);
+        bool PutBucket(const uint32_t nBucket, const uint32_t nTotal, const SectorKey& cKey);
 
 
-        /** Put
-         *
-         *  Write a key to the disk hashmaps.
+        /** Flush
          *
-         *  @param[in] cKey The key object to write.
-         *
-         *  @return True if the key was written, false otherwise.
+         *  Flush every shard to disk.
          *
          **/
-        bool Put(const SectorKey& cKey);
+        void Flush();
 
 
         /** Restore
@@ -202,8 +236,7 @@ namespace LLD
 
         /** Erase
          *
-         *  Erase a key from the disk hashmaps.
-         *  TODO: This should be optimized further.
+         *  Erase a key from the shard it hashes to.
          *
          *  @param[in] vKey the key to erase.
          *
@@ -211,7 +244,105 @@ namespace LLD
          *
          **/
         bool Erase(const std::vector<uint8_t> &vKey);
+
+
+        /** TotalBuckets
+         *
+         *  Get the total buckets of every shard. The buckets of shard n
+         *  are numbered after those of the shards before it.
+         *
+         **/
+        uint32_t TotalBuckets() const;
+
+
+        /** Depth
+         *
+         *  Get the number of hashmap files a bucket is linked through.
+         *
+         *  @param[in] nBucket The bucket to get depth of.
+         *
+         **/
+        uint16_t Depth(const uint32_t nBucket) const;
+
+
+        /** ScanBucket
+         *
+         *  Read the live keys of a bucket of its shard without writing to the keychain.
+         *
+         *  @param[in] nBucket The bucket to read.
+         *  @param[out] vKeys The live keys of the bucket.
+         *
+         *  @return True if the bucket was read.
+         *
+         **/
+        bool ScanBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys);
+
+
+        /** CompactBucket
+         *
+         *  Collapse a bucket of its shard to the files its live keys need.
+         *
+         *  @param[in] nBucket The bucket to compact.
+         *  @param[out] vKeys The live keys of the bucket.
+         *
+         *  @return True if the bucket was compacted.
+         *
+         **/
+        bool CompactBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys);
+
+
+        /** Relocate
+         *
+         *  Point a key at a new sector location, if it still points at the
+         *  location it had when it was read by CompactBucket.
+         *
+         *  @param[in] nBucket The bucket the key is in.
+         *  @param[in] cKey The key as read by CompactBucket.
+         *  @param[in] nSectorFile The sector file the record was moved to.
+         *  @param[in] nSectorStart The position in the sector file the record was moved to.
+         *
+         *  @return True if the key no longer points at its old location, false if it couldn't be written.
+         *
+         **/
+        bool Relocate(const uint32_t nBucket, const SectorKey& cKey, const uint16_t nSectorFile, const uint32_t nSectorStart);
+
+
+    private:
+
+        /** Shard
+         *
+         *  Get the shard a key hashes to.
+         *
+         *  @param[in] vKey The binary data of key.
+         *
+         **/
+        uint32_t Shard(const std::vector<uint8_t>& vKey) const;
+
+
+        /** BatchThread
+         *
+         *  Runs the lookups of batches until the keychain is closed.
+         *
+         **/
+        void BatchThread();
     };
+
+
+    /** ShardableKeychain
+     *
+     *  The keychain of the databases that take the most keys. Building with
+     *  SHARD_KEYCHAIN=1 shards them, and LINEAR_KEYCHAIN=1 gives them a linear
+     *  hash table that grows a bucket at a time. Either changes their keychain
+     *  on disk.
+     *
+     **/
+    #ifdef SHARD_KEYCHAIN
+    typedef ShardHashMap  ShardableKeychain;
+    #elif defined(LINEAR_KEYCHAIN)
+    typedef BinaryLinearMap ShardableKeychain;
+    #else
+    typedef BinaryHashMap ShardableKeychain;
+    #endif
 }
 
 #endif
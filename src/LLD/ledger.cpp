@@ -39,17 +39,43 @@ namespace LLD
     , nBucketsIn
     , nCacheIn)
 
+    , PREFETCH_MUTEX()
+    , PREFETCH_CONDITION()
+    , queueWalks()
+    , queueTx()
+    , nPrefetchBlocks(0)
+    , nPrefetchTx(0)
+    , fPrefetchStop(false)
+    , vPrefetchThreads()
     , MEMORY_MUTEX()
     , pMemory(nullptr)
     , pMiner(nullptr)
     , pCommit(new LedgerTransaction())
     {
+        metrics.Counter("prefetch_blocks_total", "Blocks read into the cache ahead of a chain walk.",       [this]{ return nPrefetchBlocks.load(); });
+        metrics.Counter("prefetch_tx_total",     "Transactions read into the cache ahead of a chain walk.", [this]{ return nPrefetchTx.load(); });
+
+        /* Start the read-ahead threads. */
+        const int64_t nThreads = std::max(config::GetArg("-lldprefetchthreads", DEFAULT_PREFETCH_THREADS), int64_t(0));
+        for(int64_t i = 0; i < nThreads; ++i)
+            vPrefetchThreads.push_back(std::thread(std::bind(&LedgerDB::Prefetcher, this)));
     }
 
 
     /* Default Destructor */
     LedgerDB::~LedgerDB()
     {
+        /* Stop the read-ahead threads before anything they read from goes away. */
+        {
+            LOCK(PREFETCH_MUTEX);
+            fPrefetchStop = true;
+        }
+        PREFETCH_CONDITION.notify_all();
+
+        for(auto& thread : vPrefetchThreads)
+            if(thread.joinable())
+                thread.join();
+
         /* Free transaction memory. */
         if(pMemory)
             delete pMemory;
@@ -64,6 +90,123 @@ namespace LLD
     }
 
 
+    /* Read the blocks following or preceding a block, and their transactions, into the cache. */
+    bool LedgerDB::Prefetch(const uint1024_t& hashStart, const uint32_t nCount, const bool fForward, const uint1024_t& hashStop)
+    {
+        /* Blocks are not in this database in client mode. */
+        if(vPrefetchThreads.empty() || config::fClient.load())
+            return false;
+
+        {
+            LOCK(PREFETCH_MUTEX);
+
+            /* Drop walks once the threads are too far behind. */
+            if(queueWalks.size() >= MAX_PREFETCH_WALKS)
+                return false;
+
+            /* Don't queue a walk that is already waiting, such as a peer asking for the same blocks again. */
+            for(const auto& walk : queueWalks)
+            {
+                if(walk.hashStart == hashStart && walk.fForward == fForward)
+                    return false;
+            }
+
+            PrefetchWalk walk;
+            walk.hashStart = hashStart;
+            walk.hashStop  = hashStop;
+            walk.nCount    = std::min(nCount, MAX_PREFETCH_BLOCKS);
+            walk.fForward  = fForward;
+
+            queueWalks.push_back(walk);
+        }
+        PREFETCH_CONDITION.notify_one();
+
+        return true;
+    }
+
+
+    /* Read-ahead thread. Reads the transactions of walked blocks, and walks the chain when there are none waiting. */
+    void LedgerDB::Prefetcher()
+    {
+        while(!fPrefetchStop.load())
+        {
+            PrefetchWalk walk;
+            std::pair<uint8_t, uint512_t> pairTx;
+            bool fWalk = false;
+
+            {
+                std::unique_lock<std::mutex> CONDITION_LOCK(PREFETCH_MUTEX);
+                PREFETCH_CONDITION.wait(CONDITION_LOCK, [this]{ return fPrefetchStop.load() || !queueTx.empty() || !queueWalks.empty(); });
+
+                if(fPrefetchStop.load())
+                    return;
+
+                /* Transactions go first, so a walk never gets far ahead of the ones it queued. */
+                if(!queueTx.empty())
+                {
+                    pairTx = queueTx.front();
+                    queueTx.pop_front();
+                }
+                else
+                {
+                    walk = queueWalks.front();
+                    queueWalks.pop_front();
+
+                    fWalk = true;
+                }
+            }
+
+            /* Read a transaction, which leaves it in the cache of its database. */
+            if(!fWalk)
+            {
+                if(pairTx.first == TAO::Ledger::TRANSACTION::TRITIUM)
+                {
+                    TAO::Ledger::Transaction tx;
+                    if(Read(pairTx.second, tx))
+                        ++nPrefetchTx;
+                }
+                else if(pairTx.first == TAO::Ledger::TRANSACTION::LEGACY && LLD::Legacy)
+                {
+                    Legacy::Transaction tx;
+                    if(LLD::Legacy->ReadTx(pairTx.second, tx))
+                        ++nPrefetchTx;
+                }
+
+                continue;
+            }
+
+            /* Walk the chain one block at a time, each read depends on the one before. */
+            TAO::Ledger::BlockState state;
+            if(!Read(walk.hashStart, state))
+                continue;
+
+            /* Stop after the last block the caller wants. */
+            uint1024_t hashLast = walk.hashStart;
+            for(uint32_t n = 0; n < walk.nCount && hashLast != walk.hashStop && !fPrefetchStop.load(); ++n)
+            {
+                const uint1024_t hashBlock = (walk.fForward ? state.hashNextBlock : state.hashPrevBlock);
+                if(hashBlock == 0 || !Read(hashBlock, state))
+                    break;
+
+                hashLast = hashBlock;
+
+                ++nPrefetchBlocks;
+
+                /* Hand the transactions to the other threads, dropping them when too far behind. */
+                {
+                    LOCK(PREFETCH_MUTEX);
+                    if(queueTx.size() + state.vtx.size() > MAX_PREFETCH_TX)
+                        continue;
+
+                    for(const auto& proof : state.vtx)
+                        queueTx.push_back(proof);
+                }
+                PREFETCH_CONDITION.notify_all();
+            }
+        }
+    }
+
+
     /* Writes the best chain pointer to the ledger DB. */
     bool LedgerDB::WriteBestChain(const uint1024_t& hashBest)
     {
@@ -198,6 +341,13 @@ namespace LLD
     }
 
 
+    /* Adds a transaction to a batch of writes to the ledger DB. */
+    void LedgerDB::WriteTx(const uint512_t& hashTx, const TAO::Ledger::Transaction& tx, WriteBatch& batch)
+    {
+        batch.Write(hashTx, tx, "tx");
+    }
+
+
     /* Reads a transaction from the ledger DB. */
     bool LedgerDB::ReadTx(const uint512_t& hashTx, TAO::Ledger::Transaction &tx, const uint8_t nFlags)
     {
@@ -254,6 +404,33 @@ namespace LLD
     }
 
 
+    /* Reads many transactions from the ledger DB in one batch. */
+    bool LedgerDB::ReadTxs(const std::vector<uint512_t>& vHashes, std::map<uint512_t, TAO::Ledger::Transaction> &mapTx)
+    {
+        /* Check for client mode. */
+        if(config::fClient.load())
+        {
+            /* Read the merkle transactions one at a time. */
+            bool fAll = true;
+            for(const auto& hashTx : vHashes)
+            {
+                TAO::Ledger::Transaction tx;
+                if(!ReadTx(hashTx, tx))
+                {
+                    fAll = false;
+                    continue;
+                }
+
+                mapTx[hashTx] = tx;
+            }
+
+            return fAll;
+        }
+
+        return MultiRead(vHashes, mapTx);
+    }
+
+
     /* Erases a transaction from the ledger DB. */
     bool LedgerDB::EraseTx(const uint512_t& hashTx)
     {
@@ -454,6 +631,13 @@ namespace LLD
     }
 
 
+    /* Adds the index of a block height to a block to a batch of writes. */
+    void LedgerDB::IndexBlock(const uint32_t& nBlockHeight, const uint1024_t& hashBlock, WriteBatch& batch)
+    {
+        batch.Index(std::make_pair(std::string("height"), nBlockHeight), hashBlock);
+    }
+
+
     /* Erase a foreign index form the keychain */
     bool LedgerDB::EraseIndex(const uint512_t& hashTx)
     {
@@ -626,6 +810,10 @@ namespace LLD
         if(config::fClient.load())
             return Client->Index(std::make_pair(hashAddress, nSequence), hashTx);
 
+        /* Keep the ordered event index up to date if enabled. */
+        if(Event && !Event->WriteEvent(hashAddress, nSequence, hashTx))
+            return false;
+
         return Index(std::make_pair(hashAddress, nSequence), hashTx);
     }
 
@@ -646,6 +834,10 @@ namespace LLD
         if(config::fClient.load())
             return Client->Erase(std::make_pair(hashAddress, nSequence - 1));
 
+        /* Keep the ordered event index up to date if enabled. */
+        if(Event && !Event->EraseEvent(hashAddress, nSequence - 1))
+            return false;
+
         return Erase(std::make_pair(hashAddress, nSequence - 1));
     }
 
@@ -908,6 +1100,13 @@ namespace LLD
     }
 
 
+    /* Adds a block state object to a batch of writes. */
+    void LedgerDB::WriteBlock(const uint1024_t& hashBlock, const TAO::Ledger::BlockState& state, WriteBatch& batch)
+    {
+        batch.Write(hashBlock, state, "block");
+    }
+
+
     /* Reads a block state object from disk. */
     bool LedgerDB::ReadBlock(const uint1024_t& hashBlock, TAO::Ledger::BlockState &state)
     {
@@ -43,6 +43,13 @@ namespace LLD
     }
 
 
+    /* Adds a transaction to a batch of writes to the legacy DB. */
+    void LegacyDB::WriteTx(const uint512_t& hashTx, const Legacy::Transaction& tx, WriteBatch& batch)
+    {
+        batch.Write(std::make_pair(std::string("tx"), hashTx), tx, "tx");
+    }
+
+
     /* Reads a transaction from the legacy DB. */
     bool LegacyDB::ReadTx(const uint512_t& hashTx, Legacy::Transaction& tx, bool &fConflicted, const uint8_t nFlags)
     {
@@ -86,6 +93,46 @@ namespace LLD
     }
 
 
+    /* Reads many transactions from the legacy DB in one batch. */
+    bool LegacyDB::ReadTxs(const std::vector<uint512_t>& vHashes, std::map<uint512_t, Legacy::Transaction>& mapTx)
+    {
+        /* Check for client mode. */
+        if(config::fClient.load())
+        {
+            /* Read the merkle transactions one at a time. */
+            bool fAll = true;
+            for(const auto& hashTx : vHashes)
+            {
+                Legacy::Transaction tx;
+                if(!ReadTx(hashTx, tx))
+                {
+                    fAll = false;
+                    continue;
+                }
+
+                mapTx[hashTx] = tx;
+            }
+
+            return fAll;
+        }
+
+        /* Build the keys for the transactions. */
+        std::vector< std::pair<std::string, uint512_t> > vKeys;
+        for(const auto& hashTx : vHashes)
+            vKeys.push_back(std::make_pair(std::string("tx"), hashTx));
+
+        /* Read the transactions in one batch. */
+        std::map<std::pair<std::string, uint512_t>, Legacy::Transaction> mapRead;
+        bool fAll = MultiRead(vKeys, mapRead);
+
+        /* Return the transactions by txid. */
+        for(const auto& read : mapRead)
+            mapTx[read.first.second] = read.second;
+
+        return fAll;
+    }
+
+
     /* Erases a transaction from the ledger DB. */
     bool LegacyDB::EraseTx(const uint512_t& hashTx)
     {
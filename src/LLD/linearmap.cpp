@@ -0,0 +1,933 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#include <LLD/keychain/linearmap.h>
+#include <LLD/include/enum.h>
+#include <LLD/include/version.h>
+#include <LLD/hash/xxh3.h>
+
+#include <Util/templates/datastream.h>
+#include <Util/include/filesystem.h>
+#include <Util/include/debug.h>
+#include <Util/include/hex.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace LLD
+{
+
+    /* The longest overflow chain followed before a bucket is treated as corrupt. */
+    const uint32_t LINEARMAP_MAX_CHAIN = std::numeric_limits<uint16_t>::max();
+
+
+    /* Compresses a key longer than nSize to its first bytes and a hash of the whole key. The
+     * bucket is found from the compressed key, so unlike the hashmap's fold no byte is dropped. */
+    static void CompressKey(std::vector<uint8_t>& vData, const uint16_t nSize)
+    {
+        if(vData.size() <= nSize)
+            return;
+
+        const uint64_t nHash = XXH64(&vData[0], vData.size(), 0);
+
+        vData.resize(nSize);
+        std::copy((uint8_t*)&nHash, (uint8_t*)&nHash + sizeof(nHash), vData.end() - sizeof(nHash));
+    }
+
+
+    /* Get the length of a key of nLength bytes once compressed to nMaxSize. */
+    static uint64_t CompressedLength(uint64_t nLength, const uint64_t nMaxSize)
+    {
+        while(nLength > nMaxSize)
+            nLength = std::max(nLength >> 1, nMaxSize);
+
+        return nLength;
+    }
+
+
+    /* Read a little endian 32 bit value. */
+    static uint32_t ReadUint32(const uint8_t* pData)
+    {
+        return uint32_t(pData[0]) | (uint32_t(pData[1]) << 8) | (uint32_t(pData[2]) << 16) | (uint32_t(pData[3]) << 24);
+    }
+
+
+    /* Write a little endian 32 bit value. */
+    static void WriteUint32(uint8_t* pData, const uint32_t nValue)
+    {
+        pData[0] = static_cast<uint8_t>(nValue);
+        pData[1] = static_cast<uint8_t>(nValue >> 8);
+        pData[2] = static_cast<uint8_t>(nValue >> 16);
+        pData[3] = static_cast<uint8_t>(nValue >> 24);
+    }
+
+
+    /* Get the offset of a slot in its page. */
+    static uint32_t SlotOffset(const uint32_t nSlot)
+    {
+        return 4 + nSlot * LINEARMAP_SLOT_SIZE;
+    }
+
+
+    /* Get the compressed key of a slot. */
+    static std::vector<uint8_t> SlotKey(const uint8_t* pSlot)
+    {
+        const uint64_t nLength = CompressedLength(pSlot[1] | (pSlot[2] << 8), LINEARMAP_MAX_KEY_SIZE);
+
+        return std::vector<uint8_t>(pSlot + 13, pSlot + 13 + nLength);
+    }
+
+
+    /* Get the hash a compressed key is addressed by. */
+    static uint64_t KeyHash(const std::vector<uint8_t>& vKeyCompressed)
+    {
+        return XXH64(&vKeyCompressed[0], vKeyCompressed.size(), 0);
+    }
+
+
+    /* Find the slot of a page holding a key, erased or not, or -1 if it isn't in the page. */
+    static int32_t FindSlot(const std::vector<uint8_t>& vPage, const std::vector<uint8_t>& vKeyCompressed)
+    {
+        for(uint32_t nSlot = 0; nSlot < LINEARMAP_BUCKET_SLOTS; ++nSlot)
+        {
+            const uint8_t* pSlot = &vPage[SlotOffset(nSlot)];
+
+            /* Compare the lengths first, an empty slot never matches since keys aren't empty. */
+            const uint64_t nLength = CompressedLength(pSlot[1] | (pSlot[2] << 8), LINEARMAP_MAX_KEY_SIZE);
+            if(nLength != vKeyCompressed.size())
+                continue;
+
+            if(std::equal(vKeyCompressed.begin(), vKeyCompressed.end(), pSlot + 13))
+                return static_cast<int32_t>(nSlot);
+        }
+
+        return -1;
+    }
+
+
+    /* Read bytes from a stream, leaving the buffer as it is past the end of the file. */
+    static bool ReadAt(std::fstream* pstream, const uint64_t nPos, uint8_t* pData, const uint32_t nSize)
+    {
+        pstream->clear();
+        if(!pstream->seekg(nPos, std::ios::beg))
+            return false;
+
+        pstream->read((char*)pData, nSize);
+        pstream->clear();
+
+        return true;
+    }
+
+
+    /* Write bytes to a stream. */
+    static bool WriteAt(std::fstream* pstream, const uint64_t nPos, const uint8_t* pData, const uint32_t nSize)
+    {
+        pstream->clear();
+        if(!pstream->seekp(nPos, std::ios::beg))
+            return false;
+
+        return static_cast<bool>(pstream->write((const char*)pData, nSize));
+    }
+
+
+    /* The Database Constructor. To determine file location and the keys held before the first split. */
+    BinaryLinearMap::BinaryLinearMap(const std::string& strBaseLocationIn, const uint8_t nFlagsIn, const uint64_t nBucketsIn)
+    : FILE_MUTEX      ( )
+    , SPLIT_MUTEX     ( )
+    , RECORD_MUTEX    (1024)
+    , strBaseLocation (strBaseLocationIn)
+    , pPrimary        (nullptr)
+    , pOverflow       (nullptr)
+    , pMeta           (nullptr)
+    , nInitial        (static_cast<uint32_t>(std::max(uint64_t(1), nBucketsIn / LINEARMAP_BUCKET_SLOTS)))
+    , nTable          (0)
+    , nOverflow       (0)
+    , nFreeHead       (0)
+    , nKeys           (0)
+    , nFlags          (nFlagsIn)
+    , pProbes         (nullptr)
+    {
+        Initialize();
+    }
+
+
+    /* Default Destructor */
+    BinaryLinearMap::~BinaryLinearMap()
+    {
+        /* Save the key count and free list for the next start. */
+        if(pMeta)
+        {
+            LOCK(FILE_MUTEX);
+            WriteMeta();
+        }
+
+        if(pPrimary)
+            delete pPrimary;
+
+        if(pOverflow)
+            delete pOverflow;
+
+        if(pMeta)
+            delete pMeta;
+    }
+
+
+    /* Open the page files and load the table metadata. */
+    void BinaryLinearMap::Initialize()
+    {
+        /* Create directories if they don't exist yet. */
+        if(!filesystem::exists(strBaseLocation) && filesystem::create_directories(strBaseLocation))
+            debug::log(0, FUNCTION, "Generated Path ", strBaseLocation);
+
+        const std::string strPrimary  = debug::safe_printstr(strBaseLocation, "_linearmap.primary");
+        const std::string strOverflow = debug::safe_printstr(strBaseLocation, "_linearmap.overflow");
+        const std::string strMeta     = debug::safe_printstr(strBaseLocation, "_linearmap.meta");
+
+        /* Load the table metadata, the table keeps the size it was created with. */
+        if(filesystem::exists(strMeta))
+        {
+            std::vector<uint8_t> vMeta(28, 0);
+
+            std::fstream stream(strMeta, std::ios::in | std::ios::binary);
+            stream.read((char*)&vMeta[0], vMeta.size());
+            stream.close();
+
+            uint32_t nLevel = 0, nSplit = 0;
+            uint64_t nTotalKeys = 0;
+
+            DataStream ssMeta(vMeta, SER_LLD, DATABASE_VERSION);
+            ssMeta >> nInitial >> nLevel >> nSplit >> nOverflow >> nFreeHead >> nTotalKeys;
+
+            nInitial = std::max(nInitial, uint32_t(1));
+            nTable.store((uint64_t(nLevel) << 32) | nSplit);
+            nKeys.store(nTotalKeys);
+
+            /* Debug output showing loading of the table. */
+            debug::log(0, FUNCTION, "Loaded Linear Hash Map of ", TotalBuckets(), " buckets and ", nTotalKeys, " keys");
+        }
+
+        /* Generate the bucket pages of a new table. */
+        else
+        {
+            /* Size the file by its last byte, the filesystem leaves the pages before it as holes. */
+            std::fstream stream(strPrimary, std::ios::out | std::ios::binary | std::ios::trunc);
+            stream.seekp(uint64_t(nInitial) * LINEARMAP_PAGE_SIZE - 1, std::ios::beg);
+            stream.put(0);
+            stream.close();
+
+            std::fstream overflow(strOverflow, std::ios::out | std::ios::binary | std::ios::trunc);
+            overflow.close();
+
+            std::fstream meta(strMeta, std::ios::out | std::ios::binary | std::ios::trunc);
+            meta.close();
+
+            /* Debug output showing generation of the table. */
+            debug::log(0, FUNCTION, "Generated Linear Hash Map of ", nInitial, " buckets");
+        }
+
+        /* Create the stream objects. */
+        pPrimary  = new std::fstream(strPrimary,  std::ios::in | std::ios::out | std::ios::binary);
+        pOverflow = new std::fstream(strOverflow, std::ios::in | std::ios::out | std::ios::binary);
+        pMeta     = new std::fstream(strMeta,     std::ios::in | std::ios::out | std::ios::binary);
+
+        LOCK(FILE_MUTEX);
+        WriteMeta();
+    }
+
+
+    /* Read a key index from the table. */
+    bool BinaryLinearMap::Get(const std::vector<uint8_t>& vKey, SectorKey &cKey)
+    {
+        /* Compress any keys larger than max size. */
+        std::vector<uint8_t> vKeyCompressed = vKey;
+        CompressKey(vKeyCompressed, LINEARMAP_MAX_KEY_SIZE);
+
+        /* Lock the bucket the key is in. */
+        uint32_t nBucket = 0;
+        std::unique_lock<std::mutex> BUCKET_LOCK = LockBucket(KeyHash(vKeyCompressed), nBucket);
+
+        /* Set the cKey return value non compressed. */
+        cKey.vKey = vKey;
+
+        /* Follow the chain of the bucket until the key is found. */
+        std::vector<uint8_t> vPage;
+        bool fOverflow = false;
+        uint32_t nPage = nBucket;
+        uint32_t nProbes = 0;
+        while(nProbes < LINEARMAP_MAX_CHAIN)
+        {
+            ++nProbes;
+            if(!ReadPage(fOverflow, nPage, vPage))
+                break;
+
+            /* Check if this page has the key. */
+            const int32_t nSlot = FindSlot(vPage, vKeyCompressed);
+            if(nSlot >= 0)
+            {
+                if(pProbes)
+                    pProbes->Record(nProbes);
+
+                /* Deserialize the key, erased keys are not returned. */
+                const uint32_t nOffset = SlotOffset(nSlot);
+                DataStream ssKey(std::vector<uint8_t>(vPage.begin() + nOffset, vPage.begin() + nOffset + LINEARMAP_SLOT_SIZE), SER_LLD, DATABASE_VERSION);
+                ssKey >> cKey;
+
+                /* Debug Output of Sector Key Information. */
+                if(config::nVerbose >= 4)
+                    debug::log(4, FUNCTION, "State: ", cKey.nState == STATE::READY ? "Valid" : "Invalid",
+                        " | Length: ", cKey.nLength,
+                        " | Bucket ", nBucket,
+                        " | Page: ", fOverflow ? "Overflow " : "Primary ", nPage,
+                        " | Sector File: ", cKey.nSectorFile,
+                        " | Sector Size: ", cKey.nSectorSize,
+                        " | Sector Start: ", cKey.nSectorStart, "\n",
+                        HexStr(vKeyCompressed.begin(), vKeyCompressed.end(), true));
+
+                return cKey.Ready();
+            }
+
+            /* Move on to the next overflow page. */
+            const uint32_t nNext = ReadUint32(&vPage[0]);
+            if(nNext == 0)
+                break;
+
+            fOverflow = true;
+            nPage     = nNext - 1;
+        }
+
+        if(pProbes)
+            pProbes->Record(nProbes);
+
+        return false;
+    }
+
+
+    /* Add the pages read by each Get to a database's metrics. */
+    void BinaryLinearMap::Instrument(Metrics& metrics)
+    {
+        pProbes = metrics.Distribution("keychain_probes", "Hashmap buckets read by each keychain lookup.");
+    }
+
+
+    /* Write a key to the table. */
+    bool BinaryLinearMap::Put(const SectorKey& cKey)
+    {
+        /* Compress any keys larger than max size. */
+        std::vector<uint8_t> vKeyCompressed = cKey.vKey;
+        CompressKey(vKeyCompressed, LINEARMAP_MAX_KEY_SIZE);
+
+        /* Serialize the key header and the compressed key into a slot. */
+        DataStream ssKey(SER_LLD, DATABASE_VERSION);
+        ssKey << cKey;
+        ssKey.write((char*)&vKeyCompressed[0], vKeyCompressed.size());
+
+        std::vector<uint8_t> vSlot = ssKey.Bytes();
+        vSlot.resize(LINEARMAP_SLOT_SIZE, 0);
+
+        {
+            /* Lock the bucket the key is in. */
+            uint32_t nBucket = 0;
+            std::unique_lock<std::mutex> BUCKET_LOCK = LockBucket(KeyHash(vKeyCompressed), nBucket);
+
+            /* Read the chain up to the page holding the key. */
+            std::vector< std::vector<uint8_t> > vPages;
+            std::vector<uint32_t> vChain;
+            if(!ReadChain(nBucket, vPages, vChain, vKeyCompressed))
+                return debug::error(FUNCTION, "failed to read bucket ", nBucket);
+
+            /* Update the key in place if it is in the table, otherwise take the first empty slot. */
+            int32_t nSlot = FindSlot(vPages.back(), vKeyCompressed);
+            uint32_t nPage = static_cast<uint32_t>(vPages.size() - 1);
+            if(nSlot < 0)
+            {
+                for(uint32_t n = 0; n < vPages.size() && nSlot < 0; ++n)
+                {
+                    for(uint32_t i = 0; i < LINEARMAP_BUCKET_SLOTS; ++i)
+                    {
+                        if(vPages[n][SlotOffset(i)] == STATE::EMPTY)
+                        {
+                            nSlot = static_cast<int32_t>(i);
+                            nPage = n;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            /* Count the key if it is new, or was erased. */
+            if(nSlot < 0 || vPages[nPage][SlotOffset(nSlot)] == STATE::EMPTY)
+                ++nKeys;
+
+            /* Write the slot into its page. */
+            if(nSlot >= 0)
+            {
+                if(!WritePage(nPage > 0, nPage > 0 ? vChain[nPage - 1] : nBucket, SlotOffset(nSlot), &vSlot[0], LINEARMAP_SLOT_SIZE))
+                    return debug::error(FUNCTION, "failed to write bucket ", nBucket);
+            }
+
+            /* Chain a new overflow page to the bucket if every slot is in use. */
+            else
+            {
+                uint32_t nNew = 0;
+                if(!AllocatePage(nNew))
+                    return debug::error(FUNCTION, "failed to allocate overflow page for bucket ", nBucket);
+
+                /* Write the key to the new page before linking it. */
+                if(!WritePage(true, nNew, SlotOffset(0), &vSlot[0], LINEARMAP_SLOT_SIZE))
+                    return debug::error(FUNCTION, "failed to write overflow page ", nNew);
+
+                std::vector<uint8_t> vNext(4, 0);
+                WriteUint32(&vNext[0], nNew + 1);
+
+                const bool fLast = !vChain.empty();
+                if(!WritePage(fLast, fLast ? vChain.back() : nBucket, 0, &vNext[0], 4))
+                    return debug::error(FUNCTION, "failed to link overflow page ", nNew);
+            }
+
+            /* Debug Output of Sector Key Information. */
+            if(config::nVerbose >= 4)
+                debug::log(4, FUNCTION, "State: ", cKey.nState == STATE::READY ? "Valid" : "Invalid",
+                    " | Length: ", cKey.nLength,
+                    " | Bucket ", nBucket,
+                    " | Depth ", vPages.size(),
+                    " | Sector File: ", cKey.nSectorFile,
+                    " | Sector Size: ", cKey.nSectorSize,
+                    " | Sector Start: ", cKey.nSectorStart,
+                    " | Key: ",  HexStr(vKeyCompressed.begin(), vKeyCompressed.end()));
+        }
+
+        /* Grow the table by a bucket if it is over its load factor. */
+        Split();
+
+        return true;
+    }
+
+
+    /* Flush all buffers to disk if using ACID transaction. */
+    void BinaryLinearMap::Flush()
+    {
+        LOCK(FILE_MUTEX);
+
+        WriteMeta();
+
+        pPrimary->flush();
+        pOverflow->flush();
+        pMeta->flush();
+    }
+
+
+    /* Erase a key from the table. */
+    bool BinaryLinearMap::Erase(const std::vector<uint8_t>& vKey)
+    {
+        /* Compress any keys larger than max size. */
+        std::vector<uint8_t> vKeyCompressed = vKey;
+        CompressKey(vKeyCompressed, LINEARMAP_MAX_KEY_SIZE);
+
+        /* Lock the bucket the key is in. */
+        uint32_t nBucket = 0;
+        std::unique_lock<std::mutex> BUCKET_LOCK = LockBucket(KeyHash(vKeyCompressed), nBucket);
+
+        /* Read the chain up to the page holding the key. */
+        std::vector< std::vector<uint8_t> > vPages;
+        std::vector<uint32_t> vChain;
+        if(!ReadChain(nBucket, vPages, vChain, vKeyCompressed))
+            return false;
+
+        const int32_t nSlot = FindSlot(vPages.back(), vKeyCompressed);
+        if(nSlot < 0)
+            return false;
+
+        /* Write the empty state over the key, leaving the key so it can be restored. */
+        const uint32_t nPage = static_cast<uint32_t>(vPages.size() - 1);
+        if(vPages[nPage][SlotOffset(nSlot)] != STATE::EMPTY)
+        {
+            const uint8_t nState = STATE::EMPTY;
+            if(!WritePage(nPage > 0, nPage > 0 ? vChain[nPage - 1] : nBucket, SlotOffset(nSlot), &nState, 1))
+                return false;
+
+            --nKeys;
+        }
+
+        return true;
+    }
+
+
+    /* Restore an erased key in the table if its slot wasn't reused. */
+    bool BinaryLinearMap::Restore(const std::vector<uint8_t>& vKey)
+    {
+        /* Compress any keys larger than max size. */
+        std::vector<uint8_t> vKeyCompressed = vKey;
+        CompressKey(vKeyCompressed, LINEARMAP_MAX_KEY_SIZE);
+
+        /* Lock the bucket the key is in. */
+        uint32_t nBucket = 0;
+        std::unique_lock<std::mutex> BUCKET_LOCK = LockBucket(KeyHash(vKeyCompressed), nBucket);
+
+        /* Read the chain up to the page holding the key. */
+        std::vector< std::vector<uint8_t> > vPages;
+        std::vector<uint32_t> vChain;
+        if(!ReadChain(nBucket, vPages, vChain, vKeyCompressed))
+            return false;
+
+        const int32_t nSlot = FindSlot(vPages.back(), vKeyCompressed);
+        if(nSlot < 0)
+            return false;
+
+        /* Skip over keys that are already ready. */
+        const uint32_t nPage = static_cast<uint32_t>(vPages.size() - 1);
+        const uint8_t nCurrent = vPages[nPage][SlotOffset(nSlot)];
+        if(nCurrent == STATE::READY)
+            return true;
+
+        /* Write the ready state over the key state. */
+        const uint8_t nState = STATE::READY;
+        if(!WritePage(nPage > 0, nPage > 0 ? vChain[nPage - 1] : nBucket, SlotOffset(nSlot), &nState, 1))
+            return false;
+
+        if(nCurrent == STATE::EMPTY)
+            ++nKeys;
+
+        return true;
+    }
+
+
+    /* Get the total buckets of the table. */
+    uint32_t BinaryLinearMap::TotalBuckets() const
+    {
+        const uint64_t nState = nTable.load();
+
+        return static_cast<uint32_t>((uint64_t(nInitial) << (nState >> 32)) + (nState & 0xffffffff));
+    }
+
+
+    /* Get the number of pages a lookup in a bucket may read. */
+    uint16_t BinaryLinearMap::Depth(const uint32_t nBucket) const
+    {
+        LOCK(RECORD_MUTEX[nBucket % RECORD_MUTEX.size()]);
+
+        if(nBucket >= TotalBuckets())
+            return 0;
+
+        std::vector< std::vector<uint8_t> > vPages;
+        std::vector<uint32_t> vChain;
+        if(!ReadChain(nBucket, vPages, vChain))
+            return 0;
+
+        /* A bucket that was never written has nothing to compact. */
+        if(vPages.size() == 1)
+        {
+            bool fEmpty = true;
+            for(uint32_t i = 0; i < LINEARMAP_BUCKET_SLOTS && fEmpty; ++i)
+                fEmpty = (vPages[0][SlotOffset(i)] == STATE::EMPTY);
+
+            if(fEmpty)
+                return 0;
+        }
+
+        return static_cast<uint16_t>(vPages.size());
+    }
+
+
+    /* Read the keys of a bucket without writing to the keychain. */
+    bool BinaryLinearMap::ScanBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys)
+    {
+        /* Lock the stripe this bucket belongs to, which keeps it from being split. */
+        LOCK(RECORD_MUTEX[nBucket % RECORD_MUTEX.size()]);
+
+        if(nBucket >= TotalBuckets())
+            return true;
+
+        /* Read the whole chain. */
+        std::vector< std::vector<uint8_t> > vPages;
+        std::vector<uint32_t> vChain;
+        if(!ReadChain(nBucket, vPages, vChain))
+            return debug::error(FUNCTION, "failed to read bucket ", nBucket);
+
+        std::vector< std::vector<uint8_t> > vSlots;
+        LiveSlots(nBucket, vPages, vSlots, vKeys);
+
+        return true;
+    }
+
+
+    /* Pack the keys of a bucket into the fewest pages. */
+    bool BinaryLinearMap::CompactBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys)
+    {
+        /* Lock the stripe this bucket belongs to, which keeps it from being split. */
+        LOCK(RECORD_MUTEX[nBucket % RECORD_MUTEX.size()]);
+
+        if(nBucket >= TotalBuckets())
+            return true;
+
+        /* Read the whole chain. */
+        std::vector< std::vector<uint8_t> > vPages;
+        std::vector<uint32_t> vChain;
+        if(!ReadChain(nBucket, vPages, vChain))
+            return debug::error(FUNCTION, "failed to read bucket ", nBucket);
+
+        /* Keep the slots in use, dropping copies left behind by a split that was cut short. */
+        std::vector< std::vector<uint8_t> > vSlots;
+        const uint32_t nStale = LiveSlots(nBucket, vPages, vSlots, vKeys);
+
+        /* Rewrite the chain only if it gets shorter or loses stale copies. */
+        const uint64_t nNeeded = std::max(uint64_t(1), (vSlots.size() + LINEARMAP_BUCKET_SLOTS - 1) / LINEARMAP_BUCKET_SLOTS);
+        if(nNeeded == vPages.size() && nStale == 0)
+            return true;
+
+        return WriteChain(nBucket, vChain, vSlots);
+    }
+
+
+    /* Point a key at a new sector location. */
+    bool BinaryLinearMap::Relocate(const uint32_t nBucket, const SectorKey& cKey, const uint16_t nSectorFile, const uint32_t nSectorStart)
+    {
+        /* Find the key by its hash, its bucket may have split since it was read. */
+        uint32_t nCurrentBucket = 0;
+        std::unique_lock<std::mutex> BUCKET_LOCK = LockBucket(KeyHash(cKey.vKey), nCurrentBucket);
+
+        /* Read the chain up to the page holding the key. */
+        std::vector< std::vector<uint8_t> > vPages;
+        std::vector<uint32_t> vChain;
+        if(!ReadChain(nCurrentBucket, vPages, vChain, cKey.vKey))
+            return false;
+
+        /* The key was erased since. */
+        const int32_t nSlot = FindSlot(vPages.back(), cKey.vKey);
+        const uint32_t nPage = static_cast<uint32_t>(vPages.size() - 1);
+        if(nSlot < 0 || vPages[nPage][SlotOffset(nSlot)] != STATE::READY)
+            return true;
+
+        /* Check the key wasn't updated since it was read. */
+        const uint32_t nOffset = SlotOffset(nSlot);
+        DataStream ssKey(std::vector<uint8_t>(vPages[nPage].begin() + nOffset, vPages[nPage].begin() + nOffset + LINEARMAP_SLOT_SIZE), SER_LLD, DATABASE_VERSION);
+        SectorKey cCurrent;
+        ssKey >> cCurrent;
+
+        if(cCurrent.nSectorFile != cKey.nSectorFile || cCurrent.nSectorStart != cKey.nSectorStart
+        || cCurrent.nSectorSize != cKey.nSectorSize)
+            return true;
+
+        /* Write the new location over the key header, leaving the key itself. */
+        cCurrent.nSectorFile  = nSectorFile;
+        cCurrent.nSectorStart = nSectorStart;
+
+        DataStream ssHeader(SER_LLD, DATABASE_VERSION);
+        ssHeader << cCurrent;
+
+        return WritePage(nPage > 0, nPage > 0 ? vChain[nPage - 1] : nCurrentBucket, nOffset, &ssHeader.Bytes()[0], ssHeader.size());
+    }
+
+
+    /* Get the bucket a key hash belongs to for a table state. */
+    uint32_t BinaryLinearMap::Address(const uint64_t nHash, const uint64_t nState) const
+    {
+        const uint64_t nBuckets = uint64_t(nInitial) << (nState >> 32);
+
+        /* Buckets before the split pointer were split this round, so use twice the table size. */
+        uint64_t nBucket = nHash % nBuckets;
+        if(nBucket < (nState & 0xffffffff))
+            nBucket = nHash % (nBuckets << 1);
+
+        return static_cast<uint32_t>(nBucket);
+    }
+
+
+    /* Find the bucket of a key hash and lock it. */
+    std::unique_lock<std::mutex> BinaryLinearMap::LockBucket(const uint64_t nHash, uint32_t &nBucket) const
+    {
+        while(true)
+        {
+            nBucket = Address(nHash, nTable.load());
+
+            /* A split holds the lock of the bucket it splits, so the address is settled once the lock is held. */
+            std::unique_lock<std::mutex> BUCKET_LOCK(RECORD_MUTEX[nBucket % RECORD_MUTEX.size()]);
+            if(Address(nHash, nTable.load()) == nBucket)
+                return BUCKET_LOCK;
+        }
+    }
+
+
+    /* Read the pages of a bucket. */
+    bool BinaryLinearMap::ReadChain(const uint32_t nBucket, std::vector< std::vector<uint8_t> >& vPages,
+                                    std::vector<uint32_t>& vChain, const std::vector<uint8_t>& vKeyCompressed) const
+    {
+        vPages.assign(1, std::vector<uint8_t>());
+        vChain.clear();
+
+        if(!ReadPage(false, nBucket, vPages[0]))
+            return false;
+
+        while(true)
+        {
+            /* Stop at the page holding the key. */
+            if(!vKeyCompressed.empty() && FindSlot(vPages.back(), vKeyCompressed) >= 0)
+                return true;
+
+            /* Stop at the end of the chain. */
+            const uint32_t nNext = ReadUint32(&vPages.back()[0]);
+            if(nNext == 0)
+                return true;
+
+            if(vChain.size() >= LINEARMAP_MAX_CHAIN)
+                return debug::error(FUNCTION, "overflow chain of bucket ", nBucket, " is corrupt");
+
+            vChain.push_back(nNext - 1);
+            vPages.push_back(std::vector<uint8_t>());
+            if(!ReadPage(true, nNext - 1, vPages.back()))
+                return false;
+        }
+    }
+
+
+    /* Get the slots of a bucket's pages that are in use. */
+    uint32_t BinaryLinearMap::LiveSlots(const uint32_t nBucket, const std::vector< std::vector<uint8_t> >& vPages,
+                                        std::vector< std::vector<uint8_t> >& vSlots, std::vector<SectorKey>& vKeys) const
+    {
+        const uint64_t nState = nTable.load();
+
+        uint32_t nStale = 0;
+        for(const auto& vPage : vPages)
+        {
+            for(uint32_t i = 0; i < LINEARMAP_BUCKET_SLOTS; ++i)
+            {
+                const uint8_t* pSlot = &vPage[SlotOffset(i)];
+                if(pSlot[0] == STATE::EMPTY)
+                    continue;
+
+                /* Get the compressed key of the slot. */
+                std::vector<uint8_t> vKeyCompressed = SlotKey(pSlot);
+                if(Address(KeyHash(vKeyCompressed), nState) != nBucket)
+                {
+                    ++nStale;
+                    continue;
+                }
+
+                vSlots.push_back(std::vector<uint8_t>(pSlot, pSlot + LINEARMAP_SLOT_SIZE));
+
+                /* Add to the live keys. */
+                DataStream ssKey(vSlots.back(), SER_LLD, DATABASE_VERSION);
+                SectorKey cKey;
+                ssKey >> cKey;
+
+                cKey.vKey = vKeyCompressed;
+                vKeys.push_back(cKey);
+            }
+        }
+
+        return nStale;
+    }
+
+
+    /* Read a bucket or overflow page. */
+    bool BinaryLinearMap::ReadPage(const bool fOverflow, const uint32_t nPage, std::vector<uint8_t>& vPage) const
+    {
+        vPage.assign(LINEARMAP_PAGE_SIZE, 0);
+
+        LOCK(FILE_MUTEX);
+        return ReadAt(fOverflow ? pOverflow : pPrimary, uint64_t(nPage) * LINEARMAP_PAGE_SIZE, &vPage[0], LINEARMAP_PAGE_SIZE);
+    }
+
+
+    /* Write data to a bucket or overflow page. */
+    bool BinaryLinearMap::WritePage(const bool fOverflow, const uint32_t nPage, const uint32_t nOffset, const uint8_t* pData, const uint32_t nSize)
+    {
+        LOCK(FILE_MUTEX);
+        return WriteAt(fOverflow ? pOverflow : pPrimary, uint64_t(nPage) * LINEARMAP_PAGE_SIZE + nOffset, pData, nSize);
+    }
+
+
+    /* Pack slots into a chain of pages from the front. */
+    bool BinaryLinearMap::WriteChain(const uint32_t nBucket, std::vector<uint32_t> vChain, const std::vector< std::vector<uint8_t> >& vSlots)
+    {
+        /* Get the pages needed, a bucket always has its own page. */
+        const uint32_t nPages = static_cast<uint32_t>(std::max(uint64_t(1), (vSlots.size() + LINEARMAP_BUCKET_SLOTS - 1) / LINEARMAP_BUCKET_SLOTS));
+        while(vChain.size() + 1 < nPages)
+        {
+            uint32_t nNew = 0;
+            if(!AllocatePage(nNew))
+                return false;
+
+            vChain.push_back(nNew);
+        }
+
+        /* Write from the back so each page links to one that is already written. */
+        for(int32_t nPage = nPages - 1; nPage >= 0; --nPage)
+        {
+            std::vector<uint8_t> vPage(LINEARMAP_PAGE_SIZE, 0);
+            if(static_cast<uint32_t>(nPage) + 1 < nPages)
+                WriteUint32(&vPage[0], vChain[nPage] + 1);
+
+            for(uint32_t i = 0; i < LINEARMAP_BUCKET_SLOTS; ++i)
+            {
+                const uint64_t nSlot = uint64_t(nPage) * LINEARMAP_BUCKET_SLOTS + i;
+                if(nSlot >= vSlots.size())
+                    break;
+
+                std::copy(vSlots[nSlot].begin(), vSlots[nSlot].end(), vPage.begin() + SlotOffset(i));
+            }
+
+            if(!WritePage(nPage > 0, nPage > 0 ? vChain[nPage - 1] : nBucket, 0, &vPage[0], LINEARMAP_PAGE_SIZE))
+                return debug::error(FUNCTION, "failed to write bucket ", nBucket);
+        }
+
+        /* Free the overflow pages the chain no longer needs. */
+        for(uint32_t n = nPages - 1; n < vChain.size(); ++n)
+            FreePage(vChain[n]);
+
+        return true;
+    }
+
+
+    /* Take an overflow page from the free list, or add one to the end of the file. */
+    bool BinaryLinearMap::AllocatePage(uint32_t &nPage)
+    {
+        LOCK(FILE_MUTEX);
+
+        /* Reuse the first free page, its header links the next free one. */
+        if(nFreeHead != 0)
+        {
+            nPage = nFreeHead - 1;
+
+            std::vector<uint8_t> vNext(4, 0);
+            if(!ReadAt(pOverflow, uint64_t(nPage) * LINEARMAP_PAGE_SIZE, &vNext[0], 4))
+                return false;
+
+            nFreeHead = ReadUint32(&vNext[0]);
+        }
+        else
+            nPage = nOverflow++;
+
+        /* Clear the page so it holds no keys. */
+        const std::vector<uint8_t> vEmpty(LINEARMAP_PAGE_SIZE, 0);
+        if(!WriteAt(pOverflow, uint64_t(nPage) * LINEARMAP_PAGE_SIZE, &vEmpty[0], LINEARMAP_PAGE_SIZE))
+            return false;
+
+        WriteMeta();
+
+        return true;
+    }
+
+
+    /* Add an overflow page to the free list. */
+    void BinaryLinearMap::FreePage(const uint32_t nPage)
+    {
+        LOCK(FILE_MUTEX);
+
+        std::vector<uint8_t> vNext(4, 0);
+        WriteUint32(&vNext[0], nFreeHead);
+
+        if(!WriteAt(pOverflow, uint64_t(nPage) * LINEARMAP_PAGE_SIZE, &vNext[0], 4))
+            return;
+
+        nFreeHead = nPage + 1;
+        WriteMeta();
+    }
+
+
+    /* Write the table metadata in place. */
+    void BinaryLinearMap::WriteMeta()
+    {
+        const uint64_t nState = nTable.load();
+
+        DataStream ssMeta(SER_LLD, DATABASE_VERSION);
+        ssMeta << nInitial << uint32_t(nState >> 32) << uint32_t(nState & 0xffffffff) << nOverflow << nFreeHead << nKeys.load();
+
+        WriteAt(pMeta, 0, &ssMeta.Bytes()[0], ssMeta.size());
+    }
+
+
+    /* Split the bucket at the split pointer. */
+    bool BinaryLinearMap::Split()
+    {
+        /* Check the load without waiting on a split in progress. */
+        if(nKeys.load() * 100 <= uint64_t(LINEARMAP_LOAD_PERCENT) * LINEARMAP_BUCKET_SLOTS * TotalBuckets())
+            return false;
+
+        LOCK(SPLIT_MUTEX);
+
+        /* Check again, another split may have made room. */
+        const uint64_t nState = nTable.load();
+        if(nKeys.load() * 100 <= uint64_t(LINEARMAP_LOAD_PERCENT) * LINEARMAP_BUCKET_SLOTS * TotalBuckets())
+            return false;
+
+        /* The bucket at the split pointer gets a partner at the end of the table. */
+        const uint64_t nBuckets = uint64_t(nInitial) << (nState >> 32);
+        const uint32_t nBucket  = static_cast<uint32_t>(nState & 0xffffffff);
+        const uint32_t nNew     = static_cast<uint32_t>(nBucket + nBuckets);
+        if(nBuckets * 2 > std::numeric_limits<uint32_t>::max())
+            return false;
+
+        /* Lock both buckets, they may share a stripe. */
+        std::unique_lock<std::mutex> BUCKET_LOCK(RECORD_MUTEX[nBucket % RECORD_MUTEX.size()]);
+        std::unique_lock<std::mutex> NEW_LOCK;
+        if(nNew % RECORD_MUTEX.size() != nBucket % RECORD_MUTEX.size())
+            NEW_LOCK = std::unique_lock<std::mutex>(RECORD_MUTEX[nNew % RECORD_MUTEX.size()]);
+
+        /* Read the whole chain of the bucket. */
+        std::vector< std::vector<uint8_t> > vPages;
+        std::vector<uint32_t> vChain;
+        if(!ReadChain(nBucket, vPages, vChain))
+            return debug::error(FUNCTION, "failed to read bucket ", nBucket);
+
+        /* Rehash the keys with twice the table size. */
+        std::vector< std::vector<uint8_t> > vStay;
+        std::vector< std::vector<uint8_t> > vMove;
+        for(const auto& vPage : vPages)
+        {
+            for(uint32_t i = 0; i < LINEARMAP_BUCKET_SLOTS; ++i)
+            {
+                const uint8_t* pSlot = &vPage[SlotOffset(i)];
+                if(pSlot[0] == STATE::EMPTY)
+                    continue;
+
+                /* Drop copies left behind by a split that was cut short. */
+                const uint64_t nHash = KeyHash(SlotKey(pSlot));
+                if(Address(nHash, nState) != nBucket)
+                    continue;
+
+                if(nHash % (nBuckets << 1) == nBucket)
+                    vStay.push_back(std::vector<uint8_t>(pSlot, pSlot + LINEARMAP_SLOT_SIZE));
+                else
+                    vMove.push_back(std::vector<uint8_t>(pSlot, pSlot + LINEARMAP_SLOT_SIZE));
+            }
+        }
+
+        /* Write the new bucket before lookups are sent to it. */
+        if(!WriteChain(nNew, std::vector<uint32_t>(), vMove))
+            return false;
+
+        /* Advance the split pointer, starting the next round once every bucket is split. */
+        uint64_t nNext = nState + 1;
+        if((nNext & 0xffffffff) == nBuckets)
+            nNext = ((nState >> 32) + 1) << 32;
+
+        nTable.store(nNext);
+        {
+            LOCK(FILE_MUTEX);
+            WriteMeta();
+        }
+
+        /* Take the moved keys out of the old bucket. */
+        if(!WriteChain(nBucket, vChain, vStay))
+            return false;
+
+        /* Debug output of the split. */
+        if(config::nVerbose >= 4)
+            debug::log(4, FUNCTION, "Split bucket ", nBucket, " into ", nNew,
+                " | Stayed ", vStay.size(),
+                " | Moved ", vMove.size(),
+                " | Buckets ", TotalBuckets());
+
+        return true;
+    }
+}
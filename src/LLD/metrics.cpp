@@ -0,0 +1,312 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#include <LLD/include/metrics.h>
+
+#include <Util/include/mutex.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+namespace LLD
+{
+
+    /* The prefix of every metric name in the Prometheus dump. */
+    const std::string METRICS_PREFIX = "nexus_lld_";
+
+
+    /* The quantiles reported for each histogram. */
+    const double METRICS_QUANTILES[] = { 0.5, 0.99, 0.999 };
+
+
+    /* The JSON keys of the reported quantiles. */
+    const char* METRICS_QUANTILE_KEYS[] = { "p50", "p99", "p999" };
+
+
+    /* The list of every registry, function local so databases built during static init can register. */
+    static std::mutex& RegistryMutex()
+    {
+        static std::mutex REGISTRY_MUTEX;
+        return REGISTRY_MUTEX;
+    }
+
+    static std::vector<Metrics*>& Registry()
+    {
+        static std::vector<Metrics*> vRegistry;
+        return vRegistry;
+    }
+
+
+    /* Get the bucket a value is counted in. */
+    static uint32_t GetBucket(const uint64_t nValue)
+    {
+        /* Small values have a bucket each. */
+        if(nValue < (1u << Histogram::SUB_BITS))
+            return static_cast<uint32_t>(nValue);
+
+        /* The highest set bit picks the power of two, the bits below it pick the bucket within it. */
+        const uint32_t nHigh = 63 - __builtin_clzll(nValue);
+        const uint32_t nSub  = static_cast<uint32_t>(nValue >> (nHigh - Histogram::SUB_BITS)) & ((1u << Histogram::SUB_BITS) - 1);
+
+        return ((nHigh - Histogram::SUB_BITS + 1) << Histogram::SUB_BITS) + nSub;
+    }
+
+
+    /* Get the largest value counted in a bucket. */
+    static uint64_t GetUpper(const uint32_t nBucket)
+    {
+        if(nBucket < (1u << Histogram::SUB_BITS))
+            return nBucket;
+
+        const uint32_t nHigh = (nBucket >> Histogram::SUB_BITS) - 1 + Histogram::SUB_BITS;
+        const uint64_t nSub  = nBucket & ((1u << Histogram::SUB_BITS) - 1);
+        const uint64_t nLow  = ((uint64_t(1) << Histogram::SUB_BITS) + nSub) << (nHigh - Histogram::SUB_BITS);
+
+        return nLow + (uint64_t(1) << (nHigh - Histogram::SUB_BITS)) - 1;
+    }
+
+
+    /* Format a reported value for the Prometheus dump. */
+    static std::string Format(const double dValue)
+    {
+        std::ostringstream ssValue;
+        ssValue.precision(9);
+        ssValue << dValue;
+
+        return ssValue.str();
+    }
+
+
+    /* Default Constructor. */
+    Histogram::Histogram()
+    : nCount (0)
+    , nSum   (0)
+    {
+        for(uint32_t n = 0; n < TOTAL_BUCKETS; ++n)
+            vBuckets[n].store(0, std::memory_order_relaxed);
+    }
+
+
+    /* Count a value. */
+    void Histogram::Record(const uint64_t nValue)
+    {
+        vBuckets[GetBucket(nValue)].fetch_add(1, std::memory_order_relaxed);
+
+        nCount.fetch_add(1, std::memory_order_relaxed);
+        nSum.fetch_add(nValue, std::memory_order_relaxed);
+    }
+
+
+    /* Get the count of all values. */
+    uint64_t Histogram::Count() const
+    {
+        return nCount.load(std::memory_order_relaxed);
+    }
+
+
+    /* Get the sum of all values. */
+    uint64_t Histogram::Sum() const
+    {
+        return nSum.load(std::memory_order_relaxed);
+    }
+
+
+    /* Get the value that the given share of values are at or below. */
+    uint64_t Histogram::Quantile(const double dQuantile) const
+    {
+        /* Take the total from the buckets, the count may be ahead of them while values are recorded. */
+        uint64_t nTotal = 0;
+        for(uint32_t n = 0; n < TOTAL_BUCKETS; ++n)
+            nTotal += vBuckets[n].load(std::memory_order_relaxed);
+
+        if(nTotal == 0)
+            return 0;
+
+        /* Find the bucket holding the value at the rank of the quantile. */
+        const uint64_t nRank = std::max(uint64_t(1), static_cast<uint64_t>(std::ceil(dQuantile * nTotal)));
+
+        uint64_t nSeen = 0;
+        for(uint32_t n = 0; n < TOTAL_BUCKETS; ++n)
+        {
+            nSeen += vBuckets[n].load(std::memory_order_relaxed);
+            if(nSeen >= nRank)
+                return GetUpper(n);
+        }
+
+        return GetUpper(TOTAL_BUCKETS - 1);
+    }
+
+
+    /* Constructor. */
+    Metrics::Metrics(const std::string& strNameIn)
+    : MUTEX         ( )
+    , strName       (strNameIn)
+    , mapValues     ( )
+    , mapHistograms ( )
+    {
+        std::unique_lock<std::mutex> REGISTRY_LOCK(RegistryMutex());
+        Registry().push_back(this);
+    }
+
+
+    /* Default Destructor. */
+    Metrics::~Metrics()
+    {
+        {
+            std::unique_lock<std::mutex> REGISTRY_LOCK(RegistryMutex());
+
+            std::vector<Metrics*>& vRegistry = Registry();
+            vRegistry.erase(std::remove(vRegistry.begin(), vRegistry.end(), this), vRegistry.end());
+        }
+
+        for(auto& histogram : mapHistograms)
+            delete histogram.second.pHistogram;
+    }
+
+
+    /* Add a value that only grows. */
+    void Metrics::Counter(const std::string& strKey, const std::string& strHelp, const std::function<uint64_t()>& fnValue)
+    {
+        LOCK(MUTEX);
+
+        mapValues[strKey] = Value{ strHelp, false, fnValue };
+    }
+
+
+    /* Add a value that goes up and down. */
+    void Metrics::Gauge(const std::string& strKey, const std::string& strHelp, const std::function<uint64_t()>& fnValue)
+    {
+        LOCK(MUTEX);
+
+        mapValues[strKey] = Value{ strHelp, true, fnValue };
+    }
+
+
+    /* Add a histogram, or get it if the key is already added. */
+    Histogram* Metrics::Distribution(const std::string& strKey, const std::string& strHelp, const double dScale)
+    {
+        LOCK(MUTEX);
+
+        auto it = mapHistograms.find(strKey);
+        if(it != mapHistograms.end())
+            return it->second.pHistogram;
+
+        Histogram* pHistogram = new Histogram();
+        mapHistograms[strKey] = Scaled{ strHelp, dScale, pHistogram };
+
+        return pHistogram;
+    }
+
+
+    /* Get the name of the database. */
+    const std::string& Metrics::Name() const
+    {
+        return strName;
+    }
+
+
+    /* Dump the values of this registry. */
+    json::json Metrics::ToJSON() const
+    {
+        LOCK(MUTEX);
+
+        json::json jsonRet;
+        for(const auto& value : mapValues)
+            jsonRet[value.first] = value.second.fnValue();
+
+        for(const auto& histogram : mapHistograms)
+        {
+            const Histogram* pHistogram = histogram.second.pHistogram;
+            const double dScale         = histogram.second.dScale;
+
+            json::json jsonHistogram;
+            jsonHistogram["count"] = pHistogram->Count();
+            jsonHistogram["sum"]   = pHistogram->Sum() * dScale;
+
+            for(uint32_t n = 0; n < 3; ++n)
+                jsonHistogram[METRICS_QUANTILE_KEYS[n]] = pHistogram->Quantile(METRICS_QUANTILES[n]) * dScale;
+
+            jsonRet[histogram.first] = jsonHistogram;
+        }
+
+        return jsonRet;
+    }
+
+
+    /* Dump every registry, by database name. */
+    json::json Metrics::DumpJSON()
+    {
+        std::unique_lock<std::mutex> REGISTRY_LOCK(RegistryMutex());
+
+        json::json jsonRet = json::json::object();
+        for(const auto& pmetrics : Registry())
+            jsonRet[pmetrics->Name()] = pmetrics->ToJSON();
+
+        return jsonRet;
+    }
+
+
+    /* Dump every registry in the Prometheus text format. */
+    std::string Metrics::DumpPrometheus()
+    {
+        std::unique_lock<std::mutex> REGISTRY_LOCK(RegistryMutex());
+
+        /* Group the samples of every database under one header per metric. */
+        std::map<std::string, std::pair<std::string, std::string>> mapMetrics;
+        for(const auto& pmetrics : Registry())
+        {
+            LOCK(pmetrics->MUTEX);
+
+            const std::string strLabel = "database=\"" + pmetrics->strName + "\"";
+            for(const auto& value : pmetrics->mapValues)
+            {
+                const std::string strMetric = METRICS_PREFIX + value.first;
+
+                std::pair<std::string, std::string>& metric = mapMetrics[strMetric];
+                if(metric.first.empty())
+                    metric.first = "# HELP " + strMetric + " " + value.second.strHelp + "\n"
+                                 + "# TYPE " + strMetric + (value.second.fGauge ? " gauge\n" : " counter\n");
+
+                metric.second += strMetric + "{" + strLabel + "} " + std::to_string(value.second.fnValue()) + "\n";
+            }
+
+            for(const auto& histogram : pmetrics->mapHistograms)
+            {
+                const std::string strMetric = METRICS_PREFIX + histogram.first;
+                const Histogram* pHistogram = histogram.second.pHistogram;
+                const double dScale         = histogram.second.dScale;
+
+                std::pair<std::string, std::string>& metric = mapMetrics[strMetric];
+                if(metric.first.empty())
+                    metric.first = "# HELP " + strMetric + " " + histogram.second.strHelp + "\n"
+                                 + "# TYPE " + strMetric + " summary\n";
+
+                for(uint32_t n = 0; n < 3; ++n)
+                    metric.second += strMetric + "{" + strLabel + ",quantile=\"" + Format(METRICS_QUANTILES[n]) + "\"} "
+                                   + Format(pHistogram->Quantile(METRICS_QUANTILES[n]) * dScale) + "\n";
+
+                metric.second += strMetric + "_sum{" + strLabel + "} " + Format(pHistogram->Sum() * dScale) + "\n";
+                metric.second += strMetric + "_count{" + strLabel + "} " + std::to_string(pHistogram->Count()) + "\n";
+            }
+        }
+
+        std::string strRet;
+        for(const auto& metric : mapMetrics)
+            strRet += metric.second.first + metric.second.second;
+
+        return strRet;
+    }
+
+}
@@ -0,0 +1,124 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#include <LLD/templates/mmap.h>
+
+#include <Util/include/debug.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace LLD
+{
+
+    /* Maps the given file into memory. */
+    MemoryMap::MemoryMap(const std::string& strPathIn)
+    : strPath (strPathIn)
+    , pBegin  (nullptr)
+    , nSize   (0)
+    {
+    #ifndef WIN32
+        /* Open the file as read only, the mapping is never written through. */
+        int fd = open(strPath.c_str(), O_RDONLY);
+        if(fd < 0)
+        {
+            debug::error(FUNCTION, "failed to open ", strPath, " (", strerror(errno), ")");
+            return;
+        }
+
+        /* Get the current file size. */
+        struct stat st;
+        if(fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            close(fd);
+            return;
+        }
+
+        /* Map the file. A shared mapping sees writes made through the file streams. */
+        void* pMap = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+        /* The descriptor is no longer needed once the mapping exists. */
+        close(fd);
+
+        /* Check for mapping failures. */
+        if(pMap == MAP_FAILED)
+        {
+            debug::error(FUNCTION, "failed to map ", strPath, " (", strerror(errno), ")");
+            return;
+        }
+
+        /* Records are read at random positions. */
+        madvise(pMap, st.st_size, MADV_RANDOM);
+
+        pBegin = static_cast<uint8_t*>(pMap);
+        nSize  = static_cast<uint64_t>(st.st_size);
+    #endif
+    }
+
+
+    /* Default Destructor */
+    MemoryMap::~MemoryMap()
+    {
+    #ifndef WIN32
+        if(pBegin)
+            munmap(pBegin, nSize);
+    #endif
+    }
+
+
+    /* Determines if the file failed to map. */
+    bool MemoryMap::IsNull() const
+    {
+        return pBegin == nullptr;
+    }
+
+
+    /* Returns the total bytes that are mapped. */
+    uint64_t MemoryMap::Size() const
+    {
+        return nSize;
+    }
+
+
+    /* Copy a range of the mapped file into a buffer. */
+    bool MemoryMap::Read(const uint64_t nStart, std::vector<uint8_t>& vData) const
+    {
+        /* Check that the range is inside the mapping. */
+        if(IsNull() || nStart + vData.size() > nSize)
+            return false;
+
+        /* Copy the record out of the mapping. */
+        std::copy(pBegin + nStart, pBegin + nStart + vData.size(), vData.begin());
+
+        return true;
+    }
+
+
+    /* Get a pointer into the mapping. */
+    const uint8_t* MemoryMap::Data(const uint64_t nStart) const
+    {
+        /* Check that the position is inside the mapping. */
+        if(IsNull() || nStart > nSize)
+            return nullptr;
+
+        return pBegin + nStart;
+    }
+}
@@ -0,0 +1,922 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#include <LLD/keychain/orderedmap.h>
+#include <LLD/templates/key.h>
+#include <LLD/templates/mmap.h>
+#include <LLD/include/version.h>
+
+#include <Util/templates/datastream.h>
+#include <Util/include/filesystem.h>
+#include <Util/include/debug.h>
+#include <Util/include/hex.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <limits>
+
+namespace LLD
+{
+
+    /* The bytes of an entry before its key, the serialized SectorKey. */
+    static const uint32_t ORDEREDMAP_HEADER_SIZE = 13;
+
+
+    /* The bytes of the trailer at the end of a run, the end of the entries, the total keys and the erased keys. */
+    static const uint32_t ORDEREDMAP_TRAILER_SIZE = 24;
+
+
+    /* Compare a binary key with the key of an entry, in the same order as std::map. */
+    static int32_t CompareKey(const uint8_t* pKey, const uint64_t nLength, const std::vector<uint8_t>& vKey)
+    {
+        const int32_t nCompare = memcmp(pKey, vKey.data(), std::min(nLength, uint64_t(vKey.size())));
+        if(nCompare != 0)
+            return nCompare;
+
+        if(nLength == vKey.size())
+            return 0;
+
+        return (nLength < vKey.size()) ? -1 : 1;
+    }
+
+
+    /* Serialize an entry, the sector key followed by the binary key. */
+    static void WriteEntry(const SectorKey& cKey, DataStream& ssEntry)
+    {
+        ssEntry << cKey;
+        ssEntry.write((char*)cKey.vKey.data(), cKey.vKey.size());
+    }
+
+
+    /*  One immutable sorted file of keys. */
+    struct OrderedRun
+    {
+    public:
+
+        /** The file number of the run. **/
+        uint32_t nFile;
+
+        /** The mapping of the file. **/
+        std::unique_ptr<MemoryMap> pMap;
+
+        /** The file read into memory, where it can't be mapped. **/
+        std::vector<uint8_t> vData;
+
+        /** The beginning of the file bytes. **/
+        const uint8_t* pBegin;
+
+        /** The end of the entries, where the sparse index begins. **/
+        uint64_t nEnd;
+
+        /** The total entries of the run. **/
+        uint64_t nKeys;
+
+        /** The entries of the run that are erased keys. **/
+        uint64_t nErased;
+
+        /** Every ORDEREDMAP_INDEX_INTERVAL'th key and its position. **/
+        std::vector< std::pair<std::vector<uint8_t>, uint64_t> > vIndex;
+
+        /** Constructor **/
+        OrderedRun(const uint32_t nFileIn)
+        : nFile   (nFileIn)
+        , pMap    ( )
+        , vData   ( )
+        , pBegin  (nullptr)
+        , nEnd    (0)
+        , nKeys   (0)
+        , nErased (0)
+        , vIndex  ( )
+        {
+        }
+
+
+        /** Read the entry at a position and move past it, false at the end of the entries. **/
+        bool Read(uint64_t& nPos, SectorKey& cKey) const
+        {
+            /* Check the header is inside the entries. */
+            if(nPos + ORDEREDMAP_HEADER_SIZE > nEnd)
+                return false;
+
+            /* Copy the header out in the same layout it was serialized in. */
+            const uint8_t* pEntry = pBegin + nPos;
+            cKey.nState = pEntry[0];
+            std::copy(pEntry + 1, pEntry + 3,  (uint8_t*)&cKey.nLength);
+            std::copy(pEntry + 3, pEntry + 5,  (uint8_t*)&cKey.nSectorFile);
+            std::copy(pEntry + 5, pEntry + 9,  (uint8_t*)&cKey.nSectorSize);
+            std::copy(pEntry + 9, pEntry + 13, (uint8_t*)&cKey.nSectorStart);
+
+            /* Check the key is inside the entries. */
+            if(nPos + ORDEREDMAP_HEADER_SIZE + cKey.nLength > nEnd)
+                return false;
+
+            cKey.vKey.assign(pEntry + ORDEREDMAP_HEADER_SIZE, pEntry + ORDEREDMAP_HEADER_SIZE + cKey.nLength);
+            nPos += ORDEREDMAP_HEADER_SIZE + cKey.nLength;
+
+            return true;
+        }
+
+
+        /** Get the position of the index block that may hold the first key not less than vKey. **/
+        uint64_t Seek(const std::vector<uint8_t>& vKey) const
+        {
+            auto it = std::upper_bound(vIndex.begin(), vIndex.end(), vKey,
+                [](const std::vector<uint8_t>& vFind, const std::pair<std::vector<uint8_t>, uint64_t>& entry)
+                {
+                    return vFind < entry.first;
+                });
+
+            /* The block before the first index key greater than vKey. */
+            if(it == vIndex.begin())
+                return 0;
+
+            return (--it)->second;
+        }
+
+
+        /** Find the entry of a key. **/
+        bool Find(const std::vector<uint8_t>& vKey, SectorKey& cKey) const
+        {
+            /* Scan the block the key would be in. */
+            uint64_t nPos = Seek(vKey);
+            for(uint32_t n = 0; n <= ORDEREDMAP_INDEX_INTERVAL; ++n)
+            {
+                /* Check the key before copying it out. */
+                if(nPos + ORDEREDMAP_HEADER_SIZE > nEnd)
+                    return false;
+
+                uint16_t nLength = 0;
+                std::copy(pBegin + nPos + 1, pBegin + nPos + 3, (uint8_t*)&nLength);
+                if(nPos + ORDEREDMAP_HEADER_SIZE + nLength > nEnd)
+                    return false;
+
+                const int32_t nCompare = CompareKey(pBegin + nPos + ORDEREDMAP_HEADER_SIZE, nLength, vKey);
+                if(nCompare > 0)
+                    return false;
+
+                if(nCompare == 0)
+                    return Read(nPos, cKey);
+
+                nPos += ORDEREDMAP_HEADER_SIZE + nLength;
+            }
+
+            return false;
+        }
+    };
+
+
+    /*  Position in a sorted source of entries, used to merge runs and memory tables in key order. */
+    struct OrderedCursor
+    {
+        /** The run being read, null when reading a memory table copy. **/
+        std::shared_ptr<OrderedRun> pRun;
+
+        /** The position of the next entry in the run. **/
+        uint64_t nPos;
+
+        /** The memory table copy being read. **/
+        std::vector<SectorKey> vMemory;
+
+        /** The next entry of the memory table copy. **/
+        uint64_t nMemory;
+
+        /** The current entry. **/
+        SectorKey cKey;
+
+        /** Flag for if the current entry is valid. **/
+        bool fValid;
+
+        /** Constructor **/
+        OrderedCursor()
+        : pRun    ( )
+        , nPos    (0)
+        , vMemory ( )
+        , nMemory (0)
+        , cKey    ( )
+        , fValid  (false)
+        {
+        }
+
+
+        /** Move to the next entry. **/
+        void Next()
+        {
+            if(pRun)
+                fValid = pRun->Read(nPos, cKey);
+            else
+            {
+                fValid = (nMemory < vMemory.size());
+                if(fValid)
+                    cKey = vMemory[nMemory++];
+            }
+        }
+
+
+        /** Move to the first entry not less than vKey. **/
+        void Seek(const std::vector<uint8_t>& vKey)
+        {
+            if(pRun)
+                nPos = pRun->Seek(vKey);
+
+            do
+                Next();
+            while(fValid && cKey.vKey < vKey);
+        }
+    };
+
+
+    /* Read the sources in key order, giving the newest entry of each key, newest source last. */
+    static void MergeCursors(std::vector<OrderedCursor>& vCursors, const std::function<bool(const SectorKey&)>& fnEntry)
+    {
+        while(true)
+        {
+            /* Find the least key, taking the newest source on ties. */
+            int32_t nLeast = -1;
+            for(uint32_t n = 0; n < vCursors.size(); ++n)
+            {
+                if(!vCursors[n].fValid)
+                    continue;
+
+                if(nLeast == -1 || !(vCursors[nLeast].cKey.vKey < vCursors[n].cKey.vKey))
+                    nLeast = n;
+            }
+
+            /* Check for the end of every source. */
+            if(nLeast == -1)
+                return;
+
+            /* Copy out the entry, since moving the cursors past it overwrites it. */
+            const SectorKey cKey = vCursors[nLeast].cKey;
+
+            /* Move every source past the key. */
+            for(auto& cursor : vCursors)
+                if(cursor.fValid && cursor.cKey.vKey == cKey.vKey)
+                    cursor.Next();
+
+            if(!fnEntry(cKey))
+                return;
+        }
+    }
+
+
+    /* The Database Constructor. */
+    BinaryOrderedMap::BinaryOrderedMap(const std::string& strBaseLocationIn, const uint8_t nFlagsIn, const uint64_t nBucketsIn)
+    : KEY_MUTEX       ( )
+    , MERGE_MUTEX     ( )
+    , strBaseLocation (strBaseLocationIn)
+    , mapMemory       ( )
+    , nMemoryBytes    (0)
+    , vRuns           ( )
+    , nNextRun        (0)
+    , pLog            (nullptr)
+    , nFlags          (nFlagsIn)
+    {
+        Initialize();
+    }
+
+
+    /* Default Destructor */
+    BinaryOrderedMap::~BinaryOrderedMap()
+    {
+        LOCK(KEY_MUTEX);
+
+        /* Write out the memory table so the log doesn't have to be replayed on the next start. */
+        if(pLog && !mapMemory.empty())
+            FlushMemory();
+
+        if(pLog)
+            delete pLog;
+    }
+
+
+    /* Load the sorted runs and replay the log into the memory table. */
+    void BinaryOrderedMap::Initialize()
+    {
+        LOCK(KEY_MUTEX);
+
+        /* Create directories if they don't exist yet. */
+        if(!filesystem::exists(strBaseLocation) && filesystem::create_directories(strBaseLocation))
+            debug::log(0, FUNCTION, "Generated Path ", strBaseLocation);
+
+        /* Read the list of live runs. */
+        std::vector<uint32_t> vLive;
+        {
+            std::ifstream stream(strBaseLocation + "_orderedmap.runs", std::ios::in | std::ios::binary | std::ios::ate);
+            if(stream)
+            {
+                std::vector<uint8_t> vManifest(static_cast<uint64_t>(stream.tellg()), 0);
+                stream.seekg(0, std::ios::beg);
+                stream.read((char*)vManifest.data(), vManifest.size());
+
+                try
+                {
+                    DataStream ssManifest(vManifest, SER_LLD, DATABASE_VERSION);
+                    ssManifest >> nNextRun >> vLive;
+                }
+                catch(const std::exception& e)
+                {
+                    debug::error(FUNCTION, "damaged run list: ", e.what());
+                }
+            }
+        }
+
+        /* Load the runs, and remove runs left over from a merge or flush that didn't finish. */
+        for(uint32_t nFile = 0; nFile < nNextRun; ++nFile)
+        {
+            const std::string strFile = debug::safe_printstr(strBaseLocation, "_orderedmap.", std::setfill('0'), std::setw(5), nFile);
+            if(std::find(vLive.begin(), vLive.end(), nFile) == vLive.end())
+            {
+                if(filesystem::exists(strFile))
+                    filesystem::remove(strFile);
+
+                continue;
+            }
+
+            std::shared_ptr<OrderedRun> pRun = LoadRun(nFile);
+            if(!pRun)
+            {
+                debug::error(FUNCTION, "failed to load run ", nFile);
+                continue;
+            }
+
+            vRuns.push_back(pRun);
+        }
+
+        /* Replay the log into the memory table. */
+        {
+            std::ifstream stream(strBaseLocation + "_orderedmap.log", std::ios::in | std::ios::binary | std::ios::ate);
+            if(stream)
+            {
+                std::shared_ptr<OrderedRun> pLogRun = std::make_shared<OrderedRun>(0);
+                pLogRun->vData.resize(static_cast<uint64_t>(stream.tellg()));
+                stream.seekg(0, std::ios::beg);
+                stream.read((char*)pLogRun->vData.data(), pLogRun->vData.size());
+
+                pLogRun->pBegin = pLogRun->vData.data();
+                pLogRun->nEnd   = pLogRun->vData.size();
+
+                /* A torn entry at the end was never acknowledged, so stop there. */
+                uint64_t nPos = 0;
+                SectorKey cKey;
+                while(pLogRun->Read(nPos, cKey))
+                {
+                    nMemoryBytes += ORDEREDMAP_HEADER_SIZE + cKey.vKey.size();
+                    mapMemory[cKey.vKey] = cKey;
+                }
+            }
+        }
+
+        /* Open the log for new keys. */
+        if(!(nFlags & FLAGS::READONLY))
+        {
+            pLog = new std::ofstream(strBaseLocation + "_orderedmap.log", std::ios::out | std::ios::binary | std::ios::app);
+            if(!pLog->is_open())
+                debug::error(FUNCTION, "failed to open log");
+        }
+
+        debug::log(0, FUNCTION, "Loaded ", vRuns.size(), " runs and ", mapMemory.size(), " logged keys");
+    }
+
+
+    /* Read a key from the keychain. */
+    bool BinaryOrderedMap::Get(const std::vector<uint8_t>& vKey, SectorKey &cKey)
+    {
+        LOCK(KEY_MUTEX);
+
+        /* Find the newest entry, an erased entry hides older ones. */
+        if(!Find(vKey, cKey) || !cKey.Ready())
+            return false;
+
+        /* Debug Output of Sector Key Information. */
+        if(config::nVerbose >= 4)
+            debug::log(4, FUNCTION, "State: ", cKey.nState == STATE::READY ? "Valid" : "Invalid",
+                " | Length: ", cKey.nLength,
+                " | Sector File: ", cKey.nSectorFile,
+                " | Sector Size: ", cKey.nSectorSize,
+                " | Sector Start: ", cKey.nSectorStart,
+                " | Key: ", HexStr(vKey.begin(), vKey.end()));
+
+        return true;
+    }
+
+
+    /* Write a key to the keychain. */
+    bool BinaryOrderedMap::Put(const SectorKey& cKey)
+    {
+        {
+            LOCK(KEY_MUTEX);
+
+            if(!Append(cKey))
+                return false;
+
+            /* Keep writing into memory until the memory table is full. */
+            if(nMemoryBytes < ORDEREDMAP_MAX_MEMORY)
+                return true;
+
+            if(!FlushMemory())
+                return false;
+        }
+
+        /* Merge runs of similar size, without blocking readers. */
+        return Merge(false);
+    }
+
+
+    /* Flush the log to disk. */
+    void BinaryOrderedMap::Flush()
+    {
+        LOCK(KEY_MUTEX);
+
+        if(pLog)
+            pLog->flush();
+    }
+
+
+    /* Restore an erased key from keychain. */
+    bool BinaryOrderedMap::Restore(const std::vector<uint8_t>& vKey)
+    {
+        LOCK(KEY_MUTEX);
+
+        /* Find the erased entry, which keeps the location the key had. */
+        SectorKey cKey;
+        if(!Find(vKey, cKey))
+            return false;
+
+        /* Skip over keys that aren't erased. */
+        if(cKey.Ready())
+            return true;
+
+        cKey.nState = STATE::READY;
+        return Append(cKey);
+    }
+
+
+    /* Erase a key from the keychain. */
+    bool BinaryOrderedMap::Erase(const std::vector<uint8_t>& vKey)
+    {
+        LOCK(KEY_MUTEX);
+
+        /* Check the key is there to erase. */
+        SectorKey cKey;
+        if(!Find(vKey, cKey) || !cKey.Ready())
+            return false;
+
+        /* Write an erased entry over the key, keeping its location for Restore. */
+        cKey.nState = STATE::EMPTY;
+        return Append(cKey);
+    }
+
+
+    /* Read the keys from vBegin up to but not including vEnd, in key order. */
+    bool BinaryOrderedMap::Range(const std::vector<uint8_t>& vBegin, const std::vector<uint8_t>& vEnd,
+                                 std::vector<SectorKey>& vKeys, const uint32_t nLimit)
+    {
+        /* Take the runs and a copy of the range of the memory table, then read without the lock. */
+        std::vector<OrderedCursor> vCursors;
+        {
+            LOCK(KEY_MUTEX);
+
+            for(const auto& pRun : vRuns)
+            {
+                vCursors.emplace_back();
+                vCursors.back().pRun = pRun;
+            }
+
+            vCursors.emplace_back();
+            for(auto it = mapMemory.lower_bound(vBegin); it != mapMemory.end(); ++it)
+            {
+                if(!vEnd.empty() && !(it->first < vEnd))
+                    break;
+
+                vCursors.back().vMemory.push_back(it->second);
+            }
+        }
+
+        for(auto& cursor : vCursors)
+            cursor.Seek(vBegin);
+
+        /* Merge the sources, skipping erased keys. */
+        const uint64_t nStart = vKeys.size();
+        MergeCursors(vCursors, [&](const SectorKey& cKey)
+        {
+            if(!vEnd.empty() && !(cKey.vKey < vEnd))
+                return false;
+
+            if(cKey.Ready())
+                vKeys.push_back(cKey);
+
+            return vKeys.size() - nStart < nLimit;
+        });
+
+        return vKeys.size() > nStart;
+    }
+
+
+    /* Get the total buckets of the keychain. */
+    uint32_t BinaryOrderedMap::TotalBuckets() const
+    {
+        return 1;
+    }
+
+
+    /* Get the number of runs and memory tables a lookup may read. */
+    uint16_t BinaryOrderedMap::Depth(const uint32_t nBucket) const
+    {
+        LOCK(KEY_MUTEX);
+
+        return static_cast<uint16_t>(vRuns.size() + (mapMemory.empty() ? 0 : 1));
+    }
+
+
+    /* Read the live keys of the tree in key order, without merging any runs. */
+    bool BinaryOrderedMap::ScanBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys)
+    {
+        Range(std::vector<uint8_t>(), std::vector<uint8_t>(), vKeys, std::numeric_limits<uint32_t>::max());
+
+        return true;
+    }
+
+
+    /* Write out the memory table and merge every run into one. */
+    bool BinaryOrderedMap::CompactBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys)
+    {
+        {
+            LOCK(KEY_MUTEX);
+
+            if(!mapMemory.empty() && !FlushMemory())
+                return false;
+        }
+
+        if(!Merge(true))
+            return false;
+
+        Range(std::vector<uint8_t>(), std::vector<uint8_t>(), vKeys, std::numeric_limits<uint32_t>::max());
+
+        return true;
+    }
+
+
+    /* Point a key at a new sector location. */
+    bool BinaryOrderedMap::Relocate(const uint32_t nBucket, const SectorKey& cKey, const uint16_t nSectorFile, const uint32_t nSectorStart)
+    {
+        LOCK(KEY_MUTEX);
+
+        /* Check the key wasn't updated or erased since it was read. */
+        SectorKey cCurrent;
+        if(!Find(cKey.vKey, cCurrent) || !cCurrent.Ready())
+            return true;
+
+        if(cCurrent.nSectorFile != cKey.nSectorFile || cCurrent.nSectorStart != cKey.nSectorStart
+        || cCurrent.nSectorSize != cKey.nSectorSize)
+            return true;
+
+        cCurrent.nSectorFile  = nSectorFile;
+        cCurrent.nSectorStart = nSectorStart;
+
+        return Append(cCurrent);
+    }
+
+
+    /* Find the newest entry of a key, including erased ones. */
+    bool BinaryOrderedMap::Find(const std::vector<uint8_t>& vKey, SectorKey& cKey) const
+    {
+        /* Check the memory table first. */
+        auto it = mapMemory.find(vKey);
+        if(it != mapMemory.end())
+        {
+            cKey = it->second;
+            return true;
+        }
+
+        /* Check the runs from newest to oldest. */
+        for(auto run = vRuns.rbegin(); run != vRuns.rend(); ++run)
+            if((*run)->Find(vKey, cKey))
+                return true;
+
+        return false;
+    }
+
+
+    /* Write an entry to the log and memory table. */
+    bool BinaryOrderedMap::Append(const SectorKey& cKey)
+    {
+        if(!pLog || !pLog->is_open())
+            return debug::error(FUNCTION, "keychain is read only");
+
+        /* Keep the key length with the key. */
+        SectorKey cEntry = cKey;
+        cEntry.nLength   = static_cast<uint16_t>(cKey.vKey.size());
+
+        /* Write the entry to the log before it is visible. */
+        DataStream ssEntry(SER_LLD, DATABASE_VERSION);
+        WriteEntry(cEntry, ssEntry);
+
+        if(!pLog->write((char*)ssEntry.data(), ssEntry.size()))
+            return debug::error(FUNCTION, "failed to write to log");
+
+        pLog->flush();
+
+        /* Add to the memory table, a key written twice is only counted once. */
+        auto it = mapMemory.find(cEntry.vKey);
+        if(it == mapMemory.end())
+        {
+            nMemoryBytes += ssEntry.size();
+            mapMemory.emplace(cEntry.vKey, cEntry);
+        }
+        else
+            it->second = cEntry;
+
+        return true;
+    }
+
+
+    /* Write the memory table out as a new run and clear the log. */
+    bool BinaryOrderedMap::FlushMemory()
+    {
+        /* Write the run. */
+        auto it = mapMemory.begin();
+        std::shared_ptr<OrderedRun> pRun = WriteRun(nNextRun++, [&](SectorKey& cKey)
+        {
+            if(it == mapMemory.end())
+                return false;
+
+            cKey = (it++)->second;
+            return true;
+        });
+
+        if(!pRun)
+            return false;
+
+        /* Make the run live. */
+        vRuns.push_back(pRun);
+        if(!WriteManifest())
+        {
+            vRuns.pop_back();
+            return false;
+        }
+
+        /* The keys are in the run, so start a new log. */
+        delete pLog;
+        pLog = new std::ofstream(strBaseLocation + "_orderedmap.log", std::ios::out | std::ios::binary | std::ios::trunc);
+
+        mapMemory.clear();
+        nMemoryBytes = 0;
+
+        return true;
+    }
+
+
+    /* Merge the newest runs into one. */
+    bool BinaryOrderedMap::Merge(const bool fAll)
+    {
+        LOCK(MERGE_MUTEX);
+
+        /* Pick the runs to merge. */
+        std::vector< std::shared_ptr<OrderedRun> > vInputs;
+        bool fOldest = false;
+        uint32_t nFile = 0;
+        {
+            LOCK(KEY_MUTEX);
+
+            /* Take the newest runs while the next older run is no more than twice their size. */
+            uint64_t nCount = 1, nTotal = vRuns.empty() ? 0 : vRuns.back()->nEnd;
+            while(nCount < vRuns.size() && vRuns[vRuns.size() - nCount - 1]->nEnd <= nTotal * 2)
+                nTotal += vRuns[vRuns.size() - ++nCount]->nEnd;
+
+            /* Merge everything if asked or if there are too many runs. */
+            if(fAll || vRuns.size() > ORDEREDMAP_MAX_RUNS)
+                nCount = vRuns.size();
+
+            /* A single run is only rewritten to drop its erased keys. */
+            if(nCount == 0 || (nCount == 1 && !(fAll && vRuns.back()->nErased > 0)))
+                return true;
+
+            vInputs.assign(vRuns.end() - nCount, vRuns.end());
+            fOldest = (nCount == vRuns.size());
+            nFile   = nNextRun++;
+        }
+
+        /* Merge the runs in key order, oldest source first so ties go to the newest. */
+        std::vector<OrderedCursor> vCursors(vInputs.size());
+        for(uint32_t n = 0; n < vInputs.size(); ++n)
+        {
+            vCursors[n].pRun = vInputs[n];
+            vCursors[n].Next();
+        }
+
+        /* Collect the merged entries a block at a time, to stream them into the new run. */
+        std::vector<SectorKey> vBlock;
+        uint64_t nBlock = 0;
+        bool fEnd = false;
+        auto fnFill = [&]()
+        {
+            vBlock.clear();
+            nBlock = 0;
+
+            MergeCursors(vCursors, [&](const SectorKey& cKey)
+            {
+                /* Erased keys can be dropped once there is nothing older for them to hide. */
+                if(fOldest && !cKey.Ready())
+                    return true;
+
+                vBlock.push_back(cKey);
+                return vBlock.size() < 1024;
+            });
+
+            fEnd = vBlock.empty();
+        };
+
+        fnFill();
+        std::shared_ptr<OrderedRun> pRun = WriteRun(nFile, [&](SectorKey& cKey)
+        {
+            if(nBlock == vBlock.size())
+                fnFill();
+
+            if(fEnd)
+                return false;
+
+            cKey = vBlock[nBlock++];
+            return true;
+        });
+
+        if(!pRun)
+            return false;
+
+        /* Swap the merged run in for its inputs, newer runs may have been added behind them. */
+        {
+            LOCK(KEY_MUTEX);
+
+            auto it = std::find(vRuns.begin(), vRuns.end(), vInputs.front());
+            if(it == vRuns.end())
+                return debug::error(FUNCTION, "merged runs were replaced");
+
+            it = vRuns.erase(it, it + vInputs.size());
+            vRuns.insert(it, pRun);
+
+            if(!WriteManifest())
+                return false;
+        }
+
+        /* Remove the inputs, readers still holding them keep their mappings. */
+        for(const auto& pInput : vInputs)
+            filesystem::remove(debug::safe_printstr(strBaseLocation, "_orderedmap.", std::setfill('0'), std::setw(5), pInput->nFile));
+
+        debug::log(3, FUNCTION, "Merged ", vInputs.size(), " runs into ", pRun->nKeys, " keys");
+
+        return true;
+    }
+
+
+    /* Write a sorted run file, and load it. */
+    std::shared_ptr<OrderedRun> BinaryOrderedMap::WriteRun(const uint32_t nFile, const std::function<bool(SectorKey&)>& fnNext)
+    {
+        const std::string strFile = debug::safe_printstr(strBaseLocation, "_orderedmap.", std::setfill('0'), std::setw(5), nFile);
+
+        std::ofstream stream(strFile, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!stream)
+        {
+            debug::error(FUNCTION, "failed to create run ", nFile);
+            return nullptr;
+        }
+
+        /* Write the entries, indexing every ORDEREDMAP_INDEX_INTERVAL'th key. */
+        std::vector< std::pair<std::vector<uint8_t>, uint64_t> > vIndex;
+        uint64_t nEnd = 0, nKeys = 0, nErased = 0;
+
+        DataStream ssEntries(SER_LLD, DATABASE_VERSION);
+        SectorKey cKey;
+        while(fnNext(cKey))
+        {
+            if(nKeys % ORDEREDMAP_INDEX_INTERVAL == 0)
+                vIndex.push_back(std::make_pair(cKey.vKey, nEnd + ssEntries.size()));
+
+            cKey.nLength = static_cast<uint16_t>(cKey.vKey.size());
+            WriteEntry(cKey, ssEntries);
+
+            ++nKeys;
+            if(!cKey.Ready())
+                ++nErased;
+
+            /* Write out in blocks. */
+            if(ssEntries.size() >= 1024 * 1024)
+            {
+                stream.write((char*)ssEntries.data(), ssEntries.size());
+                nEnd += ssEntries.size();
+                ssEntries.SetNull();
+            }
+        }
+
+        stream.write((char*)ssEntries.data(), ssEntries.size());
+        nEnd += ssEntries.size();
+
+        /* Write the sparse index and the trailer. */
+        DataStream ssFooter(SER_LLD, DATABASE_VERSION);
+        ssFooter << vIndex << nEnd << nKeys << nErased;
+
+        stream.write((char*)ssFooter.data(), ssFooter.size());
+        stream.close();
+
+        if(!stream)
+        {
+            debug::error(FUNCTION, "failed to write run ", nFile);
+            return nullptr;
+        }
+
+        return LoadRun(nFile);
+    }
+
+
+    /* Map a sorted run file and read its sparse index. */
+    std::shared_ptr<OrderedRun> BinaryOrderedMap::LoadRun(const uint32_t nFile)
+    {
+        const std::string strFile = debug::safe_printstr(strBaseLocation, "_orderedmap.", std::setfill('0'), std::setw(5), nFile);
+
+        std::shared_ptr<OrderedRun> pRun = std::make_shared<OrderedRun>(nFile);
+
+        /* Map the file, or read it into memory where it can't be mapped. */
+        uint64_t nSize = 0;
+        pRun->pMap.reset(new MemoryMap(strFile));
+        if(!pRun->pMap->IsNull())
+        {
+            pRun->pBegin = pRun->pMap->Data(0);
+            nSize        = pRun->pMap->Size();
+        }
+        else
+        {
+            std::ifstream stream(strFile, std::ios::in | std::ios::binary | std::ios::ate);
+            if(!stream)
+                return nullptr;
+
+            pRun->vData.resize(static_cast<uint64_t>(stream.tellg()));
+            stream.seekg(0, std::ios::beg);
+            stream.read((char*)pRun->vData.data(), pRun->vData.size());
+
+            pRun->pBegin = pRun->vData.data();
+            nSize        = pRun->vData.size();
+        }
+
+        /* Read the trailer and the sparse index before it. */
+        if(nSize < ORDEREDMAP_TRAILER_SIZE)
+            return nullptr;
+
+        try
+        {
+            const DataStream ssTrailer(std::vector<uint8_t>(pRun->pBegin + nSize - ORDEREDMAP_TRAILER_SIZE, pRun->pBegin + nSize), SER_LLD, DATABASE_VERSION);
+            ssTrailer >> pRun->nEnd >> pRun->nKeys >> pRun->nErased;
+
+            if(pRun->nEnd > nSize - ORDEREDMAP_TRAILER_SIZE)
+                return nullptr;
+
+            const DataStream ssIndex(std::vector<uint8_t>(pRun->pBegin + pRun->nEnd, pRun->pBegin + nSize - ORDEREDMAP_TRAILER_SIZE), SER_LLD, DATABASE_VERSION);
+            ssIndex >> pRun->vIndex;
+        }
+        catch(const std::exception& e)
+        {
+            debug::error(FUNCTION, "damaged run ", nFile, ": ", e.what());
+            return nullptr;
+        }
+
+        return pRun;
+    }
+
+
+    /* Replace the list of live runs on disk in one rename. */
+    bool BinaryOrderedMap::WriteManifest()
+    {
+        std::vector<uint32_t> vLive;
+        for(const auto& pRun : vRuns)
+            vLive.push_back(pRun->nFile);
+
+        DataStream ssManifest(SER_LLD, DATABASE_VERSION);
+        ssManifest << nNextRun << vLive;
+
+        /* Write a new list beside the old one. */
+        const std::string strManifest = strBaseLocation + "_orderedmap.runs";
+        {
+            std::ofstream stream(strManifest + ".tmp", std::ios::out | std::ios::binary | std::ios::trunc);
+            stream.write((char*)ssManifest.data(), ssManifest.size());
+            stream.close();
+
+            if(!stream)
+                return debug::error(FUNCTION, "failed to write run list");
+        }
+
+        /* Swap it in, so a crash leaves either list whole. */
+        if(!filesystem::rename(strManifest + ".tmp", strManifest))
+            return debug::error(FUNCTION, "failed to replace run list");
+
+        return true;
+    }
+}
@@ -261,6 +261,13 @@ namespace LLD
     }
 
 
+    /* Read a state register as it was when a read view of the register database was opened. */
+    bool RegisterDB::ReadState(const ReadView& view, const uint256_t& hashRegister, TAO::Register::State& state)
+    {
+        return Read(view, std::make_pair(std::string("state"), hashRegister), state);
+    }
+
+
     /* Erase a state register from the register database. */
     bool RegisterDB::EraseState(const uint256_t& hashRegister, const uint8_t nFlags)
     {
@@ -12,23 +12,63 @@
 ____________________________________________________________________________________________*/
 
 #include <LLD/templates/sector.h>
+#include <LLD/templates/bulk.h>
+#include <LLD/include/compress.h>
+#include <LLD/hash/xxh3.h>
 
+#include <LLD/cache/binary_clock.h>
 #include <LLD/cache/binary_lfu.h>
 #include <LLD/cache/binary_lru.h>
 
 #include <LLD/keychain/filemap.h>
 #include <LLD/keychain/hashmap.h>
+#include <LLD/keychain/linearmap.h>
+#include <LLD/keychain/orderedmap.h>
 #include <LLD/keychain/shard_hashmap.h>
 #include <LLD/keychain/hashtree.h>
 
 #include <Util/include/filesystem.h>
 #include <Util/include/hex.h>
 
+#include <algorithm>
+#include <cstring>
 #include <functional>
+#include <limits>
 
 namespace LLD
 {
 
+    /* Check the checksum that ends a record of a checksummed database. */
+    static bool VerifyChecksum(const uint8_t* pData, const uint64_t nSize)
+    {
+        if(nSize < RECORD_CHECKSUM_SIZE)
+            return false;
+
+        uint64_t nChecksum = 0;
+        std::memcpy(&nChecksum, pData + nSize - RECORD_CHECKSUM_SIZE, RECORD_CHECKSUM_SIZE);
+
+        return XXH3_64bits(pData, nSize - RECORD_CHECKSUM_SIZE) == nChecksum;
+    }
+
+
+    /* Read the compact size in front of a record, false if the bytes run out first. */
+    static bool ReadRecordSize(const uint8_t* pData, const uint64_t nAvailable, uint64_t& nHeader, uint64_t& nSize)
+    {
+        if(nAvailable == 0)
+            return false;
+
+        nHeader = (pData[0] < 253) ? 1 : (pData[0] == 253) ? 3 : (pData[0] == 254) ? 5 : 9;
+        if(nHeader > nAvailable)
+            return false;
+
+        nSize = (nHeader == 1) ? pData[0] : 0;
+        for(uint64_t i = nHeader - 1; i > 0; --i)
+            nSize = (nSize << 8) | pData[i];
+
+        return true;
+    }
+
+
     /* The Database Constructor. To determine file location and the Bytes per Record. */
     template<class KeychainType, class CacheType>
     SectorDatabase<KeychainType, CacheType>::SectorDatabase(const std::string& strNameIn,
@@ -37,24 +77,50 @@ namespace LLD
     : CONDITION_MUTEX()
     , CONDITION()
     , SECTOR_MUTEX()
-    , BUFFER_MUTEX()
     , TRANSACTION_MUTEX()
+    , MAP_MUTEX()
     , strBaseLocation(config::GetDataDir() + strNameIn + "/datachain/")
     , strName(strNameIn)
     , runtime()
     , pTransaction(nullptr)
+    , pVersions(std::make_shared<VersionStore>())
     , pSectorKeys(new KeychainType((config::GetDataDir() + strName + "/keychain/"), nFlagsIn, nBucketsIn))
     , cachePool(new CacheType(nCacheIn))
+    , pBudget(pCacheBudget)
+    , nBudgetPool(0)
     , fileCache(new TemplateLRU<uint32_t, std::fstream*>(8))
+    , mapMemory()
+    , mapMappedAt()
+    , setUnmapped()
     , nCurrentFile(0)
     , nCurrentFileSize(0)
     , CacheWriterThread()
     , MeterThread()
-    , vDiskBuffer()
+    , CompactorThread()
+    , ScrubberThread()
+    , vRetired()
+    , queueDisk()
     , nBufferBytes(0)
+    , nMaxBufferBytes(static_cast<uint32_t>(std::max(config::GetArg("-lldbuffer", MAX_SECTOR_BUFFER_SIZE), int64_t(1))))
+    , nBufferWaiting(0)
+    , fWriterWaiting(false)
+    , nBufferPeak(0)
+    , nBufferStalls(0)
+    , nStallMicroseconds(0)
+    , nBatchesFlushed(0)
+    , nRecordsCoalesced(0)
     , nBytesRead(0)
     , nBytesWrote(0)
     , nRecordsFlushed(0)
+    , nCacheHits(0)
+    , nCacheMisses(0)
+    , nFlushes(0)
+    , nBytesScrubbed(0)
+    , nRecordsDamaged(0)
+    , metrics(strNameIn)
+    , pGetLatency(nullptr)
+    , pPutLatency(nullptr)
+    , pCommitLatency(nullptr)
     , fDestruct(false)
     , fInitialized(false)
     , nFlags(nFlagsIn)
@@ -66,6 +132,41 @@ namespace LLD
         /* Initialize the Database. */
         Initialize();
 
+        /* Register the metrics, which are read when dumped. */
+        metrics.Counter("read_bytes_total",          "Bytes of keys and records read.",                     [this]{ return nBytesRead.load(); });
+        metrics.Counter("write_bytes_total",         "Bytes of records written to sector files.",           [this]{ return nBytesWrote.load(); });
+        metrics.Counter("records_written_total",     "Records written to sector files.",                    [this]{ return nRecordsFlushed.load(); });
+        metrics.Counter("cache_hits_total",          "Reads served by the cache pool.",                     [this]{ return nCacheHits.load(); });
+        metrics.Counter("cache_misses_total",        "Reads that missed the cache pool.",                   [this]{ return nCacheMisses.load(); });
+        metrics.Counter("flushes_total",             "Flushes of sector file streams to the OS.",           [this]{ return nFlushes.load(); });
+        metrics.Counter("buffer_stalls_total",       "Puts that waited for the disk buffer to drain.",      [this]{ return nBufferStalls.load(); });
+        metrics.Counter("buffer_stall_microseconds", "Time puts waited for the disk buffer to drain.",      [this]{ return nStallMicroseconds.load(); });
+        metrics.Counter("batches_total",             "Batches written by the cache writer.",                [this]{ return nBatchesFlushed.load(); });
+        metrics.Counter("coalesced_total",           "Puts dropped for a later put of the same key.",       [this]{ return nRecordsCoalesced.load(); });
+        metrics.Counter("scrubbed_bytes_total",      "Bytes of sector files verified by the scrubber.",     [this]{ return nBytesScrubbed.load(); });
+        metrics.Counter("damaged_records_total",     "Records that failed their checksum on a read or scrub.", [this]{ return nRecordsDamaged.load(); });
+        metrics.Gauge("buffer_bytes",                "Bytes put and not yet written to the keychain.",      [this]{ return uint64_t(nBufferBytes.load()); });
+        metrics.Gauge("buffer_peak_bytes",           "Most bytes the disk buffer has held.",                [this]{ return uint64_t(nBufferPeak.load()); });
+        metrics.Gauge("buffer_max_bytes",            "Bytes the disk buffer holds before puts wait.",       [this]{ return uint64_t(nMaxBufferBytes); });
+        metrics.Gauge("snapshots",                   "Read views open.",                                    [this]{ return pVersions->Pinned(); });
+        metrics.Gauge("snapshot_versions",           "Records kept for the open read views.",               [this]{ return pVersions->Versions(); });
+        metrics.Gauge("cache_capacity_bytes",        "Bytes the cache pool holds before evicting.",         [this]{ return cachePool->Capacity(); });
+        metrics.Counter("cache_ghost_hits_total",    "Misses on keys the cache pool evicted recently.",     [this]{ return cachePool->Ghosts(); });
+
+        pGetLatency    = metrics.Distribution("get_seconds",    "Time taken to read a record by key.",       1e-9);
+        pPutLatency    = metrics.Distribution("put_seconds",    "Time taken to write or buffer a record.",   1e-9);
+        pCommitLatency = metrics.Distribution("commit_seconds", "Time taken to commit a transaction.",       1e-9);
+
+        pSectorKeys->Instrument(metrics);
+
+        /* Share the cache budget if there is one, starting from the size asked for. */
+        if(pBudget)
+        {
+            nBudgetPool = pBudget->Register(strName, nCacheIn,
+                [this](const uint64_t nCapacity){ cachePool->Resize(nCapacity); },
+                [this]{ return cachePool->Ghosts(); });
+        }
+
         if(config::GetBoolArg("-runtime", false))
         {
             debug::log(0, ANSI_COLOR_GREEN FUNCTION, "executed in ",
@@ -74,6 +175,8 @@ namespace LLD
 
         CacheWriterThread = std::thread(std::bind(&SectorDatabase::CacheWriter, this));
         MeterThread = std::thread(std::bind(&SectorDatabase::Meter, this));
+        CompactorThread = std::thread(std::bind(&SectorDatabase::Compactor, this));
+        ScrubberThread = std::thread(std::bind(&SectorDatabase::Scrubber, this));
     }
 
 
@@ -90,6 +193,16 @@ namespace LLD
         if(MeterThread.joinable())
             MeterThread.join();
 
+        if(CompactorThread.joinable())
+            CompactorThread.join();
+
+        if(ScrubberThread.joinable())
+            ScrubberThread.join();
+
+        /* Leave the budget before the cache pool is gone. */
+        if(pBudget)
+            pBudget->Unregister(nBudgetPool);
+
         if(pTransaction)
             delete pTransaction;
 
@@ -104,6 +217,30 @@ namespace LLD
     }
 
 
+    /*  Get the counters of the buffered write path. */
+    template<class KeychainType, class CacheType>
+    WriterStats SectorDatabase<KeychainType, CacheType>::GetWriterStats() const
+    {
+        WriterStats stats;
+        stats.nBufferBytes       = nBufferBytes.load();
+        stats.nBufferPeak        = nBufferPeak.load();
+        stats.nStalls            = nBufferStalls.load();
+        stats.nStallMicroseconds = nStallMicroseconds.load();
+        stats.nBatches           = nBatchesFlushed.load();
+        stats.nCoalesced         = nRecordsCoalesced.load();
+
+        return stats;
+    }
+
+
+    /*  Get the metrics registry of this database. */
+    template<class KeychainType, class CacheType>
+    const Metrics& SectorDatabase<KeychainType, CacheType>::GetMetrics() const
+    {
+        return metrics;
+    }
+
+
     /*  Initialize Sector Database. */
     template<class KeychainType, class CacheType>
     void SectorDatabase<KeychainType, CacheType>::Initialize()
@@ -144,6 +281,46 @@ namespace LLD
             ++nCurrentFile;
         }
 
+        /* Check the encoding flags the sector files were written with, their records can't be read with others. */
+        const std::string strEncoding = strBaseLocation + "_encoding";
+        std::ifstream ssEncoding(strEncoding, std::ios::in | std::ios::binary);
+        if(ssEncoding)
+        {
+            uint8_t nStored = 0;
+            if(!ssEncoding.read((char*)&nStored, 1))
+                throw debug::exception(FUNCTION, strName, " failed to read ", strEncoding);
+
+            /* Keep the checksums of a database created with -lldchecksum, it only decides for new ones. */
+            if(nStored & FLAGS::CHECKSUM)
+                nFlags |= FLAGS::CHECKSUM;
+
+            const uint8_t nEncoding = (nFlags & ENCODING_FLAGS);
+            if(nStored != nEncoding)
+                throw debug::exception(FUNCTION, strName, " was written with encoding flags ", uint32_t(nStored),
+                    " and can't be opened with ", uint32_t(nEncoding));
+        }
+        else
+        {
+            /* Checksum the records of a new database if asked to. */
+            const bool fNew = (nCurrentFile == 0 && nCurrentFileSize == 0);
+            if(fNew && config::GetBoolArg("-lldchecksum", false))
+                nFlags |= FLAGS::CHECKSUM;
+
+            /* Databases with records from before the flags were recorded were written without any. */
+            const uint8_t nEncoding = (nFlags & ENCODING_FLAGS);
+            if(nEncoding != 0 && !fNew)
+                throw debug::exception(FUNCTION, strName, " was written without encoding flags and can't be opened with ",
+                    uint32_t(nEncoding));
+
+            /* Record the flags for the next time the database is opened. */
+            if(!(nFlags & FLAGS::READONLY))
+            {
+                std::ofstream ssStored(strEncoding, std::ios::out | std::ios::binary | std::ios::trunc);
+                if(!ssStored.write((char*)&nEncoding, 1))
+                    debug::error(FUNCTION, strName, " failed to write ", strEncoding);
+            }
+        }
+
         pTransaction = nullptr;
         fInitialized = true;
     }
@@ -153,17 +330,26 @@ namespace LLD
     template<class KeychainType, class CacheType>
     bool SectorDatabase<KeychainType, CacheType>::Get(const std::vector<uint8_t>& vKey, std::vector<uint8_t>& vData)
     {
+        LatencyTimer latency(pGetLatency);
+
         /* Iterate if meters are enabled. */
         nBytesRead += static_cast<uint32_t>(vKey.size() + vData.size());
 
         /* Check the cache pool for key first. */
         if(cachePool->Get(vKey, vData))
+        {
+            ++nCacheHits;
             return true;
+        }
+
+        ++nCacheMisses;
 
         /* Get the key from the keychain. */
         SectorKey cKey;
         if(pSectorKeys->Get(vKey, cKey))
         {
+            /* Read through the memory map if enabled, falling back to the file streams. */
+            if(!(nFlags & FLAGS::MAPPED) || !ReadMapped(cKey, vData))
             {
                 LOCK(SECTOR_MUTEX);
 
@@ -198,6 +384,10 @@ namespace LLD
 
             }
 
+            /* Check and decompress the record, the cache holds it decoded. */
+            if(!Decode(vData))
+                return debug::error(FUNCTION, "damaged record in file ", cKey.nSectorFile, " at ", cKey.nSectorStart);
+
             /* Add to cache */
             cachePool->Put(cKey, vKey, vData);
 
@@ -218,14 +408,16 @@ namespace LLD
     template<class KeychainType, class CacheType>
     bool SectorDatabase<KeychainType, CacheType>::Get(const SectorKey& cKey, std::vector<uint8_t>& vData)
     {
-        {
-            LOCK(SECTOR_MUTEX);
+        nBytesRead += static_cast<uint32_t>(cKey.vKey.size() + vData.size());
 
-            nBytesRead += static_cast<uint32_t>(cKey.vKey.size() + vData.size());
+        /* Check the cache pool for key first. */
+        if(cachePool->Get(cKey.vKey, vData))
+            return true;
 
-            /* Check the cache pool for key first. */
-            if(cachePool->Get(cKey.vKey, vData))
-                return true;
+        /* Read through the memory map if enabled, falling back to the file streams. */
+        if(!(nFlags & FLAGS::MAPPED) || !ReadMapped(cKey, vData))
+        {
+            LOCK(SECTOR_MUTEX);
 
             /* Find the file stream for LRU cache. */
             std::fstream *pstream;
@@ -262,368 +454,1797 @@ namespace LLD
                     " | Current File Size: ", cKey.nSectorStart, "\n", HexStr(vData.begin(), vData.end(), true));
         }
 
+        /* Check and decompress the record. */
+        if(!Decode(vData))
+            return debug::error(FUNCTION, "damaged record in file ", cKey.nSectorFile, " at ", cKey.nSectorStart);
+
         return true;
     }
 
 
-    /*  Update a record on disk. */
+    /*  Get a record from cache or from disk as a view of the cached or memory mapped buffer. */
     template<class KeychainType, class CacheType>
-    bool SectorDatabase<KeychainType, CacheType>::Update(const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData)
+    bool SectorDatabase<KeychainType, CacheType>::Get(const std::vector<uint8_t>& vKey, ViewStream& ssData)
     {
-        /* Check the keychain for key. */
-        SectorKey key;
-        if(!pSectorKeys->Get(vKey, key))
-            return false;
+        LatencyTimer latency(pGetLatency);
 
-        /* Get current size */
-        uint64_t nSize = vData.size() + GetSizeOfCompactSize(vData.size());
+        /* Share the cached buffer if the key is in the cache pool. */
+        std::shared_ptr<const std::vector<uint8_t>> pCached;
+        if(cachePool->Get(vKey, pCached))
+        {
+            ++nCacheHits;
+            nBytesRead += static_cast<uint32_t>(vKey.size() + pCached->size());
+
+            ssData.SetView(pCached, pCached->data(), pCached->size());
+            return true;
+        }
+
+        ++nCacheMisses;
 
-        /* Check data size constraints. */
-        if(nSize != key.nSectorSize)
+        /* Get the key from the keychain. */
+        SectorKey cKey;
+        if(!pSectorKeys->Get(vKey, cKey))
             return false;
 
-        /* Write the data into the memory cache. */
-        cachePool->Put(key, vKey, vData, false);
+        nBytesRead += static_cast<uint32_t>(vKey.size() + cKey.nSectorSize);
 
+        /* View the record in the memory map, which already serves as a cache of the file. Compressed records have to be copied out.
+         * A mapped database never rewrites a record in place (see Update and Delete), and compaction doesn't truncate a file
+         * while its mapping is held, so the bytes checked here are the bytes the view deserializes. */
+        if((nFlags & FLAGS::MAPPED) && !(nFlags & FLAGS::COMPRESS))
         {
-            LOCK(SECTOR_MUTEX);
-
-            /* Find the file stream for LRU cache. */
-            std::fstream* pstream;
-            if(!fileCache->Get(key.nSectorFile, pstream))
+            std::shared_ptr<MemoryMap> pmap = GetMapped(cKey);
+            if(pmap)
             {
-                /* Set the new stream pointer. */
-                pstream = new std::fstream(debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), key.nSectorFile), std::ios::in | std::ios::out | std::ios::binary);
-                if(!pstream->is_open())
+                /* Get compact size from record. */
+                uint64_t nSize = GetSizeOfCompactSize(cKey.nSectorSize);
+
+                const uint8_t* pRecord = pmap->Data(cKey.nSectorStart + nSize);
+                uint64_t nRecord       = cKey.nSectorSize - nSize;
+
+                /* Check the checksum in place, and leave it out of the view. */
+                if(nFlags & FLAGS::CHECKSUM)
                 {
-                    delete pstream;
-                    return false;
+                    if(!VerifyChecksum(pRecord, nRecord))
+                    {
+                        ++nRecordsDamaged;
+                        return debug::error(FUNCTION, "damaged record in file ", cKey.nSectorFile, " at ", cKey.nSectorStart);
+                    }
+
+                    nRecord -= RECORD_CHECKSUM_SIZE;
                 }
 
-                /* If file not found add to LRU cache. */
-                fileCache->Put(key.nSectorFile, pstream);
+                ssData.SetView(pmap, pRecord, nRecord);
+                return true;
             }
+        }
 
-            /* If it is a New Sector, Assign a Binary Position. */
-            pstream->seekp(key.nSectorStart, std::ios::beg);
+        /* Read through the file streams into a buffer the view owns. */
+        std::shared_ptr<std::vector<uint8_t>> pRecord = std::make_shared<std::vector<uint8_t>>();
+        if(!Get(cKey, *pRecord))
+            return false;
 
-            /* Write the size of record. */
-            WriteCompactSize(*pstream, vData.size());
+        /* Add to cache */
+        cachePool->Put(cKey, vKey, *pRecord);
 
-            /* Write the data record. */
-            if(!pstream->write((char*) &vData[0], vData.size()))
-                return debug::error(FUNCTION, "only ", pstream->gcount(), "/", vData.size(), " bytes written");
+        ssData.SetView(pRecord, pRecord->data(), pRecord->size());
+        return true;
+    }
 
-            pstream->flush();
 
-            /* Records flushed indicator. */
-            ++nRecordsFlushed;
-            nBytesWrote += static_cast<uint32_t>(vData.size());
+    /*  Get many records from cache or from disk. */
+    template<class KeychainType, class CacheType>
+    uint32_t SectorDatabase<KeychainType, CacheType>::BatchGet(const std::vector< std::vector<uint8_t> >& vKeys, std::vector< std::vector<uint8_t> >& vData)
+    {
+        /* Clear any remaining data. */
+        vData.clear();
+        vData.resize(vKeys.size());
+
+        /* Check the cache pool for each key first. */
+        uint32_t nFound = 0;
+        std::vector< std::vector<uint8_t> > vMissing;
+        std::vector<uint32_t> vIndexes;
+        for(uint32_t n = 0; n < vKeys.size(); ++n)
+        {
+            if(cachePool->Get(vKeys[n], vData[n]))
+            {
+                ++nCacheHits;
+                ++nFound;
+                continue;
+            }
 
-            /* Verbose output. */
-            if(config::nVerbose >= 5)
-                debug::log(5, FUNCTION, "Current File: ", key.nSectorFile,
-                    " | Current File Size: ", key.nSectorStart, "\n", HexStr(vData.begin(), vData.end(), true));
+            ++nCacheMisses;
+
+            vMissing.push_back(vKeys[n]);
+            vIndexes.push_back(n);
         }
 
-        return true;
-    }
+        /* Get the rest from the keychain in one batch, which sharded keychains look up in parallel. */
+        std::vector< std::pair<SectorKey, uint32_t> > vSectors;
+        pSectorKeys->BatchGet(vMissing, vSectors);
 
+        for(auto& sector : vSectors)
+            sector.second = vIndexes[sector.second];
 
-    /*  Force a write to disk immediately bypassing write buffers. */
-    template<class KeychainType, class CacheType>
-    bool SectorDatabase<KeychainType, CacheType>::Force(const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData)
-    {
-        if(nFlags & FLAGS::APPEND || !Update(vKey, vData))
+        /* Sort the disk reads by file and binary position. */
+        std::sort(vSectors.begin(), vSectors.end(),
+            [](const std::pair<SectorKey, uint32_t>& a, const std::pair<SectorKey, uint32_t>& b)
+            {
+                if(a.first.nSectorFile != b.first.nSectorFile)
+                    return a.first.nSectorFile < b.first.nSectorFile;
+
+                return a.first.nSectorStart < b.first.nSectorStart;
+            });
+
+        /* Read through the memory map if enabled, leaving the rest for the file streams. */
+        std::vector< std::pair<SectorKey, uint32_t> > vPending;
+        for(const auto& sector : vSectors)
+        {
+            if(!(nFlags & FLAGS::MAPPED) || !ReadMapped(sector.first, vData[sector.second]))
+            {
+                vData[sector.second].clear();
+                vPending.push_back(sector);
+            }
+        }
+
+        /* Read the remaining records, merging records close together on disk into one read. */
         {
+            LOCK(SECTOR_MUTEX);
 
+            std::vector<uint8_t> vSpan;
+            for(uint32_t nBegin = 0, nEnd = 0; nBegin < vPending.size(); nBegin = nEnd)
             {
-                LOCK(SECTOR_MUTEX);
+                /* Get the first record of this read. */
+                const SectorKey& cFirst = vPending[nBegin].first;
 
-                /* Create new file if above current file size. */
-                if(nCurrentFileSize > MAX_SECTOR_FILE_SIZE)
+                /* Extend the read over following records in the same file that are close enough. */
+                uint64_t nSpanStart = cFirst.nSectorStart;
+                uint64_t nSpanEnd   = nSpanStart + cFirst.nSectorSize;
+                for(nEnd = nBegin + 1; nEnd < vPending.size(); ++nEnd)
                 {
-                    debug::log(4, FUNCTION, "allocating new sector file ", nCurrentFile + 1);
-
-                    ++nCurrentFile;
-                    nCurrentFileSize = 0;
+                    const SectorKey& cNext = vPending[nEnd].first;
+                    if(cNext.nSectorFile != cFirst.nSectorFile
+                    || cNext.nSectorStart > nSpanEnd + MAX_BATCH_READ_GAP
+                    || cNext.nSectorStart + cNext.nSectorSize > nSpanStart + MAX_BATCH_READ_SIZE)
+                        break;
 
-                    std::ofstream stream
-                    (
-                        debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), nCurrentFile),
-                        std::ios::out | std::ios::binary | std::ios::trunc
-                    );
-                    stream.close();
+                    nSpanEnd = std::max(nSpanEnd, uint64_t(cNext.nSectorStart + cNext.nSectorSize));
                 }
 
                 /* Find the file stream for LRU cache. */
                 std::fstream* pstream;
-                if(!fileCache->Get(nCurrentFile, pstream))
+                if(!fileCache->Get(cFirst.nSectorFile, pstream))
                 {
                     /* Set the new stream pointer. */
-                    pstream = new std::fstream(debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), nCurrentFile), std::ios::in | std::ios::out | std::ios::binary);
+                    pstream = new std::fstream(debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), cFirst.nSectorFile), std::ios::in | std::ios::out | std::ios::binary);
                     if(!pstream->is_open())
                     {
                         delete pstream;
-                        return false;
+
+                        debug::error(FUNCTION, "couldn't create stream file");
+                        continue;
                     }
 
                     /* If file not found add to LRU cache. */
-                    fileCache->Put(nCurrentFile, pstream);
+                    fileCache->Put(cFirst.nSectorFile, pstream);
                 }
 
-                /* If it is a New Sector, Assign a Binary Position. */
-                pstream->seekp(nCurrentFileSize, std::ios::beg);
+                /* Seek to the start of the span on disk. */
+                pstream->seekg(nSpanStart, std::ios::beg);
 
-                /* Write the size of record. */
-                WriteCompactSize(*pstream, vData.size());
+                /* Read the whole span, a short read only loses the records past the end. */
+                vSpan.resize(nSpanEnd - nSpanStart);
+                pstream->read((char*) &vSpan[0], vSpan.size());
 
-                /* Write the data record. */
-                if(!pstream->write((char*) &vData[0], vData.size()))
-                    return debug::error(FUNCTION, "only ", pstream->gcount(), "/", vData.size(), " bytes written");
+                uint64_t nRead = pstream->gcount();
+                pstream->clear();
 
-                pstream->flush();
-            }
+                /* Iterate if meters are enabled. */
+                nBytesRead += static_cast<uint32_t>(nRead);
 
-            /* Get current size */
-            uint64_t nSize = vData.size() + GetSizeOfCompactSize(vData.size());
+                /* Copy each record out of the span. */
+                for(uint32_t n = nBegin; n < nEnd; ++n)
+                {
+                    const SectorKey& cKey = vPending[n].first;
 
-            /* Create a new Sector Key. */
-            SectorKey key(STATE::READY, vKey, static_cast<uint16_t>(nCurrentFile),
-                            nCurrentFileSize, static_cast<uint32_t>(nSize));
+                    /* Get compact size from record. */
+                    uint64_t nSize        = GetSizeOfCompactSize(cKey.nSectorSize);
+                    uint64_t nRecordStart = cKey.nSectorStart + nSize - nSpanStart;
+                    uint64_t nRecordEnd   = cKey.nSectorStart + cKey.nSectorSize - nSpanStart;
 
-            /* Increment the current filesize */
-            nCurrentFileSize += static_cast<uint32_t>(nSize);
+                    /* Check that the record was fully read. */
+                    if(nRecordEnd > nRead)
+                    {
+                        debug::error(FUNCTION, "only ", nRead, "/", nRecordEnd, " bytes read");
+                        continue;
+                    }
 
-            /* Records flushed indicator. */
-            ++nRecordsFlushed;
-            nBytesWrote += static_cast<uint32_t>(nSize);
+                    vData[vPending[n].second].assign(vSpan.begin() + nRecordStart, vSpan.begin() + nRecordEnd);
+                }
+            }
+        }
 
-            /* Assign the Key to Keychain. */
-            if(!pSectorKeys->Put(key))
-                return debug::error(FUNCTION, "failed to write key to keychain");
+        /* Add the records read from disk to the cache. */
+        for(const auto& sector : vSectors)
+        {
+            std::vector<uint8_t>& vRecord = vData[sector.second];
+            if(vRecord.empty())
+                continue;
 
-            /* Write the data into the memory cache. */
-            cachePool->Put(key, vKey, vData, false);
+            /* Check and decompress the record, dropping it if it is damaged. */
+            if(!Decode(vRecord))
+            {
+                debug::error(FUNCTION, "damaged record in file ", sector.first.nSectorFile, " at ", sector.first.nSectorStart);
 
-            /* Verboe output. */
-            if(config::nVerbose >= 5)
-                debug::log(5, FUNCTION, "Current File: ", key.nSectorFile,
-                    " | Current File Size: ", key.nSectorStart, "\n", HexStr(vData.begin(), vData.end(), true));
+                vRecord.clear();
+                continue;
+            }
+
+            cachePool->Put(sector.first, vKeys[sector.second], vRecord);
+            ++nFound;
         }
 
-        return true;
+        return nFound;
     }
 
 
-    /*  Write a record into the cache and disk buffer for flushing to disk. */
+    /*  Get the records with keys from vBegin up to but not including vEnd, in key order. */
     template<class KeychainType, class CacheType>
-    bool SectorDatabase<KeychainType, CacheType>::Put(const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData)
+    uint32_t SectorDatabase<KeychainType, CacheType>::RangeGet(const std::vector<uint8_t>& vBegin, const std::vector<uint8_t>& vEnd,
+                                                               std::vector< std::vector<uint8_t> >& vData, const uint32_t nLimit)
     {
-        /* Handle force write mode. */
-        if(nFlags & FLAGS::FORCE)
-            return Force(vKey, vData);
+        /* Clear any remaining data. */
+        vData.clear();
 
-        /* Wait if the buffer is full. */
-        if(nBufferBytes.load() >= MAX_SECTOR_BUFFER_SIZE)
-        {
-            std::unique_lock<std::mutex> CONDITION_LOCK(CONDITION_MUTEX);
-            CONDITION.wait(CONDITION_LOCK, [this]{ return fDestruct.load() || nBufferBytes.load() < MAX_SECTOR_BUFFER_SIZE; });
-        }
+        /* Get the keys in order from the keychain. */
+        std::vector<SectorKey> vKeys;
+        if(!pSectorKeys->Range(vBegin, vEnd, vKeys, nLimit))
+            return 0;
 
-        /* Add to the write buffer thread. */
+        /* Read the records, which are already located so the keychain isn't read again. */
+        vData.reserve(vKeys.size());
+        for(const auto& cKey : vKeys)
         {
-            LOCK(BUFFER_MUTEX);
+            /* Skip keychain only entries. */
+            if(cKey.nSectorSize == 0)
+                continue;
 
-            vDiskBuffer.push_back(std::make_pair(vKey, vData));
-            nBufferBytes += static_cast<uint32_t>(vKey.size() + vData.size());
-        }
+            std::vector<uint8_t> vRecord;
+            if(!Get(cKey, vRecord))
+                continue;
 
-        /* Notify if buffer was added to. */
-        CONDITION.notify_all();
+            vData.push_back(std::move(vRecord));
+        }
 
-        return true;
+        return static_cast<uint32_t>(vData.size());
     }
 
 
-    /*  Update a record on disk. */
+    /*  Read a record through the memory mapped sector file. */
     template<class KeychainType, class CacheType>
-    bool SectorDatabase<KeychainType, CacheType>::Delete(const std::vector<uint8_t>& vKey)
+    bool SectorDatabase<KeychainType, CacheType>::ReadMapped(const SectorKey& cKey, std::vector<uint8_t>& vData)
     {
-        /* Check the keychain for key. */
-        SectorKey key;
-        if(!pSectorKeys->Get(vKey, key))
-            return false;
+        /* Get compact size from record. */
+        uint64_t nSize = GetSizeOfCompactSize(cKey.nSectorSize);
 
-        /* Return the Key existance in the Keychain Database. */
-        if(!pSectorKeys->Erase(vKey))
+        /* Get the mapping covering the record. */
+        std::shared_ptr<MemoryMap> pmap = GetMapped(cKey);
+        if(!pmap)
             return false;
 
-        /* Check that this key isn't a keychain only entry. */
-        if(key.nSectorFile ==0 && key.nSectorSize == 0 && key.nSectorStart == 0)
-            return true;
+        /* Resize for proper record length. */
+        vData.resize(cKey.nSectorSize - nSize);
 
-        {
-            LOCK(SECTOR_MUTEX);
+        /* Copy the record out of the mapping without holding any locks. */
+        return pmap->Read(cKey.nSectorStart + nSize, vData);
+    }
 
-            /* Find the file stream for LRU cache. */
-            std::fstream* pstream;
-            if(!fileCache->Get(key.nSectorFile, pstream))
-            {
-                /* Set the new stream pointer. */
-                pstream = new std::fstream(debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), key.nSectorFile), std::ios::in | std::ios::out | std::ios::binary);
-                if(!pstream->is_open())
-                {
-                    delete pstream;
-                    return false;
-                }
 
-                /* If file not found add to LRU cache. */
-                fileCache->Put(key.nSectorFile, pstream);
-            }
+    /*  Get the bytes of a record as written to disk. */
+    template<class KeychainType, class CacheType>
+    void SectorDatabase<KeychainType, CacheType>::Encode(const std::vector<uint8_t>& vData, std::vector<uint8_t>& vDisk) const
+    {
+        if(nFlags & FLAGS::COMPRESS)
+            Compress(vData, vDisk);
+        else
+            vDisk = vData;
 
-            /* If it is a New Sector, Assign a Binary Position. */
-            pstream->seekg(key.nSectorStart, std::ios::beg);
+        /* The checksum covers the bytes on disk, so damage is caught before decompressing. */
+        if(nFlags & FLAGS::CHECKSUM)
+        {
+            const uint64_t nChecksum = XXH3_64bits(vDisk.data(), vDisk.size());
+            vDisk.insert(vDisk.end(), (uint8_t*)&nChecksum, (uint8_t*)&nChecksum + RECORD_CHECKSUM_SIZE);
+        }
+    }
 
-            /* Write the size of record. */
-            uint64_t nSize = ReadCompactSize(*pstream);
 
-            /* Seek to write at specific location. */
-            pstream->seekp(key.nSectorStart + GetSizeOfCompactSize(nSize), std::ios::beg);
+    /*  Check the checksum of a record read from disk and decompress it. */
+    template<class KeychainType, class CacheType>
+    bool SectorDatabase<KeychainType, CacheType>::Decode(std::vector<uint8_t>& vData)
+    {
+        if(nFlags & FLAGS::CHECKSUM)
+        {
+            if(!VerifyChecksum(vData.data(), vData.size()))
+            {
+                ++nRecordsDamaged;
+                return false;
+            }
 
-            /* Update the record with blank data. */
-            DataStream ssData(SER_LLD, DATABASE_VERSION);
-            ssData << std::string("NONE");
-            ssData.resize(nSize);
+            vData.resize(vData.size() - RECORD_CHECKSUM_SIZE);
+        }
 
-            /* Write the data record. */
-            if(!pstream->write((char*)ssData.data(), ssData.size()))
-                return debug::error(FUNCTION, "only ", pstream->gcount(), " bytes written");
+        if(!(nFlags & FLAGS::COMPRESS))
+            return true;
 
-            /* Flush the rest of the write buffer in stream. */
-            pstream->flush();
+        std::vector<uint8_t> vCompressed;
+        vCompressed.swap(vData);
+
+        if(!Decompress(vCompressed, vData))
+        {
+            ++nRecordsDamaged;
+            return false;
         }
 
         return true;
     }
 
 
-    /*  Flushes periodically data from the cache buffer to disk. */
+    /*  Get the current memory mapping of a record's sector file. */
     template<class KeychainType, class CacheType>
-    void SectorDatabase<KeychainType, CacheType>::CacheWriter()
+    std::shared_ptr<MemoryMap> SectorDatabase<KeychainType, CacheType>::GetMapped(const SectorKey& cKey)
     {
-        /* Wait for initialization. */
-        while(!fInitialized)
-            runtime::sleep(100);
-
-        /* Check if writing is enabled. */
-        if(!(nFlags & FLAGS::WRITE) && !(nFlags & FLAGS::APPEND))
-            return;
-
-        /* No cache write on force mode. */
-        if(nFlags & FLAGS::FORCE)
-        {
-            debug::log(0, FUNCTION, strBaseLocation, " in FORCE mode... closing");
-            return;
-        }
+        /* The mapping has to reach the end of the record. */
+        const uint64_t nEnd = cKey.nSectorStart + cKey.nSectorSize;
 
+        /* Take the flush generation before mapping, so a flush while mapping is picked up by the next read. */
+        const uint64_t nGeneration = nFlushes.load();
 
-        while(true)
+        /* Get the current mapping of the sector file. */
+        std::shared_ptr<MemoryMap> pmap;
         {
-            /* Wait for buffer to empty before shutting down. */
-            if((fDestruct.load()) && nBufferBytes.load() == 0)
-                return;
+            LOCK(MAP_MUTEX);
 
-            /* Check for data to be written. */
-            std::unique_lock<std::mutex> CONDITION_LOCK(CONDITION_MUTEX);
-            CONDITION.wait(CONDITION_LOCK, [this]{ return fDestruct.load() || nBufferBytes.load() > 0; });
+            /* Files being truncated by compaction are read through the file streams. */
+            if(setUnmapped.count(cKey.nSectorFile))
+                return nullptr;
 
-            /* Swap the buffer object to get ready for writes. */
-            std::vector< std::pair<std::vector<uint8_t>, std::vector<uint8_t>> > vIndexes;
+            auto it = mapMemory.find(cKey.nSectorFile);
+            if(it != mapMemory.end())
             {
-                LOCK(BUFFER_MUTEX);
+                pmap = it->second;
 
-                vIndexes.swap(vDiskBuffer);
-                nBufferBytes = 0;
+                /* Check the record is inside the current mapping. */
+                if(pmap->Size() >= nEnd)
+                    return pmap;
+
+                /* Nothing was flushed since the file was last mapped, so a new mapping wouldn't reach the record either. */
+                if(mapMappedAt[cKey.nSectorFile] == nGeneration)
+                    return nullptr;
             }
+        }
 
-            /* Create a new file if the sector file size is over file size limits. */
-            if(nCurrentFileSize > MAX_SECTOR_FILE_SIZE)
-            {
-                debug::log(0, FUNCTION, "allocating new sector file ", nCurrentFile + 1);
+        /* Remap the file since the record is past the end of the current mapping. */
+        pmap = std::make_shared<MemoryMap>(
+            debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), cKey.nSectorFile));
 
-                /* Iterate the current file and reset current file sie. */
-                ++nCurrentFile;
-                nCurrentFileSize = 0;
+        /* Check for mapping failures. */
+        if(pmap->IsNull())
+            return nullptr;
 
-                /* Create a new file for next writes. */
-                std::fstream stream(debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), nCurrentFile), std::ios::out | std::ios::binary | std::ios::trunc);
-                stream.close();
-            }
+        /* Swap in the new mapping, readers of the old mapping release it when done. */
+        {
+            LOCK(MAP_MUTEX);
 
-            /* Iterate through buffer to queue disk writes. */
-            for(const auto& vObj : vIndexes)
-            {
-                /* Force write data. */
-                Force(vObj.first, vObj.second);
+            /* Don't hand out a mapping of a file compaction started to truncate since. */
+            if(setUnmapped.count(cKey.nSectorFile))
+                return nullptr;
 
-                /* Set no longer reserved in cache pool. */
-                cachePool->Reserve(vObj.first, false);
-            }
+            std::shared_ptr<MemoryMap>& pcurrent = mapMemory[cKey.nSectorFile];
+            if(!pcurrent || pcurrent->Size() < pmap->Size())
+                pcurrent = pmap;
 
-            /* Notify the condition. */
-            CONDITION.notify_all();
+            /* Remap the file at most once for each flush. */
+            uint64_t& nMappedAt = mapMappedAt[cKey.nSectorFile];
+            nMappedAt = std::max(nMappedAt, nGeneration);
+        }
 
-            /* Verbose logging. */
-            debug::log(3, FUNCTION, "Flushed ", nRecordsFlushed.load(),
-                " Records of ", nBytesWrote.load(), " Bytes");
+        /* Check the file had been flushed far enough to map the record. */
+        if(pmap->Size() < nEnd)
+            return nullptr;
 
-            /* Reset counters if not in meter mode. */
-            if(!config::GetBoolArg("-meters"))
+        return pmap;
+    }
+
+
+    /*  Update a record on disk. */
+    template<class KeychainType, class CacheType>
+    bool SectorDatabase<KeychainType, CacheType>::Update(const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData, const bool fFlush)
+    {
+        /* Mapped reads copy records without the sector lock, so a record is appended again rather than rewritten under them. */
+        if(nFlags & FLAGS::MAPPED)
+            return false;
+
+        {
+            /* Hold the sector lock from reading the key, so compaction can't move the record under the write. */
+            LOCK(SECTOR_MUTEX);
+
+            /* Check the keychain for key. */
+            SectorKey key;
+            if(!pSectorKeys->Get(vKey, key))
+                return false;
+
+            /* Encode the record if the database compresses or checksums it. */
+            std::vector<uint8_t> vEncoded;
+            if(nFlags & (FLAGS::COMPRESS | FLAGS::CHECKSUM))
+                Encode(vData, vEncoded);
+
+            const std::vector<uint8_t>& vDisk = (nFlags & (FLAGS::COMPRESS | FLAGS::CHECKSUM)) ? vEncoded : vData;
+
+            /* Get current size */
+            uint64_t nSize = vDisk.size() + GetSizeOfCompactSize(vDisk.size());
+
+            /* Check data size constraints. */
+            if(nSize != key.nSectorSize)
+                return false;
+
+            /* Write the data into the memory cache. */
+            cachePool->Put(key, vKey, vData, false);
+
+            /* Find the file stream for LRU cache. */
+            std::fstream* pstream;
+            if(!fileCache->Get(key.nSectorFile, pstream))
+            {
+                /* Set the new stream pointer. */
+                pstream = new std::fstream(debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), key.nSectorFile), std::ios::in | std::ios::out | std::ios::binary);
+                if(!pstream->is_open())
+                {
+                    delete pstream;
+                    return false;
+                }
+
+                /* If file not found add to LRU cache. */
+                fileCache->Put(key.nSectorFile, pstream);
+            }
+
+            /* If it is a New Sector, Assign a Binary Position. */
+            pstream->seekp(key.nSectorStart, std::ios::beg);
+
+            /* Write the size of record. */
+            WriteCompactSize(*pstream, vDisk.size());
+
+            /* Write the data record. */
+            if(!pstream->write((char*) &vDisk[0], vDisk.size()))
+                return debug::error(FUNCTION, "only ", pstream->gcount(), "/", vDisk.size(), " bytes written");
+
+            /* Flush unless the caller flushes after a batch. */
+            if(fFlush)
+            {
+                pstream->flush();
+                ++nFlushes;
+            }
+
+            /* Records flushed indicator. */
+            ++nRecordsFlushed;
+            nBytesWrote += static_cast<uint32_t>(vDisk.size());
+
+            /* Verbose output. */
+            if(config::nVerbose >= 5)
+                debug::log(5, FUNCTION, "Current File: ", key.nSectorFile,
+                    " | Current File Size: ", key.nSectorStart, "\n", HexStr(vData.begin(), vData.end(), true));
+        }
+
+        return true;
+    }
+
+
+    /*  Force a write to disk immediately bypassing write buffers. */
+    template<class KeychainType, class CacheType>
+    bool SectorDatabase<KeychainType, CacheType>::Force(const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData, const bool fFlush)
+    {
+        if(nFlags & FLAGS::APPEND || !Update(vKey, vData, fFlush))
+        {
+            /* Write the record to the end of the current file. */
+            SectorKey key;
+            if(!Allocate(vKey, vData, key, fFlush))
+                return false;
+
+            /* Assign the Key to Keychain. */
+            if(!pSectorKeys->Put(key))
+                return debug::error(FUNCTION, "failed to write key to keychain");
+
+            /* Write the data into the memory cache. */
+            cachePool->Put(key, vKey, vData, false);
+        }
+
+        return true;
+    }
+
+
+    /*  Append a record to the end of the current sector file, without writing its key. */
+    template<class KeychainType, class CacheType>
+    bool SectorDatabase<KeychainType, CacheType>::Allocate(const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData,
+                                                           SectorKey& cKey, const bool fFlush)
+    {
+        /* Encode the record if the database compresses or checksums it. */
+        std::vector<uint8_t> vEncoded;
+        if(nFlags & (FLAGS::COMPRESS | FLAGS::CHECKSUM))
+            Encode(vData, vEncoded);
+
+        const std::vector<uint8_t>& vDisk = (nFlags & (FLAGS::COMPRESS | FLAGS::CHECKSUM)) ? vEncoded : vData;
+
+        /* Get current size */
+        uint64_t nSize = vDisk.size() + GetSizeOfCompactSize(vDisk.size());
+
+        /* The position of the record, assigned under the sector lock. */
+        uint32_t nFile  = 0;
+        uint32_t nStart = 0;
+        {
+            LOCK(SECTOR_MUTEX);
+
+            /* Create new file if above current file size. */
+            if(nCurrentFileSize > MAX_SECTOR_FILE_SIZE)
+            {
+                debug::log(4, FUNCTION, "allocating new sector file ", nCurrentFile + 1);
+
+                ++nCurrentFile;
+                nCurrentFileSize = 0;
+
+                std::ofstream stream
+                (
+                    debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), nCurrentFile),
+                    std::ios::out | std::ios::binary | std::ios::trunc
+                );
+                stream.close();
+            }
+
+            /* Find the file stream for LRU cache. */
+            std::fstream* pstream;
+            if(!fileCache->Get(nCurrentFile, pstream))
+            {
+                /* Set the new stream pointer. */
+                pstream = new std::fstream(debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), nCurrentFile), std::ios::in | std::ios::out | std::ios::binary);
+                if(!pstream->is_open())
+                {
+                    delete pstream;
+                    return false;
+                }
+
+                /* If file not found add to LRU cache. */
+                fileCache->Put(nCurrentFile, pstream);
+            }
+
+            /* If it is a New Sector, Assign a Binary Position. */
+            pstream->seekp(nCurrentFileSize, std::ios::beg);
+
+            /* Write the size of record. */
+            WriteCompactSize(*pstream, vDisk.size());
+
+            /* Write the data record. */
+            if(!pstream->write((char*) &vDisk[0], vDisk.size()))
+                return debug::error(FUNCTION, "only ", pstream->gcount(), "/", vDisk.size(), " bytes written");
+
+            /* Flush unless the caller flushes after a batch. */
+            if(fFlush)
+            {
+                pstream->flush();
+                ++nFlushes;
+            }
+
+            /* Increment the current filesize */
+            nFile  = nCurrentFile;
+            nStart = nCurrentFileSize;
+            nCurrentFileSize += static_cast<uint32_t>(nSize);
+        }
+
+        /* Create a new Sector Key. */
+        cKey = SectorKey(STATE::READY, vKey, static_cast<uint16_t>(nFile), nStart, static_cast<uint32_t>(nSize));
+
+        /* Records flushed indicator. */
+        ++nRecordsFlushed;
+        nBytesWrote += static_cast<uint32_t>(nSize);
+
+        /* Verboe output. */
+        if(config::nVerbose >= 5)
+            debug::log(5, FUNCTION, "Current File: ", cKey.nSectorFile,
+                " | Current File Size: ", cKey.nSectorStart, "\n", HexStr(vData.begin(), vData.end(), true));
+
+        return true;
+    }
+
+
+    /*  Flush the write buffers of every open sector file stream. */
+    template<class KeychainType, class CacheType>
+    void SectorDatabase<KeychainType, CacheType>::FlushStreams()
+    {
+        LOCK(SECTOR_MUTEX);
+
+        /* Iterate the linked list until end. */
+        TemplateNode<uint32_t, std::fstream*>* pnode = fileCache->pfirst;
+        while(pnode)
+        {
+            /* Flush to disk. */
+            pnode->Data->flush();
+
+            /* Set to next. */
+            pnode = pnode->pnext;
+        }
+
+        ++nFlushes;
+    }
+
+
+    /*  Write a record into the cache and disk buffer for flushing to disk. */
+    template<class KeychainType, class CacheType>
+    bool SectorDatabase<KeychainType, CacheType>::Put(const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData)
+    {
+        LatencyTimer latency(pPutLatency);
+
+        /* Handle force write mode. */
+        if(nFlags & FLAGS::FORCE)
+            return Force(vKey, vData);
+
+        /* Wait if the buffer is full, and count the stall. */
+        if(nBufferBytes.load() >= nMaxBufferBytes)
+        {
+            runtime::timer timer;
+            timer.Start();
+
+            ++nBufferWaiting;
+            {
+                std::unique_lock<std::mutex> CONDITION_LOCK(CONDITION_MUTEX);
+                CONDITION.wait(CONDITION_LOCK, [this]{ return fDestruct.load() || nBufferBytes.load() < nMaxBufferBytes; });
+            }
+            --nBufferWaiting;
+
+            ++nBufferStalls;
+            nStallMicroseconds += timer.ElapsedMicroseconds();
+        }
+
+        /* Count the bytes before queueing, so the writer never takes more off than was added. */
+        const uint32_t nBytes = (nBufferBytes += static_cast<uint32_t>(vKey.size() + vData.size()));
+
+        /* Track the peak of the buffer. */
+        uint32_t nPeak = nBufferPeak.load();
+        while(nBytes > nPeak && !nBufferPeak.compare_exchange_weak(nPeak, nBytes)) { }
+
+        /* Add to the write buffer thread. */
+        queueDisk.Push(std::make_pair(vKey, vData));
+
+        /* Only take the lock to wake the writer when it is asleep. */
+        if(fWriterWaiting.load())
+        {
+            LOCK(CONDITION_MUTEX);
+            CONDITION.notify_all();
+        }
+
+        return true;
+    }
+
+
+    /*  Update a record on disk. */
+    template<class KeychainType, class CacheType>
+    bool SectorDatabase<KeychainType, CacheType>::Delete(const std::vector<uint8_t>& vKey)
+    {
+        /* Check the keychain for key. */
+        SectorKey key;
+        if(!pSectorKeys->Get(vKey, key))
+            return false;
+
+        /* Return the Key existance in the Keychain Database. */
+        if(!pSectorKeys->Erase(vKey))
+            return false;
+
+        /* Check that this key isn't a keychain only entry. */
+        if(key.nSectorFile ==0 && key.nSectorSize == 0 && key.nSectorStart == 0)
+            return true;
+
+        /* Leave the record for compaction when mapped reads may be copying it. */
+        if(nFlags & FLAGS::MAPPED)
+            return true;
+
+        {
+            LOCK(SECTOR_MUTEX);
+
+            /* Find the file stream for LRU cache. */
+            std::fstream* pstream;
+            if(!fileCache->Get(key.nSectorFile, pstream))
+            {
+                /* Set the new stream pointer. */
+                pstream = new std::fstream(debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), key.nSectorFile), std::ios::in | std::ios::out | std::ios::binary);
+                if(!pstream->is_open())
+                {
+                    delete pstream;
+                    return false;
+                }
+
+                /* If file not found add to LRU cache. */
+                fileCache->Put(key.nSectorFile, pstream);
+            }
+
+            /* If it is a New Sector, Assign a Binary Position. */
+            pstream->seekg(key.nSectorStart, std::ios::beg);
+
+            /* Write the size of record. */
+            uint64_t nSize = ReadCompactSize(*pstream);
+
+            /* Seek to write at specific location. */
+            pstream->seekp(key.nSectorStart + GetSizeOfCompactSize(nSize), std::ios::beg);
+
+            /* Update the record with blank data. */
+            DataStream ssData(SER_LLD, DATABASE_VERSION);
+            ssData << std::string("NONE");
+            ssData.resize(nSize);
+
+            /* Write the data record. */
+            if(!pstream->write((char*)ssData.data(), ssData.size()))
+                return debug::error(FUNCTION, "only ", pstream->gcount(), " bytes written");
+
+            /* Flush the rest of the write buffer in stream. */
+            pstream->flush();
+            ++nFlushes;
+        }
+
+        return true;
+    }
+
+
+    /*  Apply the writes, erases and indexes of a batch under a single lock. */
+    template<class KeychainType, class CacheType>
+    bool SectorDatabase<KeychainType, CacheType>::Apply(const WriteBatch& batch)
+    {
+        if(nFlags & FLAGS::READONLY)
+            return debug::error(FUNCTION, "Apply called on database in read-only mode");
+
+        if(batch.Empty())
+            return true;
+
+        /* Erased keys leave the cache before the lock, the same as a single erase. */
+        for(const auto& entry : batch.Entries())
+            if(entry.nType == BATCH::ERASE)
+                cachePool->Remove(batch.Key(entry));
+
+        LOCK(TRANSACTION_MUTEX);
+
+        /* Inside a transaction the arena is already in the journal's format, so it is appended as one piece. */
+        if(pTransaction)
+        {
+            const std::vector<uint8_t>& vArena = batch.Arena();
+            pTransaction->ssJournal.write((char*)&vArena[0], vArena.size());
+
+            for(const auto& entry : batch.Entries())
+            {
+                const std::vector<uint8_t> vKey = batch.Key(entry);
+                switch(entry.nType)
+                {
+                    case BATCH::RECORD:
+                        pTransaction->setErasedData.erase(vKey);
+                        pTransaction->mapTransactions[vKey] = batch.Data(entry);
+                        break;
+
+                    case BATCH::KEYCHAIN:
+                        pTransaction->setErasedData.erase(vKey);
+                        pTransaction->setKeychain.insert(vKey);
+                        break;
+
+                    case BATCH::ERASE:
+                        pTransaction->EraseTransaction(vKey);
+                        break;
+
+                    case BATCH::INDEX:
+                        pTransaction->setErasedData.erase(vKey);
+                        pTransaction->mapIndex[vKey] = batch.Data(entry);
+                        break;
+                }
+            }
+
+            return true;
+        }
+
+        /* Outside a transaction apply in order, holding the lock so no transaction starts part way through. */
+        bool fSuccess = true;
+        for(const auto& entry : batch.Entries())
+        {
+            const std::vector<uint8_t> vKey = batch.Key(entry);
+            switch(entry.nType)
+            {
+                case BATCH::RECORD:
+                {
+                    if(!Put(vKey, batch.Data(entry)))
+                        fSuccess = false;
+
+                    break;
+                }
+
+                case BATCH::KEYCHAIN:
+                {
+                    SectorKey cKey(STATE::READY, vKey, 0, 0, 0);
+                    if(!pSectorKeys->Put(cKey))
+                        fSuccess = false;
+
+                    break;
+                }
+
+                case BATCH::ERASE:
+                {
+                    if(!Delete(vKey))
+                        fSuccess = false;
+
+                    break;
+                }
+
+                case BATCH::INDEX:
+                {
+                    /* Point the key at the sector of the record it indexes. */
+                    const std::vector<uint8_t> vIndex = batch.Data(entry);
+
+                    SectorKey cKey;
+                    if(!pSectorKeys->Get(vIndex, cKey))
+                    {
+                        fSuccess = false;
+                        break;
+                    }
+
+                    cachePool->Remove(vIndex);
+                    cachePool->Remove(vKey);
+
+                    cKey.SetKey(vKey);
+                    if(!pSectorKeys->Put(cKey))
+                        fSuccess = false;
+
+                    break;
+                }
+            }
+        }
+
+        return fSuccess;
+    }
+
+
+    /*  Flushes data from the cache buffer to disk as it arrives. */
+    template<class KeychainType, class CacheType>
+    void SectorDatabase<KeychainType, CacheType>::CacheWriter()
+    {
+        /* Wait for initialization. */
+        while(!fInitialized)
+            runtime::sleep(100);
+
+        /* Check if writing is enabled. */
+        if(!(nFlags & FLAGS::WRITE) && !(nFlags & FLAGS::APPEND))
+            return;
+
+        /* No cache write on force mode. */
+        if(nFlags & FLAGS::FORCE)
+        {
+            debug::log(0, FUNCTION, strBaseLocation, " in FORCE mode... closing");
+            return;
+        }
+
+        /* The batch the keychain writers are working on. */
+        std::map<std::vector<uint8_t>, std::vector<uint8_t>> mapFlight;
+        std::vector<SectorKey> vFlight;
+        uint32_t nFlightBytes = 0;
+
+        /* The keychain writers wait on a new batch sequence, and count down when done with it. */
+        std::mutex KEYCHAIN_MUTEX;
+        std::condition_variable KEYCHAIN_CONDITION;
+        uint64_t nSequence = 0;
+        uint32_t nPending  = 0;
+        bool fStop         = false;
+
+        /* Start the keychain writers. Keys of different buckets are written in parallel. */
+        const uint32_t nWriters = static_cast<uint32_t>(std::max(config::GetArg("-lldwriters", DEFAULT_KEYCHAIN_WRITERS), int64_t(1)));
+
+        std::vector<std::thread> vWriters;
+        for(uint32_t nThread = 0; nThread < nWriters; ++nThread)
+        {
+            vWriters.push_back(std::thread([&, nThread]()
+            {
+                uint64_t nLast = 0;
+                while(true)
+                {
+                    {
+                        std::unique_lock<std::mutex> KEYCHAIN_LOCK(KEYCHAIN_MUTEX);
+                        KEYCHAIN_CONDITION.wait(KEYCHAIN_LOCK, [&]{ return fStop || nSequence != nLast; });
+
+                        if(nSequence == nLast)
+                            return;
+
+                        nLast = nSequence;
+                    }
+
+                    /* Each writer takes every nWriters'th key of the batch. */
+                    for(uint64_t n = nThread; n < vFlight.size(); n += nWriters)
+                    {
+                        if(!pSectorKeys->Put(vFlight[n]))
+                            debug::error(FUNCTION, "failed to write key to keychain");
+                    }
+
+                    {
+                        LOCK(KEYCHAIN_MUTEX);
+                        if(--nPending == 0)
+                            KEYCHAIN_CONDITION.notify_all();
+                    }
+                }
+            }));
+        }
+
+        /* Wait for the keychain writers to finish the batch in flight, then release its buffer. */
+        auto fnFinish = [&]()
+        {
+            {
+                std::unique_lock<std::mutex> KEYCHAIN_LOCK(KEYCHAIN_MUTEX);
+                KEYCHAIN_CONDITION.wait(KEYCHAIN_LOCK, [&]{ return nPending == 0; });
+            }
+
+            /* Set no longer reserved in cache pool. */
+            for(const auto& record : mapFlight)
+                cachePool->Reserve(record.first, false);
+
+            mapFlight.clear();
+            vFlight.clear();
+
+            nBufferBytes -= nFlightBytes;
+            nFlightBytes  = 0;
+
+            /* Wake any puts waiting for room. */
+            if(nBufferWaiting.load() > 0)
+            {
+                LOCK(CONDITION_MUTEX);
+                CONDITION.notify_all();
+            }
+        };
+
+        while(true)
+        {
+            /* Wait for puts when the queue is drained. */
+            if(queueDisk.Empty())
+            {
+                /* Finish the keys in flight before sleeping, so nothing is held while idle. */
+                if(!mapFlight.empty())
+                {
+                    fnFinish();
+                    continue;
+                }
+
+                /* Wait for buffer to empty before shutting down. */
+                if(fDestruct.load())
+                    break;
+
+                std::unique_lock<std::mutex> CONDITION_LOCK(CONDITION_MUTEX);
+                fWriterWaiting = true;
+                CONDITION.wait(CONDITION_LOCK, [this]{ return fDestruct.load() || !queueDisk.Empty(); });
+                fWriterWaiting = false;
+
+                continue;
+            }
+
+            /* Drain a batch of half the buffer, so puts keep flowing while it is written. */
+            std::map<std::vector<uint8_t>, std::vector<uint8_t>> mapBatch;
+            uint32_t nBatchBytes = 0;
+
+            std::pair<std::vector<uint8_t>, std::vector<uint8_t>> record;
+            while(nBatchBytes < nMaxBufferBytes / 2 && queueDisk.Pop(record))
+            {
+                nBatchBytes += static_cast<uint32_t>(record.first.size() + record.second.size());
+
+                /* The last put of a key wins. */
+                auto it = mapBatch.find(record.first);
+                if(it != mapBatch.end())
+                {
+                    it->second.swap(record.second);
+                    ++nRecordsCoalesced;
+                }
+                else
+                    mapBatch.emplace(std::move(record.first), std::move(record.second));
+            }
+
+            /* In place updates read the keychain, so they can't pass keys of the same record still in flight. */
+            if(!(nFlags & FLAGS::APPEND))
+            {
+                for(const auto& item : mapBatch)
+                {
+                    if(mapFlight.count(item.first))
+                    {
+                        fnFinish();
+                        break;
+                    }
+                }
+            }
+
+            /* Sort the records that fit their old sector by file position, the rest are appended. Compressed sizes are only known once written. */
+            const uint64_t nChecksum = (nFlags & FLAGS::CHECKSUM) ? RECORD_CHECKSUM_SIZE : 0;
+
+            std::vector<SectorKey> vKeys;
+            std::vector< std::pair<SectorKey, const std::pair<const std::vector<uint8_t>, std::vector<uint8_t>>*> > vUpdates;
+            for(const auto& item : mapBatch)
+            {
+                const uint64_t nDisk = item.second.size() + nChecksum;
+
+                SectorKey key;
+                if(!(nFlags & FLAGS::APPEND) && pSectorKeys->Get(item.first, key)
+                && ((nFlags & FLAGS::COMPRESS) || key.nSectorSize == nDisk + GetSizeOfCompactSize(nDisk)))
+                {
+                    vUpdates.push_back(std::make_pair(key, &item));
+                    continue;
+                }
+
+                /* Append new records in key order, readable from the cache until their key is written. */
+                if(Allocate(item.first, item.second, key, false))
+                {
+                    cachePool->Put(key, item.first, item.second, true);
+                    vKeys.push_back(key);
+                }
+            }
+
+            std::sort(vUpdates.begin(), vUpdates.end(),
+                [](const std::pair<SectorKey, const std::pair<const std::vector<uint8_t>, std::vector<uint8_t>>*>& a,
+                   const std::pair<SectorKey, const std::pair<const std::vector<uint8_t>, std::vector<uint8_t>>*>& b)
+            {
+                if(a.first.nSectorFile != b.first.nSectorFile)
+                    return a.first.nSectorFile < b.first.nSectorFile;
+
+                return a.first.nSectorStart < b.first.nSectorStart;
+            });
+
+            /* Write the updates, appending any whose sector changed since it was read. */
+            for(const auto& update : vUpdates)
+            {
+                const std::vector<uint8_t>& vKey  = update.second->first;
+                const std::vector<uint8_t>& vData = update.second->second;
+
+                SectorKey key;
+                if(!Update(vKey, vData, false) && Allocate(vKey, vData, key, false))
+                {
+                    cachePool->Put(key, vKey, vData, true);
+                    vKeys.push_back(key);
+                }
+            }
+
+            /* Flush the batch to disk once. */
+            FlushStreams();
+
+            /* Hand the keys to the keychain writers, once they are done with the last batch. */
+            fnFinish();
+            {
+                LOCK(KEYCHAIN_MUTEX);
+
+                mapFlight.swap(mapBatch);
+                vFlight.swap(vKeys);
+                nFlightBytes = nBatchBytes;
+
+                nPending = nWriters;
+                ++nSequence;
+            }
+            KEYCHAIN_CONDITION.notify_all();
+
+            ++nBatchesFlushed;
+
+            /* Verbose logging. */
+            debug::log(3, FUNCTION, "Flushed ", mapFlight.size(),
+                " Records of ", nFlightBytes, " Bytes");
+        }
+
+        /* Stop the keychain writers. */
+        {
+            LOCK(KEYCHAIN_MUTEX);
+            fStop = true;
+        }
+        KEYCHAIN_CONDITION.notify_all();
+
+        for(auto& thread : vWriters)
+            thread.join();
+    }
+
+
+    /*  LLD Meter Thread. Logs the Reads/Writes per second from the running totals. */
+    template<class KeychainType, class CacheType>
+    void SectorDatabase<KeychainType, CacheType>::Meter()
+    {
+        if(!config::GetBoolArg("-lldmeters", false))
+            return;
+
+        runtime::timer TIMER;
+        TIMER.Start();
+
+        /* The totals logged so far. */
+        uint64_t nLastWrote   = 0;
+        uint64_t nLastRead    = 0;
+        uint64_t nLastRecords = 0;
+        uint64_t nLastStalls  = 0;
+
+        while(!fDestruct.load())
+        {
+            runtime::sleep(100);
+            if(TIMER.Elapsed() < 30)
+                continue;
+
+            /* Take the totals since the last log. */
+            const uint64_t nWrote   = nBytesWrote.load();
+            const uint64_t nRead    = nBytesRead.load();
+            const uint64_t nRecords = nRecordsFlushed.load();
+            const uint64_t nStalls  = nBufferStalls.load();
+
+            /* Write and Read data rates. */
+            double WPS = (nWrote - nLastWrote) / (TIMER.Elapsed() * 1024.0);
+            double RPS = (nRead  - nLastRead)  / (TIMER.Elapsed() * 1024.0);
+
+            /* Check for zero values. */
+            if(WPS == 0 && RPS == 0 && nRecords == nLastRecords)
+                continue;
+
+            /* Debug output. */
+            debug::log(0,
+                ANSI_COLOR_FUNCTION, strName, " LLD : ", ANSI_COLOR_RESET,
+                "Writing ", WPS, " Kb/s | ",
+                "Reading ", RPS, " Kb/s | ",
+                "Records ", nRecords - nLastRecords, " | ",
+                "Buffer ", nBufferBytes.load() / 1024, " Kb | ",
+                "Stalls ", nStalls - nLastStalls, " | ",
+                "Get p99 ", pGetLatency->Quantile(0.99) / 1000, " us");
+
+            nLastWrote   = nWrote;
+            nLastRead    = nRead;
+            nLastRecords = nRecords;
+            nLastStalls  = nStalls;
+
+            TIMER.Reset();
+        }
+    }
+
+
+    /*  LLD Compactor Thread. Runs a compaction every -lldcompactinterval seconds. */
+    template<class KeychainType, class CacheType>
+    void SectorDatabase<KeychainType, CacheType>::Compactor()
+    {
+        /* Mapped databases append every update and leave deleted records, so they compact unless told not to. */
+        if(!config::GetBoolArg("-lldcompact", (nFlags & FLAGS::MAPPED) != 0))
+            return;
+
+        /* Wait for initialization. */
+        while(!fInitialized)
+            runtime::sleep(100);
+
+        /* Check if writing is enabled. */
+        if(nFlags & FLAGS::READONLY)
+            return;
+
+        const uint64_t nInterval = std::max(config::GetArg("-lldcompactinterval", 3600), int64_t(1));
+
+        runtime::timer TIMER;
+        TIMER.Start();
+
+        while(!fDestruct.load())
+        {
+            runtime::sleep(100);
+            if(TIMER.Elapsed() < nInterval)
+                continue;
+
+            Compact();
+            TIMER.Reset();
+        }
+    }
+
+
+    /*  LLD Scrubber Thread. Verifies the sector files of a checksummed database. */
+    template<class KeychainType, class CacheType>
+    void SectorDatabase<KeychainType, CacheType>::Scrubber()
+    {
+        if(!(nFlags & FLAGS::CHECKSUM) || !config::GetBoolArg("-lldscrub", true))
+            return;
+
+        /* Wait for initialization. */
+        while(!fInitialized)
+            runtime::sleep(100);
+
+        const uint64_t nInterval = std::max(config::GetArg("-lldscrubinterval", 86400), int64_t(1));
+
+        /* The first pass starts once the database is open, so damage from while it was closed shows early. */
+        bool fScrub = true;
+
+        runtime::timer TIMER;
+        TIMER.Start();
+
+        while(!fDestruct.load())
+        {
+            if(fScrub || TIMER.Elapsed() >= nInterval)
+            {
+                Scrub();
+                TIMER.Reset();
+
+                fScrub = false;
+            }
+
+            runtime::sleep(100);
+        }
+    }
+
+
+    /*  Read every sector file front to back and check the checksum of each record. */
+    template<class KeychainType, class CacheType>
+    bool SectorDatabase<KeychainType, CacheType>::Scrub()
+    {
+        if(!(nFlags & FLAGS::CHECKSUM))
+            return false;
+
+        runtime::timer TIMER;
+        TIMER.Start();
+
+        /* Write out buffered appends, so the records up to the current size are all on disk. */
+        FlushStreams();
+
+        uint32_t nLastFile = 0;
+        uint64_t nLastSize = 0;
+        {
+            LOCK(SECTOR_MUTEX);
+
+            nLastFile = nCurrentFile;
+            nLastSize = nCurrentFileSize;
+        }
+
+        const uint64_t nRate = std::max(config::GetArg("-lldscrubrate", DEFAULT_SCRUB_RATE), int64_t(1));
+
+        uint64_t nScrubbed = 0;
+        uint64_t nRecords  = 0;
+        uint64_t nDamaged  = 0;
+
+        runtime::timer RATE;
+        RATE.Start();
+
+        std::vector<uint8_t> vBuffer;
+        for(uint32_t nFile = 0; nFile <= nLastFile; ++nFile)
+        {
+            std::ifstream stream(debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), nFile), std::ios::in | std::ios::binary | std::ios::ate);
+            if(!stream)
+                continue;
+
+            /* Files emptied by compaction are truncated, and the current one is read up to where it was flushed. */
+            const uint64_t nFileSize = (nFile == nLastFile) ? nLastSize : static_cast<uint64_t>(stream.tellg());
+
+            uint64_t nPos  = 0;
+            uint64_t nWant = MAX_BATCH_READ_SIZE;
+            while(nPos < nFileSize)
+            {
+                if(fDestruct.load())
+                    return false;
+
+                /* Read the next records, under the sector lock so an in place update isn't read half written. */
+                vBuffer.resize(std::min(nWant, nFileSize - nPos));
+                uint64_t nRead = 0;
+                {
+                    LOCK(SECTOR_MUTEX);
+
+                    stream.seekg(nPos, std::ios::beg);
+                    stream.read((char*) &vBuffer[0], vBuffer.size());
+
+                    nRead = stream.gcount();
+                    stream.clear();
+                }
+
+                /* Check every record that was read whole. */
+                bool fEnd = false;
+                uint64_t nOffset = 0;
+                uint64_t nHeader = 0;
+                uint64_t nSize   = 0;
+                while(ReadRecordSize(&vBuffer[nOffset], nRead - nOffset, nHeader, nSize))
+                {
+                    /* A record of no size is past the last one written. */
+                    if(nSize == 0)
+                    {
+                        fEnd = true;
+                        break;
+                    }
+
+                    if(nOffset + nHeader + nSize > nRead)
+                        break;
+
+                    if(!VerifyChecksum(&vBuffer[nOffset + nHeader], nSize))
+                    {
+                        /* An in place update may have been flushed in part, so read the record again once it is whole. */
+                        FlushStreams();
+
+                        std::vector<uint8_t> vRecord(nSize, 0);
+                        {
+                            LOCK(SECTOR_MUTEX);
+
+                            stream.seekg(nPos + nOffset + nHeader, std::ios::beg);
+                            stream.read((char*) &vRecord[0], vRecord.size());
+                            stream.clear();
+                        }
+
+                        if(!VerifyChecksum(&vRecord[0], nSize))
+                        {
+                            ++nDamaged;
+                            ++nRecordsDamaged;
+
+                            debug::error(FUNCTION, strName, " damaged record of ", nSize, " bytes in file ", nFile, " at ", nPos + nOffset);
+                        }
+                    }
+
+                    nOffset += nHeader + nSize;
+                    ++nRecords;
+                }
+
+                nPos           += nOffset;
+                nScrubbed      += nOffset;
+                nBytesScrubbed += nOffset;
+
+                if(fEnd)
+                    break;
+
+                /* Read at least the whole of a record larger than the last read. */
+                if(nOffset == 0)
+                {
+                    if(nPos + nRead >= nFileSize || nHeader + nSize <= nRead)
+                    {
+                        debug::error(FUNCTION, strName, " file ", nFile, " ends in a partial record at ", nPos);
+                        break;
+                    }
+
+                    nWant = nHeader + nSize;
+                    continue;
+                }
+
+                nWant = MAX_BATCH_READ_SIZE;
+
+                /* Sleep off the time the verified bytes are ahead of the rate. */
+                const uint64_t nAhead = (nScrubbed * 1000) / nRate;
+                if(nAhead > RATE.ElapsedMilliseconds())
+                    runtime::sleep(nAhead - RATE.ElapsedMilliseconds());
+            }
+        }
+
+        debug::log(0, FUNCTION, strName, " scrubbed ", nRecords, " records of ", nScrubbed, " bytes in ",
+            TIMER.Elapsed(), " seconds | ", nDamaged, " damaged");
+
+        return true;
+    }
+
+
+    /*  Reclaim the space of overwritten and erased records. */
+    template<class KeychainType, class CacheType>
+    bool SectorDatabase<KeychainType, CacheType>::Compact()
+    {
+        runtime::timer TIMER;
+        TIMER.Start();
+
+        /* Get the sizes of the sector files before the current one, which is still being written to. */
+        uint32_t nLastFile = 0;
+        {
+            LOCK(SECTOR_MUTEX);
+            nLastFile = nCurrentFile;
+        }
+
+        std::vector<uint64_t> vFileSize(nLastFile, 0);
+        for(uint32_t nFile = 0; nFile < nLastFile; ++nFile)
+        {
+            std::ifstream stream(debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), nFile), std::ios::in | std::ios::binary | std::ios::ate);
+            if(stream)
+                vFileSize[nFile] = static_cast<uint64_t>(stream.tellg());
+        }
+
+        /* Collapse the keychain buckets, counting the live bytes of each sector file. The bucket
+         * count is read each pass since a growing keychain adds buckets while it is walked. */
+        uint64_t nDepthBefore = 0;
+        uint64_t nDepthAfter  = 0;
+        uint64_t nUsed        = 0;
+        bool fComplete        = true;
+        std::vector<uint64_t> vLive(nLastFile, 0);
+        for(uint32_t nBucket = 0; nBucket < pSectorKeys->TotalBuckets(); ++nBucket)
+        {
+            /* Give way to the other database threads. */
+            if(nBucket % 4096 == 0)
+            {
+                if(fDestruct.load())
+                    return false;
+
+                runtime::sleep(1);
+            }
+
+            /* Skip buckets that were never written. */
+            const uint16_t nDepth = pSectorKeys->Depth(nBucket);
+            if(nDepth == 0)
+                continue;
+
+            std::vector<SectorKey> vKeys;
+            if(!pSectorKeys->CompactBucket(nBucket, vKeys))
+            {
+                fComplete = false;
+                continue;
+            }
+
+            ++nUsed;
+            nDepthBefore += nDepth;
+            nDepthAfter  += pSectorKeys->Depth(nBucket);
+
+            for(const auto& cKey : vKeys)
+                if(cKey.nSectorFile < nLastFile)
+                    vLive[cKey.nSectorFile] += cKey.nSectorSize;
+        }
+
+        /* Truncate the files emptied last time, once no reader holds their mapping. */
+        uint64_t nReclaimed = 0;
+        std::vector<uint32_t> vHeld;
+        for(const auto& nFile : vRetired)
+        {
+            /* Keep files that a key was pointed into since, the next pass moves it out. */
+            if(!fComplete || nFile >= nLastFile || vLive[nFile] > 0)
+                continue;
+
+            /* Stop mapping the file, and keep it for the next pass while a reader or view still holds its mapping,
+             * since reading past the end of a truncated mapping raises SIGBUS. */
+            {
+                LOCK(MAP_MUTEX);
+                setUnmapped.insert(nFile);
+
+                auto it = mapMemory.find(nFile);
+                if(it != mapMemory.end())
+                {
+                    if(it->second.use_count() > 1)
+                    {
+                        /* It is empty already, so it isn't picked for compaction again. */
+                        vHeld.push_back(nFile);
+                        vFileSize[nFile] = 0;
+
+                        continue;
+                    }
+
+                    mapMemory.erase(it);
+                }
+
+                mapMappedAt.erase(nFile);
+            }
+
+            /* Close the file stream, and truncate it so the numbering of the sector files has no gaps. */
+            {
+                LOCK(SECTOR_MUTEX);
+                fileCache->Remove(nFile);
+
+                std::ofstream stream(debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), nFile), std::ios::out | std::ios::binary | std::ios::trunc);
+                stream.close();
+            }
+
+            nReclaimed += vFileSize[nFile];
+            vFileSize[nFile] = 0;
+        }
+        vRetired.swap(vHeld);
+
+        /* Pick the files that are mostly dead records. */
+        std::vector<bool> vCompact(nLastFile, false);
+        uint32_t nCompact = 0;
+        for(uint32_t nFile = 0; nFile < nLastFile; ++nFile)
+        {
+            if(vFileSize[nFile] == 0 || vLive[nFile] * 100 > vFileSize[nFile] * (100 - MIN_COMPACT_DEAD_PERCENT))
+                continue;
+
+            vCompact[nFile] = true;
+            ++nCompact;
+        }
+
+        /* Move the live records out of the picked files, at no more than -lldcompactrate bytes per second. */
+        const uint64_t nRate = std::max(config::GetArg("-lldcompactrate", DEFAULT_COMPACT_RATE), int64_t(1));
+
+        uint64_t nMoved = 0;
+        if(nCompact > 0)
+        {
+            runtime::timer RATE;
+            RATE.Start();
+
+            for(uint32_t nBucket = 0; nBucket < pSectorKeys->TotalBuckets(); ++nBucket)
             {
-                nBytesWrote     = 0;
-                nRecordsFlushed = 0;
+                if(nBucket % 4096 == 0 && fDestruct.load())
+                    return false;
+
+                /* Get the live keys, the bucket is already compacted. */
+                std::vector<SectorKey> vKeys;
+                if(pSectorKeys->Depth(nBucket) == 0)
+                    continue;
+
+                /* Keys that can't be read may be in any file, so keep them all. */
+                if(!pSectorKeys->CompactBucket(nBucket, vKeys))
+                {
+                    vCompact.assign(nLastFile, false);
+                    break;
+                }
+
+                for(const auto& cKey : vKeys)
+                {
+                    /* Skip keychain only entries and records in files that stay. */
+                    if(cKey.nSectorSize == 0 || cKey.nSectorFile >= nLastFile || !vCompact[cKey.nSectorFile])
+                        continue;
+
+                    /* Keep the file if its key is mid write, or the record couldn't be moved. */
+                    if(cKey.nState != STATE::READY || !MoveRecord(nBucket, cKey))
+                    {
+                        vCompact[cKey.nSectorFile] = false;
+                        continue;
+                    }
+
+                    /* Sleep off the time the moved bytes are ahead of the rate. */
+                    nMoved += cKey.nSectorSize;
+
+                    const uint64_t nAhead = (nMoved * 1000) / nRate;
+                    if(nAhead > RATE.ElapsedMilliseconds())
+                        runtime::sleep(nAhead - RATE.ElapsedMilliseconds());
+                }
             }
         }
+
+        /* Retire the files that were emptied. */
+        uint64_t nPending = 0;
+        for(uint32_t nFile = 0; nFile < nLastFile; ++nFile)
+        {
+            if(!vCompact[nFile])
+                continue;
+
+            vRetired.push_back(nFile);
+            nPending += vFileSize[nFile];
+        }
+
+        /* Debug output. */
+        debug::log(0, ANSI_COLOR_FUNCTION, strName, " LLD : ", ANSI_COLOR_RESET,
+            "Compacted in ", TIMER.Elapsed(), " seconds | ",
+            "Moved ", nMoved, " bytes | ",
+            "Reclaimed ", nReclaimed, " bytes | ",
+            "Retired ", vRetired.size(), " files of ", nPending, " bytes | ",
+            "Lookup depth ", nUsed ? double(nDepthBefore) / nUsed : 0.0, " -> ", nUsed ? double(nDepthAfter) / nUsed : 0.0);
+
+        return true;
     }
 
 
-    /*  LLD Meter Thread. Tracks the Reads/Writes per second. */
+    /*  Copy a record to the end of the current sector file and point its key at the copy. */
     template<class KeychainType, class CacheType>
-    void SectorDatabase<KeychainType, CacheType>::Meter()
+    bool SectorDatabase<KeychainType, CacheType>::MoveRecord(const uint32_t nBucket, const SectorKey& cKey)
     {
-        if(!config::GetBoolArg("-lldmeters", false))
-            return;
+        /* Hold the sector lock until the key is swapped, so an in place update can't be lost. */
+        LOCK(SECTOR_MUTEX);
+
+        /* Find the file stream for LRU cache. */
+        std::fstream* pstream;
+        if(!fileCache->Get(cKey.nSectorFile, pstream))
+        {
+            /* Set the new stream pointer. */
+            pstream = new std::fstream(debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), cKey.nSectorFile), std::ios::in | std::ios::out | std::ios::binary);
+            if(!pstream->is_open())
+            {
+                delete pstream;
+                return debug::error(FUNCTION, "couldn't create stream file");
+            }
+
+            /* If file not found add to LRU cache. */
+            fileCache->Put(cKey.nSectorFile, pstream);
+        }
+
+        /* Read the record with its size header. */
+        std::vector<uint8_t> vRecord(cKey.nSectorSize, 0);
+        pstream->seekg(cKey.nSectorStart, std::ios::beg);
+        if(!pstream->read((char*) &vRecord[0], vRecord.size()))
+        {
+            pstream->clear();
+            return debug::error(FUNCTION, "only ", pstream->gcount(), "/", vRecord.size(), " bytes read");
+        }
+
+        /* Create new file if above current file size. */
+        if(nCurrentFileSize > MAX_SECTOR_FILE_SIZE)
+        {
+            debug::log(4, FUNCTION, "allocating new sector file ", nCurrentFile + 1);
+
+            ++nCurrentFile;
+            nCurrentFileSize = 0;
+
+            std::ofstream stream
+            (
+                debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), nCurrentFile),
+                std::ios::out | std::ios::binary | std::ios::trunc
+            );
+            stream.close();
+        }
+
+        /* Find the file stream of the current file. */
+        if(!fileCache->Get(nCurrentFile, pstream))
+        {
+            /* Set the new stream pointer. */
+            pstream = new std::fstream(debug::safe_printstr(strBaseLocation, "_block.", std::setfill('0'), std::setw(5), nCurrentFile), std::ios::in | std::ios::out | std::ios::binary);
+            if(!pstream->is_open())
+            {
+                delete pstream;
+                return debug::error(FUNCTION, "couldn't create stream file");
+            }
+
+            /* If file not found add to LRU cache. */
+            fileCache->Put(nCurrentFile, pstream);
+        }
+
+        /* Write the copy, flushed before the key points at it. */
+        pstream->seekp(nCurrentFileSize, std::ios::beg);
+        if(!pstream->write((char*) &vRecord[0], vRecord.size()))
+            return debug::error(FUNCTION, "only ", pstream->gcount(), "/", vRecord.size(), " bytes written");
+
+        pstream->flush();
+        ++nFlushes;
+
+        /* Swap the key to the copy, the copy is left unused if the key changed since. */
+        const uint32_t nStart = nCurrentFileSize;
+        nCurrentFileSize += cKey.nSectorSize;
+
+        return pSectorKeys->Relocate(nBucket, cKey, static_cast<uint16_t>(nCurrentFile), nStart);
+    }
+
 
+    /*  Write every record of the database to a bulk file. */
+    template<class KeychainType, class CacheType>
+    bool SectorDatabase<KeychainType, CacheType>::Export(const std::string& strFile)
+    {
         runtime::timer TIMER;
         TIMER.Start();
 
-        while(!fDestruct.load())
+        /* Keep commits out, so none is exported half applied. */
+        LOCK(TRANSACTION_MUTEX);
+
+        /* The keys are written as the keychain stores them, so note its shape. */
+        BulkWriter writer(strFile);
+        if(!writer.Header(KeychainType::Name(), pSectorKeys->TotalBuckets()))
+            return debug::error(FUNCTION, strName, " failed to start ", strFile);
+
+        uint64_t nBytes = 0;
+        for(uint32_t nBucket = 0; nBucket < pSectorKeys->TotalBuckets(); ++nBucket)
         {
-            runtime::sleep(100);
-            if(TIMER.Elapsed() < 30)
+            /* Skip buckets that were never written. */
+            if(pSectorKeys->Depth(nBucket) == 0)
                 continue;
 
-            /* Write and Read data rates. */
-            double WPS = nBytesWrote.load() / (TIMER.Elapsed() * 1024.0);
-            double RPS = nBytesRead.load() / (TIMER.Elapsed() * 1024.0);
+            /* Get the live keys of the bucket, leaving the keychain as it is. */
+            std::vector<SectorKey> vKeys;
+            if(!pSectorKeys->ScanBucket(nBucket, vKeys))
+                return debug::error(FUNCTION, strName, " failed to read bucket ", nBucket);
 
-            /* Check for zero values. */
-            if(WPS == 0 && RPS == 0 && nRecordsFlushed.load() == 0)
-                continue;
+            /* Sort the keys, so the same records always export to the same file. */
+            std::sort(vKeys.begin(), vKeys.end(),
+                [](const SectorKey& a, const SectorKey& b) { return a.vKey < b.vKey; });
 
-            /* Debug output. */
-            debug::log(0,
-                ANSI_COLOR_FUNCTION, strName, " LLD : ", ANSI_COLOR_RESET,
-                "Writing ", WPS, " Kb/s | ",
-                "Reading ", RPS, " Kb/s | ",
-                "Records ", nRecordsFlushed.load());
+            for(const auto& cKey : vKeys)
+            {
+                /* Skip keys that are mid write. */
+                if(cKey.nState != STATE::READY)
+                    continue;
 
-            TIMER.Reset();
-            nBytesWrote.store(0);
-            nBytesRead.store(0);
-            nRecordsFlushed.store(0);
+                BulkRecord record;
+                record.nBucket   = nBucket;
+                record.nLength   = cKey.nLength;
+                record.vKey      = cKey.vKey;
+                record.fKeychain = (cKey.nSectorSize == 0);
+
+                /* Read the record as it reads from the database, an import compresses it as it likes. */
+                if(!record.fKeychain && !Get(cKey, record.vData))
+                    return debug::error(FUNCTION, strName, " failed to read record in bucket ", nBucket);
+
+                if(!writer.Add(record))
+                    return false;
+
+                nBytes += record.vData.size();
+            }
+        }
+
+        if(!writer.Close())
+            return debug::error(FUNCTION, strName, " failed to finish ", strFile);
+
+        debug::log(0, FUNCTION, strName, " exported ", writer.Records(), " records of ", nBytes,
+            " bytes to ", strFile, " in ", TIMER.ElapsedMilliseconds(), " ms");
+
+        return true;
+    }
+
+
+    /*  Load a bulk file into an empty database. */
+    template<class KeychainType, class CacheType>
+    bool SectorDatabase<KeychainType, CacheType>::Import(const std::string& strFile, const uint32_t nThreads)
+    {
+        runtime::timer TIMER;
+        TIMER.Start();
+
+        LOCK(TRANSACTION_MUTEX);
+
+        /* Records are appended from the start of the sector files, so there can't be any yet. */
+        {
+            LOCK(SECTOR_MUTEX);
+            if(nCurrentFile > 0 || nCurrentFileSize > 0)
+                return debug::error(FUNCTION, strName, " is not empty");
+        }
+
+        BulkReader reader(strFile);
+
+        /* Check the keys were read from a keychain of this type. */
+        std::string strKeychain;
+        uint32_t nBuckets = 0;
+        if(!reader.Header(strKeychain, nBuckets))
+            return debug::error(FUNCTION, strName, " failed to read ", strFile);
+
+        if(strKeychain != KeychainType::Name())
+            return debug::error(FUNCTION, strName, " keychain ", KeychainType::Name(), " can't load keys of ", strKeychain);
+
+        /* The keys of a block are written while the records of the next are appended. */
+        const uint32_t nWriters = std::max(nThreads, uint32_t(1));
+
+        std::vector<BulkRecord> vPending;
+        std::vector<SectorKey> vPendingKeys;
+        std::vector<std::thread> vWriters;
+        std::atomic<bool> fFailed(false);
+
+        uint64_t nBytes = 0;
+        bool fEnd = false;
+        while(!fEnd)
+        {
+            std::vector<BulkRecord> vRecords;
+            bool fRead = reader.Next(vRecords, fEnd);
+
+            /* Append the records in the order of the file, so the sector files are written front to back. */
+            std::vector<SectorKey> vKeys(vRecords.size());
+            for(uint32_t i = 0; fRead && i < vRecords.size(); ++i)
+            {
+                const BulkRecord& record = vRecords[i];
+                if(record.fKeychain)
+                    vKeys[i] = SectorKey(STATE::READY, record.vKey, 0, 0, 0);
+                else if(!Allocate(record.vKey, record.vData, vKeys[i], false))
+                    fRead = false;
+
+                /* Keep the length the key had before the keychain compressed it. */
+                vKeys[i].nLength = record.nLength;
+                nBytes += record.vData.size();
+            }
+
+            /* Wait for the keys of the last block. */
+            for(auto& thread : vWriters)
+                thread.join();
+
+            vWriters.clear();
+
+            if(!fRead || fFailed.load())
+                return debug::error(FUNCTION, strName, " failed to load ", strFile, " after ", reader.Records(), " records");
+
+            /* Write the keys of this block, each thread taking its own buckets so none waits on another's locks. */
+            vPending.swap(vRecords);
+            vPendingKeys.swap(vKeys);
+            for(uint32_t nWriter = 0; nWriter < nWriters && !vPending.empty(); ++nWriter)
+            {
+                vWriters.emplace_back([this, nWriter, nWriters, nBuckets, &vPending, &vPendingKeys, &fFailed]()
+                {
+                    for(uint32_t i = 0; i < vPending.size() && !fFailed.load(); ++i)
+                    {
+                        if(vPending[i].nBucket % nWriters != nWriter)
+                            continue;
+
+                        if(!pSectorKeys->PutBucket(vPending[i].nBucket, nBuckets, vPendingKeys[i]))
+                            fFailed = true;
+                    }
+                });
+            }
         }
+
+        for(auto& thread : vWriters)
+            thread.join();
+
+        if(fFailed.load())
+            return debug::error(FUNCTION, strName, " failed to write keys of ", strFile);
+
+        /* Nothing went through the journal, so flush it all to disk now. */
+        FlushStreams();
+        pSectorKeys->Flush();
+
+        debug::log(0, FUNCTION, strName, " imported ", reader.Records(), " records of ", nBytes,
+            " bytes from ", strFile, " in ", TIMER.ElapsedMilliseconds(), " ms");
+
+        return true;
+    }
+
+
+    /*  Open a read view of the transactions committed so far. */
+    template<class KeychainType, class CacheType>
+    ReadView SectorDatabase<KeychainType, CacheType>::Snapshot()
+    {
+        /* Commits are applied under the transaction lock, so pin between them. */
+        LOCK(TRANSACTION_MUTEX);
+
+        return ReadView(pVersions, pVersions->Pin());
     }
 
 
@@ -669,6 +2290,26 @@ namespace LLD
     }
 
 
+    /*  Add the transaction commitment message to a shared write-ahead log group. */
+    template<class KeychainType, class CacheType>
+    bool SectorDatabase<KeychainType, CacheType>::TxnCheckpoint(Journal& journal)
+    {
+        LOCK(TRANSACTION_MUTEX);
+
+        /* Check for active transaction. */
+        if(!pTransaction)
+            return false;
+
+        /* Set commit message into journal. */
+        pTransaction->ssJournal << std::string("commit");
+
+        /* Add to the group, which is written to disk once every database has checkpointed. */
+        journal.Append(strName, pTransaction->ssJournal.Bytes());
+
+        return true;
+    }
+
+
     /*  Release the transaction checkpoint. */
     template<class KeychainType, class CacheType>
     void SectorDatabase<KeychainType, CacheType>::TxnRelease()
@@ -682,9 +2323,10 @@ namespace LLD
         /** Set the transaction pointer to null also acting like a flag **/
         pTransaction = nullptr;
 
-        /* Delete the transaction journal file. */
-        std::ofstream stream(debug::safe_printstr(config::GetDataDir(), strName, "/journal.dat"), std::ios::trunc);
-        stream.close();
+        /* Delete the transaction journal file, only written when not using the shared write-ahead log. */
+        std::string strJournal = debug::safe_printstr(config::GetDataDir(), strName, "/journal.dat");
+        if(filesystem::exists(strJournal))
+            filesystem::remove(strJournal);
     }
 
 
@@ -692,22 +2334,51 @@ namespace LLD
     template<class KeychainType, class CacheType>
     bool SectorDatabase<KeychainType, CacheType>::TxnCommit()
     {
+        LatencyTimer latency(pCommitLatency);
+
         LOCK(TRANSACTION_MUTEX);
 
         /* Check that there is a valid transaction to apply to the database. */
         if(!pTransaction)
             return false;
 
+        /* Keep the records this commit replaces for the open read views, before any of them change. */
+        const uint64_t nCommit = pVersions->Sequence() + 1;
+        if(pVersions->Pinned() > 0)
+        {
+            std::set< std::vector<uint8_t> > setKeys(pTransaction->setErasedData.begin(), pTransaction->setErasedData.end());
+            setKeys.insert(pTransaction->setKeychain.begin(), pTransaction->setKeychain.end());
+
+            for(const auto& item : pTransaction->mapTransactions)
+                setKeys.insert(item.first);
+
+            for(const auto& item : pTransaction->mapIndex)
+                setKeys.insert(item.first);
+
+            for(const auto& vKey : setKeys)
+            {
+                if(!pVersions->Needs(vKey))
+                    continue;
+
+                std::vector<uint8_t> vData;
+                const bool fExists = Get(vKey, vData);
+
+                pVersions->Keep(vKey, nCommit, fExists, vData);
+            }
+        }
+
         /* Erase data set to be removed. */
         for(const auto& item : pTransaction->setErasedData)
             if(!pSectorKeys->Erase(item))
                 return debug::error(FUNCTION, "failed to erase from keychain");
 
-        /* Commit the sector data. */
+        /* Commit the sector data, flushing the streams once after all records are written. */
         for(const auto& item : pTransaction->mapTransactions)
-            if(!Force(item.first, item.second))
+            if(!Force(item.first, item.second, false))
                 return debug::error(FUNCTION, "failed to commit sector data");
 
+        FlushStreams();
+
         /* Commit keychain entries. */
         for(const auto& item : pTransaction->setKeychain)
         {
@@ -738,6 +2409,9 @@ namespace LLD
                 return debug::error(FUNCTION, "failed to write indexing entry");
         }
 
+        /* Views opened from now on see this commit. */
+        pVersions->Advance(nCommit);
+
         /* Cleanup the transaction object. */
         delete pTransaction;
         pTransaction = nullptr;
@@ -775,11 +2449,34 @@ namespace LLD
 
         debug::log(0, FUNCTION, strName, " transaction journal detected of ", nSize, " bytes");
 
+        return TxnReplay(vBuffer);
+    }
+
+
+    /*  Recover a transaction from a write-ahead log group. */
+    template<class KeychainType, class CacheType>
+    bool SectorDatabase<KeychainType, CacheType>::TxnRecovery(const std::map<std::string, std::vector<uint8_t>>& mapJournals)
+    {
+        /* Check that this database is part of the group. */
+        auto it = mapJournals.find(strName);
+        if(it == mapJournals.end())
+            return false;
+
+        debug::log(0, FUNCTION, strName, " write-ahead log entry of ", it->second.size(), " bytes");
+
+        return TxnReplay(it->second);
+    }
+
+
+    /*  Rebuild the transaction object from the binary data of a journal. */
+    template<class KeychainType, class CacheType>
+    bool SectorDatabase<KeychainType, CacheType>::TxnReplay(const std::vector<uint8_t>& vJournal)
+    {
         /* Create the transaction object. */
         TxnBegin();
 
         /* Serialize the key. */
-        const DataStream ssJournal(vBuffer, SER_LLD, DATABASE_VERSION);
+        const DataStream ssJournal(vJournal, SER_LLD, DATABASE_VERSION);
         while(!ssJournal.End())
         {
             /* Read the data entry type. */
@@ -857,7 +2554,12 @@ namespace LLD
 
     /* Explicity instantiate all template instances needed for compiler. */
     template class SectorDatabase<BinaryHashMap,  BinaryLRU>;
-    //template class SectorDatabase<ShardHashMap,   BinaryLRU>;
+    template class SectorDatabase<BinaryHashMap,  BinaryCLOCK>;
+    template class SectorDatabase<BinaryOrderedMap, BinaryLRU>;
+    template class SectorDatabase<ShardHashMap,   BinaryLRU>;
+    template class SectorDatabase<ShardHashMap,   BinaryCLOCK>;
+    template class SectorDatabase<BinaryLinearMap, BinaryLRU>;
+    template class SectorDatabase<BinaryLinearMap, BinaryCLOCK>;
     //template class SectorDatabase<BinaryHashMap,  BinaryLFU>;
     //template class SectorDatabase<BinaryHashTree, BinaryLRU>;
 
@@ -12,794 +12,331 @@
 ____________________________________________________________________________________________*/
 
 #include <LLD/keychain/shard_hashmap.h>
-#include <LLD/include/enum.h>
-#include <LLD/include/version.h>
 #include <LLD/hash/xxh3.h>
 
-#include <Util/templates/datastream.h>
+#include <Util/include/args.h>
+#include <Util/include/config.h>
 #include <Util/include/filesystem.h>
 #include <Util/include/debug.h>
-#include <Util/include/hex.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <iomanip>
+#include <thread>
 
 namespace LLD
 {
 
-    /** The Database Constructor. To determine file location and the Bytes per Record. **/
-    ShardHashMap::ShardHashMap(const std::string& strBaseLocationIn, const uint8_t nFlagsIn,
-        const uint64_t nBucketsIn, const uint32_t nShardsIn)
-    : KEY_MUTEX()
-    , strBaseLocation(strBaseLocationIn)
-    , fileCache(new TemplateLRU<std::pair<uint16_t, uint16_t>, std::fstream*>(8))
-    , diskShards(new TemplateLRU<uint16_t, std::vector<uint16_t>*>(nShardsIn))
-    , indexCache(new TemplateLRU<uint16_t, std::fstream*>(nShardsIn))
-    , HASHMAP_TOTAL_BUCKETS(nBucketsIn)
-    , HASHMAP_TOTAL_SHARDS(nShardsIn)
-    , HASHMAP_MAX_KEY_SIZE(32)
-    , HASHMAP_KEY_ALLOCATION(static_cast<uint16_t>(HASHMAP_MAX_KEY_SIZE + 13))
-    , nFlags(nFlagsIn)
-    , RECORD_MUTEX(1024)
+    /* The Database Constructor. The buckets are split evenly over the shards. */
+    ShardHashMap::ShardHashMap(const std::string& strBaseLocationIn, const uint8_t nFlagsIn, const uint64_t nBucketsIn)
+    : strBaseLocation       (strBaseLocationIn)
+    , vLocations            ( )
+    , vShards               ( )
+    , HASHMAP_TOTAL_BUCKETS (nBucketsIn)
+    , nShardBuckets         (0)
+    , nFlags                (nFlagsIn)
+    , BATCH_MUTEX           ( )
+    , BATCH_CONDITION       ( )
+    , queueLookups          ( )
+    , vBatchThreads         ( )
+    , fBatchStop            (false)
     {
         Initialize();
-    }
-
-
-    /* Copy Constructor */
-    ShardHashMap::ShardHashMap(const ShardHashMap& map)
-    : KEY_MUTEX()
-    , strBaseLocation(map.strBaseLocation)
-    , fileCache(map.fileCache)
-    , diskShards(map.diskShards)
-    , indexCache(map.indexCache)
-    , HASHMAP_TOTAL_BUCKETS(map.HASHMAP_TOTAL_BUCKETS)
-    , HASHMAP_TOTAL_SHARDS(map.HASHMAP_TOTAL_SHARDS)
-    , HASHMAP_MAX_KEY_SIZE(map.HASHMAP_MAX_KEY_SIZE)
-    , HASHMAP_KEY_ALLOCATION(map.HASHMAP_KEY_ALLOCATION)
-    , nFlags(map.nFlags)
-    , RECORD_MUTEX(map.RECORD_MUTEX.size())
-    {
-        Initialize();
-    }
 
-
-    /* Copy Assignment Operator */
-    ShardHashMap& ShardHashMap::operator=(const ShardHashMap& map)
-    {
-        strBaseLocation        = map.strBaseLocation;
-        fileCache              = map.fileCache;
-        diskShards             = map.diskShards;
-        indexCache             = map.indexCache;
-        HASHMAP_TOTAL_BUCKETS  = map.HASHMAP_TOTAL_BUCKETS;
-        HASHMAP_TOTAL_SHARDS   = map.HASHMAP_TOTAL_SHARDS;
-        HASHMAP_MAX_KEY_SIZE   = map.HASHMAP_MAX_KEY_SIZE;
-        HASHMAP_KEY_ALLOCATION = map.HASHMAP_KEY_ALLOCATION;
-        nFlags                 = map.nFlags;
-
-        Initialize();
-
-        return *this;
+        /* Start the batch threads, the first shard of a batch is looked up by its caller. */
+        for(uint32_t nShard = 1; nShard < vShards.size(); ++nShard)
+            vBatchThreads.push_back(std::thread(std::bind(&ShardHashMap::BatchThread, this)));
     }
 
 
-    /** Default Destructor **/
+    /* Default Destructor */
     ShardHashMap::~ShardHashMap()
     {
-        delete fileCache;
-        delete diskShards;
-        delete indexCache;
-    }
-
-
-    /*  Compresses a given key until it matches size criteria.
-     *  This function is one way and efficient for reducing key sizes. */
-    void ShardHashMap::CompressKey(std::vector<uint8_t>& vData, uint16_t nSize)
-    {
-        /* Loop until key is of desired size. */
-        while(vData.size() > nSize)
+        /* Stop the batch threads before the shards they read go away. */
         {
-            /* Loop half of the key to XOR elements. */
-            uint64_t nSize2 = (vData.size() >> 1);
-            for(uint64_t i = 0; i < nSize2; ++i)
-            {
-                uint64_t i2 = (i << 1);
-                if(i2 < (nSize2 << 1))
-                    vData[i] = vData[i] ^ vData[i2];
-            }
-
-            /* Resize the container to half its size. */
-            vData.resize(std::max(uint16_t(nSize2), nSize));
+            std::unique_lock<std::mutex> lock(BATCH_MUTEX);
+            fBatchStop = true;
         }
-    }
-
+        BATCH_CONDITION.notify_all();
 
-    /*  Calculates a bucket to be used for the hashmap allocation. */
-    uint32_t ShardHashMap::GetBucket(const std::vector<uint8_t>& vKey, uint32_t& nShard)
-    {
-        /* Get an xxHash. */
-        uint64_t nBucket = XXH64(&vKey[0], vKey.size(), 0) / 7;
-        nShard = static_cast<uint32_t>(nBucket % HASHMAP_TOTAL_SHARDS);
+        for(auto& thread : vBatchThreads)
+            if(thread.joinable())
+                thread.join();
 
-        /* Get the hashmap bucket. */
-        return static_cast<uint32_t>(nBucket % HASHMAP_TOTAL_BUCKETS);
+        for(auto& pshard : vShards)
+            delete pshard;
     }
 
 
-    /* Loads a disk index containing shard data into memory.*/
-    static uint64_t TOTAL_KEYS = 0;
-    void ShardHashMap::LoadShardIndex(const uint32_t nShard)
+    /*  Read or create the list of shard directories, and open every shard. */
+    void ShardHashMap::Initialize()
     {
-        /* Check that disk index isn't already loaded. */
-        if(diskShards->Has(nShard))
-            return;
-
-        /* Build the hashmap indexes. */
-        std::string index = debug::safe_printstr(strBaseLocation, "_index.", std::setfill('0'), std::setw(3), nShard);
-        if(!filesystem::exists(index))
-        {
-            /* Generate empty space for new file. */
-            const static std::vector<uint8_t> vSpace(HASHMAP_TOTAL_BUCKETS * 2, 0);
-
-            /* Write the new disk index .*/
-            std::fstream stream(index, std::ios::out | std::ios::binary | std::ios::trunc);
-            stream.write((char*)&vSpace[0], vSpace.size());
-            stream.close();
-
-            /* Debug output showing generation of disk index. */
-            debug::log(0, FUNCTION, "Generated Disk Index ", nShard, " of ", vSpace.size(), " bytes");
-
-            /* Set disk index cache to blank values. */
-            std::vector<uint16_t>* hashmap = new std::vector<uint16_t>(HASHMAP_TOTAL_BUCKETS, 0);
+        /* Create directories if they don't exist yet. */
+        if(!filesystem::exists(strBaseLocation) && filesystem::create_directories(strBaseLocation))
+            debug::log(0, FUNCTION, "Generated Path ", strBaseLocation);
 
-            /* Add to the LRU cache. */
-            diskShards->Put(nShard, hashmap);
-        }
+        /* Read the shard directories of an existing keychain, they can't change once keys are written. */
+        const std::string strManifest = strBaseLocation + "_shards";
 
-        /* Read the hashmap indexes. */
-        else
+        std::ifstream ssManifest(strManifest);
+        if(ssManifest.is_open())
         {
-            /* Create the stream index object. */
-            std::fstream* pstream;
-            if(!indexCache->Get(nShard, pstream))
+            std::string strLocation;
+            while(std::getline(ssManifest, strLocation))
             {
-                pstream = new std::fstream(index, std::ios::in | std::ios::out | std::ios::binary);
-                if(!pstream->is_open())
-                {
-                    delete pstream;
-                    throw debug::exception(FUNCTION, "index cache file could not be loaded");
-                }
-
-                indexCache->Put(nShard, pstream);
+                if(!strLocation.empty())
+                    vLocations.push_back(strLocation);
             }
 
-            /* Build a vector to read the disk index. */
-            std::vector<uint8_t> vIndex(HASHMAP_TOTAL_BUCKETS * 2, 0);
+            if(vLocations.empty())
+                throw debug::exception(FUNCTION, "no shards listed in ", strManifest);
+        }
+        else
+        {
+            /* Spread new shards over the shard roots, or keep them under the keychain without any. */
+            const uint32_t nShards = static_cast<uint32_t>(std::max(config::GetArg("-lldshards", DEFAULT_KEYCHAIN_SHARDS), int64_t(1)));
+            const std::vector<std::string> vRoots = config::mapMultiArgs["-lldsharddir"];
 
-            /* Read the entire index shard. */
-            pstream->read((char*)&vIndex[0], vIndex.size());
+            /* The path of the keychain under the data directory is repeated under each root. */
+            std::string strRelative = strBaseLocation;
 
-            /* Deserialize the values into memory index. */
-            uint32_t nTotalKeys = 0;
+            const std::string strDataDir = config::GetDataDir();
+            if(strRelative.compare(0, strDataDir.size(), strDataDir) == 0)
+                strRelative = strRelative.substr(strDataDir.size());
 
-            /* Create the hashmap vector. */
-            std::vector<uint16_t>* hashmap = new std::vector<uint16_t>(HASHMAP_TOTAL_BUCKETS, 0);
-            for(uint32_t nBucket = 0; nBucket < HASHMAP_TOTAL_BUCKETS; ++nBucket)
+            for(uint32_t nShard = 0; nShard < nShards; ++nShard)
             {
-                std::copy((uint8_t *)&vIndex[nBucket * 2], (uint8_t *)&vIndex[nBucket * 2] + 2, (uint8_t *)&hashmap->at(nBucket));
+                std::string strRoot = strBaseLocation;
+                if(!vRoots.empty())
+                {
+                    strRoot = vRoots[nShard % vRoots.size()];
+                    if(strRoot.back() != '/')
+                        strRoot += '/';
 
-                nTotalKeys += hashmap->at(nBucket);
+                    strRoot += strRelative;
+                }
 
-                TOTAL_KEYS += hashmap->at(nBucket);
+                vLocations.push_back(debug::safe_printstr(strRoot, "shard.", std::setfill('0'), std::setw(3), nShard, "/"));
             }
 
-            /* Debug output showing loading of disk index. */
-            //debug::log(0, FUNCTION, "Loaded Shard ", nShard, " Index of ", vIndex.size(), " bytes and ", nTotalKeys, " keys");
-
-            /* Add to the LRU cache. */
-            diskShards->Put(nShard, hashmap);
-        }
-    }
-
-
-    /*  Read a key index from the disk hashmaps. */
-    void ShardHashMap::Initialize()
-    {
-        /* Create directories if they don't exist yet. */
-        if(!filesystem::exists(strBaseLocation) && filesystem::create_directories(strBaseLocation))
-            debug::log(0, FUNCTION, "Generated Path ", strBaseLocation);
-
-        /* Loop through the available shards. */
-        for(uint32_t nShard = 0; nShard < HASHMAP_TOTAL_SHARDS; ++nShard)
-        {
-            /* Load the hashmap shards. */
-            LoadShardIndex(nShard);
-
-            /* Build the first hashmap index file if it doesn't exist. */
-            std::string file = debug::safe_printstr(strBaseLocation, "_hashmap.",
-                std::setfill('0'), std::setw(3), nShard, ".", std::setfill('0'), std::setw(5), 0u);
-
-            /* Create hashmap for current shard. */
-            if(!filesystem::exists(file))
+            /* Write the list in one rename, so a crash can't leave half of it. */
             {
-                /* Build a vector with empty bytes to flush to disk. */
-                std::vector<uint8_t> vSpace(HASHMAP_TOTAL_BUCKETS * HASHMAP_KEY_ALLOCATION, 0);
+                std::ofstream stream(strManifest + ".tmp", std::ios::out | std::ios::trunc);
+                for(const auto& strLocation : vLocations)
+                    stream << strLocation << "\n";
 
-                /* Flush the empty keychain file to disk. */
-                std::fstream stream(file, std::ios::out | std::ios::binary | std::ios::trunc);
-                stream.write((char*)&vSpace[0], vSpace.size());
-                stream.close();
-
-                /* Debug output showing generating of the hashmap file. */
-                debug::log(0, FUNCTION, "Generated Disk Hash Map 0 of ", vSpace.size(), " bytes");
+                stream.flush();
+                if(!stream)
+                    throw debug::exception(FUNCTION, "failed to write ", strManifest);
             }
 
-            /* Load the stream object into the stream LRU cache. */
-            std::fstream* pstream = new std::fstream(file, std::ios::in | std::ios::out | std::ios::binary);
-            if(!pstream->is_open())
-                throw debug::exception(FUNCTION, "failed to open ", file);
+            if(std::rename((strManifest + ".tmp").c_str(), strManifest.c_str()) != 0)
+                throw debug::exception(FUNCTION, "failed to rename ", strManifest);
 
-            fileCache->Put(std::make_pair(nShard, 0), pstream);
+            debug::log(0, FUNCTION, "Generated ", nShards, " shards over ", std::max(vRoots.size(), size_t(1)), " directories");
         }
 
-        debug::log(0, FUNCTION, "Shard Hashmap Initialized with ", TOTAL_KEYS, " total keys");
+        /* Open each shard, which creates its files the first time. */
+        nShardBuckets = static_cast<uint32_t>(std::max(HASHMAP_TOTAL_BUCKETS / vLocations.size(), uint64_t(1)));
+        for(const auto& strLocation : vLocations)
+            vShards.push_back(new BinaryHashMap(strLocation, nFlags, nShardBuckets));
     }
 
 
-    /*  Read a key index from the disk hashmaps. */
+    /*  Read a key index from the shard it hashes to. */
     bool ShardHashMap::Get(const std::vector<uint8_t>& vKey, SectorKey &cKey)
     {
-        LOCK(KEY_MUTEX);
+        return vShards[Shard(vKey)]->Get(vKey, cKey);
+    }
 
-        /* Get the assigned bucket for the hashmap. */
-        uint32_t nShard  = 0;
-        uint32_t nBucket = GetBucket(vKey, nShard);
 
-        /* Get the file binary position. */
-        uint32_t nFilePos = nBucket * HASHMAP_KEY_ALLOCATION;
+    /*  Read many keys, with the keys of each shard looked up on a batch thread. */
+    uint32_t ShardHashMap::BatchGet(const std::vector< std::vector<uint8_t> >& vKeys,
+                                    std::vector< std::pair<SectorKey, uint32_t> >& vSectors)
+    {
+        /* Small batches aren't worth handing to other threads. */
+        if(vKeys.size() < MIN_PARALLEL_KEYS || vBatchThreads.empty())
+            return Keychain::BatchGet(vKeys, vSectors);
 
-        /* Set the cKey return value non compressed. */
-        cKey.vKey = vKey;
+        /* Group the keys by shard. */
+        std::vector< std::vector<uint32_t> > vGroups(vShards.size());
+        for(uint32_t n = 0; n < vKeys.size(); ++n)
+            vGroups[Shard(vKeys[n])].push_back(n);
 
-        /* Compress any keys larger than max size. */
-        std::vector<uint8_t> vKeyCompressed = vKey;
-        CompressKey(vKeyCompressed, HASHMAP_MAX_KEY_SIZE);
+        /* Each shard's keys are looked up in order, into their own results. */
+        std::vector< std::vector< std::pair<SectorKey, uint32_t> > > vFound(vShards.size());
 
-        /* Get the disk index. */
-        std::vector<uint16_t>* hashmap;
-        if(!diskShards->Get(nShard, hashmap))
-        {
-            LoadShardIndex(nShard);
-            if(!diskShards->Get(nShard, hashmap))
-                return debug::error(FUNCTION, "couldn't get shard index");
-        }
+        /* The lookups of this batch still running on the batch threads. */
+        std::mutex DONE_MUTEX;
+        std::condition_variable DONE_CONDITION;
+        uint32_t nRunning = 0;
 
-        /* Reverse iterate the linked file list from hashmap to get most recent keys first. */
-        std::vector<uint8_t> vBucket(HASHMAP_KEY_ALLOCATION, 0);
-        for(int16_t i = hashmap->at(nBucket) - 1; i >= 0; --i)
+        auto fnLookup = [&](const uint32_t nShard)
         {
-            /* Find the file stream for LRU cache. */
-            std::fstream *pstream;
-            if(!fileCache->Get(std::make_pair(nShard, i), pstream))
+            for(const auto& n : vGroups[nShard])
             {
-                /* Set the new stream pointer. */
-                std::string filename = debug::safe_printstr(strBaseLocation, "_hashmap.",
-                    std::setfill('0'), std::setw(3), nShard, ".", std::setfill('0'), std::setw(5), i);
-
-                pstream = new std::fstream(filename, std::ios::in | std::ios::out | std::ios::binary);
-                if(!pstream->is_open())
-                {
-                    delete pstream;
-                    continue;
-                }
-
-                /* If file not found add to LRU cache. */
-                fileCache->Put(std::make_pair(nShard, i), pstream);
+                SectorKey cKey;
+                if(vShards[nShard]->Get(vKeys[n], cKey))
+                    vFound[nShard].push_back(std::make_pair(cKey, n));
             }
+        };
 
-            /* Seek to the hashmap index in file. */
-            pstream->seekg(nFilePos, std::ios::beg);
-
-            /* Read the bucket binary data from file stream */
-            pstream->read((char*) &vBucket[0], vBucket.size());
-
-            /* Check if this bucket has the key */
-            if(std::equal(vBucket.begin() + 13, vBucket.begin() + 13 + vKeyCompressed.size(), vKeyCompressed.begin()))
+        /* Queue every other shard with keys to the batch threads, and look up the first on this one. */
+        {
+            std::unique_lock<std::mutex> lock(BATCH_MUTEX);
+            for(uint32_t nShard = 1; nShard < vShards.size(); ++nShard)
             {
-                /* Deserialie key and return if found. */
-                DataStream ssKey(vBucket, SER_LLD, DATABASE_VERSION);
-                ssKey >> cKey;
-
-                /* Check if the key is ready. */
-                if(!cKey.Ready())
+                if(vGroups[nShard].empty())
                     continue;
 
-                /* Debug Output of Sector Key Information. */
-                if(config::nVerbose >= 4)
-                    debug::log(4, FUNCTION, "State: ", cKey.nState == STATE::READY ? "Valid" : "Invalid",
-                        " | Length: ", cKey.nLength,
-                        " | Bucket ", nBucket,
-                        " | Location: ", nFilePos,
-                        " | File: ", hashmap->at(nBucket) - 1,
-                        " | Sector File: ", cKey.nSectorFile,
-                        " | Sector Size: ", cKey.nSectorSize,
-                        " | Sector Start: ", cKey.nSectorStart, "\n",
-                        HexStr(vKeyCompressed.begin(), vKeyCompressed.end(), true));
-
-                return true;
+                ++nRunning;
+                queueLookups.push_back([&, nShard]
+                {
+                    fnLookup(nShard);
+
+                    std::unique_lock<std::mutex> DONE_LOCK(DONE_MUTEX);
+                    if(--nRunning == 0)
+                        DONE_CONDITION.notify_one();
+                });
             }
         }
+        BATCH_CONDITION.notify_all();
 
-        return false;
-    }
-
+        fnLookup(0);
 
-    /*  Read a key index from the disk hashmaps.
-     *  This method iterates all maps to find all keys. */
-    bool ShardHashMap::Get(const std::vector<uint8_t>& vKey, std::vector<SectorKey>& vKeys)
-    {
-        LOCK(KEY_MUTEX);
-
-        /* Get the assigned bucket for the hashmap. */
-        uint32_t nShard  = 0;
-        uint32_t nBucket = GetBucket(vKey, nShard);
-
-        /* Get the file binary position. */
-        uint32_t nFilePos = nBucket * HASHMAP_KEY_ALLOCATION;
-
-        /* Compress any keys larger than max size. */
-        std::vector<uint8_t> vKeyCompressed = vKey;
-        CompressKey(vKeyCompressed, HASHMAP_MAX_KEY_SIZE);
-
-        /* Get the disk index. */
-        std::vector<uint16_t>* hashmap;
-        if(!diskShards->Get(nShard, hashmap))
+        /* Wait for the batch threads, this batch's results live on this stack. */
         {
-            LoadShardIndex(nShard);
-            if(!diskShards->Get(nShard, hashmap))
-                return debug::error(FUNCTION, "couldn't get shard index");
+            std::unique_lock<std::mutex> DONE_LOCK(DONE_MUTEX);
+            DONE_CONDITION.wait(DONE_LOCK, [&]{ return nRunning == 0; });
         }
 
-        /* Reverse iterate the linked file list from hashmap to get most recent keys first. */
-        std::vector<uint8_t> vBucket(HASHMAP_KEY_ALLOCATION, 0);
-        for(int16_t i = hashmap->at(nBucket) - 1; i >= 0; --i)
+        /* Gather the results. */
+        uint32_t nFound = 0;
+        for(const auto& vShard : vFound)
         {
-            /* Find the file stream for LRU cache. */
-            std::fstream *pstream;
-            if(!fileCache->Get(std::make_pair(nShard, i), pstream))
-            {
-                /* Set the new stream pointer. */
-                std::string filename = debug::safe_printstr(strBaseLocation, "_hashmap.",
-                    std::setfill('0'), std::setw(3), nShard, ".", std::setfill('0'), std::setw(5), i);
-
-                pstream = new std::fstream(filename, std::ios::in | std::ios::out | std::ios::binary);
-                if(!pstream->is_open())
-                {
-                    delete pstream;
-                    continue;
-                }
-
-                /* If file not found add to LRU cache. */
-                fileCache->Put(std::make_pair(nShard, i), pstream);
-            }
-
-            /* Seek to the hashmap index in file. */
-            pstream->seekg (nFilePos, std::ios::beg);
-
-            /* Read the bucket binary data from file stream */
-            pstream->read((char*) &vBucket[0], vBucket.size());
-
-            /* Check if this bucket has the key */
-            if(std::equal(vBucket.begin() + 13, vBucket.begin() + 13 + vKeyCompressed.size(), vKeyCompressed.begin()))
-            {
-                /* Deserialize key and return if found. */
-                DataStream ssKey(vBucket, SER_LLD, DATABASE_VERSION);
-                SectorKey cKey;
-                ssKey >> cKey;
-
-                /* Check if the key is in ready state. */
-                if(!cKey.Ready())
-                    continue;
-
-                /* Assign the binary key. */
-                cKey.vKey = vKey;
-
-                /* Add key to return vector. */
-                vKeys.push_back(cKey);
-
-                /* Debug Output of Sector Key Information. */
-                if(config::nVerbose >= 4)
-                    debug::log(4, FUNCTION, "Found State: ", cKey.nState == STATE::READY ? "Valid" : "Invalid",
-                        " | Length: ", cKey.nLength,
-                        " | Bucket ", nBucket,
-                        " | Location: ", nFilePos,
-                        " | File: ", hashmap->at(nBucket) - 1,
-                        " | Sector File: ", cKey.nSectorFile,
-                        " | Sector Size: ", cKey.nSectorSize,
-                        " | Sector Start: ", cKey.nSectorStart, "\n",
-                        HexStr(vKeyCompressed.begin(), vKeyCompressed.end(), true));
-            }
+            vSectors.insert(vSectors.end(), vShard.begin(), vShard.end());
+            nFound += static_cast<uint32_t>(vShard.size());
         }
 
-        return (vKeys.size() > 0);
+        return nFound;
     }
 
 
-    /*  Write a key to the disk hashmaps. */
+    /*  Write a key to the shard it hashes to. */
     bool ShardHashMap::Put(const SectorKey& cKey)
     {
-        LOCK(KEY_MUTEX);
-
-        /* Get the assigned bucket for the hashmap. */
-        uint32_t nShard  = 0;
-        uint32_t nBucket = GetBucket(cKey.vKey, nShard);
-
-        /* Get the file binary position. */
-        uint32_t nFilePos = nBucket * HASHMAP_KEY_ALLOCATION;
-
-        /* Compress any keys larger than max size. */
-        std::vector<uint8_t> vKeyCompressed = cKey.vKey;
-        CompressKey(vKeyCompressed, HASHMAP_MAX_KEY_SIZE);
-
-        /* Get the disk index. */
-        std::vector<uint16_t>* hashmap;
-        if(!diskShards->Get(nShard, hashmap))
-        {
-            LoadShardIndex(nShard);
-            if(!diskShards->Get(nShard, hashmap))
-                return debug::error(FUNCTION, "couldn't get shard index");
-        }
-
-        /* Handle if not in append mode which will update the key. */
-        if(!(nFlags & FLAGS::APPEND))
-        {
-            /* Reverse iterate the linked file list from hashmap to get most recent keys first. */
-            std::vector<uint8_t> vBucket(HASHMAP_KEY_ALLOCATION, 0);
-            for(int16_t i = hashmap->at(nBucket) - 1; i >= 0; --i)
-            {
-                /* Find the file stream for LRU cache. */
-                std::fstream *pstream;
-                if(!fileCache->Get(std::make_pair(nShard, i), pstream))
-                {
-                    /* Set the new stream pointer. */
-                    std::string filename = debug::safe_printstr(strBaseLocation, "_hashmap.",
-                        std::setfill('0'), std::setw(3), nShard, ".", std::setfill('0'), std::setw(5), i);
-
-                    pstream = new std::fstream(filename, std::ios::in | std::ios::out | std::ios::binary);
-                    if(!pstream->is_open())
-                    {
-                        delete pstream;
-                        continue;
-                    }
-
-                    /* If file not found add to LRU cache. */
-                    fileCache->Put(std::make_pair(nShard, i), pstream);
-                }
-
-                /* Seek to the hashmap index in file. */
-                pstream->seekg (nFilePos, std::ios::beg);
-
-                /* Read the bucket binary data from file stream */
-                pstream->read((char*) &vBucket[0], vBucket.size());
-
-                /* Check if this bucket has the key or is in an empty state. */
-                if(vBucket[0] == STATE::EMPTY || std::equal(vBucket.begin() + 13, vBucket.begin() + 13 + vKeyCompressed.size(), vKeyCompressed.begin()))
-                {
-                    /* Serialize the key and return if found. */
-                    DataStream ssKey(SER_LLD, DATABASE_VERSION);
-                    ssKey << cKey;
-
-                    /* Serialize the key into the end of the vector. */
-                    ssKey.write((char*)&vKeyCompressed[0], vKeyCompressed.size());
-
-                    /* Handle the disk writing operations. */
-                    pstream->seekp (nFilePos, std::ios::beg);
-                    pstream->write((char*)&ssKey.Bytes()[0], ssKey.size());
-                    pstream->flush();
-
-                    /* Debug Output of Sector Key Information. */
-                    if(config::nVerbose >= 4)
-                        debug::log(4, FUNCTION, "State: ", cKey.nState == STATE::READY ? "Valid" : "Invalid",
-                            " | Length: ", cKey.nLength,
-                            " | Bucket ", nBucket,
-                            " | Location: ", nFilePos,
-                            " | File: ", hashmap->at(nBucket) - 1,
-                            " | Sector File: ", cKey.nSectorFile,
-                            " | Sector Size: ", cKey.nSectorSize,
-                            " | Sector Start: ", cKey.nSectorStart, "\n",
-                            HexStr(vKeyCompressed.begin(), vKeyCompressed.end(), true));
-
-                    return true;
-                }
-            }
-        }
-
-        /* Create a new disk hashmap object in linked list if it doesn't exist. */
-        std::string file = debug::safe_printstr(strBaseLocation, "_hashmap.",
-            std::setfill('0'), std::setw(3), nShard, ".", std::setfill('0'), std::setw(5), hashmap->at(nBucket));
-
-        if(!filesystem::exists(file))
-        {
-            /* Blank vector to write empty space in new disk file. */
-            std::vector<uint8_t> vSpace(HASHMAP_KEY_ALLOCATION, 0);
-
-            /* Write the blank data to the new file handle. */
-            std::ofstream stream(file, std::ios::out | std::ios::binary | std::ios::app);
-            if(!stream)
-                return debug::error(FUNCTION, strerror(errno));
-
-            for(uint32_t i = 0; i < HASHMAP_TOTAL_BUCKETS; ++i)
-                stream.write((char*)&vSpace[0], vSpace.size());
-
-            stream.flush();
-            stream.close();
-
-            /* Debug output for monitoring new disk maps. */
-            debug::log(0, FUNCTION, "Generated Disk Hash Map ", hashmap->at(nBucket), " in Shard ", nShard, " of ", vSpace.size(), " bytes");
-
-            //debug::log(0, FUNCTION, "Total Space Efficiency is ", (nTotalKeys * 100.0) / (hashmap.size() * nTotalHashmaps),
-            //                        " With ", nTotalKeys, " Keys");
-        }
-
-        /* Read the State and Size of Sector Header. */
-        DataStream ssKey(SER_LLD, DATABASE_VERSION);
-        ssKey << cKey;
-
-        /* Serialize the key into the end of the vector. */
-        ssKey.write((char*)&vKeyCompressed[0], vKeyCompressed.size());
-
-        /* Find the file stream for LRU cache. */
-        std::fstream* pstream;
-        if(!fileCache->Get(std::make_pair(nShard, hashmap->at(nBucket)), pstream))
-        {
-            /* Set the new stream pointer. */
-            std::string filename = debug::safe_printstr(strBaseLocation, "_hashmap.",
-                std::setfill('0'), std::setw(3), nShard, ".", std::setfill('0'), std::setw(5), hashmap->at(nBucket));
-
-            /* Set the new stream pointer. */
-            pstream = new std::fstream(filename, std::ios::in | std::ios::out | std::ios::binary);
-            if(!pstream || !pstream->is_open())
-            {
-                delete pstream;
-                return debug::error(FUNCTION, "Failed to generate file object");
-            }
-
-            /* If not in cache, add to the LRU. */
-            fileCache->Put(std::make_pair(nShard, hashmap->at(nBucket)), pstream);
-        }
+        return vShards[Shard(cKey.vKey)]->Put(cKey);
+    }
 
-        /* Flush the key file to disk. */
-        pstream->seekp (nFilePos, std::ios::beg);
-        pstream->write((char*)&ssKey.Bytes()[0], ssKey.size());
-        pstream->flush();
 
-        /* Seek to the index position. */
-        std::fstream* pindex;
-        if(!indexCache->Get(nShard, pindex))
+    /*  Write a key as read by CompactBucket into the same bucket of the shards. */
+    bool ShardHashMap::PutBucket(const uint32_t nBucket, const uint32_t nTotal, const SectorKey& cKey)
+    {
+        /* Keys from a keychain of another shape have to be whole to be hashed again. */
+        if(nTotal != TotalBuckets() || nBucket >= nTotal)
         {
-            /* Build the hashmap indexes. */
-            std::string index = debug::safe_printstr(strBaseLocation, "_index.", std::setfill('0'), std::setw(3), nShard);
-
-            /* Create new index file. */
-            pindex = new std::fstream(index, std::ios::in | std::ios::out | std::ios::binary);
-            if(!pindex->is_open())
-            {
-                delete pindex;
-                return debug::error(FUNCTION, "Failed to generate file object");
-            }
+            if(cKey.nLength != cKey.vKey.size())
+                return debug::error(FUNCTION, "compressed key needs ", nTotal, " buckets, keychain has ", TotalBuckets());
 
-            /* If not in cache, add to the LRU. */
-            indexCache->Put(nShard, pindex);
+            return Put(cKey);
         }
 
-        /* Seek to binary position in index file. */
-        pindex->seekp((nBucket * 2), std::ios::beg);
-
-        /* Write the index to disk. */
-        uint16_t nIndex = ++hashmap->at(nBucket);
+        return vShards[nBucket / nShardBuckets]->PutBucket(nBucket % nShardBuckets, nShardBuckets, cKey);
+    }
 
-        /* Get the bucket data. */
-        std::vector<uint8_t> vBucket((uint8_t*)&nIndex, (uint8_t*)&nIndex + 2);
 
-        /* Write the index into hashmap. */
-        pindex->write((char*)&vBucket[0], vBucket.size());
-        pindex->flush();
+    /*  Flush every shard to disk. */
+    void ShardHashMap::Flush()
+    {
+        for(auto& pshard : vShards)
+            pshard->Flush();
+    }
 
-        /* Debug Output of Sector Key Information. */
-        if(config::nVerbose >= 4)
-            debug::log(4, FUNCTION, "State: ", cKey.nState == STATE::READY ? "Valid" : "Invalid",
-                " | Length: ", cKey.nLength,
-                " | Bucket ", nBucket,
-                " | Location: ", nFilePos,
-                " | File: ", hashmap->at(nBucket) - 1,
-                " | Sector File: ", cKey.nSectorFile,
-                " | Sector Size: ", cKey.nSectorSize,
-                " | Sector Start: ", cKey.nSectorStart,
-                " | Key: ",  HexStr(vKeyCompressed.begin(), vKeyCompressed.end()));
 
-        return true;
+    /*  Restore an erased key from keychain. */
+    bool ShardHashMap::Restore(const std::vector<uint8_t> &vKey)
+    {
+        return vShards[Shard(vKey)]->Restore(vKey);
     }
 
 
-    /*  Erase a key from the disk hashmaps.
-     *  TODO: This should be optimized further. */
-    bool ShardHashMap::Erase(const std::vector<uint8_t>& vKey)
+    /*  Erase a key from the shard it hashes to. */
+    bool ShardHashMap::Erase(const std::vector<uint8_t> &vKey)
     {
-        LOCK(KEY_MUTEX);
-
-        /* Get the assigned bucket for the hashmap. */
-        uint32_t nShard  = 0;
-        uint32_t nBucket = GetBucket(vKey, nShard);
+        return vShards[Shard(vKey)]->Erase(vKey);
+    }
 
-        /* Get the file binary position. */
-        uint32_t nFilePos = nBucket * HASHMAP_KEY_ALLOCATION;
 
-        /* Compress any keys larger than max size. */
-        std::vector<uint8_t> vKeyCompressed = vKey;
-        CompressKey(vKeyCompressed, HASHMAP_MAX_KEY_SIZE);
+    /*  Add the probe depth of every shard to a database's metrics. */
+    void ShardHashMap::Instrument(Metrics& metrics)
+    {
+        for(auto& pshard : vShards)
+            pshard->Instrument(metrics);
+    }
 
-        /* Get the disk index. */
-        std::vector<uint16_t>* hashmap;
-        if(!diskShards->Get(nShard, hashmap))
-        {
-            LoadShardIndex(nShard);
-            if(!diskShards->Get(nShard, hashmap))
-                return debug::error(FUNCTION, "couldn't get shard index");
-        }
 
-        /* Reverse iterate the linked file list from hashmap to get most recent keys first. */
-        std::vector<uint8_t> vBucket(HASHMAP_KEY_ALLOCATION, 0);
-        for(int16_t i = hashmap->at(nBucket) - 1; i >= 0; --i)
-        {
-            /* Find the file stream for LRU cache. */
-            std::fstream* pstream;
-            if(!fileCache->Get(std::make_pair(nShard, i), pstream))
-            {
-                /* Set the new stream pointer. */
-                std::string filename = debug::safe_printstr(strBaseLocation, "_hashmap.",
-                    std::setfill('0'), std::setw(3), nShard, ".", std::setfill('0'), std::setw(5), i);
+    /*  Get the total buckets of every shard. */
+    uint32_t ShardHashMap::TotalBuckets() const
+    {
+        return nShardBuckets * static_cast<uint32_t>(vShards.size());
+    }
 
-                /* Set the new stream pointer. */
-                pstream = new std::fstream(filename, std::ios::in | std::ios::out | std::ios::binary);
-                if(!pstream->is_open())
-                {
-                    delete pstream;
-                    return debug::error(FUNCTION, "Failed to generate file object");
-                }
 
-                /* If not in cache, add to the LRU. */
-                fileCache->Put(std::make_pair(nShard, i), pstream);
-            }
+    /*  Get the number of hashmap files a bucket is linked through. */
+    uint16_t ShardHashMap::Depth(const uint32_t nBucket) const
+    {
+        return vShards[nBucket / nShardBuckets]->Depth(nBucket % nShardBuckets);
+    }
 
-            /* Seek to the hashmap index in file. */
-            pstream->seekg (nFilePos, std::ios::beg);
 
-            /* Read the bucket binary data from file stream */
-            pstream->read((char*) &vBucket[0], vBucket.size());
+    /*  Read the live keys of a bucket of its shard without writing to the keychain. */
+    bool ShardHashMap::ScanBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys)
+    {
+        return vShards[nBucket / nShardBuckets]->ScanBucket(nBucket % nShardBuckets, vKeys);
+    }
 
-            /* Check if this bucket has the key */
-            if(std::equal(vBucket.begin() + 13, vBucket.begin() + 13 + vKeyCompressed.size(), vKeyCompressed.begin()))
-            {
-                /* Deserialize key and return if found. */
-                DataStream ssKey(vBucket, SER_LLD, DATABASE_VERSION);
-                SectorKey cKey;
-                ssKey >> cKey;
-
-                /* Seek to the hashmap index in file. */
-                pstream->seekp (nFilePos, std::ios::beg);
-
-                /* Read the bucket binary data from file stream */
-                std::vector<uint8_t> vEmpty(HASHMAP_KEY_ALLOCATION, 0);
-                pstream->write((char*) &vEmpty[0], vEmpty.size());
-                pstream->flush();
-
-                /* Debug Output of Sector Key Information. */
-                if(config::nVerbose >= 4)
-                    debug::log(4, FUNCTION, "Erased State: ", cKey.nState == STATE::READY ? "Valid" : "Invalid",
-                        " | Length: ", cKey.nLength,
-                        " | Bucket ", nBucket,
-                        " | Location: ", nFilePos,
-                        " | File: ", hashmap->at(nBucket) - 1,
-                        " | Sector File: ", cKey.nSectorFile,
-                        " | Sector Size: ", cKey.nSectorSize,
-                        " | Sector Start: ", cKey.nSectorStart,
-                        " | Key: ", HexStr(vKeyCompressed.begin(), vKeyCompressed.end()));
-
-                return true;
-            }
-        }
 
-        return false;
+    /*  Collapse a bucket of its shard to the files its live keys need. */
+    bool ShardHashMap::CompactBucket(const uint32_t nBucket, std::vector<SectorKey>& vKeys)
+    {
+        return vShards[nBucket / nShardBuckets]->CompactBucket(nBucket % nShardBuckets, vKeys);
     }
 
 
-    /*  Restore an index in the hashmap if it is found. */
-    bool ShardHashMap::Restore(const std::vector<uint8_t> &vKey)
+    /*  Point a key at a new sector location, if it hasn't changed since CompactBucket. */
+    bool ShardHashMap::Relocate(const uint32_t nBucket, const SectorKey& cKey, const uint16_t nSectorFile, const uint32_t nSectorStart)
     {
-        LOCK(KEY_MUTEX);
-
-        /* Get the assigned bucket for the hashmap. */
-        uint32_t nShard  = 0;
-        uint32_t nBucket = GetBucket(vKey, nShard);
+        return vShards[nBucket / nShardBuckets]->Relocate(nBucket % nShardBuckets, cKey, nSectorFile, nSectorStart);
+    }
 
-        /* Get the file binary position. */
-        uint32_t nFilePos = nBucket * HASHMAP_KEY_ALLOCATION;
 
-        /* Compress any keys larger than max size. */
-        std::vector<uint8_t> vKeyCompressed = vKey;
-        CompressKey(vKeyCompressed, HASHMAP_MAX_KEY_SIZE);
+    /*  Get the shard a key hashes to. */
+    uint32_t ShardHashMap::Shard(const std::vector<uint8_t>& vKey) const
+    {
+        /* Use the high bits, the shard's buckets are picked from the whole hash. */
+        return static_cast<uint32_t>((XXH64(&vKey[0], vKey.size(), 0) >> 32) % vShards.size());
+    }
 
-        /* Get the disk index. */
-        std::vector<uint16_t>* hashmap;
-        if(!diskShards->Get(nShard, hashmap))
-        {
-            LoadShardIndex(nShard);
-            if(!diskShards->Get(nShard, hashmap))
-                return debug::error(FUNCTION, "couldn't get shard index");
-        }
 
-        /* Reverse iterate the linked file list from hashmap to get most recent keys first. */
-        std::vector<uint8_t> vBucket(HASHMAP_KEY_ALLOCATION, 0);
-        for(int16_t i = hashmap->at(nBucket) - 1; i >= 0; --i)
+    /*  Runs the lookups of batches until the keychain is closed. */
+    void ShardHashMap::BatchThread()
+    {
+        while(!fBatchStop.load())
         {
-            /* Find the file stream for LRU cache. */
-            std::fstream* pstream;
-            if(!fileCache->Get(std::make_pair(nShard, i), pstream))
+            std::function<void()> fnLookup;
             {
-                /* Set the new stream pointer. */
-                std::string filename = debug::safe_printstr(strBaseLocation, "_hashmap.",
-                    std::setfill('0'), std::setw(3), nShard, ".", std::setfill('0'), std::setw(5), hashmap->at(nBucket));
+                std::unique_lock<std::mutex> CONDITION_LOCK(BATCH_MUTEX);
+                BATCH_CONDITION.wait(CONDITION_LOCK, [this]{ return fBatchStop.load() || !queueLookups.empty(); });
 
-                /* Set the new stream pointer. */
-                pstream = new std::fstream(filename, std::ios::in | std::ios::out | std::ios::binary);
+                if(fBatchStop.load())
+                    return;
 
-                /* If file not found add to LRU cache. */
-                fileCache->Put(std::make_pair(nShard, i), pstream);
+                fnLookup = std::move(queueLookups.front());
+                queueLookups.pop_front();
             }
 
-            /* Seek to the hashmap index in file. */
-            pstream->seekg (nFilePos, std::ios::beg);
-
-            /* Read the bucket binary data from file stream */
-            pstream->read((char*) &vBucket[0], vBucket.size());
-
-            /* Check if this bucket has the key */
-            if(std::equal(vBucket.begin() + 13, vBucket.begin() + 13 + vKeyCompressed.size(), vKeyCompressed.begin()))
-            {
-                /* Deserialize key and return if found. */
-                DataStream ssKey(vBucket, SER_LLD, DATABASE_VERSION);
-                SectorKey cKey;
-                ssKey >> cKey;
-
-                /* Skip over keys that are already erased. */
-                if(cKey.Ready())
-                    return true;
-
-                /* Seek to the hashmap index in file. */
-                pstream->seekp (nFilePos, std::ios::beg);
-
-                /* Read the bucket binary data from file stream */
-                std::vector<uint8_t> vReady(STATE::READY);
-                pstream->write((char*) &vReady[0], vReady.size());
-                pstream->flush();
-
-                /* Debug Output of Sector Key Information. */
-                if(config::nVerbose >= 4)
-                    debug::log(4, FUNCTION, "Restored State: ", cKey.nState == STATE::READY ? "Valid" : "Invalid",
-                        " | Length: ", cKey.nLength,
-                        " | Bucket ", nBucket,
-                        " | Location: ", nFilePos,
-                        " | File: ", hashmap->at(nBucket) - 1,
-                        " | Sector File: ", cKey.nSectorFile,
-                        " | Sector Size: ", cKey.nSectorSize,
-                        " | Sector Start: ", cKey.nSectorStart,
-                        " | Key: ", HexStr(vKeyCompressed.begin(), vKeyCompressed.end()));
-
-                return true;
-            }
+            fnLookup();
         }
-
-        return false;
     }
-
-
 }
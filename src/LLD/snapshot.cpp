@@ -0,0 +1,206 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#include <LLD/templates/snapshot.h>
+
+#include <Util/include/mutex.h>
+
+namespace LLD
+{
+
+    /* Default Constructor. */
+    VersionStore::VersionStore()
+    : MUTEX       ( )
+    , nSequence   (0)
+    , setPinned   ( )
+    , mapVersions ( )
+    , nVersions   (0)
+    {
+    }
+
+
+    /* Get the last commit applied. */
+    uint64_t VersionStore::Sequence() const
+    {
+        LOCK(MUTEX);
+
+        return nSequence;
+    }
+
+
+    /* Mark a commit as applied. */
+    void VersionStore::Advance(const uint64_t nSequenceIn)
+    {
+        LOCK(MUTEX);
+
+        nSequence = nSequenceIn;
+    }
+
+
+    /* Open a view at the last commit applied. */
+    uint64_t VersionStore::Pin()
+    {
+        LOCK(MUTEX);
+
+        setPinned.insert(nSequence);
+
+        return nSequence;
+    }
+
+
+    /* Close a view, dropping the versions no open view needs. */
+    void VersionStore::Unpin(const uint64_t nPinned)
+    {
+        LOCK(MUTEX);
+
+        auto itPinned = setPinned.find(nPinned);
+        if(itPinned != setPinned.end())
+            setPinned.erase(itPinned);
+
+        /* Without views nothing is needed. */
+        if(setPinned.empty())
+        {
+            mapVersions.clear();
+            nVersions = 0;
+
+            return;
+        }
+
+        /* Views read versions after the commit they are pinned at, so versions up to the oldest view are done with. */
+        const uint64_t nOldest = *setPinned.begin();
+        for(auto it = mapVersions.begin(); it != mapVersions.end(); )
+        {
+            std::vector<Version>& vVersions = it->second;
+
+            uint32_t nDone = 0;
+            while(nDone < vVersions.size() && vVersions[nDone].nSequence <= nOldest)
+                ++nDone;
+
+            vVersions.erase(vVersions.begin(), vVersions.begin() + nDone);
+            nVersions -= nDone;
+
+            if(vVersions.empty())
+                it = mapVersions.erase(it);
+            else
+                ++it;
+        }
+    }
+
+
+    /* Get the number of open views. */
+    uint64_t VersionStore::Pinned() const
+    {
+        LOCK(MUTEX);
+
+        return setPinned.size();
+    }
+
+
+    /* Get the number of versions kept. */
+    uint64_t VersionStore::Versions() const
+    {
+        LOCK(MUTEX);
+
+        return nVersions;
+    }
+
+
+    /* Check if a key's record has to be kept before a commit changes it. */
+    bool VersionStore::Needs(const std::vector<uint8_t>& vKey) const
+    {
+        LOCK(MUTEX);
+
+        if(setPinned.empty())
+            return false;
+
+        auto it = mapVersions.find(vKey);
+        if(it == mapVersions.end())
+            return true;
+
+        return it->second.back().nSequence <= *setPinned.rbegin();
+    }
+
+
+    /* Keep the record a key held before a commit. */
+    void VersionStore::Keep(const std::vector<uint8_t>& vKey, const uint64_t nCommit, const bool fExists, const std::vector<uint8_t>& vData)
+    {
+        LOCK(MUTEX);
+
+        mapVersions[vKey].push_back(Version{ nCommit, fExists, vData });
+        ++nVersions;
+    }
+
+
+    /* Get the record a key held at a commit, if a later commit replaced it. */
+    bool VersionStore::Find(const std::vector<uint8_t>& vKey, const uint64_t nPinned, bool &fExists, std::vector<uint8_t>& vData) const
+    {
+        LOCK(MUTEX);
+
+        auto it = mapVersions.find(vKey);
+        if(it == mapVersions.end())
+            return false;
+
+        /* The first commit after the view replaced the record the view sees. */
+        for(const auto& version : it->second)
+        {
+            if(version.nSequence <= nPinned)
+                continue;
+
+            fExists = version.fExists;
+            vData   = version.vData;
+
+            return true;
+        }
+
+        return false;
+    }
+
+
+    /* Constructor. */
+    ReadView::ReadView(const std::shared_ptr<VersionStore>& pStoreIn, const uint64_t nSequenceIn)
+    : pStore    (pStoreIn)
+    , nSequence (nSequenceIn)
+    {
+    }
+
+
+    /* Move Constructor. */
+    ReadView::ReadView(ReadView&& view)
+    : pStore    (std::move(view.pStore))
+    , nSequence (view.nSequence)
+    {
+        view.pStore.reset();
+    }
+
+
+    /* Default Destructor. */
+    ReadView::~ReadView()
+    {
+        if(pStore)
+            pStore->Unpin(nSequence);
+    }
+
+
+    /* Get the commit the view is pinned at. */
+    uint64_t ReadView::Sequence() const
+    {
+        return nSequence;
+    }
+
+
+    /* Check if the view is of the database that owns a store. */
+    bool ReadView::Of(const std::shared_ptr<VersionStore>& pStoreIn) const
+    {
+        return pStore && pStore == pStoreIn;
+    }
+}
@@ -0,0 +1,276 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLD_TEMPLATES_BATCH_H
+#define NEXUS_LLD_TEMPLATES_BATCH_H
+
+#include <LLD/include/enum.h>
+#include <LLD/include/version.h>
+
+#include <Util/templates/datastream.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace LLD
+{
+
+    /** BatchEntry
+     *
+     *  The type of an entry of a write batch, and where its key and data are in the arena.
+     *
+     **/
+    struct BatchEntry
+    {
+        /** The type of the entry, from BATCH. **/
+        uint8_t nType;
+
+        /** The first byte of the key in the arena. **/
+        uint32_t nKeyBegin;
+
+        /** The bytes of the key. **/
+        uint32_t nKeySize;
+
+        /** The first byte of the record or index in the arena, 0 if none. **/
+        uint32_t nDataBegin;
+
+        /** The bytes of the record or index, 0 if none. **/
+        uint32_t nDataSize;
+    };
+
+
+    /** WriteBatch
+     *
+     *  Writes, erases and indexes across keys, applied to a database together
+     *  with SectorDatabase::Apply.
+     *
+     *  Every entry is serialized once, when it is added, into a single arena
+     *  that is already in the format of a transaction journal. Inside a
+     *  transaction the arena is appended to the journal as one piece, so the
+     *  batch commits or rolls back with the transaction. Outside of one the
+     *  entries are applied in order under one lock, with the same durability
+     *  as writing them one at a time.
+     *
+     **/
+    class WriteBatch
+    {
+        /** The serialized entries, in the format of a transaction journal. **/
+        DataStream ssArena;
+
+
+        /** The serialized key or record being added, reused between entries. **/
+        DataStream ssScratch;
+
+
+        /** The entries, in the order they were added. **/
+        std::vector<BatchEntry> vEntries;
+
+
+        /** Append
+         *
+         *  Add the scratch bytes to the arena as a byte vector.
+         *
+         *  @return The first byte of them in the arena.
+         *
+         **/
+        uint32_t Append();
+
+
+        /** Add
+         *
+         *  Add the entry for the key and data just appended.
+         *
+         *  @param[in] nType The type of the entry, from BATCH.
+         *  @param[in] nKeyBegin The first byte of the key in the arena.
+         *  @param[in] nKeySize The bytes of the key.
+         *  @param[in] nDataBegin The first byte of the record or index in the arena.
+         *  @param[in] nDataSize The bytes of the record or index.
+         *
+         **/
+        void Add(const uint8_t nType, const uint32_t nKeyBegin, const uint32_t nKeySize,
+                 const uint32_t nDataBegin = 0, const uint32_t nDataSize = 0);
+
+
+    public:
+
+        /** Default Constructor. **/
+        WriteBatch();
+
+
+        /** Write
+         *
+         *  Add a key/value pair to write.
+         *
+         *  @param[in] key The key to write.
+         *  @param[in] value The value to write.
+         *  @param[in] strType The type specifier of the record.
+         *
+         **/
+        template<typename Key, typename Type>
+        void Write(const Key& key, const Type& value, const std::string& strType = "NONE")
+        {
+            ssArena << std::string("write");
+
+            ssScratch.clear();
+            ssScratch << key;
+
+            const uint32_t nKeySize  = static_cast<uint32_t>(ssScratch.size());
+            const uint32_t nKeyBegin = Append();
+
+            ssScratch.clear();
+            ssScratch << strType << value;
+
+            const uint32_t nDataSize  = static_cast<uint32_t>(ssScratch.size());
+            const uint32_t nDataBegin = Append();
+
+            Add(BATCH::RECORD, nKeyBegin, nKeySize, nDataBegin, nDataSize);
+        }
+
+
+        /** Write
+         *
+         *  Add a key to write to the keychain, with no record.
+         *
+         *  @param[in] key The key to write.
+         *
+         **/
+        template<typename Key>
+        void Write(const Key& key)
+        {
+            ssArena << std::string("key");
+
+            ssScratch.clear();
+            ssScratch << key;
+
+            const uint32_t nKeySize  = static_cast<uint32_t>(ssScratch.size());
+            const uint32_t nKeyBegin = Append();
+
+            Add(BATCH::KEYCHAIN, nKeyBegin, nKeySize);
+        }
+
+
+        /** Erase
+         *
+         *  Add a key to erase.
+         *
+         *  @param[in] key The key to erase.
+         *
+         **/
+        template<typename Key>
+        void Erase(const Key& key)
+        {
+            ssArena << std::string("erase");
+
+            ssScratch.clear();
+            ssScratch << key;
+
+            const uint32_t nKeySize  = static_cast<uint32_t>(ssScratch.size());
+            const uint32_t nKeyBegin = Append();
+
+            Add(BATCH::ERASE, nKeyBegin, nKeySize);
+        }
+
+
+        /** Index
+         *
+         *  Add a key to point at the record of another key.
+         *
+         *  @param[in] key The key to write.
+         *  @param[in] index The key of the record to point at.
+         *
+         **/
+        template<typename Key, typename Type>
+        void Index(const Key& key, const Type& index)
+        {
+            ssArena << std::string("index");
+
+            ssScratch.clear();
+            ssScratch << key;
+
+            const uint32_t nKeySize  = static_cast<uint32_t>(ssScratch.size());
+            const uint32_t nKeyBegin = Append();
+
+            ssScratch.clear();
+            ssScratch << index;
+
+            const uint32_t nDataSize  = static_cast<uint32_t>(ssScratch.size());
+            const uint32_t nDataBegin = Append();
+
+            Add(BATCH::INDEX, nKeyBegin, nKeySize, nDataBegin, nDataSize);
+        }
+
+
+        /** Entries
+         *
+         *  Get the entries, in the order they were added.
+         *
+         **/
+        const std::vector<BatchEntry>& Entries() const;
+
+
+        /** Arena
+         *
+         *  Get the serialized entries, in the format of a transaction journal.
+         *
+         **/
+        const std::vector<uint8_t>& Arena() const;
+
+
+        /** Key
+         *
+         *  Get the key of an entry.
+         *
+         *  @param[in] entry The entry to get the key of.
+         *
+         **/
+        std::vector<uint8_t> Key(const BatchEntry& entry) const;
+
+
+        /** Data
+         *
+         *  Get the record or index of an entry.
+         *
+         *  @param[in] entry The entry to get the record or index of.
+         *
+         **/
+        std::vector<uint8_t> Data(const BatchEntry& entry) const;
+
+
+        /** Count
+         *
+         *  Get the entries in the batch.
+         *
+         **/
+        uint32_t Count() const;
+
+
+        /** Empty
+         *
+         *  Check if the batch has no entries.
+         *
+         **/
+        bool Empty() const;
+
+
+        /** Clear
+         *
+         *  Remove every entry, keeping the memory of the arena for the next batch.
+         *
+         **/
+        void Clear();
+    };
+}
+
+#endif
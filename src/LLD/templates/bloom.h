@@ -0,0 +1,133 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLD_TEMPLATES_BLOOM_H
+#define NEXUS_LLD_TEMPLATES_BLOOM_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace LLD
+{
+
+    /** BloomFilter
+     *
+     *  Probabilistic set membership filter.
+     *
+     *  Answers whether a key may be in a set, with no false negatives.
+     *  Used in front of disk structures so that keys which are absent
+     *  never cost a disk read. Insert and Has are safe to call from
+     *  multiple threads at once.
+     *
+     **/
+    class BloomFilter
+    {
+        /** The bit array of the filter. **/
+        std::vector<std::atomic<uint64_t>> vBits;
+
+
+        /** The total bits in the filter. **/
+        uint64_t nBits;
+
+
+        /** The number of hash functions per key. **/
+        uint32_t nHashes;
+
+
+    public:
+
+        /** Default Constructor. **/
+        BloomFilter() = delete;
+
+
+        /** Constructor
+         *
+         *  @param[in] nBitsIn The total bits to allocate for the filter.
+         *  @param[in] nHashesIn The number of hash functions per key.
+         *
+         **/
+        BloomFilter(const uint64_t nBitsIn, const uint32_t nHashesIn = 4);
+
+
+        /** Insert
+         *
+         *  Add a key to the filter.
+         *
+         *  @param[in] vKey The binary data of the key.
+         *
+         **/
+        void Insert(const std::vector<uint8_t>& vKey);
+
+
+        /** Insert
+         *
+         *  Add a key to the filter from a raw buffer.
+         *
+         *  @param[in] pBegin The beginning of the key data.
+         *  @param[in] nSize The size of the key data.
+         *
+         **/
+        void Insert(const uint8_t* pBegin, const uint64_t nSize);
+
+
+        /** Has
+         *
+         *  Check if a key may be in the filter.
+         *
+         *  @param[in] vKey The binary data of the key.
+         *
+         *  @return False if the key is definitely absent, true if it may be present.
+         *
+         **/
+        bool Has(const std::vector<uint8_t>& vKey) const;
+
+
+        /** Clear
+         *
+         *  Remove all keys from the filter.
+         *
+         **/
+        void Clear();
+
+
+        /** Load
+         *
+         *  Read the filter from disk.
+         *
+         *  @param[in] strPath The path of the filter file.
+         *  @param[in] nValidator The state of the data the filter must have been saved for.
+         *
+         *  @return True if the filter was loaded, false if missing, of wrong size, or saved for other data.
+         *
+         **/
+        bool Load(const std::string& strPath, const uint64_t nValidator);
+
+
+        /** Save
+         *
+         *  Write the filter to disk.
+         *
+         *  @param[in] strPath The path of the filter file.
+         *  @param[in] nValidator The state of the data the filter covers, checked on load.
+         *
+         *  @return True if the filter was written.
+         *
+         **/
+        bool Save(const std::string& strPath, const uint64_t nValidator) const;
+    };
+}
+
+#endif
@@ -0,0 +1,244 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLD_TEMPLATES_BULK_H
+#define NEXUS_LLD_TEMPLATES_BULK_H
+
+#include <Util/templates/datastream.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace LLD
+{
+
+    /* The bytes of records gathered into each block of a bulk file. */
+    const uint32_t BULK_BLOCK_SIZE = 1024 * 1024 * 4; //4 MB Blocks
+
+
+    /** BulkRecord
+     *
+     *  A record of a bulk file, with its key as the keychain stored it.
+     *
+     **/
+    struct BulkRecord
+    {
+        /** The keychain bucket the key was read from. **/
+        uint32_t nBucket;
+
+        /** The length of the key before the keychain compressed it. **/
+        uint16_t nLength;
+
+        /** The key as the keychain stored it. **/
+        std::vector<uint8_t> vKey;
+
+        /** True if the key has no record in the sector files. **/
+        bool fKeychain;
+
+        /** The record, as it reads from the database. **/
+        std::vector<uint8_t> vData;
+    };
+
+
+    /** BulkWriter
+     *
+     *  Writes a bulk file. The file is a header, blocks of records in the order
+     *  they are added, and a trailer with the totals. Each of them is framed by
+     *  its size and a checksum, so a reader can tell a damaged or cut short file
+     *  before it loads any of it.
+     *
+     **/
+    class BulkWriter
+    {
+        /** The file being written. **/
+        std::ofstream stream;
+
+
+        /** The records of the block being gathered. **/
+        DataStream ssBlock;
+
+
+        /** The records in the block being gathered. **/
+        uint32_t nBlockRecords;
+
+
+        /** The records written. **/
+        uint64_t nRecords;
+
+
+        /** The blocks written. **/
+        uint64_t nBlocks;
+
+
+        /** WriteFrame
+         *
+         *  Write a header, block or trailer with its size and checksum.
+         *
+         *  @param[in] vPayload The bytes to frame.
+         *
+         *  @return True if the frame was written.
+         *
+         **/
+        bool WriteFrame(const std::vector<uint8_t>& vPayload);
+
+
+        /** WriteBlock
+         *
+         *  Write the records gathered so far as a block.
+         *
+         **/
+        bool WriteBlock();
+
+
+    public:
+
+        /** Default Constructor. **/
+        BulkWriter() = delete;
+
+
+        /** Constructor
+         *
+         *  @param[in] strPath The file to write, replaced if it exists.
+         *
+         **/
+        BulkWriter(const std::string& strPath);
+
+
+        /** Header
+         *
+         *  Write the header, with the shape of the keychain the keys are read from.
+         *
+         *  @param[in] strKeychain The type of the keychain.
+         *  @param[in] nBuckets The buckets of the keychain.
+         *
+         *  @return True if the header was written.
+         *
+         **/
+        bool Header(const std::string& strKeychain, const uint32_t nBuckets);
+
+
+        /** Add
+         *
+         *  Add a record, writing a block once enough are gathered.
+         *
+         *  @param[in] record The record to add.
+         *
+         *  @return True if the record was added.
+         *
+         **/
+        bool Add(const BulkRecord& record);
+
+
+        /** Close
+         *
+         *  Write the last block and the trailer, and close the file.
+         *
+         *  @return True if the file is complete on disk.
+         *
+         **/
+        bool Close();
+
+
+        /** Records
+         *
+         *  Get the records written.
+         *
+         **/
+        uint64_t Records() const;
+    };
+
+
+    /** BulkReader
+     *
+     *  Reads a bulk file back a block at a time, checking every frame.
+     *
+     **/
+    class BulkReader
+    {
+        /** The file being read. **/
+        std::ifstream stream;
+
+
+        /** The records read. **/
+        uint64_t nRecords;
+
+
+        /** The blocks read. **/
+        uint64_t nBlocks;
+
+
+        /** ReadFrame
+         *
+         *  Read a header, block or trailer and check its checksum.
+         *
+         *  @param[out] vPayload The bytes framed.
+         *
+         *  @return True if a whole frame was read and its checksum matches.
+         *
+         **/
+        bool ReadFrame(std::vector<uint8_t>& vPayload);
+
+
+    public:
+
+        /** Default Constructor. **/
+        BulkReader() = delete;
+
+
+        /** Constructor
+         *
+         *  @param[in] strPath The file to read.
+         *
+         **/
+        BulkReader(const std::string& strPath);
+
+
+        /** Header
+         *
+         *  Read the header.
+         *
+         *  @param[out] strKeychain The type of the keychain the keys were read from.
+         *  @param[out] nBuckets The buckets of the keychain.
+         *
+         *  @return True if the file is a bulk file of this version.
+         *
+         **/
+        bool Header(std::string& strKeychain, uint32_t& nBuckets);
+
+
+        /** Next
+         *
+         *  Read the next block of records.
+         *
+         *  @param[out] vRecords The records of the block, empty at the trailer.
+         *  @param[out] fEnd True once the trailer is read and matches the blocks before it.
+         *
+         *  @return True if a block or the trailer was read.
+         *
+         **/
+        bool Next(std::vector<BulkRecord>& vRecords, bool &fEnd);
+
+
+        /** Records
+         *
+         *  Get the records read.
+         *
+         **/
+        uint64_t Records() const;
+    };
+}
+
+#endif
@@ -0,0 +1,124 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLD_TEMPLATES_JOURNAL_H
+#define NEXUS_LLD_TEMPLATES_JOURNAL_H
+
+#include <LLD/include/metrics.h>
+
+#include <Util/templates/datastream.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace LLD
+{
+
+    /** Journal
+     *
+     *  Append only write-ahead log shared by the databases that commit together.
+     *
+     *  Each database adds its transaction journal to the current group, and the
+     *  whole group is written with a single commit marker and a single sync to
+     *  disk. A group is only replayed on recovery if its commit marker and
+     *  checksum are intact, so the databases in a group commit all or nothing.
+     *
+     **/
+    class Journal
+    {
+        /** Mutex for Thread Synchronization. **/
+        std::mutex MUTEX;
+
+
+        /** The path of the log file. **/
+        std::string strPath;
+
+
+        /** The group of database journals waiting to be committed. **/
+        DataStream ssGroup;
+
+
+        /** The syncs of the log to disk. **/
+        std::atomic<uint64_t> nSyncs;
+
+
+        /** The metrics of the log, listed as the journal database. **/
+        Metrics metrics;
+
+
+        /** The time taken by each sync, in nanoseconds. **/
+        Histogram* pSyncLatency;
+
+
+    public:
+
+        /** Default Constructor. **/
+        Journal() = delete;
+
+
+        /** Constructor
+         *
+         *  @param[in] strPathIn The path of the log file.
+         *
+         **/
+        Journal(const std::string& strPathIn);
+
+
+        /** Append
+         *
+         *  Add a database's transaction journal to the current group.
+         *
+         *  @param[in] strName The name of the database.
+         *  @param[in] vJournal The binary data of the database's journal.
+         *
+         **/
+        void Append(const std::string& strName, const std::vector<uint8_t>& vJournal);
+
+
+        /** Commit
+         *
+         *  Write the current group to the log with its commit marker, and sync it to disk.
+         *
+         *  @return True if the group was written and synced.
+         *
+         **/
+        bool Commit();
+
+
+        /** Recover
+         *
+         *  Read the committed group from the log, if there is one.
+         *
+         *  @param[out] mapJournals The database journals of the group, by database name.
+         *
+         *  @return True if a complete group was found.
+         *
+         **/
+        bool Recover(std::map<std::string, std::vector<uint8_t>>& mapJournals);
+
+
+        /** Clear
+         *
+         *  Empty the log once its group has been applied to the databases.
+         *
+         **/
+        void Clear();
+    };
+}
+
+#endif
@@ -0,0 +1,119 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLD_TEMPLATES_MMAP_H
+#define NEXUS_LLD_TEMPLATES_MMAP_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace LLD
+{
+
+    /** MemoryMap
+     *
+     *  Read-only memory mapping of a sector file.
+     *
+     *  The mapping covers the size of the file at the time it was opened. Once
+     *  opened the object is immutable, so any number of threads can read from it
+     *  without locking. When the file grows a new MemoryMap is created to replace
+     *  it, and the old mapping is released once its last reader lets go of it.
+     *
+     **/
+    class MemoryMap
+    {
+        /** The path of the mapped file. **/
+        std::string strPath;
+
+
+        /** The beginning of the mapped region. **/
+        uint8_t* pBegin;
+
+
+        /** The total bytes mapped. **/
+        uint64_t nSize;
+
+
+    public:
+
+        /** Default Constructor. **/
+        MemoryMap() = delete;
+
+
+        /** Copy Constructor. **/
+        MemoryMap(const MemoryMap& map) = delete;
+
+
+        /** Copy Assignment Operator. **/
+        MemoryMap& operator=(const MemoryMap& map) = delete;
+
+
+        /** Constructor
+         *
+         *  Maps the given file into memory.
+         *
+         *  @param[in] strPathIn The path of the file to map.
+         *
+         **/
+        MemoryMap(const std::string& strPathIn);
+
+
+        /** Default Destructor **/
+        ~MemoryMap();
+
+
+        /** IsNull
+         *
+         *  Determines if the file failed to map.
+         *
+         **/
+        bool IsNull() const;
+
+
+        /** Size
+         *
+         *  Returns the total bytes that are mapped.
+         *
+         **/
+        uint64_t Size() const;
+
+
+        /** Read
+         *
+         *  Copy a range of the mapped file into a buffer.
+         *
+         *  @param[in] nStart The binary position to read from.
+         *  @param[out] vData The buffer to read into, sized to the bytes wanted.
+         *
+         *  @return True if the range is within the mapping, false otherwise.
+         *
+         **/
+        bool Read(const uint64_t nStart, std::vector<uint8_t>& vData) const;
+
+
+        /** Data
+         *
+         *  Get a pointer into the mapping, valid for as long as this object lives.
+         *
+         *  @param[in] nStart The binary position to point to.
+         *
+         *  @return The mapped bytes at the position, nullptr if outside the mapping.
+         *
+         **/
+        const uint8_t* Data(const uint64_t nStart) const;
+    };
+}
+
+#endif
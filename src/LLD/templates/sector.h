@@ -16,20 +16,32 @@ ________________________________________________________________________________
 #define NEXUS_LLD_TEMPLATES_SECTOR_H
 
 
+#include <LLD/include/budget.h>
 #include <LLD/include/enum.h>
+#include <LLD/include/metrics.h>
 #include <LLD/include/version.h>
+#include <LLD/templates/batch.h>
+#include <LLD/templates/journal.h>
 #include <LLD/templates/key.h>
+#include <LLD/templates/mmap.h>
+#include <LLD/templates/snapshot.h>
 #include <LLD/templates/transaction.h>
 
 #include <LLD/cache/template_lru.h>
 
 #include <Util/templates/datastream.h>
+#include <Util/templates/mpscqueue.h>
+#include <Util/templates/viewstream.h>
 #include <Util/include/runtime.h>
 #include <Util/include/debug.h>
 
 #include <string>
+#include <limits>
 #include <cstdint>
 #include <atomic>
+#include <map>
+#include <set>
+#include <memory>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -47,7 +59,66 @@ namespace LLD
 
 
     /* The maximum amount of bytes allowed in the memory buffer for disk flushes. **/
-    const uint32_t MAX_SECTOR_BUFFER_SIZE = 1024 * 1024 * 4; //32 MB Max Disk Buffer
+    const uint32_t MAX_SECTOR_BUFFER_SIZE = 1024 * 1024 * 4; //4 MB Max Disk Buffer
+
+
+    /* The default threads writing the keys of a flushed batch to the keychain. */
+    const uint32_t DEFAULT_KEYCHAIN_WRITERS = 2;
+
+
+    /* The largest gap between two records that a batch read will merge into one disk read. */
+    const uint32_t MAX_BATCH_READ_GAP = 1024 * 16; //16 KB Max Gap
+
+
+    /* The largest disk read that a batch read will merge records into. */
+    const uint32_t MAX_BATCH_READ_SIZE = 1024 * 1024; //1 MB Max Read
+
+
+    /* The least share of a sector file that has to be dead records before compaction rewrites it. */
+    const uint32_t MIN_COMPACT_DEAD_PERCENT = 50; //50% Dead
+
+
+    /* The default rate compaction rewrites records at, in bytes per second. */
+    const uint32_t DEFAULT_COMPACT_RATE = 1024 * 1024 * 8; //8 MB/s
+
+
+    /* The bytes of the checksum that ends each record of a checksummed database. */
+    const uint32_t RECORD_CHECKSUM_SIZE = 8;
+
+
+    /* The default rate the scrubber verifies sector files at, in bytes per second. */
+    const uint32_t DEFAULT_SCRUB_RATE = 1024 * 1024 * 4; //4 MB/s
+
+
+    /* The flags that change how records are written to the sector files, recorded when a database is created. */
+    const uint8_t ENCODING_FLAGS = FLAGS::COMPRESS | FLAGS::CHECKSUM;
+
+
+    /** WriterStats
+     *
+     *  Counters of the buffered write path, for watching backpressure.
+     *
+     **/
+    struct WriterStats
+    {
+        /** The bytes put and not yet written to the keychain. **/
+        uint32_t nBufferBytes;
+
+        /** The most bytes the buffer has held. **/
+        uint32_t nBufferPeak;
+
+        /** The puts that had to wait for the buffer to drain. **/
+        uint64_t nStalls;
+
+        /** The total time puts waited for the buffer to drain. **/
+        uint64_t nStallMicroseconds;
+
+        /** The batches written by the cache writer. **/
+        uint64_t nBatches;
+
+        /** The puts dropped because a later put of the same key was in the same batch. **/
+        uint64_t nCoalesced;
+    };
 
 
     /** SectorDatabase
@@ -92,8 +163,8 @@ namespace LLD
             TODO: Lock Mutex based on Read / Writes on a per Sector Basis.
             Will allow higher efficiency for thread concurrency. */
         std::mutex SECTOR_MUTEX;
-        std::mutex BUFFER_MUTEX;
         std::mutex TRANSACTION_MUTEX;
+        std::mutex MAP_MUTEX;
 
 
         /* The String to hold the Disk Location of Database File. */
@@ -109,6 +180,10 @@ namespace LLD
         SectorTransaction* pTransaction;
 
 
+        /* The records replaced by commits, kept for the open read views. */
+        std::shared_ptr<VersionStore> pVersions;
+
+
         /* Sector Keys Database. */
         KeychainType* pSectorKeys;
 
@@ -117,10 +192,30 @@ namespace LLD
         CacheType* cachePool;
 
 
+        /* The budget the cache pool shares with other databases, nullptr if it keeps its own size. */
+        CacheBudget* pBudget;
+
+
+        /* The identifier of the cache pool in the budget. */
+        uint32_t nBudgetPool;
+
+
         /* File stream object. */
         mutable TemplateLRU<uint32_t, std::fstream*>* fileCache;
 
 
+        /* Memory mapped sector files for lock-free reads in MAPPED mode. */
+        std::map<uint32_t, std::shared_ptr<MemoryMap>> mapMemory;
+
+
+        /* The flush generation each sector file was last mapped at, guarded by MAP_MUTEX. */
+        std::map<uint32_t, uint64_t> mapMappedAt;
+
+
+        /* Sector files retired by compaction that are no longer mapped, guarded by MAP_MUTEX. */
+        std::set<uint32_t> setUnmapped;
+
+
         /* The current File Position. */
         mutable uint32_t nCurrentFile;
         mutable uint32_t nCurrentFileSize;
@@ -134,17 +229,61 @@ namespace LLD
         std::thread MeterThread;
 
 
-        /* Disk Buffer Vector. */
-        std::vector< std::pair< std::vector<uint8_t>, std::vector<uint8_t> > > vDiskBuffer;
+        /* The compactor thread. */
+        std::thread CompactorThread;
+
+
+        /* The scrubber thread. */
+        std::thread ScrubberThread;
 
 
-        /* Disk Buffer Memory Size. */
+        /* Sector files emptied by the last compaction, truncated on the next one once readers have moved on. */
+        std::vector<uint32_t> vRetired;
+
+
+        /* Disk Buffer Queue, pushed to by any thread and drained by the cache writer. */
+        MPSCQueue< std::pair< std::vector<uint8_t>, std::vector<uint8_t> > > queueDisk;
+
+
+        /* Disk Buffer Memory Size, counted until the keys of a record are written. */
         std::atomic<uint32_t> nBufferBytes;
 
-        /* For the Meter. */
-        std::atomic<uint32_t> nBytesRead;
-        std::atomic<uint32_t> nBytesWrote;
-        std::atomic<uint32_t> nRecordsFlushed;
+
+        /* The most bytes held in the buffer before puts wait. */
+        uint32_t nMaxBufferBytes;
+
+
+        /* Puts waiting on the buffer, and whether the cache writer is waiting on puts. */
+        std::atomic<uint32_t> nBufferWaiting;
+        std::atomic<bool> fWriterWaiting;
+
+
+        /* Backpressure counters. */
+        std::atomic<uint32_t> nBufferPeak;
+        std::atomic<uint64_t> nBufferStalls;
+        std::atomic<uint64_t> nStallMicroseconds;
+        std::atomic<uint64_t> nBatchesFlushed;
+        std::atomic<uint64_t> nRecordsCoalesced;
+
+        /* Running totals, read by the metrics and the meter. */
+        std::atomic<uint64_t> nBytesRead;
+        std::atomic<uint64_t> nBytesWrote;
+        std::atomic<uint64_t> nRecordsFlushed;
+        std::atomic<uint64_t> nCacheHits;
+        std::atomic<uint64_t> nCacheMisses;
+        std::atomic<uint64_t> nFlushes;
+        std::atomic<uint64_t> nBytesScrubbed;
+        std::atomic<uint64_t> nRecordsDamaged;
+
+
+        /* The metrics of this database, declared after the totals it reads so it is destroyed first. */
+        Metrics metrics;
+
+
+        /* Latency histograms, owned by the metrics. */
+        Histogram* pGetLatency;
+        Histogram* pPutLatency;
+        Histogram* pCommitLatency;
 
         /* Destructor Flag. */
         std::atomic<bool> fDestruct;
@@ -172,12 +311,77 @@ namespace LLD
 
         /** Initialize
          *
-         *  Initialize Sector Database.
+         *  Initialize Sector Database. New databases checksum their records with
+         *  -lldchecksum, and existing ones keep the checksums they were created
+         *  with. Throws if the sector files were written with other encoding
+         *  flags than the database is opened with.
          *
          **/
         void Initialize();
 
 
+        /** GetWriterStats
+         *
+         *  Get the counters of the buffered write path.
+         *
+         **/
+        WriterStats GetWriterStats() const;
+
+
+        /** GetMetrics
+         *
+         *  Get the metrics registry of this database.
+         *
+         **/
+        const Metrics& GetMetrics() const;
+
+
+        /** Snapshot
+         *
+         *  Open a read view of the transactions committed so far. A commit
+         *  being applied is waited out, so the view never sees half of one.
+         *
+         *  @return The view, closed when it is destroyed.
+         *
+         **/
+        ReadView Snapshot();
+
+
+        /** Exists
+         *
+         *  Determine if the entry identified by the given key existed when a read view was opened.
+         *
+         *  @param[in] view The read view of this database.
+         *  @param[in] key The key to the database entry.
+         *
+         *  @return True if the entry existed, false otherwise.
+         *
+         **/
+        template<typename Key>
+        bool Exists(const ReadView& view, const Key& key)
+        {
+            if(!view.Of(pVersions))
+                return debug::error(FUNCTION, "read view is of another database");
+
+            /* Serialize Key into Bytes. */
+            DataStream ssKey(SER_LLD, DATABASE_VERSION);
+            ssKey << key;
+
+            /* Get reference of key. */
+            const std::vector<uint8_t>& vKey = ssKey.Bytes();
+
+            /* Check the current record first, a commit keeps the record it replaces before changing it. */
+            SectorKey cKey;
+            bool fExists = cachePool->Has(vKey) || pSectorKeys->Get(vKey, cKey);
+
+            /* Use the record the key held when the view was opened if it changed since. */
+            std::vector<uint8_t> vData;
+            pVersions->Find(vKey, view.Sequence(), fExists, vData);
+
+            return fExists;
+        }
+
+
         /** Exists
          *
          *  Determine if the entry identified by the given key exists.
@@ -395,6 +599,43 @@ namespace LLD
                             if(nSize == 0) //reached end of current file
                                 break;
 
+                            /* Compressed and checksummed records are decoded before they are read. */
+                            if(nFlags & (FLAGS::COMPRESS | FLAGS::CHECKSUM))
+                            {
+                                std::vector<uint8_t> vRecord(nSize);
+                                ssData.read((char*)&vRecord[0], nSize);
+
+                                /* Iterate to next position. */
+                                nStart += nSize + GetSizeOfCompactSize(nSize);
+
+                                /* Skip damaged records. */
+                                if(!Decode(vRecord))
+                                    continue;
+
+                                /* Deserialize the String. */
+                                DataStream ssRecord(vRecord, SER_LLD, DATABASE_VERSION);
+
+                                std::string strThis;
+                                ssRecord >> strThis;
+
+                                /* Check the type. */
+                                if(strType == strThis)
+                                {
+                                    /* Get the value. */
+                                    Type value;
+                                    ssRecord >> value;
+
+                                    /* Push next value. */
+                                    vValues.push_back(value);
+
+                                    /* Check limits. */
+                                    if(nLimit != -1 && --nLimit == 0)
+                                        return (vValues.size() > 0);
+                                }
+
+                                continue;
+                            }
+
                             /* Deserialize the String. */
                             std::string strThis;
                             ssData >> strThis;
@@ -440,6 +681,111 @@ namespace LLD
         }
 
 
+        /** RangeRead
+         *
+         *  Sequential read of the entries with keys from begin up to but not including end,
+         *  in the order of their serialized keys. Needs an ordered keychain, and doesn't
+         *  see writes still pending in a transaction.
+         *
+         *  @param[in] begin The key to start reading from.
+         *  @param[in] end The key to stop reading before.
+         *  @param[out] vValues The database entry values read out.
+         *  @param[in] nLimit The total records to read, -1 for all.
+         *
+         *  @return True if any entries were read, false otherwise.
+         *
+         **/
+        template<typename Key, typename Type>
+        bool RangeRead(const Key& begin, const Key& end, std::vector<Type>& vValues, int32_t nLimit = 1000)
+        {
+            /* Serialize the keys into bytes. */
+            DataStream ssBegin(SER_LLD, DATABASE_VERSION);
+            ssBegin << begin;
+
+            DataStream ssEnd(SER_LLD, DATABASE_VERSION);
+            ssEnd << end;
+
+            return GetRange(ssBegin.Bytes(), ssEnd.Bytes(), vValues, nLimit);
+        }
+
+
+        /** PrefixRead
+         *
+         *  Sequential read of the entries whose serialized keys begin with the serialized
+         *  prefix, such as every entry keyed by a pair beginning with an address. Needs an
+         *  ordered keychain, and doesn't see writes still pending in a transaction.
+         *
+         *  @param[in] prefix The leading part of the keys to read.
+         *  @param[out] vValues The database entry values read out.
+         *  @param[in] nLimit The total records to read, -1 for all.
+         *
+         *  @return True if any entries were read, false otherwise.
+         *
+         **/
+        template<typename Prefix, typename Type>
+        bool PrefixRead(const Prefix& prefix, std::vector<Type>& vValues, int32_t nLimit = 1000)
+        {
+            /* Serialize the prefix into bytes. */
+            DataStream ssPrefix(SER_LLD, DATABASE_VERSION);
+            ssPrefix << prefix;
+
+            /* The end of the range is the least key greater than every key with the prefix, empty if there is none. */
+            std::vector<uint8_t> vEnd = ssPrefix.Bytes();
+            while(!vEnd.empty() && vEnd.back() == 0xff)
+                vEnd.pop_back();
+
+            if(!vEnd.empty())
+                ++vEnd.back();
+
+            return GetRange(ssPrefix.Bytes(), vEnd, vValues, nLimit);
+        }
+
+
+        /** GetRange
+         *
+         *  Sequential read of the entries with binary keys from vBegin up to but not including vEnd.
+         *
+         *  @param[in] vBegin The binary key to start reading from.
+         *  @param[in] vEnd The binary key to stop reading before, empty to read to the end.
+         *  @param[out] vValues The database entry values read out.
+         *  @param[in] nLimit The total records to read, -1 for all.
+         *
+         *  @return True if any entries were read, false otherwise.
+         *
+         **/
+        template<typename Type>
+        bool GetRange(const std::vector<uint8_t>& vBegin, const std::vector<uint8_t>& vEnd,
+            std::vector<Type>& vValues, int32_t nLimit = 1000)
+        {
+            /* Clear any remaining data. */
+            vValues.clear();
+
+            /* Get the records in key order. */
+            std::vector< std::vector<uint8_t> > vData;
+            if(RangeGet(vBegin, vEnd, vData, (nLimit == -1) ? std::numeric_limits<uint32_t>::max() : nLimit) == 0)
+                return false;
+
+            /* Deserialize the records. */
+            for(const auto& vRecord : vData)
+            {
+                ViewStream ssValue(SER_LLD, DATABASE_VERSION);
+                ssValue.SetView(nullptr, vRecord.data(), vRecord.size());
+
+                /* Deserialize the String. */
+                std::string strType;
+                ssValue >> strType;
+
+                /* Deseriazlie the Value. */
+                Type value;
+                ssValue >> value;
+
+                vValues.push_back(value);
+            }
+
+            return (vValues.size() > 0);
+        }
+
+
         /** Read
          *
          *  Read a database entry identified by the given key.
@@ -453,13 +799,11 @@ namespace LLD
         template<typename Key, typename Type>
         bool Read(const Key& key, Type& value)
         {
-            /* Serialize Key into Bytes. */
-            DataStream ssKey(SER_LLD, DATABASE_VERSION);
+            /* Serialize Key into a per-thread buffer, reused so hot reads don't allocate. */
+            static thread_local DataStream ssKey(SER_LLD, DATABASE_VERSION);
+            ssKey.SetNull();
             ssKey << key;
 
-            /* Get the Data from Sector Database. */
-            std::vector<uint8_t> vData;
-
             /* Get reference of key. */
             std::vector<uint8_t>& vKey = ssKey.Bytes();
 
@@ -473,17 +817,17 @@ namespace LLD
                         return false;
 
                     /* Check for indexes. */
-                    if(pTransaction->mapIndex.count(vKey))
-                        vKey = pTransaction->mapIndex[vKey];
+                    auto itIndex = pTransaction->mapIndex.find(vKey);
+                    if(itIndex != pTransaction->mapIndex.end())
+                        vKey = itIndex->second;
 
                     /* Check if the new data is set in a transaction to ensure that the database knows what is in volatile memory. */
-                    if(pTransaction->mapTransactions.count(vKey))
+                    auto itData = pTransaction->mapTransactions.find(vKey);
+                    if(itData != pTransaction->mapTransactions.end())
                     {
-                        /* Get the data from the transction object. */
-                        vData = pTransaction->mapTransactions[vKey];
-
-                        /* Deserialize Value. */
-                        DataStream ssValue(vData, SER_LLD, DATABASE_VERSION);
+                        /* View the data in the transaction object, it can't change while the lock is held. */
+                        ViewStream ssValue(SER_LLD, DATABASE_VERSION);
+                        ssValue.SetView(nullptr, itData->second.data(), itData->second.size());
 
                         /* Deserialize the String. */
                         std::string strType;
@@ -497,8 +841,54 @@ namespace LLD
                 }
             }
 
-            /* Get the data from the database. */
-            if(!Get(vKey, vData))
+            /* Get the Data from Sector Database, viewed in place where possible. */
+            ViewStream ssValue(SER_LLD, DATABASE_VERSION);
+            if(!Get(vKey, ssValue))
+                return false;
+
+            /* Deserialize the String. */
+            std::string strType;
+            ssValue >> strType;
+
+            /* Deseriazlie the Value. */
+            ssValue >> value;
+
+            return true;
+        }
+
+
+        /** Read
+         *
+         *  Read a database entry as it was when a read view was opened. Pending
+         *  and later transactions are not seen, and no transaction lock is held.
+         *
+         *  @param[in] view The read view of this database.
+         *  @param[in] key The key to the database entry to read.
+         *  @param[out] value The database entry value to read out.
+         *
+         *  @return True if the entry read, false otherwise.
+         *
+         **/
+        template<typename Key, typename Type>
+        bool Read(const ReadView& view, const Key& key, Type& value)
+        {
+            if(!view.Of(pVersions))
+                return debug::error(FUNCTION, "read view is of another database");
+
+            /* Serialize the Key. */
+            DataStream ssKey(SER_LLD, DATABASE_VERSION);
+            ssKey << key;
+
+            /* Get reference of key. */
+            const std::vector<uint8_t>& vKey = ssKey.Bytes();
+
+            /* Read the current record first, a commit keeps the record it replaces before changing it. */
+            std::vector<uint8_t> vData;
+            bool fExists = Get(vKey, vData);
+
+            /* Use the record the key held when the view was opened if it changed since. */
+            pVersions->Find(vKey, view.Sequence(), fExists, vData);
+            if(!fExists)
                 return false;
 
             /* Deserialize Value. */
@@ -515,6 +905,100 @@ namespace LLD
         }
 
 
+        /** MultiRead
+         *
+         *  Read many database entries in one pass. Entries not in the cache are
+         *  read from disk in file and position order, so that records close to
+         *  each other on disk are read together.
+         *
+         *  @param[in] vKeys The keys to the database entries to read.
+         *  @param[out] mapValues The database entry values read out, by key.
+         *
+         *  @return True if every entry was read, false otherwise.
+         *
+         **/
+        template<typename Key, typename Type>
+        bool MultiRead(const std::vector<Key>& vKeys, std::map<Key, Type>& mapValues)
+        {
+            /* The keys that need to be read from the database. */
+            std::vector< std::vector<uint8_t> > vBatch;
+            std::vector<uint32_t> vIndexes;
+
+            /* Check each key against the transaction first. */
+            uint32_t nFound = 0;
+            for(uint32_t n = 0; n < vKeys.size(); ++n)
+            {
+                /* Serialize Key into Bytes. */
+                DataStream ssKey(SER_LLD, DATABASE_VERSION);
+                ssKey << vKeys[n];
+
+                /* Get reference of key. */
+                std::vector<uint8_t>& vKey = ssKey.Bytes();
+
+                /* Check that the key is not pending in a transaction for Erase. */
+                {
+                    LOCK(TRANSACTION_MUTEX);
+                    if(pTransaction)
+                    {
+                        /* Check if in erase queue. */
+                        if(pTransaction->setErasedData.count(vKey))
+                            continue;
+
+                        /* Check for indexes. */
+                        if(pTransaction->mapIndex.count(vKey))
+                            vKey = pTransaction->mapIndex[vKey];
+
+                        /* Check if the new data is set in a transaction to ensure that the database knows what is in volatile memory. */
+                        if(pTransaction->mapTransactions.count(vKey))
+                        {
+                            /* Deserialize Value. */
+                            DataStream ssValue(pTransaction->mapTransactions[vKey], SER_LLD, DATABASE_VERSION);
+
+                            /* Deserialize the String. */
+                            std::string strType;
+                            ssValue >> strType;
+
+                            /* Deseriazlie the Value. */
+                            ssValue >> mapValues[vKeys[n]];
+                            ++nFound;
+
+                            continue;
+                        }
+                    }
+                }
+
+                /* Add the key to the batch. */
+                vBatch.push_back(vKey);
+                vIndexes.push_back(n);
+            }
+
+            /* Get the data from the database. */
+            std::vector< std::vector<uint8_t> > vData;
+            BatchGet(vBatch, vData);
+
+            /* Deserialize the values that were found. */
+            for(uint32_t n = 0; n < vBatch.size(); ++n)
+            {
+                /* Skip over records that weren't found. */
+                if(vData[n].empty())
+                    continue;
+
+                /* Deserialize Value. */
+                DataStream ssValue(vData[n], SER_LLD, DATABASE_VERSION);
+
+                /* Deserialize the String. */
+                std::string strType;
+                ssValue >> strType;
+
+                /* Deseriazlie the Value. */
+                ssValue >> mapValues[vKeys[vIndexes[n]]];
+                ++nFound;
+            }
+
+            return nFound == vKeys.size();
+        }
+
+
         /** Index
          *
          *  Indexes a key into memory.
@@ -672,6 +1156,20 @@ namespace LLD
         }
 
 
+        /** Apply
+         *
+         *  Apply the writes, erases and indexes of a batch under a single lock.
+         *  Inside a transaction the batch is appended to its journal in one
+         *  piece, so it commits or rolls back with the rest of it.
+         *
+         *  @param[in] batch The batch to apply.
+         *
+         *  @return True if every entry was applied, false otherwise.
+         *
+         **/
+        bool Apply(const WriteBatch& batch);
+
+
         /** Get
          *
          *  Get a record from cache or from disk
@@ -699,17 +1197,121 @@ namespace LLD
         bool Get(const SectorKey& cKey, std::vector<uint8_t>& vData);
 
 
+        /** Get
+         *
+         *  Get a record from cache or from disk as a view of the cached or
+         *  memory mapped buffer, so that it can be deserialized without copying.
+         *
+         *  @param[in] vKey The binary data of the key to get.
+         *  @param[out] ssData The stream viewing the binary data of the record.
+         *
+         *  @return True if the record was read successfully.
+         *
+         **/
+        bool Get(const std::vector<uint8_t>& vKey, ViewStream& ssData);
+
+
+        /** BatchGet
+         *
+         *  Get many records from cache or from disk. Records that miss the cache
+         *  are sorted by file and position, and records close together on disk
+         *  are read with a single seek and read.
+         *
+         *  @param[in] vKeys The binary data of the keys to get.
+         *  @param[out] vData The binary data of the records, in the order of the keys.
+         *                    Records that weren't found are left empty.
+         *
+         *  @return The total records that were found.
+         *
+         **/
+        uint32_t BatchGet(const std::vector< std::vector<uint8_t> >& vKeys, std::vector< std::vector<uint8_t> >& vData);
+
+
+        /** RangeGet
+         *
+         *  Get the records with binary keys from vBegin up to but not including vEnd, in
+         *  key order. Keychains that aren't ordered have no ranges, and get nothing.
+         *
+         *  @param[in] vBegin The binary key to start reading from.
+         *  @param[in] vEnd The binary key to stop reading before, empty to read to the end.
+         *  @param[out] vData The binary data of the records read.
+         *  @param[in] nLimit The most keys to read.
+         *
+         *  @return The total records read.
+         *
+         **/
+        uint32_t RangeGet(const std::vector<uint8_t>& vBegin, const std::vector<uint8_t>& vEnd,
+                          std::vector< std::vector<uint8_t> >& vData, const uint32_t nLimit);
+
+
+        /** ReadMapped
+         *
+         *  Read a record through the memory mapped sector file, without
+         *  holding the sector lock. The file is remapped if it has grown
+         *  past the current mapping.
+         *
+         *  @param[in] cKey The sector key from keychain.
+         *  @param[out] vData The binary data of the record to get.
+         *
+         *  @return True if the record was read successfully.
+         *
+         **/
+        bool ReadMapped(const SectorKey& cKey, std::vector<uint8_t>& vData);
+
+
+        /** GetMapped
+         *
+         *  Get the current memory mapping of a record's sector file. The file
+         *  is remapped if it has grown past the current mapping, at most once
+         *  for each flush of the sector files.
+         *
+         *  @param[in] cKey The sector key from keychain.
+         *
+         *  @return The mapping covering the record, or nullptr if it can't be mapped.
+         *
+         **/
+        std::shared_ptr<MemoryMap> GetMapped(const SectorKey& cKey);
+
+
+        /** Encode
+         *
+         *  Get the bytes of a record as written to disk, compressed if the
+         *  database is compressed and ending in its checksum if checksummed.
+         *
+         *  @param[in] vData The record.
+         *  @param[out] vDisk The record as written to disk.
+         *
+         **/
+        void Encode(const std::vector<uint8_t>& vData, std::vector<uint8_t>& vDisk) const;
+
+
+        /** Decode
+         *
+         *  Check the checksum of a record read from disk and decompress it, as
+         *  the database is set up for. Records served from the cache were
+         *  checked when they were read, so only disk reads pass through here.
+         *
+         *  @param[in,out] vData The record as read from disk, replaced by the record.
+         *
+         *  @return True unless the record is damaged.
+         *
+         **/
+        bool Decode(std::vector<uint8_t>& vData);
+
+
         /** Update
          *
-         *  Update a record on disk.
+         *  Update a record on disk. Records of a mapped database are never
+         *  rewritten in place, so this fails and the caller appends it.
          *
          *  @param[in] vKey The binary data of the key to flush
          *  @param[in] vData The binary data of the record to flush
+         *  @param[in] fFlush Flag to flush the stream, false when the caller flushes after a batch.
          *
          *  @return True if the flush was successful.
          *
          **/
-        bool Update(const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData);
+        bool Update(const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData, const bool fFlush = true);
 
 
         /** Force
@@ -718,11 +1320,48 @@ namespace LLD
          *
          *  @param[in] vKey The binary data of the key to flush
          *  @param[in] vData The binary data of the record to flush
+         *  @param[in] fFlush Flag to flush the stream, false when the caller flushes after a batch.
          *
          *  @return True if the flush was successful.
          *
          **/
-        bool Force(const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData);
+        bool Force(const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData, const bool fFlush = true);
+
+
+        /** Allocate
+         *
+         *  Append a record to the end of the current sector file, without writing its key.
+         *
+         *  @param[in] vKey The binary data of the key to flush
+         *  @param[in] vData The binary data of the record to flush
+         *  @param[out] cKey The key of the new record.
+         *  @param[in] fFlush Flag to flush the stream, false when the caller flushes after a batch.
+         *
+         *  @return True if the record was written.
+         *
+         **/
+        bool Allocate(const std::vector<uint8_t>& vKey, const std::vector<uint8_t>& vData, SectorKey& cKey, const bool fFlush = true);
+
+
+        /** MoveRecord
+         *
+         *  Copy a record to the end of the current sector file and point its key at the copy.
+         *
+         *  @param[in] nBucket The keychain bucket the key is in.
+         *  @param[in] cKey The key of the record, as read from the keychain bucket.
+         *
+         *  @return True if the key no longer points at the old record.
+         *
+         **/
+        bool MoveRecord(const uint32_t nBucket, const SectorKey& cKey);
+
+
+        /** FlushStreams
+         *
+         *  Flush the write buffers of every open sector file stream.
+         *
+         **/
+        void FlushStreams();
 
 
         /** Put
@@ -753,7 +1392,10 @@ namespace LLD
 
         /** CacheWriter
          *
-         *  Flushes periodically data from the cache buffer to disk.
+         *  Flushes data from the cache buffer to disk as it arrives. Each batch is
+         *  drained from the queue, duplicate keys are coalesced, in place updates
+         *  are written in file order and new records appended, then the keys are
+         *  handed to a pool of keychain writers while the next batch is written.
          *
          **/
         void CacheWriter();
@@ -767,6 +1409,84 @@ namespace LLD
         void Meter();
 
 
+        /** Compactor
+         *
+         *  LLD Compactor Thread. Runs a compaction every -lldcompactinterval seconds.
+         *
+         **/
+        void Compactor();
+
+
+        /** Scrubber
+         *
+         *  LLD Scrubber Thread. Verifies the sector files of a checksummed
+         *  database every -lldscrubinterval seconds, unless -lldscrub=0.
+         *
+         **/
+        void Scrubber();
+
+
+        /** Scrub
+         *
+         *  Read every sector file front to back and check the checksum of each
+         *  record, at no more than -lldscrubrate bytes per second. Records that
+         *  fail are logged with their file and position, and counted in the
+         *  damaged_records_total metric along with those failing on reads.
+         *
+         *  @return True if the pass ran to the end.
+         *
+         **/
+        bool Scrub();
+
+
+        /** Compact
+         *
+         *  Reclaim the space of overwritten and erased records. Keychain buckets
+         *  are collapsed to the layers their live keys need, then the live records
+         *  of sector files that are mostly dead are rewritten to the end of the
+         *  current file and their keys swapped to the new location. The emptied
+         *  files are truncated on the following compaction, if no key has been
+         *  pointed into them since.
+         *
+         *  @return True if the compaction ran to the end.
+         *
+         **/
+        bool Compact();
+
+
+        /** Export
+         *
+         *  Write every record of the database to a bulk file, bucket by bucket
+         *  in keychain order and sorted by key within a bucket. The keychain is
+         *  only read, so a read only database can be exported. Commits wait
+         *  until the export is done, but it is meant for a database nothing
+         *  else is writing to.
+         *
+         *  @param[in] strFile The bulk file to write.
+         *
+         *  @return True if every record was written.
+         *
+         **/
+        bool Export(const std::string& strFile);
+
+
+        /** Import
+         *
+         *  Load a bulk file into an empty database, past the cache writer and
+         *  the journal. Records are appended to the sector files in the order
+         *  of the file, and their keys written into the buckets they were
+         *  exported from by a pool of threads, each taking its own buckets.
+         *  The keychain has to be of the type the file was exported from.
+         *
+         *  @param[in] strFile The bulk file to read.
+         *  @param[in] nThreads The threads writing keys to the keychain.
+         *
+         *  @return True if every record was loaded and the file checked out.
+         *
+         **/
+        bool Import(const std::string& strFile, const uint32_t nThreads = DEFAULT_KEYCHAIN_WRITERS);
+
+
         /** TxnBegin
          *
          *  Start a database transaction.
@@ -783,6 +1503,17 @@ namespace LLD
         bool TxnCheckpoint();
 
 
+        /** TxnCheckpoint
+         *
+         *  Add the transaction commitment message to a write-ahead log
+         *  group shared with other databases.
+         *
+         *  @param[in] journal The write-ahead log to add to.
+         *
+         **/
+        bool TxnCheckpoint(Journal& journal);
+
+
         /** TxnRelease
          *
          *  Release the transaction checkpoint.
@@ -808,6 +1539,28 @@ namespace LLD
          **/
         bool TxnRecovery();
 
+
+        /** TxnRecovery
+         *
+         *  Recover a transaction from a write-ahead log group.
+         *
+         *  @param[in] mapJournals The database journals of the group, by database name.
+         *
+         **/
+        bool TxnRecovery(const std::map<std::string, std::vector<uint8_t>>& mapJournals);
+
+
+        /** TxnReplay
+         *
+         *  Rebuild the transaction object from the binary data of a journal.
+         *
+         *  @param[in] vJournal The binary data of the journal.
+         *
+         *  @return True if the journal reached its commit message.
+         *
+         **/
+        bool TxnReplay(const std::vector<uint8_t>& vJournal);
+
     };
 }
 
@@ -0,0 +1,258 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLD_TEMPLATES_SNAPSHOT_H
+#define NEXUS_LLD_TEMPLATES_SNAPSHOT_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace LLD
+{
+
+    /** VersionStore
+     *
+     *  The records that committed transactions replaced, kept for as long as a
+     *  read view pinned before the commit is open.
+     *
+     *  Commits are numbered in order. A view pinned at commit N reads a key's
+     *  current record, unless a later commit replaced it, in which case it reads
+     *  the record kept by the first commit after N. Records are only kept while
+     *  views are open, so a database without views pays nothing.
+     *
+     **/
+    class VersionStore
+    {
+        /** Version
+         *
+         *  The record a key held before a commit.
+         *
+         **/
+        struct Version
+        {
+            /** The commit that replaced the record. **/
+            uint64_t nSequence;
+
+            /** True if the key had a record, false if the commit created it. **/
+            bool fExists;
+
+            /** The record the key held. **/
+            std::vector<uint8_t> vData;
+        };
+
+
+        /** Mutex for the views and versions. **/
+        mutable std::mutex MUTEX;
+
+
+        /** The last commit applied. **/
+        uint64_t nSequence;
+
+
+        /** The commits the open views are pinned at. **/
+        std::multiset<uint64_t> setPinned;
+
+
+        /** The versions of each key, oldest commit first. **/
+        std::map< std::vector<uint8_t>, std::vector<Version> > mapVersions;
+
+
+        /** The versions kept across all keys. **/
+        uint64_t nVersions;
+
+
+    public:
+
+        /** Default Constructor. **/
+        VersionStore();
+
+
+        /** Copy Constructor. **/
+        VersionStore(const VersionStore& store)            = delete;
+
+
+        /** Copy Assignment. **/
+        VersionStore& operator=(const VersionStore& store) = delete;
+
+
+        /** Sequence
+         *
+         *  Get the last commit applied.
+         *
+         **/
+        uint64_t Sequence() const;
+
+
+        /** Advance
+         *
+         *  Mark a commit as applied, views pinned from now on see it.
+         *
+         *  @param[in] nSequenceIn The commit applied.
+         *
+         **/
+        void Advance(const uint64_t nSequenceIn);
+
+
+        /** Pin
+         *
+         *  Open a view at the last commit applied.
+         *
+         *  @return The commit the view is pinned at.
+         *
+         **/
+        uint64_t Pin();
+
+
+        /** Unpin
+         *
+         *  Close a view, dropping the versions no open view needs.
+         *
+         *  @param[in] nPinned The commit the view was pinned at.
+         *
+         **/
+        void Unpin(const uint64_t nPinned);
+
+
+        /** Pinned
+         *
+         *  Get the number of open views.
+         *
+         **/
+        uint64_t Pinned() const;
+
+
+        /** Versions
+         *
+         *  Get the number of versions kept.
+         *
+         **/
+        uint64_t Versions() const;
+
+
+        /** Needs
+         *
+         *  Check if a key's record has to be kept before a commit changes it.
+         *  It doesn't if no view is open, or a version newer than every open
+         *  view is already kept, since views read the oldest version after them.
+         *
+         *  @param[in] vKey The key the commit changes.
+         *
+         **/
+        bool Needs(const std::vector<uint8_t>& vKey) const;
+
+
+        /** Keep
+         *
+         *  Keep the record a key held before a commit.
+         *
+         *  @param[in] vKey The key the commit changes.
+         *  @param[in] nCommit The commit about to be applied.
+         *  @param[in] fExists True if the key has a record.
+         *  @param[in] vData The record of the key.
+         *
+         **/
+        void Keep(const std::vector<uint8_t>& vKey, const uint64_t nCommit, const bool fExists, const std::vector<uint8_t>& vData);
+
+
+        /** Find
+         *
+         *  Get the record a key held at a commit, if a later commit replaced it.
+         *
+         *  @param[in] vKey The key to find.
+         *  @param[in] nPinned The commit the view is pinned at.
+         *  @param[out] fExists True if the key had a record.
+         *  @param[out] vData The record the key held.
+         *
+         *  @return True if a version was found, false if the current record is the one to read.
+         *
+         **/
+        bool Find(const std::vector<uint8_t>& vKey, const uint64_t nPinned, bool &fExists, std::vector<uint8_t>& vData) const;
+    };
+
+
+    /** ReadView
+     *
+     *  A handle on a database pinned at a commit. Reads through it see every
+     *  transaction committed before it was taken and none after, without
+     *  holding the transaction lock. Writes made outside of a transaction are
+     *  not versioned, and are seen as soon as they are made.
+     *
+     *  Versions are kept for as long as the view is open, so close it when done.
+     *
+     **/
+    class ReadView
+    {
+        /** The versions of the database the view is of. **/
+        std::shared_ptr<VersionStore> pStore;
+
+
+        /** The commit the view is pinned at. **/
+        uint64_t nSequence;
+
+
+    public:
+
+        /** Default Constructor. **/
+        ReadView() = delete;
+
+
+        /** Constructor. Takes over a pin on the store.
+         *
+         *  @param[in] pStoreIn The versions of the database.
+         *  @param[in] nSequenceIn The commit the view is pinned at.
+         *
+         **/
+        ReadView(const std::shared_ptr<VersionStore>& pStoreIn, const uint64_t nSequenceIn);
+
+
+        /** Copy Constructor. **/
+        ReadView(const ReadView& view)            = delete;
+
+
+        /** Move Constructor. **/
+        ReadView(ReadView&& view);
+
+
+        /** Copy Assignment. **/
+        ReadView& operator=(const ReadView& view) = delete;
+
+
+        /** Default Destructor. Closes the view. **/
+        ~ReadView();
+
+
+        /** Sequence
+         *
+         *  Get the commit the view is pinned at.
+         *
+         **/
+        uint64_t Sequence() const;
+
+
+        /** Of
+         *
+         *  Check if the view is of the database that owns a store.
+         *
+         *  @param[in] pStoreIn The versions of the database.
+         *
+         **/
+        bool Of(const std::shared_ptr<VersionStore>& pStoreIn) const;
+    };
+}
+
+#endif
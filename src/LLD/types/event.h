@@ -0,0 +1,123 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLD_INCLUDE_EVENT_H
+#define NEXUS_LLD_INCLUDE_EVENT_H
+
+#include <LLC/types/uint1024.h>
+
+#include <LLD/templates/sector.h>
+#include <LLD/cache/binary_lru.h>
+#include <LLD/keychain/orderedmap.h>
+
+
+namespace LLD
+{
+
+    /** EventDB
+     *
+     *  The database class for the ordered event index. Events are keyed by address and
+     *  big-endian sequence, so that the events of an address are read back as a range.
+     *
+     **/
+    class EventDB : public SectorDatabase<BinaryOrderedMap, BinaryLRU>
+    {
+
+    public:
+
+        /** The Database Constructor. To determine file location and the Bytes per Record. **/
+        EventDB(const uint8_t nFlagsIn = FLAGS::CREATE | FLAGS::WRITE,
+            const uint32_t nBucketsIn = 77773, const uint32_t nCacheIn = 1024 * 1024);
+
+
+        /** Default Destructor **/
+        virtual ~EventDB();
+
+
+        /** WriteEvent
+         *
+         *  Writes an event's transaction hash to the index.
+         *
+         *  @param[in] hashAddress The address the event is for.
+         *  @param[in] nSequence The sequence number of the event.
+         *  @param[in] hashTx The transaction hash of the event.
+         *
+         *  @return True if the event was successfully written, false otherwise.
+         *
+         **/
+        bool WriteEvent(const uint256_t& hashAddress, const uint32_t nSequence, const uint512_t& hashTx);
+
+
+        /** EraseEvent
+         *
+         *  Erases an event from the index.
+         *
+         *  @param[in] hashAddress The address the event is for.
+         *  @param[in] nSequence The sequence number of the event.
+         *
+         *  @return True if the event was successfully erased, false otherwise.
+         *
+         **/
+        bool EraseEvent(const uint256_t& hashAddress, const uint32_t nSequence);
+
+
+        /** ReadFirst
+         *
+         *  Reads the first sequence number indexed for an address. Events from before
+         *  the index was enabled are only in the ledger database.
+         *
+         *  @param[in] hashAddress The address to read for.
+         *  @param[out] nFirst The first sequence number indexed.
+         *
+         *  @return True if the address has any events indexed, false otherwise.
+         *
+         **/
+        bool ReadFirst(const uint256_t& hashAddress, uint32_t &nFirst);
+
+
+        /** ReadEvents
+         *
+         *  Reads the transaction hashes of the events from sequence nBegin up to but
+         *  not including nEnd, in sequence order.
+         *
+         *  @param[in] hashAddress The address to read for.
+         *  @param[in] nBegin The sequence number to start from.
+         *  @param[in] nEnd The sequence number to stop before.
+         *  @param[out] vHashes The transaction hashes read.
+         *
+         *  @return True if any events were read, false otherwise.
+         *
+         **/
+        bool ReadEvents(const uint256_t& hashAddress, const uint32_t nBegin, const uint32_t nEnd,
+                        std::vector<uint512_t> &vHashes);
+
+
+    private:
+
+        /** SequenceKey
+         *
+         *  Get the big-endian bytes of a sequence number, which sort in the
+         *  same order as the numbers do.
+         *
+         *  @param[in] nSequence The sequence number.
+         *
+         *  @return The bytes to key the event by.
+         *
+         **/
+        static std::vector<uint8_t> SequenceKey(const uint32_t nSequence);
+
+    };
+}
+
+#endif
@@ -18,8 +18,9 @@ ________________________________________________________________________________
 #include <LLC/types/uint1024.h>
 
 #include <LLD/templates/sector.h>
-#include <LLD/cache/binary_lru.h>
+#include <LLD/cache/binary_clock.h>
 #include <LLD/keychain/hashmap.h>
+#include <LLD/keychain/shard_hashmap.h>
 
 #include <TAO/Operation/types/contract.h>
 
@@ -29,6 +30,7 @@ ________________________________________________________________________________
 
 #include <Util/include/memory.h>
 
+#include <deque>
 #include <tuple>
 
 
@@ -67,14 +69,89 @@ namespace LLD
     };
 
 
+    /* The read-ahead threads of the ledger DB, 0 to disable read-ahead. */
+    const uint32_t DEFAULT_PREFETCH_THREADS = 2;
+
+
+    /* The most blocks one read-ahead walks. */
+    const uint32_t MAX_PREFETCH_BLOCKS = 10000;
+
+
+    /* The most transactions waiting to be read ahead, any more are dropped. */
+    const uint32_t MAX_PREFETCH_TX = 100000;
+
+
+    /* The most walks waiting for a read-ahead thread, any more are dropped. */
+    const uint32_t MAX_PREFETCH_WALKS = 32;
+
+
     /** LedgerDB
      *
      *  The database class for the Ledger Layer.
      *
      **/
-    class LedgerDB : public SectorDatabase<BinaryHashMap, BinaryLRU>
+    class LedgerDB : public SectorDatabase<ShardableKeychain, BinaryCLOCK>
     {
 
+        /** PrefetchWalk
+         *
+         *  A walk along the chain waiting for a read-ahead thread.
+         *
+         **/
+        struct PrefetchWalk
+        {
+            /** The block to walk from, which is not read itself. **/
+            uint1024_t hashStart;
+
+            /** The block to stop after, 0 to walk all of nCount. **/
+            uint1024_t hashStop;
+
+            /** The blocks to read. **/
+            uint32_t nCount;
+
+            /** True to follow the next blocks, false the previous ones. **/
+            bool fForward;
+        };
+
+
+        /** Mutex for the read-ahead queues. **/
+        std::mutex PREFETCH_MUTEX;
+
+
+        /** Condition to wake the read-ahead threads. **/
+        std::condition_variable PREFETCH_CONDITION;
+
+
+        /** The walks waiting for a read-ahead thread. **/
+        std::deque<PrefetchWalk> queueWalks;
+
+
+        /** The transactions of walked blocks waiting for a read-ahead thread, by type and hash. **/
+        std::deque< std::pair<uint8_t, uint512_t> > queueTx;
+
+
+        /** The blocks and transactions read ahead. **/
+        std::atomic<uint64_t> nPrefetchBlocks;
+        std::atomic<uint64_t> nPrefetchTx;
+
+
+        /** Flag to stop the read-ahead threads. **/
+        std::atomic<bool> fPrefetchStop;
+
+
+        /** The read-ahead threads, from -lldprefetchthreads. **/
+        std::vector<std::thread> vPrefetchThreads;
+
+
+        /** Prefetcher
+         *
+         *  Read-ahead thread. Reads the transactions of walked blocks, and walks
+         *  the chain when there are none waiting.
+         *
+         **/
+        void Prefetcher();
+
+
         /** Mutex to lock internall when accessing memory mode. **/
         std::mutex MEMORY_MUTEX;
 
@@ -103,6 +180,29 @@ namespace LLD
         virtual ~LedgerDB();
 
 
+        /** Prefetch
+         *
+         *  Read the blocks following or preceding a block, and their
+         *  transactions, into the cache on the read-ahead threads. Returns at
+         *  once, so a caller walking the same blocks finds them in the cache
+         *  instead of waiting on a disk read for each.
+         *
+         *  A walk already waiting from the same block is not queued again, and
+         *  walks past MAX_PREFETCH_WALKS are dropped, so callers that ask for
+         *  more than the threads can read don't grow the queue.
+         *
+         *  @param[in] hashStart The block to walk from, which is not read itself.
+         *  @param[in] nCount The blocks to read, at most MAX_PREFETCH_BLOCKS.
+         *  @param[in] fForward True to follow the next blocks, false the previous ones.
+         *  @param[in] hashStop The block to stop after, 0 to read all of nCount.
+         *
+         *  @return True if the walk was queued, false if it was dropped or read-ahead is disabled.
+         *
+         **/
+        bool Prefetch(const uint1024_t& hashStart, const uint32_t nCount, const bool fForward = true,
+                      const uint1024_t& hashStop = uint1024_t(0));
+
+
         /** WriteBestChain
          *
          *  Writes the best chain pointer to the ledger DB.
@@ -180,6 +280,18 @@ namespace LLD
         bool WriteTx(const uint512_t& hashTx, const TAO::Ledger::Transaction& tx);
 
 
+        /** WriteTx
+         *
+         *  Adds a transaction to a batch of writes to the ledger DB.
+         *
+         *  @param[in] hashTx The txid of transaction to write.
+         *  @param[in] tx The transaction object to write.
+         *  @param[out] batch The batch to add the write to.
+         *
+         **/
+        void WriteTx(const uint512_t& hashTx, const TAO::Ledger::Transaction& tx, WriteBatch& batch);
+
+
         /** ReadTx
          *
          *  Reads a transaction from the ledger DB.
@@ -209,6 +321,19 @@ namespace LLD
         bool ReadTx(const uint512_t& hashTx, TAO::Ledger::Transaction &tx, bool &fConflicted, const uint8_t nFlags = TAO::Ledger::FLAGS::BLOCK);
 
 
+        /** ReadTxs
+         *
+         *  Reads many transactions from the ledger DB in one batch.
+         *
+         *  @param[in] vHashes The txids of transactions to read.
+         *  @param[out] mapTx The transactions that were read, by txid.
+         *
+         *  @return True if every transaction was read, false otherwise.
+         *
+         **/
+        bool ReadTxs(const std::vector<uint512_t>& vHashes, std::map<uint512_t, TAO::Ledger::Transaction> &mapTx);
+
+
         /** EraseTx
          *
          *  Erases a transaction from the ledger DB.
@@ -328,6 +453,18 @@ namespace LLD
         bool IndexBlock(const uint32_t& nBlockHeight, const uint1024_t& hashBlock);
 
 
+        /** IndexBlock
+         *
+         *  Adds the index of a block height to a block to a batch of writes to the ledger DB.
+         *
+         *  @param[in] nBlockHeight The block height to index to.
+         *  @param[in] hashBlock The block hash to index to.
+         *  @param[out] batch The batch to add the index to.
+         *
+         **/
+        void IndexBlock(const uint32_t& nBlockHeight, const uint1024_t& hashBlock, WriteBatch& batch);
+
+
         /** EraseIndex
          *
          *  Erase a foreign index form the keychain
@@ -634,6 +771,18 @@ namespace LLD
         bool WriteBlock(const uint1024_t& hashBlock, const TAO::Ledger::BlockState& state);
 
 
+        /** WriteBlock
+         *
+         *  Adds a block state object to a batch of writes to the ledger DB.
+         *
+         *  @param[in] hashBlock The block hash to write as.
+         *  @param[in] state The block state object to write.
+         *  @param[out] batch The batch to add the write to.
+         *
+         **/
+        void WriteBlock(const uint1024_t& hashBlock, const TAO::Ledger::BlockState& state, WriteBatch& batch);
+
+
         /** ReadBlock
          *
          *  Reads a block state object from disk.
@@ -60,6 +60,18 @@ namespace LLD
         bool WriteTx(const uint512_t& hashTx, const Legacy::Transaction& tx);
 
 
+        /** WriteTx
+         *
+         *  Adds a transaction to a batch of writes to the legacy DB.
+         *
+         *  @param[in] hashTx The txid of transaction to write.
+         *  @param[in] tx The transaction object to write.
+         *  @param[out] batch The batch to add the write to.
+         *
+         **/
+        void WriteTx(const uint512_t& hashTx, const Legacy::Transaction& tx, WriteBatch& batch);
+
+
         /** ReadTx
          *
          *  Reads a transaction from the legacy DB.
@@ -89,6 +101,19 @@ namespace LLD
         bool ReadTx(const uint512_t& hashTx, Legacy::Transaction& tx, const uint8_t nFlags = TAO::Ledger::FLAGS::BLOCK);
 
 
+        /** ReadTxs
+         *
+         *  Reads many transactions from the legacy DB in one batch.
+         *
+         *  @param[in] vHashes The txids of transactions to read.
+         *  @param[out] mapTx The transactions that were read, by txid.
+         *
+         *  @return True if every transaction was read, false otherwise.
+         *
+         **/
+        bool ReadTxs(const std::vector<uint512_t>& vHashes, std::map<uint512_t, Legacy::Transaction>& mapTx);
+
+
         /** EraseTx
          *
          *  Erases a transaction from the ledger DB.
@@ -18,8 +18,9 @@ ________________________________________________________________________________
 #include <LLC/types/uint1024.h>
 
 #include <LLD/templates/sector.h>
-#include <LLD/cache/binary_lru.h>
+#include <LLD/cache/binary_clock.h>
 #include <LLD/keychain/hashmap.h>
+#include <LLD/keychain/shard_hashmap.h>
 
 #include <TAO/Register/types/state.h>
 
@@ -52,7 +53,7 @@ namespace LLD
      *  The database class for the Register Layer.
      *
      **/
-    class RegisterDB : public SectorDatabase<BinaryHashMap, BinaryLRU>
+    class RegisterDB : public SectorDatabase<ShardableKeychain, BinaryCLOCK>
     {
         
         /** Memory mutex to lock when accessing internal memory states. **/
@@ -115,6 +116,20 @@ namespace LLD
         bool ReadState(const uint256_t& hashRegister, TAO::Register::State& state, const uint8_t nFlags = TAO::Ledger::FLAGS::BLOCK);
 
 
+        /** ReadState
+         *
+         *  Read a state register as it was when a read view of the register database was opened.
+         *
+         *  @param[in] view The read view of the register database.
+         *  @param[in] hashRegister The register address.
+         *  @param[out] state The state register to read.
+         *
+         *  @return True if read was successful, false otherwise.
+         *
+         **/
+        bool ReadState(const ReadView& view, const uint256_t& hashRegister, TAO::Register::State& state);
+
+
         /** EraseState
          *
          *  Erase a state register from the register database.
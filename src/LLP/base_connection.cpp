@@ -51,6 +51,8 @@ namespace LLP
     , fDDOS           (false)
     , fOUTGOING       (false)
     , fCONNECTED      (false)
+    , fPROCESSING     (false)
+    , nDisconnect     (0)
     , nDataThread     (-1)
     , nDataIndex      (-1)
     , FLUSH_CONDITION (nullptr)
@@ -73,6 +75,8 @@ namespace LLP
     , fDDOS           (fDDOSIn)
     , fOUTGOING       (fOutgoing)
     , fCONNECTED      (false)
+    , fPROCESSING     (false)
+    , nDisconnect     (0)
     , nDataThread     (-1)
     , nDataIndex      (-1)
     , FLUSH_CONDITION (nullptr)
@@ -95,6 +99,8 @@ namespace LLP
     , fDDOS           (fDDOSIn)
     , fOUTGOING       (fOutgoing)
     , fCONNECTED      (false)
+    , fPROCESSING     (false)
+    , nDisconnect     (0)
     , nDataThread     (-1)
     , nDataIndex      (-1)
     , FLUSH_CONDITION (nullptr)
@@ -147,6 +153,8 @@ namespace LLP
         fDDOS           = false;
         fOUTGOING       = false;
         fCONNECTED      = false;
+        fPROCESSING     = false;
+        nDisconnect     = 0;
         nDataThread     = -1;
         nDataIndex      = -1;
 
@@ -191,8 +199,16 @@ namespace LLP
     template <class PacketType>
     void BaseConnection<PacketType>::WritePacket(const PacketType& PACKET)
     {
-        /* Get the bytes of the packet. */
-        const std::vector<uint8_t> vBytes = PACKET.GetBytes();
+        /* Get the bytes of the packet, shared so a partial send queues them without a copy. */
+        WritePacket(std::make_shared<const std::vector<uint8_t>>(PACKET.GetBytes()));
+    }
+
+
+    /*  Write a single packet that is already serialized to the TCP stream. */
+    template <class PacketType>
+    void BaseConnection<PacketType>::WritePacket(const std::shared_ptr<const std::vector<uint8_t>>& pBytes)
+    {
+        const std::vector<uint8_t>& vBytes = *pBytes;
 
         /* Stop sending packets if send buffer is full. */
         uint64_t nMaxSendBuffer = config::GetArg("-maxsendbuffer", MAX_SEND_BUFFER);
@@ -207,7 +223,7 @@ namespace LLP
                 PrintHex(vBytes);
 
             /* Write the packet to socket buffer. */
-            Write(vBytes, vBytes.size());
+            Write(pBytes);
 
             /* Update packet count. */
             ++PACKETS;
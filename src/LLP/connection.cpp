@@ -49,11 +49,17 @@ namespace LLP
     {
 
         /* Handle Reading Packet Type Header. */
-        if(Available() >= 1 && INCOMING.IsNull())
+        if(INCOMING.IsNull())
         {
-            std::vector<uint8_t> HEADER(1, 255);
-            if(Read(HEADER, 1) == 1)
-                INCOMING.HEADER = HEADER[0];
+            /* Read what the socket has in one call, then frame the packet out of the receive buffer. */
+            if(Received() < 1)
+                Fill();
+
+            if(Received() >= 1)
+            {
+                INCOMING.HEADER = Peek()[0];
+                Consume(1);
+            }
         }
 
         /* At this point we need to check agin whether the packet is considered complete as some
@@ -61,40 +67,43 @@ namespace LLP
         if(!INCOMING.IsNull() && !INCOMING.Complete())
         {
             /* Read the packet length. */
-            if(Available() >= 4 && INCOMING.LENGTH == 0)
+            if(INCOMING.LENGTH == 0)
             {
+                if(Received() < 4)
+                    Fill();
+
                 /* Handle Reading Packet Length Header. */
-                std::vector<uint8_t> BYTES(4, 0);
-                if(Read(BYTES, 4) == 4)
+                if(Received() >= 4)
                 {
-                    INCOMING.SetLength(BYTES);
+                    INCOMING.SetLength(std::vector<uint8_t>(Peek(), Peek() + 4));
+                    Consume(4);
+
                     Event(EVENTS::HEADER);
                 }
             }
 
             /* Handle Reading Packet Data. */
-            uint32_t nAvailable = Available();
-            if(INCOMING.Header() && nAvailable > 0 && !INCOMING.IsNull() && INCOMING.DATA.size() < INCOMING.LENGTH)
+            if(INCOMING.Header() && !INCOMING.IsNull() && INCOMING.DATA.size() < INCOMING.LENGTH)
             {
-                /* The maximum number of bytes to read is th number of bytes specified in the message length, 
+                /* The maximum number of bytes to read is th number of bytes specified in the message length,
                    minus any already read on previous reads*/
                 uint32_t nMaxRead = (uint32_t)(INCOMING.LENGTH - INCOMING.DATA.size());
-                
-                /* Vector to receve the read bytes. This should be the smaller of the number of bytes currently available or the
-                   maximum amount to read */
-                std::vector<uint8_t> DATA(std::min(nAvailable, nMaxRead), 0);
-
-                /* Read up to the buffer size. */
-                int32_t nRead = Read(DATA, DATA.size()); 
-                
-                /* If something was read, insert it into the packet data.  NOTE: that due to SSL packet framing we could end up 
-                   reading less bytes than appear available.  Therefore we only copy the number of bytes actually read */
+
+                /* Only go to the socket when the buffer doesn't already hold the rest of the packet. */
+                if(Received() < nMaxRead)
+                    Fill();
+
+                /* Copy straight out of the receive buffer into the packet data. */
+                uint32_t nRead = std::min(Received(), nMaxRead);
                 if(nRead > 0)
-                    INCOMING.DATA.insert(INCOMING.DATA.end(), DATA.begin(), DATA.begin() + nRead);
-                    
-                /* If the packet is now considered complete, fire the packet complete event */
-                if(INCOMING.Complete())
-                    Event(EVENTS::PACKET, static_cast<uint32_t>(DATA.size()));
+                {
+                    INCOMING.DATA.insert(INCOMING.DATA.end(), Peek(), Peek() + nRead);
+                    Consume(nRead);
+
+                    /* If the packet is now considered complete, fire the packet complete event */
+                    if(INCOMING.Complete())
+                        Event(EVENTS::PACKET, nRead);
+                }
             }
         }
     }
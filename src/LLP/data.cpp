@@ -12,6 +12,7 @@
 ____________________________________________________________________________________________*/
 
 #include <LLP/include/base_address.h>
+#include <LLP/include/executor.h>
 #include <LLP/templates/data.h>
 
 #include <LLP/templates/socket.h>
@@ -25,6 +26,15 @@ ________________________________________________________________________________
 
 #include <Util/include/hex.h>
 
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
 
 namespace LLP
 {
@@ -33,7 +43,7 @@ namespace LLP
     template <class ProtocolType>
     DataThread<ProtocolType>::DataThread(uint32_t nID, bool ffDDOSIn,
                                          uint32_t rScore, uint32_t cScore,
-                                         uint32_t nTimeout, bool fMeter)
+                                         uint32_t nTimeout, bool fMeter, Executor* pExecutor)
     : fDDOS           (ffDDOSIn)
     , fMETER          (fMeter)
     , fDestruct       (false)
@@ -43,13 +53,43 @@ namespace LLP
     , TIMEOUT         (nTimeout)
     , DDOS_rSCORE     (rScore)
     , DDOS_cSCORE     (cScore)
+#ifdef __linux__
+    , nEpoll          (config::GetBoolArg("-llpepoll", true) ? epoll_create1(EPOLL_CLOEXEC) : -1)
+#else
+    , nEpoll          (-1)
+#endif
+#ifdef __linux__
+    , nWake           (eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+#else
+    , nWake           (-1)
+#endif
+    , EXECUTOR        (pExecutor)
+    , nProcessing     (0)
     , CONNECTIONS     (memory::atomic_ptr< std::vector<std::shared_ptr<ProtocolType>> >(new std::vector<std::shared_ptr<ProtocolType>>()))
-    , RELAY           (memory::atomic_ptr< std::queue<std::pair<typename ProtocolType::message_t, DataStream>> >(new std::queue<std::pair<typename ProtocolType::message_t, DataStream>>()))
+    , RELAY           (memory::atomic_ptr< std::queue<std::shared_ptr<const RelayMessage<ProtocolType>>> >(new std::queue<std::shared_ptr<const RelayMessage<ProtocolType>>>()))
     , CONDITION       ( )
     , DATA_THREAD     (std::bind(&DataThread::Thread, this))
     , FLUSH_CONDITION ( )
     , FLUSH_THREAD    (std::bind(&DataThread::Flush, this))
     {
+#ifdef __linux__
+        /* Have epoll return once a worker gives a connection back. */
+        if(nEpoll >= 0 && nWake >= 0)
+        {
+            epoll_event event;
+            event.events   = EPOLLIN;
+            event.data.u64 = EPOLL_WAKE_EVENT;
+
+            /* Fall back to checking on the workers without it. */
+            if(epoll_ctl(nEpoll, EPOLL_CTL_ADD, nWake, &event) < 0)
+            {
+                debug::error(FUNCTION, "failed to watch wake-up: ", strerror(errno));
+
+                close(nWake);
+                nWake = -1;
+            }
+        }
+#endif
     }
 
 
@@ -68,6 +108,15 @@ namespace LLP
 
         CONNECTIONS.free();
         RELAY.free();
+
+#ifdef __linux__
+        /* Close the epoll instance once nothing waits on it. */
+        if(nEpoll >= 0)
+            close(nEpoll);
+
+        if(nWake >= 0)
+            close(nWake);
+#endif
     }
 
 
@@ -80,6 +129,18 @@ namespace LLP
         uint32_t nSize = CONNECTIONS->size();
         for(uint32_t nIndex = 0; nIndex < nSize; ++nIndex)
         {
+            /* Skip over empty slots. */
+            std::shared_ptr<ProtocolType> CONNECTION = CONNECTIONS->at(nIndex);
+            if(!CONNECTION)
+                continue;
+
+            /* Leave a connection a worker has to the data thread, which removes it once the worker is done. */
+            if(CONNECTION->fPROCESSING.load())
+            {
+                CONNECTION->nDisconnect = DISCONNECT::FORCE;
+                continue;
+            }
+
             /* When on destruct or shutdown, remove the connection without events. */
             if(fDestruct.load() || config::fShutdown.load())
                 remove_connection(nIndex);
@@ -96,6 +157,18 @@ namespace LLP
      *  LLP Messaging Thread. */
     template <class ProtocolType>
     void DataThread<ProtocolType>::Thread()
+    {
+        /* Use epoll when it could be created. */
+        if(nEpoll >= 0)
+            epoll_thread();
+        else
+            poll_thread();
+    }
+
+
+    /* Polls every connection each iteration, and checks and reads all of them. */
+    template <class ProtocolType>
+    void DataThread<ProtocolType>::poll_thread()
     {
         /* Cache sleep time if applicable. */
         uint32_t nSleep = config::GetArg("-llpsleep", 0);
@@ -136,9 +209,13 @@ namespace LLP
             /* Wrapped mutex lock. */
             uint32_t nSize = static_cast<uint32_t>(CONNECTIONS->size());
 
-            /* Check the pollfd's size. */
-            if(POLLFDS.size() != nSize)
-                POLLFDS.resize(nSize);
+            /* Check the pollfd's size, with the wake-up behind the connections. */
+            const uint32_t nPolls = nSize + (nWake >= 0 ? 1 : 0);
+            if(POLLFDS.size() != nPolls)
+                POLLFDS.resize(nPolls);
+
+            /* Connections holding a packet already read from the socket can't wait on poll. */
+            bool fReceived = false;
 
             /* Initialize the revents for all connection pollfd structures.
             * One connection must be live, so verify that and skip if none
@@ -151,8 +228,8 @@ namespace LLP
                     POLLFDS.at(nIndex).events  = POLLIN;// | POLLRDHUP;
                     POLLFDS.at(nIndex).revents = 0; //reset return events
 
-                    /* Set to invalid socket if connection is inactive. */
-                    if(!CONNECTIONS->at(nIndex))
+                    /* Set to invalid socket if connection is inactive, or a worker has its packet. */
+                    if(!CONNECTIONS->at(nIndex) || CONNECTIONS->at(nIndex)->fPROCESSING.load())
                     {
                         POLLFDS.at(nIndex).fd = INVALID_SOCKET;
 
@@ -161,6 +238,10 @@ namespace LLP
 
                     /* Set the correct file descriptor. */
                     POLLFDS.at(nIndex).fd = CONNECTIONS->at(nIndex)->fd;
+
+                    /* Check for bytes left in the receive buffer. */
+                    if(CONNECTIONS->at(nIndex)->Received() > 0)
+                        fReceived = true;
                 }
                 catch(const std::exception& e)
                 {
@@ -168,11 +249,20 @@ namespace LLP
                 }
             }
 
-            /* Poll the sockets. */
+            /* Have poll return once a worker gives a connection back. */
+            if(nWake >= 0)
+            {
+                POLLFDS.at(nSize).fd      = nWake;
+                POLLFDS.at(nSize).events  = POLLIN;
+                POLLFDS.at(nSize).revents = 0;
+            }
+
+            /* Poll the sockets, briefly while workers have some and there is no wake-up to tell when they are done. */
+            const int32_t nTimeout = fReceived ? 0 : ((nWake < 0 && nProcessing.load() > 0) ? 1 : 100);
 #ifdef WIN32
-            int32_t nPoll = WSAPoll((pollfd*)&POLLFDS[0], nSize, 100);
+            int32_t nPoll = WSAPoll((pollfd*)&POLLFDS[0], nPolls, nTimeout);
 #else
-            int32_t nPoll = poll((pollfd*)&POLLFDS[0], nSize, 100);
+            int32_t nPoll = poll((pollfd*)&POLLFDS[0], nPolls, nTimeout);
 #endif
 
             /* Check poll for available sockets. */
@@ -182,6 +272,10 @@ namespace LLP
                 continue;
             }
 
+            /* Clear the wake-up, as every connection is checked below anyway. */
+            if(nWake >= 0 && (POLLFDS.at(nSize).revents & POLLIN))
+                clear_wake();
+
 
             /* Check all connections for data and packets. */
             for(uint32_t nIndex = 0; nIndex < nSize; ++nIndex)
@@ -190,8 +284,20 @@ namespace LLP
                 std::shared_ptr<ProtocolType> CONNECTION = CONNECTIONS->at(nIndex);
                 try
                 {
+                    /* Skip over Inactive Connections, and the ones a worker has. */
+                    if(!CONNECTION || CONNECTION->fPROCESSING.load())
+                        continue;
+
+                    /* Remove a connection a worker or another thread asked to disconnect, its socket can be closed already. */
+                    const uint8_t nReason = CONNECTION->nDisconnect.load();
+                    if(nReason != 0)
+                    {
+                        remove_connection_with_event(nIndex, nReason);
+                        continue;
+                    }
+
                     /* Skip over Inactive Connections. */
-                    if(!CONNECTION || !CONNECTION->Connected())
+                    if(!CONNECTION->Connected())
                         continue;
 
                     /* Disconnect if there was a polling error */
@@ -208,96 +314,295 @@ namespace LLP
                         continue;
                     }
 
-                    /* Remove Connection if it has Timed out or had any read/write Errors. */
-                    if(CONNECTION->Errors())
+                    /* Disconnect if pollin signaled with no data (This happens on Linux). */
+                    if((POLLFDS.at(nIndex).revents & POLLIN)
+                    && CONNECTION->Available() == 0 && !CONNECTION->IsSSL())
                     {
-                        remove_connection_with_event(nIndex, DISCONNECT::ERRORS);
+                        remove_connection_with_event(nIndex, DISCONNECT::POLL_EMPTY);
                         continue;
                     }
 
                     /* Remove Connection if it has Timed out or had any Errors. */
-                    if(CONNECTION->Timeout(TIMEOUT * 1000, Socket::READ))
+                    if(!check_connection(nIndex, CONNECTION))
+                        continue;
+
+                    /* Generic event for Connection. */
+                    CONNECTION->Event(EVENTS::GENERIC);
+
+                    /* Work on Reading a Packet. **/
+                    read_connection(nIndex, CONNECTION);
+                }
+                catch(const std::exception& e)
+                {
+                    debug::error(FUNCTION, "Data Connection: ", e.what());
+                    remove_connection_with_event(nIndex, DISCONNECT::ERRORS);
+                }
+            }
+        }
+    }
+
+
+    /* Waits on the edge-triggered epoll interest set, and only reads the connections with data. */
+    template <class ProtocolType>
+    void DataThread<ProtocolType>::epoll_thread()
+    {
+#ifdef __linux__
+        /* Cache sleep time if applicable. */
+        uint32_t nSleep = config::GetArg("-llpsleep", 0);
+
+        /* The mutex for the condition. */
+        std::mutex CONDITION_MUTEX;
+
+        /* The events returned by each wait. */
+        std::vector<epoll_event> vEvents(MAX_EPOLL_EVENTS);
+
+        /* Connections with data left after their last read. Edge-triggered events
+         * only fire on new data, so these are read again without waiting for one. */
+        std::vector<uint32_t> vReady;
+
+        /* Connections whose peer closed with data still unread, by slot and socket. */
+        std::vector< std::pair<uint32_t, int32_t> > vClosing;
+
+        /* Connections with a packet on a worker, to read again once it is done with them. */
+        std::vector<uint32_t> vBusy;
+
+        /* Time since every connection was last checked. */
+        runtime::timer timerSweep;
+        timerSweep.Start();
+
+        /* The main connection handler loop. */
+        while(!fDestruct.load() && !config::fShutdown.load())
+        {
+            /* Check for data thread sleep (helps with cpu usage). */
+            if(nSleep > 0)
+                runtime::sleep(nSleep);
+
+            /* Keep data threads waiting for work. */
+            {
+                std::unique_lock<std::mutex> CONDITION_LOCK(CONDITION_MUTEX);
+                CONDITION.wait(CONDITION_LOCK,
+                [this]
+                {
+                    return fDestruct.load()
+                    || config::fShutdown.load()
+                    || nIncoming.load() > 0
+                    || nOutbound.load() > 0;
+                });
+            }
+
+            /* Check for close. */
+            if(fDestruct.load() || config::fShutdown.load())
+                return;
+
+            /* Wait for sockets with new data or a worker giving a connection back, without blocking while some still have data left. */
+            int32_t nEvents = epoll_wait(nEpoll, &vEvents[0], MAX_EPOLL_EVENTS, !vReady.empty() ? 0 : ((nWake < 0 && !vBusy.empty()) ? 1 : EPOLL_SWEEP_INTERVAL));
+            if(nEvents < 0)
+            {
+                if(errno != EINTR)
+                {
+                    runtime::sleep(1);
+                    continue;
+                }
+
+                nEvents = 0;
+            }
+
+            /* Take the connections left over from the last iteration. */
+            std::vector<uint32_t> vRead;
+            vRead.swap(vReady);
+
+            /* Take the connections workers are done with, as data that came in the meantime fired its event already. */
+            std::vector<uint32_t> vWaiting;
+            vWaiting.swap(vBusy);
+
+            std::sort(vWaiting.begin(), vWaiting.end());
+            vWaiting.erase(std::unique(vWaiting.begin(), vWaiting.end()), vWaiting.end());
+            for(const auto& nIndex : vWaiting)
+            {
+                std::shared_ptr<ProtocolType> CONNECTION = CONNECTIONS->at(nIndex);
+                if(!CONNECTION)
+                    continue;
+
+                if(CONNECTION->fPROCESSING.load())
+                {
+                    vBusy.push_back(nIndex);
+                    continue;
+                }
+
+                /* Remove a connection a worker or another thread asked to disconnect, its socket can be closed already. */
+                const uint8_t nReason = CONNECTION->nDisconnect.load();
+                if(nReason != 0)
+                {
+                    remove_connection_with_event(nIndex, nReason);
+                    continue;
+                }
+
+                if(CONNECTION->Connected())
+                    vRead.push_back(nIndex);
+            }
+
+            /* Add the connections with events. */
+            const uint32_t nSize = static_cast<uint32_t>(CONNECTIONS->size());
+            for(int32_t nEvent = 0; nEvent < nEvents; ++nEvent)
+            {
+                const epoll_event& event = vEvents[nEvent];
+
+                /* The connections workers gave back were taken from vBusy above. */
+                if(event.data.u64 == EPOLL_WAKE_EVENT)
+                {
+                    clear_wake();
+                    continue;
+                }
+
+                /* The slot is in the upper half, the socket in the lower, to skip events for a socket that has left its slot. */
+                const uint32_t nIndex = static_cast<uint32_t>(event.data.u64 >> 32);
+                const int32_t  nFile  = static_cast<int32_t>(event.data.u64 & 0xffffffff);
+                if(nIndex >= nSize)
+                    continue;
+
+                /* Access the shared pointer. */
+                std::shared_ptr<ProtocolType> CONNECTION = CONNECTIONS->at(nIndex);
+                try
+                {
+                    /* Skip over Inactive Connections. */
+                    if(!CONNECTION || !CONNECTION->Connected() || CONNECTION->fd != nFile)
+                        continue;
+
+                    /* Leave a connection to its worker, remembering a closed peer until it is done. */
+                    if(CONNECTION->fPROCESSING.load())
                     {
-                        remove_connection_with_event(nIndex, DISCONNECT::TIMEOUT);
+                        if(event.events & (EPOLLRDHUP | EPOLLHUP))
+                            vClosing.push_back(std::make_pair(nIndex, nFile));
+
+                        vBusy.push_back(nIndex);
                         continue;
                     }
 
-                    /* Disconnect if pollin signaled with no data (This happens on Linux). */
-                    if((POLLFDS.at(nIndex).revents & POLLIN)
-                    && CONNECTION->Available() == 0 && !CONNECTION->IsSSL())
+                    /* Disconnect if there was a polling error */
+                    if(event.events & EPOLLERR)
                     {
-                        remove_connection_with_event(nIndex, DISCONNECT::POLL_EMPTY);
+                        remove_connection_with_event(nIndex, DISCONNECT::POLL_ERROR);
                         continue;
                     }
 
-                    /* Disconnect if buffer is full and remote host isn't reading at all. */
-                    if(CONNECTION->Buffered()
-                    && CONNECTION->Timeout(15000, Socket::WRITE))
+                    /* Disconnect if the socket was disconnected by peer. */
+                    if(event.events & EPOLLHUP)
                     {
-                        remove_connection_with_event(nIndex, DISCONNECT::TIMEOUT_WRITE);
+                        remove_connection_with_event(nIndex, DISCONNECT::PEER);
                         continue;
                     }
 
-                    /* Check that write buffers aren't overflowed. */
-                    if(CONNECTION->Buffered() > config::GetArg("-maxsendbuffer", MAX_SEND_BUFFER))
+                    /* Disconnect if signaled with no data, which is the peer closing its end. */
+                    if((event.events & (EPOLLIN | EPOLLRDHUP))
+                    && CONNECTION->Available() == 0 && !CONNECTION->IsSSL())
                     {
-                        remove_connection_with_event(nIndex, DISCONNECT::BUFFER);
+                        remove_connection_with_event(nIndex, DISCONNECT::POLL_EMPTY);
                         continue;
                     }
 
-                    /* Handle any DDOS Filters. */
-                    if(fDDOS.load() && CONNECTION->DDOS)
-                    {
-                        /* Ban a node if it has too many Requests per Second. **/
-                        if(CONNECTION->DDOS->rSCORE.Score() > DDOS_rSCORE
-                        || CONNECTION->DDOS->cSCORE.Score() > DDOS_cSCORE)
-                            CONNECTION->DDOS->Ban();
+                    /* The peer closing fires once, so remember it until the data it sent is read. */
+                    if(event.events & EPOLLRDHUP)
+                        vClosing.push_back(std::make_pair(nIndex, nFile));
 
-                        /* Remove a connection if it was banned by DDOS Protection. */
-                        if(CONNECTION->DDOS->Banned())
-                        {
-                            debug::log(0, ProtocolType::Name(), " BANNED: ", CONNECTION->GetAddress().ToString());
-                            remove_connection_with_event(nIndex, DISCONNECT::DDOS);
-                            continue;
-                        }
+                    vRead.push_back(nIndex);
+                }
+                catch(const std::exception& e)
+                {
+                    debug::error(FUNCTION, "Data Connection: ", e.what());
+                    remove_connection_with_event(nIndex, DISCONNECT::ERRORS);
+                }
+            }
+
+            /* A connection left over can have had an event too. */
+            std::sort(vRead.begin(), vRead.end());
+            vRead.erase(std::unique(vRead.begin(), vRead.end()), vRead.end());
+
+            /* Read the connections with data. */
+            for(const auto& nIndex : vRead)
+            {
+                /* Access the shared pointer. */
+                std::shared_ptr<ProtocolType> CONNECTION = CONNECTIONS->at(nIndex);
+                try
+                {
+                    /* Skip over Inactive Connections. */
+                    if(!CONNECTION || !CONNECTION->Connected())
+                        continue;
+
+                    /* Come back once a worker is done with the connection. */
+                    if(CONNECTION->fPROCESSING.load())
+                    {
+                        vBusy.push_back(nIndex);
+                        continue;
                     }
 
-                    /* Generic event for Connection. */
-                    CONNECTION->Event(EVENTS::GENERIC);
+                    /* Remove Connection if it has Timed out or had any Errors. */
+                    if(!check_connection(nIndex, CONNECTION))
+                        continue;
 
                     /* Work on Reading a Packet. **/
-                    CONNECTION->ReadPacket();
+                    read_connection(nIndex, CONNECTION);
 
-                    /* If a Packet was received successfully, increment request count [and DDOS count if enabled]. */
-                    if(CONNECTION->PacketComplete())
-                    {
-                        /* Debug dump of message type. */
-                        if(config::nVerbose.load() >= 4)
-                            debug::log(4, FUNCTION, "Received Message (", CONNECTION->INCOMING.GetBytes().size(), " bytes)");
+                    /* Come back once a worker is done with the packet, or next iteration while there is more to read. */
+                    if(CONNECTION->fPROCESSING.load() || CONNECTION->nDisconnect.load() != 0)
+                        vBusy.push_back(nIndex);
+                    else if(CONNECTIONS->at(nIndex) == CONNECTION && CONNECTION->Connected() && CONNECTION->Available() > 0)
+                        vReady.push_back(nIndex);
+                }
+                catch(const std::exception& e)
+                {
+                    debug::error(FUNCTION, "Data Connection: ", e.what());
+                    remove_connection_with_event(nIndex, DISCONNECT::ERRORS);
+                }
+            }
 
-                        /* Debug dump of packet data. */
-                        if(config::nVerbose.load() >= 5)
-                            PrintHex(CONNECTION->INCOMING.GetBytes());
+            /* Disconnect closed peers once everything they sent is read. */
+            for(auto it = vClosing.begin(); it != vClosing.end(); )
+            {
+                std::shared_ptr<ProtocolType> CONNECTION = (it->first < CONNECTIONS->size() ? CONNECTIONS->at(it->first) : nullptr);
+                if(!CONNECTION || !CONNECTION->Connected() || CONNECTION->fd != it->second)
+                {
+                    it = vClosing.erase(it);
+                    continue;
+                }
 
-                        /* Handle Meters and DDOS. */
-                        if(fMETER)
-                            ++ProtocolType::REQUESTS;
+                /* Wait for the worker to be done with the connection. */
+                if(CONNECTION->fPROCESSING.load())
+                {
+                    ++it;
+                    continue;
+                }
 
-                        /* Increment rScore. */
-                        if(fDDOS.load() && CONNECTION->DDOS)
-                            CONNECTION->DDOS->rSCORE += 1;
+                if(CONNECTION->Available() == 0 && !CONNECTION->IsSSL())
+                {
+                    remove_connection_with_event(it->first, DISCONNECT::POLL_EMPTY);
+                    it = vClosing.erase(it);
+                    continue;
+                }
 
-                        /* Packet Process return value of False will flag Data Thread to Disconnect. */
-                        if(!CONNECTION->ProcessPacket())
-                        {
-                            remove_connection_with_event(nIndex, DISCONNECT::FORCE);
-                            continue;
-                        }
+                ++it;
+            }
 
-                        /* Run procssed event for connection triggers. */
-                        CONNECTION->Event(EVENTS::PROCESSED);
-                        CONNECTION->ResetPacket();
-                    }
+            /* Check every connection for timeouts and DDOS, and give them their generic event. */
+            if(timerSweep.ElapsedMilliseconds() < EPOLL_SWEEP_INTERVAL)
+                continue;
+
+            timerSweep.Reset();
+            for(uint32_t nIndex = 0; nIndex < nSize; ++nIndex)
+            {
+                /* Access the shared pointer. */
+                std::shared_ptr<ProtocolType> CONNECTION = CONNECTIONS->at(nIndex);
+                try
+                {
+                    /* Skip over Inactive Connections, and the ones a worker has. */
+                    if(!CONNECTION || !CONNECTION->Connected() || CONNECTION->fPROCESSING.load())
+                        continue;
+
+                    /* Remove Connection if it has Timed out or had any Errors. */
+                    if(!check_connection(nIndex, CONNECTION))
+                        continue;
+
+                    /* Generic event for Connection. */
+                    CONNECTION->Event(EVENTS::GENERIC);
                 }
                 catch(const std::exception& e)
                 {
@@ -306,6 +611,213 @@ namespace LLP
                 }
             }
         }
+#endif
+    }
+
+
+    /* Removes a connection that has errors, timed out, stopped reading its buffer, or was banned by DDOS protection. */
+    template <class ProtocolType>
+    bool DataThread<ProtocolType>::check_connection(const uint32_t nIndex, const std::shared_ptr<ProtocolType>& CONNECTION)
+    {
+        /* Remove Connection if it has Timed out or had any read/write Errors. */
+        if(CONNECTION->Errors())
+        {
+            remove_connection_with_event(nIndex, DISCONNECT::ERRORS);
+            return false;
+        }
+
+        /* Remove Connection if it has Timed out or had any Errors. */
+        if(CONNECTION->Timeout(TIMEOUT * 1000, Socket::READ))
+        {
+            remove_connection_with_event(nIndex, DISCONNECT::TIMEOUT);
+            return false;
+        }
+
+        /* Disconnect if buffer is full and remote host isn't reading at all. */
+        if(CONNECTION->Buffered()
+        && CONNECTION->Timeout(15000, Socket::WRITE))
+        {
+            remove_connection_with_event(nIndex, DISCONNECT::TIMEOUT_WRITE);
+            return false;
+        }
+
+        /* Check that write buffers aren't overflowed. */
+        if(CONNECTION->Buffered() > config::GetArg("-maxsendbuffer", MAX_SEND_BUFFER))
+        {
+            remove_connection_with_event(nIndex, DISCONNECT::BUFFER);
+            return false;
+        }
+
+        /* Handle any DDOS Filters. */
+        if(fDDOS.load() && CONNECTION->DDOS)
+        {
+            /* Ban a node if it has too many Requests per Second. **/
+            if(CONNECTION->DDOS->rSCORE.Score() > DDOS_rSCORE
+            || CONNECTION->DDOS->cSCORE.Score() > DDOS_cSCORE)
+                CONNECTION->DDOS->Ban();
+
+            /* Remove a connection if it was banned by DDOS Protection. */
+            if(CONNECTION->DDOS->Banned())
+            {
+                debug::log(0, ProtocolType::Name(), " BANNED: ", CONNECTION->GetAddress().ToString());
+                remove_connection_with_event(nIndex, DISCONNECT::DDOS);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    /* Reads from a connection, and processes the packet once complete, or hands it to a worker. */
+    template <class ProtocolType>
+    void DataThread<ProtocolType>::read_connection(const uint32_t nIndex, const std::shared_ptr<ProtocolType>& CONNECTION)
+    {
+        /* A worker has the packet of this connection still. */
+        if(CONNECTION->fPROCESSING.load())
+            return;
+
+        /* Work on Reading a Packet. **/
+        CONNECTION->ReadPacket();
+
+        /* If a Packet was received successfully, increment request count [and DDOS count if enabled]. */
+        if(CONNECTION->PacketComplete())
+        {
+            count_packet(CONNECTION);
+
+            /* Hand the packet to a worker, so this thread can go on with the other sockets. */
+            if(EXECUTOR)
+            {
+                CONNECTION->fPROCESSING = true;
+                ++nProcessing;
+
+                EXECUTOR->Submit(std::bind(&DataThread::process_connection, this, CONNECTION));
+                return;
+            }
+
+            /* Packet Process return value of False will flag Data Thread to Disconnect. */
+            if(!process_packet(CONNECTION))
+                remove_connection_with_event(nIndex, DISCONNECT::FORCE);
+        }
+    }
+
+
+    /* Counts a complete packet for the meters and DDOS protection. */
+    template <class ProtocolType>
+    void DataThread<ProtocolType>::count_packet(const std::shared_ptr<ProtocolType>& CONNECTION)
+    {
+        /* Debug dump of message type. */
+        if(config::nVerbose.load() >= 4)
+            debug::log(4, FUNCTION, "Received Message (", CONNECTION->INCOMING.GetBytes().size(), " bytes)");
+
+        /* Debug dump of packet data. */
+        if(config::nVerbose.load() >= 5)
+            PrintHex(CONNECTION->INCOMING.GetBytes());
+
+        /* Handle Meters and DDOS. */
+        if(fMETER)
+            ++ProtocolType::REQUESTS;
+
+        /* Increment rScore. */
+        if(fDDOS.load() && CONNECTION->DDOS)
+            CONNECTION->DDOS->rSCORE += 1;
+    }
+
+
+    /* Processes the complete packet of a connection. */
+    template <class ProtocolType>
+    bool DataThread<ProtocolType>::process_packet(const std::shared_ptr<ProtocolType>& CONNECTION)
+    {
+        /* Packet Process return value of False will flag Data Thread to Disconnect. */
+        if(!CONNECTION->ProcessPacket())
+            return false;
+
+        /* Run procssed event for connection triggers. */
+        CONNECTION->Event(EVENTS::PROCESSED);
+        CONNECTION->ResetPacket();
+
+        return true;
+    }
+
+
+    /* Processes a packet on a worker, along with the packets already in the receive buffer behind it. */
+    template <class ProtocolType>
+    void DataThread<ProtocolType>::process_connection(const std::shared_ptr<ProtocolType>& CONNECTION)
+    {
+        try
+        {
+            while(true)
+            {
+                /* Leave the connection for the data thread to remove, as its slot can change while on a worker. */
+                if(!process_packet(CONNECTION))
+                {
+                    CONNECTION->nDisconnect = DISCONNECT::FORCE;
+                    break;
+                }
+
+                /* Leave the socket to the data thread once the buffer runs out. */
+                if(fDestruct.load() || config::fShutdown.load() || !CONNECTION->Connected() || CONNECTION->Received() == 0)
+                    break;
+
+                CONNECTION->ReadPacket();
+                if(!CONNECTION->PacketComplete())
+                    break;
+
+                count_packet(CONNECTION);
+            }
+        }
+        catch(const std::exception& e)
+        {
+            debug::error(FUNCTION, "Data Connection: ", e.what());
+            CONNECTION->nDisconnect = DISCONNECT::ERRORS;
+        }
+
+        /* Give the connection back to the data thread. */
+        CONNECTION->fPROCESSING = false;
+        --nProcessing;
+
+        /* Wake the data thread to read it again, instead of it polling for workers being done. */
+#ifdef __linux__
+        if(nWake >= 0)
+        {
+            const uint64_t nSignal = 1;
+            if(write(nWake, &nSignal, sizeof(nSignal)) < 0 && errno != EAGAIN)
+                debug::error(FUNCTION, "failed to wake data thread: ", strerror(errno));
+        }
+#endif
+    }
+
+
+    /* Clears the signals of the wake-up eventfd. */
+    template <class ProtocolType>
+    void DataThread<ProtocolType>::clear_wake()
+    {
+#ifdef __linux__
+        uint64_t nSignals = 0;
+        if(read(nWake, &nSignals, sizeof(nSignals)) < 0 && errno != EAGAIN)
+            debug::error(FUNCTION, "failed to clear wake-up: ", strerror(errno));
+#endif
+    }
+
+
+    /* Adds the socket of a connection to the epoll interest set. */
+    template <class ProtocolType>
+    void DataThread<ProtocolType>::watch_connection(const uint32_t nIndex)
+    {
+#ifdef __linux__
+        if(nEpoll < 0)
+            return;
+
+        /* Edge-triggered, with the slot and socket to find the connection by. */
+        const int32_t nFile = CONNECTIONS->at(nIndex)->fd;
+
+        epoll_event event;
+        event.events   = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        event.data.u64 = (static_cast<uint64_t>(nIndex) << 32) | static_cast<uint32_t>(nFile);
+
+        if(epoll_ctl(nEpoll, EPOLL_CTL_ADD, nFile, &event) < 0)
+            debug::error(FUNCTION, "failed to watch socket ", nFile, ": ", strerror(errno));
+#endif
     }
 
 
@@ -364,27 +876,26 @@ namespace LLP
             if(fDestruct.load() || config::fShutdown.load())
                 return;
 
-            /* Pair to store the relay from the queue. */
-            std::pair<typename ProtocolType::message_t, DataStream> qRelay =
-                std::make_pair(typename ProtocolType::message_t(), DataStream(SER_NETWORK, MIN_PROTO_VERSION));
+            /* The relay from the queue, serialized once for every connection. */
+            std::shared_ptr<const RelayMessage<ProtocolType>> pRelay;
 
             /* Grab data from queue. */
             if(!RELAY->empty())
             {
-                /* Make a copy of the relay data. */
-                qRelay = RELAY->front();
+                pRelay = RELAY->front();
                 RELAY->pop();
             }
 
+            /* An empty message has nothing to relay. */
+            if(pRelay && pRelay->ssData.size() == 0)
+                pRelay = nullptr;
+
             /* Check all connections for data and packets. */
             uint32_t nSize = CONNECTIONS->size();
             for(uint32_t nIndex = 0; nIndex < nSize; ++nIndex)
             {
                 try
                 {
-                    /* Reset stream read position. */
-                    qRelay.second.Reset();
-
                     /* Get shared pointer to prevent race condition on the internal connection pointer. */
                     std::shared_ptr<ProtocolType> CONNECTION = CONNECTIONS->at(nIndex);
 
@@ -393,16 +904,8 @@ namespace LLP
                         continue;
 
                     /* Relay if there are active subscriptions. */
-                    const DataStream ssRelay = CONNECTION->RelayFilter(qRelay.first, qRelay.second);
-                    if(ssRelay.size() != 0)
-                    {
-                        /* Build the sender packet. */
-                        typename ProtocolType::packet_t PACKET = typename ProtocolType::packet_t(qRelay.first);
-                        PACKET.SetData(ssRelay);
-
-                        /* Write packet to socket. */
-                        CONNECTION->WritePacket(PACKET);
-                    }
+                    if(pRelay)
+                        relay_connection(CONNECTION, pRelay);
 
                     /* Attempt to flush data when buffer is available. */
                     if(CONNECTION->Buffered() && CONNECTION->Flush() < 0)
@@ -414,6 +917,42 @@ namespace LLP
     }
 
 
+    /* Writes a relay to a connection, by its subscriptions. */
+    template <class ProtocolType>
+    void DataThread<ProtocolType>::relay_connection(const std::shared_ptr<ProtocolType>& CONNECTION,
+                                                    const std::shared_ptr<const RelayMessage<ProtocolType>>& pRelay)
+    {
+        /* Write the shared packet when the connection is subscribed to the whole message. */
+        const uint32_t nSubscriptions = pRelay->nSubscriptions;
+        if(!(nSubscriptions & RELAY_FILTER))
+        {
+            const uint32_t nMatch = (CONNECTION->Notifications() & nSubscriptions);
+            if(nMatch == nSubscriptions)
+            {
+                CONNECTION->WritePacket(pRelay->pBytes);
+                return;
+            }
+
+            /* Skip the connection when it isn't subscribed to any of it. */
+            if(nMatch == 0)
+                return;
+        }
+
+        /* Filter the message for this connection, from a copy of the stream since reading it moves its position. */
+        const DataStream ssData(pRelay->ssData);
+        const DataStream ssRelay = CONNECTION->RelayFilter(pRelay->MESSAGE, ssData);
+        if(ssRelay.size() != 0)
+        {
+            /* Build the sender packet. */
+            typename ProtocolType::packet_t PACKET = typename ProtocolType::packet_t(pRelay->MESSAGE);
+            PACKET.SetData(ssRelay);
+
+            /* Write packet to socket. */
+            CONNECTION->WritePacket(PACKET);
+        }
+    }
+
+
     /* Tell the data thread an event has occured and notify each connection. */
     template<class ProtocolType>
     void DataThread<ProtocolType>::NotifyEvent()
@@ -471,6 +1010,12 @@ namespace LLP
         else
             --nOutbound;
 
+#ifdef __linux__
+        /* Stop watching the socket, a closed one has left the interest set already. */
+        if(nEpoll >= 0 && CONNECTIONS->at(nIndex)->Connected())
+            epoll_ctl(nEpoll, EPOLL_CTL_DEL, CONNECTIONS->at(nIndex)->fd, nullptr);
+#endif
+
         /* Free the memory and notify threads. */
         CONNECTIONS->at(nIndex) = nullptr;
         CONDITION.notify_all();
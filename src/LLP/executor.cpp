@@ -0,0 +1,180 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#include <LLP/include/executor.h>
+
+#include <Util/include/debug.h>
+
+namespace LLP
+{
+
+    /* The executor and worker index of the current thread, for tasks submitted from a worker. */
+    thread_local Executor* pExecutorCurrent = nullptr;
+    thread_local uint32_t  nWorkerCurrent   = 0;
+
+
+    /* Constructor */
+    Executor::Executor(const uint32_t nThreads)
+    : vWorkers        ( )
+    , CONDITION_MUTEX ( )
+    , CONDITION       ( )
+    , nPending        (0)
+    , nNext           (0)
+    , fStop           (false)
+    {
+        /* Create every queue before any worker can steal from them. */
+        for(uint32_t nID = 0; nID < nThreads; ++nID)
+            vWorkers.push_back(new Worker());
+
+        for(uint32_t nID = 0; nID < nThreads; ++nID)
+            vWorkers[nID]->THREAD = std::thread(std::bind(&Executor::worker, this, nID));
+    }
+
+
+    /* Default Destructor. */
+    Executor::~Executor()
+    {
+        Stop();
+
+        for(auto& pWorker : vWorkers)
+            delete pWorker;
+
+        vWorkers.clear();
+    }
+
+
+    /* Queues a task to a worker. */
+    void Executor::Submit(const std::function<void()>& task)
+    {
+        /* Run the task in place once there are no workers to run it. */
+        if(fStop.load() || vWorkers.empty())
+        {
+            task();
+            return;
+        }
+
+        /* Keep a task from a worker on that worker, and spread the others. */
+        uint32_t nID = 0;
+        if(pExecutorCurrent == this)
+            nID = nWorkerCurrent;
+        else
+            nID = nNext++ % vWorkers.size();
+
+        /* Count the task first, so a worker never takes one that isn't counted. */
+        {
+            std::unique_lock<std::mutex> CONDITION_LOCK(CONDITION_MUTEX);
+            ++nPending;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(vWorkers[nID]->MUTEX);
+            vWorkers[nID]->queueTasks.push_back(task);
+        }
+
+        CONDITION.notify_one();
+    }
+
+
+    /* Stops and joins the workers, dropping the tasks they didn't take. */
+    void Executor::Stop()
+    {
+        {
+            std::unique_lock<std::mutex> CONDITION_LOCK(CONDITION_MUTEX);
+            fStop = true;
+        }
+        CONDITION.notify_all();
+
+        for(auto& pWorker : vWorkers)
+        {
+            if(pWorker->THREAD.joinable())
+                pWorker->THREAD.join();
+
+            std::unique_lock<std::mutex> lock(pWorker->MUTEX);
+            pWorker->queueTasks.clear();
+        }
+    }
+
+
+    /* Returns the number of worker threads. */
+    uint32_t Executor::Size() const
+    {
+        return static_cast<uint32_t>(vWorkers.size());
+    }
+
+
+    /* Runs the tasks of a worker, and the ones it steals, until stopped. */
+    void Executor::worker(const uint32_t nID)
+    {
+        pExecutorCurrent = this;
+        nWorkerCurrent   = nID;
+
+        while(!fStop.load())
+        {
+            /* Run the next task there is. */
+            std::function<void()> task;
+            if(take_task(nID, task))
+            {
+                try
+                {
+                    task();
+                }
+                catch(const std::exception& e)
+                {
+                    debug::error(FUNCTION, "Executor Worker ", nID, ": ", e.what());
+                }
+
+                continue;
+            }
+
+            /* Sleep until there are tasks again. */
+            std::unique_lock<std::mutex> CONDITION_LOCK(CONDITION_MUTEX);
+            CONDITION.wait(CONDITION_LOCK,
+            [this]
+            {
+                return fStop.load() || nPending.load() > 0;
+            });
+        }
+    }
+
+
+    /* Takes the next task of a worker, or steals one from the others. */
+    bool Executor::take_task(const uint32_t nID, std::function<void()> &task)
+    {
+        const uint32_t nWorkers = static_cast<uint32_t>(vWorkers.size());
+        for(uint32_t nOffset = 0; nOffset < nWorkers; ++nOffset)
+        {
+            Worker* pWorker = vWorkers[(nID + nOffset) % nWorkers];
+
+            std::unique_lock<std::mutex> lock(pWorker->MUTEX);
+            if(pWorker->queueTasks.empty())
+                continue;
+
+            /* Run our own tasks in the order they came, and steal the newest of the others. */
+            if(nOffset == 0)
+            {
+                task = std::move(pWorker->queueTasks.front());
+                pWorker->queueTasks.pop_front();
+            }
+            else
+            {
+                task = std::move(pWorker->queueTasks.back());
+                pWorker->queueTasks.pop_back();
+            }
+
+            --nPending;
+            return true;
+        }
+
+        return false;
+    }
+}
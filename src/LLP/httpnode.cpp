@@ -66,14 +66,14 @@ namespace LLP
     {
         if(!INCOMING.Complete())
         {
-            /* Handle Reading Data into Buffer. */
-            uint32_t nAvailable = Available();
-            if(nAvailable > 0)
-            {                
-                std::vector<int8_t> vchData(nAvailable);
-                int nRead = Read(vchData, nAvailable);
-                if(nRead > 0)
-                    vchBuffer.insert(vchBuffer.end(), vchData.begin(), vchData.begin() + nRead);
+            /* Handle Reading Data into Buffer, with one read of whatever the socket has. */
+            Fill();
+
+            const uint32_t nRead = Received();
+            if(nRead > 0)
+            {
+                vchBuffer.insert(vchBuffer.end(), Peek(), Peek() + nRead);
+                Consume(nRead);
             }
 
             /* If waiting for buffer data, don't try to parse. */
@@ -0,0 +1,153 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLP_INCLUDE_EXECUTOR_H
+#define NEXUS_LLP_INCLUDE_EXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace LLP
+{
+
+    /** Executor
+     *
+     *  A pool of worker threads that run the packets framed by the data threads
+     *  of a server, so a slow packet doesn't hold up the other sockets.
+     *
+     *  Each worker has a queue of its own that it runs from the front of. A
+     *  worker with nothing queued steals from the back of the others before
+     *  it goes to sleep.
+     *
+     **/
+    class Executor
+    {
+        /** Worker
+         *
+         *  The queue and thread of one worker.
+         *
+         **/
+        struct Worker
+        {
+            /** The mutex for the queue. **/
+            std::mutex MUTEX;
+
+
+            /** The tasks queued to this worker. **/
+            std::deque<std::function<void()>> queueTasks;
+
+
+            /** The worker thread. **/
+            std::thread THREAD;
+        };
+
+
+        /** The workers of this executor. **/
+        std::vector<Worker*> vWorkers;
+
+
+        /** The mutex for the condition. **/
+        std::mutex CONDITION_MUTEX;
+
+
+        /** The condition for sleeping workers. **/
+        std::condition_variable CONDITION;
+
+
+        /** The tasks queued and not yet taken by a worker. **/
+        std::atomic<uint64_t> nPending;
+
+
+        /** The next worker to queue a task to from outside of the executor. **/
+        std::atomic<uint32_t> nNext;
+
+
+        /** Flag to stop the workers. **/
+        std::atomic<bool> fStop;
+
+
+    public:
+
+        /** Constructor
+         *
+         *  @param[in] nThreads The number of worker threads.
+         *
+         **/
+        Executor(const uint32_t nThreads);
+
+
+        /** Default Destructor. **/
+        ~Executor();
+
+
+        /** Submit
+         *
+         *  Queues a task to a worker. A task submitted from a worker is queued
+         *  to that worker, and one submitted once stopped is run in place.
+         *
+         *  @param[in] task The task to run.
+         *
+         **/
+        void Submit(const std::function<void()>& task);
+
+
+        /** Stop
+         *
+         *  Stops and joins the workers, dropping the tasks they didn't take.
+         *
+         **/
+        void Stop();
+
+
+        /** Size
+         *
+         *  Returns the number of worker threads.
+         *
+         **/
+        uint32_t Size() const;
+
+
+    private:
+
+        /** worker
+         *
+         *  Runs the tasks of a worker, and the ones it steals, until stopped.
+         *
+         *  @param[in] nID The index of the worker.
+         *
+         **/
+        void worker(const uint32_t nID);
+
+
+        /** take_task
+         *
+         *  Takes the next task of a worker, or steals one from the others.
+         *
+         *  @param[in] nID The index of the worker.
+         *  @param[out] task The task taken.
+         *
+         *  @return True if a task was taken.
+         *
+         **/
+        bool take_task(const uint32_t nID, std::function<void()> &task);
+    };
+}
+
+#endif
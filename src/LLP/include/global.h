@@ -174,6 +174,9 @@ namespace LLP
         /* The total data I/O threads. */
         config.nMaxThreads = static_cast<uint16_t>(config::GetArg(std::string("-threads"), 8));
 
+        /* The worker threads for processing packets (default: 0, on the data threads). */
+        config.nWorkerThreads = static_cast<uint16_t>(config::GetArg(std::string("-workerthreads"), 0));
+
         /* The timeout value (default: 30 seconds). */
         config.nTimeout = static_cast<uint32_t>(config::GetArg(std::string("-timeout"), 120));
 
@@ -60,6 +60,10 @@ namespace LLP
 
         /** Max number of data threads this server should use **/
         uint16_t nMaxThreads;
+
+
+        /** Number of worker threads to process packets on, or 0 to process them on the data threads **/
+        uint16_t nWorkerThreads;
         
 
         /** The timeout to set on new socket connections **/
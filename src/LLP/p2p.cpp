@@ -610,41 +610,44 @@ namespace LLP
         if(!INCOMING.Complete())
         {
             /** Handle Reading Packet Length Header. **/
-            if(!INCOMING.Header() && Available() >= 8)
+            if(!INCOMING.Header())
             {
-                std::vector<uint8_t> BYTES(8, 0);
-                if(Read(BYTES, 8) == 8)
+                /* Read what the socket has in one call, then frame the packet out of the receive buffer. */
+                if(Received() < 8)
+                    Fill();
+
+                if(Received() >= 8)
                 {
-                    DataStream ssHeader(BYTES, SER_NETWORK, MIN_PROTO_VERSION);
+                    DataStream ssHeader((const char*)Peek(), (const char*)Peek() + 8, SER_NETWORK, MIN_PROTO_VERSION);
                     ssHeader >> INCOMING;
+                    Consume(8);
 
                     Event(EVENTS::HEADER);
                 }
             }
 
             /** Handle Reading Packet Data. **/
-            uint32_t nAvailable = Available();
-            if(INCOMING.Header() && nAvailable > 0 && !INCOMING.IsNull() && INCOMING.DATA.size() < INCOMING.LENGTH)
+            if(INCOMING.Header() && !INCOMING.IsNull() && INCOMING.DATA.size() < INCOMING.LENGTH)
             {
-                /* The maximum number of bytes to read is th number of bytes specified in the message length, 
+                /* The maximum number of bytes to read is th number of bytes specified in the message length,
                    minus any already read on previous reads*/
                 uint32_t nMaxRead = (uint32_t)(INCOMING.LENGTH - INCOMING.DATA.size());
-                
-                /* Vector to receve the read bytes. This should be the smaller of the number of bytes currently available or the
-                   maximum amount to read */
-                std::vector<uint8_t> DATA(std::min(nAvailable, nMaxRead), 0);
 
-                /* Read up to the buffer size. */
-                int32_t nRead = Read(DATA, DATA.size()); 
-                
-                /* If something was read, insert it into the packet data.  NOTE: that due to SSL packet framing we could end up 
-                   reading less bytes than appear available.  Therefore we only copy the number of bytes actually read */
+                /* Only go to the socket when the buffer doesn't already hold the rest of the packet. */
+                if(Received() < nMaxRead)
+                    Fill();
+
+                /* Copy straight out of the receive buffer into the packet data. */
+                uint32_t nRead = std::min(Received(), nMaxRead);
                 if(nRead > 0)
-                    INCOMING.DATA.insert(INCOMING.DATA.end(), DATA.begin(), DATA.begin() + nRead);
-                    
-                /* If the packet is now considered complete, fire the packet complete event */
-                if(INCOMING.Complete())
-                    Event(EVENTS::PACKET, static_cast<uint32_t>(DATA.size()));
+                {
+                    INCOMING.DATA.insert(INCOMING.DATA.end(), Peek(), Peek() + nRead);
+                    Consume(nRead);
+
+                    /* If the packet is now considered complete, fire the packet complete event */
+                    if(INCOMING.Complete())
+                        Event(EVENTS::PACKET, nRead);
+                }
             }
         }
     }
@@ -246,7 +246,11 @@ namespace LLP
             DataStream ssHeader(SER_NETWORK, MIN_PROTO_VERSION);
             ssHeader << *this;
 
-            std::vector<uint8_t> vBytes(ssHeader.begin(), ssHeader.end());
+            /* Size the packet once so the payload is copied a single time. */
+            std::vector<uint8_t> vBytes;
+            vBytes.reserve(ssHeader.size() + DATA.size());
+
+            vBytes.insert(vBytes.end(), ssHeader.begin(), ssHeader.end());
             vBytes.insert(vBytes.end(), DATA.begin(), DATA.end());
 
             return vBytes;
@@ -201,6 +201,8 @@ namespace LLP
 
             if(HEADER < 128) /* Handle for Data Packets. */
             {
+                BYTES.reserve(5 + DATA.size());
+
                 BYTES.push_back(static_cast<uint8_t>(LENGTH >> 24));
                 BYTES.push_back(static_cast<uint8_t>(LENGTH >> 16));
                 BYTES.push_back(static_cast<uint8_t>(LENGTH >> 8));
@@ -12,6 +12,7 @@
 ____________________________________________________________________________________________*/
 
 #include <LLP/templates/server.h>
+#include <LLP/include/executor.h>
 #include <LLP/templates/data.h>
 #include <LLP/templates/ddos.h>
 #include <LLP/include/network.h>
@@ -76,6 +77,7 @@ namespace LLP
     , SSL_UPNP_THREAD   ( )
     , MANAGER_THREAD    ( )
     , pAddressManager   (nullptr)
+    , pExecutor         (config.nWorkerThreads > 0 ? new Executor(config.nWorkerThreads) : nullptr)
     , nSleepTime        (config.nManagerInterval)
     , nMaxIncoming      (config.nMaxIncoming)
     , nMaxConnections   (config.nMaxConnections)
@@ -85,7 +87,7 @@ namespace LLP
         for(uint16_t nIndex = 0; nIndex < MAX_THREADS; ++nIndex)
         {
             DATA_THREADS.push_back(new DataThread<ProtocolType>(
-                nIndex, config.fDDOS, config.nDDOSRScore, config.nDDOSCScore, config.nTimeout, config.fMeter));
+                nIndex, config.fDDOS, config.nDDOSRScore, config.nDDOSCScore, config.nTimeout, config.fMeter, pExecutor));
         }
 
         /* Initialize the address manager. */
@@ -159,6 +161,10 @@ namespace LLP
         if(SSL_LISTEN_THREAD.joinable())
             SSL_LISTEN_THREAD.join();
 
+        /* Stop the workers, so none is left on a data thread being deleted. */
+        if(pExecutor)
+            pExecutor->Stop();
+
         /* Delete the data threads. */
         for(uint16_t nIndex = 0; nIndex < MAX_THREADS; ++nIndex)
         {
@@ -166,6 +172,13 @@ namespace LLP
             DATA_THREADS[nIndex] = nullptr;
         }
 
+        /* Delete the workers. */
+        if(pExecutor)
+        {
+            delete pExecutor;
+            pExecutor = nullptr;
+        }
+
         /* Delete the DDOS entries. */
         for(auto it = DDOS_MAP->begin(); it != DDOS_MAP->end(); ++it)
         {
@@ -29,6 +29,7 @@ namespace LLP
     , nMaxIncoming  (std::numeric_limits<uint32_t>::max())
     , nMaxConnections(std::numeric_limits<uint32_t>::max())
     , nMaxThreads   (1)
+    , nWorkerThreads(0)
     , nTimeout      (30)
     , fMeter        (false)
     , fDDOS         (false)
@@ -11,6 +11,8 @@
 
 ____________________________________________________________________________________________*/
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <stdio.h>
@@ -24,6 +26,7 @@ ________________________________________________________________________________
 #ifndef WIN32
 #include <arpa/inet.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #endif
 
 #include <openssl/ssl.h>
@@ -42,8 +45,13 @@ namespace LLP
     , nLastSend          (0)
     , nLastRecv          (0)
     , nError             (0)
-    , vBuffer            ( )
+    , queueSend          ( )
+    , nSendOffset        (0)
+    , nBuffered          (0)
     , fBufferFull        (false)
+    , vRecvBuffer        ( )
+    , nRecvBegin         (0)
+    , nRecvEnd           (0)
     , nConsecutiveErrors (0)
     , addr               ( )
     {
@@ -64,8 +72,13 @@ namespace LLP
     , nLastSend          (socket.nLastSend.load())
     , nLastRecv          (socket.nLastRecv.load())
     , nError             (socket.nError.load())
-    , vBuffer            (socket.vBuffer)
+    , queueSend          (socket.queueSend)
+    , nSendOffset        (socket.nSendOffset)
+    , nBuffered          (socket.nBuffered.load())
     , fBufferFull        (socket.fBufferFull.load())
+    , vRecvBuffer        (socket.vRecvBuffer)
+    , nRecvBegin         (socket.nRecvBegin)
+    , nRecvEnd           (socket.nRecvEnd)
     , nConsecutiveErrors (socket.nConsecutiveErrors.load())
     , addr               (socket.addr)
     {
@@ -98,8 +111,13 @@ namespace LLP
     , nLastSend          (0)
     , nLastRecv          (0)
     , nError             (0)
-    , vBuffer            ( )
+    , queueSend          ( )
+    , nSendOffset        (0)
+    , nBuffered          (0)
     , fBufferFull        (false)
+    , vRecvBuffer        ( )
+    , nRecvBegin         (0)
+    , nRecvEnd           (0)
     , nConsecutiveErrors (0)
     , addr               (addrIn)
     {
@@ -215,8 +233,13 @@ namespace LLP
     , nLastSend          (0)
     , nLastRecv          (0)
     , nError             (0)
-    , vBuffer            ( )
+    , queueSend          ( )
+    , nSendOffset        (0)
+    , nBuffered          (0)
     , fBufferFull        (false)
+    , vRecvBuffer        ( )
+    , nRecvBegin         (0)
+    , nRecvEnd           (0)
     , nConsecutiveErrors (0)
     , addr               ( )
     {
@@ -518,8 +541,11 @@ namespace LLP
     /* Poll the socket to check for available data */
     int Socket::Available() const
     {
-        LOCK(SOCKET_MUTEX);
+        /* Bytes already in the receive buffer don't need the kernel to be asked. */
+        if(nRecvEnd > nRecvBegin)
+            return static_cast<int32_t>(nRecvEnd - nRecvBegin);
 
+        LOCK(SOCKET_MUTEX);
 
     #ifdef WIN32
         long unsigned int nAvailable = 0;
@@ -575,283 +601,232 @@ namespace LLP
 
         fd = INVALID_SOCKET;
 
-
+        /* Anything left unread belonged to the closed connection. */
+        nRecvBegin = 0;
+        nRecvEnd   = 0;
     }
 
 
     /* Read data from the socket buffer non-blocking */
     int Socket::Read(std::vector<uint8_t> &vData, size_t nBytes)
     {
-        LOCK(SOCKET_MUTEX);
-
-        /* Reset the error status */
-        nError.store(0);
-
-        int32_t nRead = 0;
-
-        if(pSSL)
-            nRead = SSL_read(pSSL, (int8_t*)&vData[0], nBytes);
-        else
+        /* Serve what was already read into the receive buffer first. */
+        if(nRecvEnd > nRecvBegin)
         {
-        #ifdef WIN32
-            nRead = static_cast<int32_t>(recv(fd, (char*)&vData[0], nBytes, MSG_DONTWAIT));
-        #else
-            nRead = static_cast<int32_t>(recv(fd, (int8_t*)&vData[0], nBytes, MSG_DONTWAIT));
-        #endif
-        }
-
-        if (nRead <= 0)
-        {
-            if(pSSL)
-            {
-                int nSSLError = SSL_get_error(pSSL, nRead);
-
-                switch (nSSLError)
-                {
-                    case SSL_ERROR_NONE:
-                    {
-                        // no real error, just try again...
-                        break;
-                    }
-
-                    case SSL_ERROR_SSL:
-                    {
-                        // peer disconnected...
-                        debug::error(FUNCTION, "Peer disconnected." );
-                        nError.store(ERR_get_error());
-                        break;
-                    }
-
-                    case SSL_ERROR_ZERO_RETURN:
-                    {
-                        // peer disconnected...
-                        debug::error(FUNCTION, "Peer disconnected." );
-                        nError.store(ERR_get_error());
-                        break;
-                    }
-
-                    case SSL_ERROR_WANT_READ:
-                    {
-                        // no data available right now as it needs to read more from the underlying socket
-                        break;
-                    }
+            const uint32_t nRead = std::min(static_cast<uint32_t>(nBytes), nRecvEnd - nRecvBegin);
+            std::copy(&vRecvBuffer[nRecvBegin], &vRecvBuffer[nRecvBegin] + nRead, vData.begin());
+            Consume(nRead);
 
-                    case SSL_ERROR_WANT_WRITE:
-                    {
-                        // socket not writable right now, wait and try again
-                        break;
-                    }
-
-                    default:
-                    {
-                        nError.store(ERR_get_error());
-                        break;
-                    }
-                }
-
-                /* Check if an error occurred before logging */
-                if(nError.load() > 0)
-                    debug::log(3, FUNCTION, "SSL_read failed ",  addr.ToString(), " (", nError, " ", ERR_reason_error_string(nError), ")");
-
-            }
-            else
-            {
-                nError = WSAGetLastError();
-                debug::log(3, FUNCTION, "read failed ", addr.ToString(), " (", nError, " ", strerror(nError), ")");
-            }
+            return static_cast<int32_t>(nRead);
         }
-        else if(nRead > 0)
-            nLastRecv = runtime::timestamp(true);
 
-        return nRead;
+        return read_socket(&vData[0], nBytes);
     }
 
 
     /* Read data from the socket buffer non-blocking */
     int32_t Socket::Read(std::vector<int8_t> &vData, size_t nBytes)
     {
-        LOCK(SOCKET_MUTEX);
+        /* Serve what was already read into the receive buffer first. */
+        if(nRecvEnd > nRecvBegin)
+        {
+            const uint32_t nRead = std::min(static_cast<uint32_t>(nBytes), nRecvEnd - nRecvBegin);
+            std::copy(&vRecvBuffer[nRecvBegin], &vRecvBuffer[nRecvBegin] + nRead, vData.begin());
+            Consume(nRead);
 
-        /* Reset the error status */
-        nError.store(0);
+            return static_cast<int32_t>(nRead);
+        }
 
-        int32_t nRead = 0;
+        return read_socket((uint8_t*)&vData[0], nBytes);
+    }
 
-        if(pSSL)
-            nRead = SSL_read(pSSL, (int8_t*)&vData[0], nBytes);
-        else
+
+    /* Read as much as the socket has into the receive buffer with a single call. */
+    int32_t Socket::Fill()
+    {
+        /* The buffer is only allocated once the connection has something to read. */
+        if(vRecvBuffer.size() != RECV_BUFFER_SIZE)
+            vRecvBuffer.resize(RECV_BUFFER_SIZE);
+
+        /* Move a partial packet left over to the front, so the free space is in one piece. */
+        if(nRecvBegin > 0)
         {
-        #ifdef WIN32
-            nRead = static_cast<int32_t>(recv(fd, (char*)&vData[0], nBytes, MSG_DONTWAIT));
-        #else
-            nRead = static_cast<int32_t>(recv(fd, (int8_t*)&vData[0], nBytes, MSG_DONTWAIT));
-        #endif
+            if(nRecvEnd > nRecvBegin)
+                std::memmove(&vRecvBuffer[0], &vRecvBuffer[nRecvBegin], nRecvEnd - nRecvBegin);
+
+            nRecvEnd  -= nRecvBegin;
+            nRecvBegin = 0;
         }
 
+        /* Nothing to do if the buffer is full. */
+        if(nRecvEnd == RECV_BUFFER_SIZE)
+            return 0;
 
-        if (nRead < 0)
-        {
-            if(pSSL)
-            {
-                int nSSLError = SSL_get_error(pSSL, nRead);
+        /* Read into the free space. */
+        const int32_t nRead = read_socket(&vRecvBuffer[nRecvEnd], RECV_BUFFER_SIZE - nRecvEnd);
+        if(nRead > 0)
+            nRecvEnd += static_cast<uint32_t>(nRead);
 
-                switch (nSSLError)
-                {
-                    case SSL_ERROR_NONE:
-                    {
-                        // no real error, just try again...
-                        break;
-                    }
+        return nRead;
+    }
 
-                    case SSL_ERROR_SSL:
-                    {
-                        // peer disconnected...
-                        debug::error(FUNCTION, "Peer disconnected." );
-                        nError.store(ERR_get_error());
-                        break;
-                    }
 
-                    case SSL_ERROR_ZERO_RETURN:
-                    {
-                        // peer disconnected...
-                        debug::error(FUNCTION, "Peer disconnected." );
-                        nError.store(ERR_get_error());
-                        break;
-                    }
+    /* Get the bytes in the receive buffer that haven't been consumed. */
+    uint32_t Socket::Received() const
+    {
+        return nRecvEnd - nRecvBegin;
+    }
 
-                    case SSL_ERROR_WANT_READ:
-                    {
-                        // no data available right now as it needs to read more from the underlying socket
-                        break;
-                    }
 
-                    case SSL_ERROR_WANT_WRITE:
-                    {
-                        // socket not writable right now, wait and try again
-                        break;
-                    }
+    /* Get the first unconsumed byte in the receive buffer. */
+    const uint8_t* Socket::Peek() const
+    {
+        return vRecvBuffer.data() + nRecvBegin;
+    }
 
-                    default:
-                    {
-                        nError.store(ERR_get_error());
-                        break;
-                    }
-                }
 
-                /* Check if an error occurred before logging */
-                if(nError.load() > 0)
-                    debug::log(3, FUNCTION, "SSL_read failed ",  addr.ToString(), " (", nError, " ", ERR_reason_error_string(nError), ")");
+    /* Remove bytes from the front of the receive buffer. */
+    void Socket::Consume(const uint32_t nBytes)
+    {
+        nRecvBegin += std::min(nBytes, nRecvEnd - nRecvBegin);
 
-            }
-            else
-            {
-                nError = WSAGetLastError();
-                debug::log(3, FUNCTION, "read failed ",  addr.ToString(), " (", nError, " ", strerror(nError), ")");
-            }
+        /* Start from the front again once everything is consumed. */
+        if(nRecvBegin == nRecvEnd)
+        {
+            nRecvBegin = 0;
+            nRecvEnd   = 0;
         }
-        else if(nRead > 0)
-            nLastRecv = runtime::timestamp(true);
-
-        return nRead;
     }
 
 
     /* Write data into the socket buffer non-blocking */
     int32_t Socket::Write(const std::vector<uint8_t>& vData, size_t nBytes)
     {
-        int32_t nSent = 0;
+        LOCK(DATA_MUTEX);
 
+        /* Data already queued goes out first, so queue behind it. */
+        if(!queueSend.empty())
         {
-            LOCK(DATA_MUTEX);
-
-            /* Check overflow buffer. */
-            if(vBuffer.size() > 0)
-            {
-                debug::log(3, FUNCTION, "vBuffer ", vBuffer.size(), " bytes");
+            debug::log(3, FUNCTION, "queueSend ", nBuffered.load(), " bytes");
 
-                vBuffer.insert(vBuffer.end(), vData.begin(), vData.end());
+            queue_send(std::make_shared<const std::vector<uint8_t>>(vData.begin(), vData.begin() + nBytes));
 
-                return static_cast<int32_t>(nBytes);
-            }
+            return static_cast<int32_t>(nBytes);
         }
 
         /* Write the packet. */
-        {
-            LOCK(SOCKET_MUTEX);
+        int32_t nSent = send_socket(&vData[0], nBytes);
 
-            if(pSSL)
-                nSent = static_cast<int32_t>(SSL_write(pSSL, (int8_t*)&vData[0], nBytes));
-            else
-            {
-            #ifdef WIN32
-                nSent = static_cast<int32_t>(send(fd, (char*)&vData[0], nBytes, MSG_NOSIGNAL | MSG_DONTWAIT));
-            #else
-                nSent = static_cast<int32_t>(send(fd, (int8_t*)&vData[0], nBytes, MSG_NOSIGNAL | MSG_DONTWAIT));
-            #endif
-            }
-        }
+        /* If not all data was sent non-blocking, queue what is left to be flushed. */
+        if(nSent >= 0 && nSent != static_cast<int32_t>(nBytes))
+            queue_send(std::make_shared<const std::vector<uint8_t>>(vData.begin() + nSent, vData.begin() + nBytes));
 
+        return nSent;
+    }
 
-        /* Handle for error state. */
-        if(nSent < 0)
-        {
-            if(pSSL)
-                nError = SSL_get_error(pSSL, nSent);
-            else
-                nError = WSAGetLastError();
-        }
 
-        /* If not all data was sent non-blocking, recurse until it is complete. */
-        else if(nSent != vData.size())
+    /* Write shared data into the socket buffer non-blocking. */
+    int32_t Socket::Write(const std::shared_ptr<const std::vector<uint8_t>>& pData)
+    {
+        LOCK(DATA_MUTEX);
+
+        /* Data already queued goes out first, so queue behind it. */
+        if(!queueSend.empty())
         {
-            LOCK(DATA_MUTEX);
-            vBuffer.insert(vBuffer.end(), vData.begin() + nSent, vData.end());
+            queue_send(pData);
+
+            return static_cast<int32_t>(pData->size());
         }
-        else //don't update last sent unless all the data was written to the buffer
-            nLastSend = runtime::timestamp(true);
+
+        /* Write the packet. */
+        int32_t nSent = send_socket(pData->data(), pData->size());
+
+        /* Queue the remainder by reference rather than copying it. */
+        if(nSent >= 0 && nSent != static_cast<int32_t>(pData->size()))
+            queue_send(pData, static_cast<uint32_t>(nSent));
 
         return nSent;
     }
 
 
-    /* Flushes data out of the overflow buffer */
+    /* Flushes data out of the send queue, gathering its segments into a single write. */
     int Socket::Flush()
     {
-        int32_t nSent   = 0;
-        uint32_t nBytes = 0;
-        uint32_t nSize  = 0;
-
-        {
-            LOCK(DATA_MUTEX);
-            nSize = static_cast<uint32_t>(vBuffer.size());
-        }
+        LOCK(DATA_MUTEX);
 
         /* Don't flush if buffer doesn't have any data. */
-        if(nSize == 0)
+        if(queueSend.empty())
             return 0;
 
         /* maximum transmission unit. */
         const uint32_t MTU = 16384;
 
         /* Set the maximum bytes to flush to 2^16 or maximum socket buffers. */
-        nBytes = std::min(nSize, std::min((uint32_t)config::GetArg("-maxsendsize", MTU), MTU));
+        const uint32_t nMax = std::min((uint32_t)config::GetArg("-maxsendsize", MTU), MTU);
 
-        /* If there were any errors, handle them gracefully. */
+        int32_t nSent = 0;
+        if(pSSL)
         {
-            LOCK2(DATA_MUTEX);
-            LOCK(SOCKET_MUTEX);
+            /* TLS can't gather, so write the segments one after another up to the maximum. */
+            uint32_t nOffset = nSendOffset;
+            for(auto it = queueSend.begin(); it != queueSend.end() && static_cast<uint32_t>(nSent) < nMax; ++it)
+            {
+                const uint32_t nBytes = std::min(static_cast<uint32_t>((*it)->size()) - nOffset, nMax - nSent);
 
-            if(pSSL)
-                nSent = static_cast<int32_t>(SSL_write(pSSL, (int8_t *)&vBuffer[0], nBytes));
-            else
+                int32_t nWrite = 0;
+                {
+                    LOCK(SOCKET_MUTEX);
+                    nWrite = static_cast<int32_t>(SSL_write(pSSL, (*it)->data() + nOffset, nBytes));
+                }
+
+                /* Keep what was written so far, the error is picked up on the next flush. */
+                if(nWrite <= 0)
+                {
+                    if(nSent == 0)
+                        nSent = nWrite;
+
+                    break;
+                }
+
+                nSent  += nWrite;
+                nOffset = 0;
+            }
+        }
+        else
+        {
+        #ifdef WIN32
+            /* Send the first segment. */
+            const uint32_t nBytes = std::min(static_cast<uint32_t>(queueSend.front()->size()) - nSendOffset, nMax);
             {
-            #ifdef WIN32
-                nSent = static_cast<int32_t>(send(fd, (char*)&vBuffer[0], nBytes, MSG_NOSIGNAL | MSG_DONTWAIT));
-            #else
-                nSent = static_cast<int32_t>(send(fd, (int8_t*)&vBuffer[0], nBytes, MSG_NOSIGNAL | MSG_DONTWAIT));
-            #endif
+                LOCK(SOCKET_MUTEX);
+                nSent = static_cast<int32_t>(send(fd, (char*)queueSend.front()->data() + nSendOffset, nBytes, MSG_NOSIGNAL | MSG_DONTWAIT));
+            }
+        #else
+            /* Gather the segments up to the maximum into one write. */
+            struct iovec vIO[MAX_SEND_SEGMENTS];
+
+            uint32_t nSegments = 0, nBytes = 0, nOffset = nSendOffset;
+            for(auto it = queueSend.begin(); it != queueSend.end() && nSegments < MAX_SEND_SEGMENTS && nBytes < nMax; ++it)
+            {
+                vIO[nSegments].iov_base = (void*)((*it)->data() + nOffset);
+                vIO[nSegments].iov_len  = std::min(static_cast<uint32_t>((*it)->size()) - nOffset, nMax - nBytes);
+
+                nBytes += static_cast<uint32_t>(vIO[nSegments].iov_len);
+                nOffset = 0;
+
+                ++nSegments;
             }
 
+            struct msghdr msg;
+            std::memset(&msg, 0, sizeof(msg));
+            msg.msg_iov    = vIO;
+            msg.msg_iovlen = nSegments;
+
+            {
+                LOCK(SOCKET_MUTEX);
+                nSent = static_cast<int32_t>(sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT));
+            }
+        #endif
         }
 
         /* Handle errors on flush. */
@@ -868,10 +843,8 @@ namespace LLP
         /* If not all data was sent non-blocking, recurse until it is complete. */
         else if(nSent > 0)
         {
-            LOCK(DATA_MUTEX);
-
-            /* Erase from current buffer. */
-            vBuffer.erase(vBuffer.begin(), vBuffer.begin() + nSent);
+            /* Drop the segments that were sent. */
+            consume_send(static_cast<uint32_t>(nSent));
 
             /* Update socket timers. */
             nLastSend          = runtime::timestamp(true);
@@ -904,7 +877,7 @@ namespace LLP
     /* Check that the socket has data that is buffered. */
     uint64_t Socket::Buffered() const
     {
-        return vBuffer.size();
+        return nBuffered.load();
     }
 
 
@@ -957,6 +930,166 @@ namespace LLP
         return nError;
     }
 
+
+    /* Read data from the socket non-blocking, recording any error. */
+    int32_t Socket::read_socket(uint8_t* pData, const size_t nBytes)
+    {
+        LOCK(SOCKET_MUTEX);
+
+        /* Reset the error status */
+        nError.store(0);
+
+        int32_t nRead = 0;
+
+        if(pSSL)
+            nRead = SSL_read(pSSL, pData, nBytes);
+        else
+        {
+        #ifdef WIN32
+            nRead = static_cast<int32_t>(recv(fd, (char*)pData, nBytes, MSG_DONTWAIT));
+        #else
+            nRead = static_cast<int32_t>(recv(fd, pData, nBytes, MSG_DONTWAIT));
+        #endif
+        }
+
+        if (nRead <= 0)
+        {
+            if(pSSL)
+            {
+                int nSSLError = SSL_get_error(pSSL, nRead);
+
+                switch (nSSLError)
+                {
+                    case SSL_ERROR_NONE:
+                    {
+                        // no real error, just try again...
+                        break;
+                    }
+
+                    case SSL_ERROR_SSL:
+                    {
+                        // peer disconnected...
+                        debug::error(FUNCTION, "Peer disconnected." );
+                        nError.store(ERR_get_error());
+                        break;
+                    }
+
+                    case SSL_ERROR_ZERO_RETURN:
+                    {
+                        // peer disconnected...
+                        debug::error(FUNCTION, "Peer disconnected." );
+                        nError.store(ERR_get_error());
+                        break;
+                    }
+
+                    case SSL_ERROR_WANT_READ:
+                    {
+                        // no data available right now as it needs to read more from the underlying socket
+                        break;
+                    }
+
+                    case SSL_ERROR_WANT_WRITE:
+                    {
+                        // socket not writable right now, wait and try again
+                        break;
+                    }
+
+                    default:
+                    {
+                        nError.store(ERR_get_error());
+                        break;
+                    }
+                }
+
+                /* Check if an error occurred before logging */
+                if(nError.load() > 0)
+                    debug::log(3, FUNCTION, "SSL_read failed ",  addr.ToString(), " (", nError, " ", ERR_reason_error_string(nError), ")");
+
+            }
+            else if(nRead < 0)
+            {
+                nError = WSAGetLastError();
+
+                /* Nothing to read yet isn't worth logging, it's the normal case for a non-blocking fill. */
+                if(error_code() != 0)
+                    debug::log(3, FUNCTION, "read failed ", addr.ToString(), " (", nError, " ", strerror(nError), ")");
+            }
+        }
+        else if(nRead > 0)
+            nLastRecv = runtime::timestamp(true);
+
+        return nRead;
+    }
+
+
+    /* Write data to the socket non-blocking, recording any error. */
+    int32_t Socket::send_socket(const uint8_t* pData, const size_t nBytes)
+    {
+        int32_t nSent = 0;
+        {
+            LOCK(SOCKET_MUTEX);
+
+            if(pSSL)
+                nSent = static_cast<int32_t>(SSL_write(pSSL, pData, nBytes));
+            else
+            {
+            #ifdef WIN32
+                nSent = static_cast<int32_t>(send(fd, (char*)pData, nBytes, MSG_NOSIGNAL | MSG_DONTWAIT));
+            #else
+                nSent = static_cast<int32_t>(send(fd, pData, nBytes, MSG_NOSIGNAL | MSG_DONTWAIT));
+            #endif
+            }
+        }
+
+        /* Handle for error state. */
+        if(nSent < 0)
+        {
+            if(pSSL)
+                nError = SSL_get_error(pSSL, nSent);
+            else
+                nError = WSAGetLastError();
+        }
+        else if(nSent == static_cast<int32_t>(nBytes)) //don't update last sent unless all the data was written to the buffer
+            nLastSend = runtime::timestamp(true);
+
+        return nSent;
+    }
+
+
+    /* Add a segment to the end of the send queue. */
+    void Socket::queue_send(const std::shared_ptr<const std::vector<uint8_t>>& pData, const uint32_t nOffset)
+    {
+        if(queueSend.empty())
+            nSendOffset = nOffset;
+
+        queueSend.push_back(pData);
+        nBuffered += (pData->size() - nOffset);
+    }
+
+
+    /* Remove sent bytes from the front of the send queue. */
+    void Socket::consume_send(uint32_t nBytes)
+    {
+        nBuffered -= nBytes;
+
+        /* Whole segments are dropped, and the offset kept into the one partly sent. */
+        while(nBytes > 0 && !queueSend.empty())
+        {
+            const uint32_t nLeft = static_cast<uint32_t>(queueSend.front()->size()) - nSendOffset;
+            if(nBytes < nLeft)
+            {
+                nSendOffset += nBytes;
+                break;
+            }
+
+            nBytes     -= nLeft;
+            nSendOffset = 0;
+
+            queueSend.pop_front();
+        }
+    }
+
+
     /*  Creates or destroys the SSL object depending on the flag set. */
     void Socket::SetSSL(bool fSSL)
     {
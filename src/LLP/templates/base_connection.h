@@ -100,6 +100,14 @@ namespace LLP
         std::atomic<bool> fCONNECTED;
 
 
+        /** Flag to determine if a worker is processing the packet of the connection. **/
+        std::atomic<bool> fPROCESSING;
+
+
+        /** Reason for the data thread to remove the connection, set by threads that don't own its slot. **/
+        std::atomic<uint8_t> nDisconnect;
+
+
         /** Index for the current data thread processing. **/
         int32_t nDataThread;
 
@@ -181,6 +189,29 @@ namespace LLP
         }
 
 
+        /** RelaySubscriptions
+         *
+         *  Get the subscriptions a node needs to be relayed a whole message.
+         *
+         **/
+        template<typename MessageType>
+        static uint32_t RelaySubscriptions(const MessageType& message, const DataStream& ssData)
+        {
+            return 0; //every node is relayed every message
+        }
+
+
+        /** Notifications
+         *
+         *  Get the subscriptions of this node for relayed messages.
+         *
+         **/
+        uint32_t Notifications() const
+        {
+            return 0;
+        }
+
+
         /** AddTrigger
          *
          *  Adds a new event listener to this connection to fire off condition variables on specific message types.
@@ -283,6 +314,16 @@ namespace LLP
         void WritePacket(const PacketType& PACKET);
 
 
+        /** WritePacket
+         *
+         *  Write a single packet that is already serialized to the TCP stream.
+         *
+         *  @param[in] pBytes The shared bytes of the packet, which aren't copied.
+         *
+         **/
+        void WritePacket(const std::shared_ptr<const std::vector<uint8_t>>& pBytes);
+
+
         /** ReadPacket
          *
          *  Non-Blocking Packet reader to build a packet from TCP Connection.
@@ -20,6 +20,7 @@ ________________________________________________________________________________
 
 #include <LLP/templates/ddos.h>
 #include <LLP/templates/events.h>
+#include <LLP/templates/relay.h>
 
 #include <Util/include/mutex.h>
 #include <Util/include/memory.h>
@@ -40,6 +41,7 @@ namespace LLP
     class Socket;
     class DDOS_Filter;
     class BaseAddress;
+    class Executor;
 
 
     /* Flags for connection count. */
@@ -54,6 +56,18 @@ namespace LLP
     }
 
 
+    /* The milliseconds between checks of every connection for timeouts, DDOS and generic events with epoll. */
+    const uint32_t EPOLL_SWEEP_INTERVAL = 100;
+
+
+    /* The most socket events taken from epoll in one wait. */
+    const uint32_t MAX_EPOLL_EVENTS = 256;
+
+
+    /* The epoll data of the wake-up eventfd, past any slot and socket of a connection. */
+    const uint64_t EPOLL_WAKE_EVENT = static_cast<uint64_t>(-1);
+
+
     /** DataThread
      *
      *  Base Template Thread Class for Server base. Used for Core LLP Packet Functionality.
@@ -80,12 +94,28 @@ namespace LLP
         uint32_t DDOS_cSCORE;
 
 
+        /** The epoll instance watching the connections, -1 when polling them instead. **/
+        int32_t nEpoll;
+
+
+        /** The eventfd a worker signals when it gives a connection back, -1 where there is none. **/
+        int32_t nWake;
+
+
+        /** The workers of the server to process packets on, nullptr to process them on this thread. **/
+        Executor* EXECUTOR;
+
+
+        /** The connections with a packet on a worker. **/
+        std::atomic<uint32_t> nProcessing;
+
+
         /* Vector to store Connections. */
         memory::atomic_ptr< std::vector< std::shared_ptr<ProtocolType>> > CONNECTIONS;
 
 
         /** Queu to process outbound relay messages. **/
-        memory::atomic_ptr< std::queue<std::pair<typename ProtocolType::message_t, DataStream>> > RELAY;
+        memory::atomic_ptr< std::queue<std::shared_ptr<const RelayMessage<ProtocolType>>> > RELAY;
 
 
         /** The condition for thread sleeping. **/
@@ -106,7 +136,7 @@ namespace LLP
 
         /** Default Constructor. **/
         DataThread<ProtocolType>(uint32_t nID, bool ffDDOSIn, uint32_t rScore, uint32_t cScore,
-                                 uint32_t nTimeout, bool fMeter = false);
+                                 uint32_t nTimeout, bool fMeter = false, Executor* pExecutor = nullptr);
 
 
         /** Default Destructor. **/
@@ -145,6 +175,9 @@ namespace LLP
                 else
                     CONNECTIONS->at(nSlot) = std::shared_ptr<ProtocolType>(pnode);
 
+                /* Start watching the socket. */
+                watch_connection(nSlot);
+
                 /* Fire the connected event. */
                 pnode->Event(EVENTS::CONNECT);
 
@@ -212,6 +245,9 @@ namespace LLP
                 else
                     CONNECTIONS->at(nSlot) = std::shared_ptr<ProtocolType>(pnode);
 
+                /* Start watching the socket. */
+                watch_connection(nSlot);
+
                 /* Fire the connected event. */
                 pnode->Event(EVENTS::CONNECT);
 
@@ -239,7 +275,8 @@ namespace LLP
         /** DisconnectAll
          *
          *  Disconnects all connections by issuing a DISCONNECT::FORCE event message
-         *  and then removes the connection from this data thread.
+         *  and then removes the connection from this data thread. Connections a
+         *  worker has are left for the data thread to remove once it is done.
          *
          **/
         void DisconnectAll();
@@ -249,7 +286,8 @@ namespace LLP
          *
          *  Thread that handles all the Reading of Data from Sockets.
          *  Creates a Packet QUEUE on this connection to be processed by an
-         *  LLP Messaging Thread.
+         *  LLP Messaging Thread. Waits on epoll where available, and on
+         *  poll otherwise or with -llpepoll=0.
          *
          **/
         void Thread();
@@ -274,11 +312,7 @@ namespace LLP
             DataStream ssData(SER_NETWORK, MIN_PROTO_VERSION);
             message_args(ssData, std::forward<Args>(args)...);
 
-            /* Push the relay message to outbound queue. */
-            RELAY->push(std::make_pair(message, ssData));
-
-            /* Wake up the flush thread. */
-            FLUSH_CONDITION.notify_all();
+            _Relay(message, ssData);
         }
 
 
@@ -289,9 +323,20 @@ namespace LLP
          **/
         template<typename MessageType>
         void _Relay(const MessageType& message, const DataStream& ssData)
+        {
+            _Relay(std::make_shared<const RelayMessage<ProtocolType>>(message, ssData));
+        }
+
+
+        /** _Relay
+         *
+         *  Relays a message already serialized, shared with the other data threads relaying it.
+         *
+         **/
+        void _Relay(const std::shared_ptr<const RelayMessage<ProtocolType>>& pRelay)
         {
             /* Push the relay message to outbound queue. */
-            RELAY->push(std::make_pair(message, ssData));
+            RELAY->push(pRelay);
 
             /* Wake up the flush thread. */
             FLUSH_CONDITION.notify_all();
@@ -317,6 +362,119 @@ namespace LLP
       private:
 
 
+        /** poll_thread
+         *
+         *  Polls every connection each iteration, and checks and reads all of them.
+         *
+         **/
+        void poll_thread();
+
+
+        /** epoll_thread
+         *
+         *  Waits on the edge-triggered epoll interest set, and only reads the
+         *  connections with data. The rest are checked for timeouts and DDOS
+         *  every EPOLL_SWEEP_INTERVAL milliseconds.
+         *
+         **/
+        void epoll_thread();
+
+
+        /** check_connection
+         *
+         *  Removes a connection that has errors, timed out, stopped reading
+         *  its buffer, or was banned by DDOS protection.
+         *
+         *  @param[in] nIndex The data thread index of the connection.
+         *  @param[in] CONNECTION The connection to check.
+         *
+         *  @return False if the connection was removed.
+         *
+         **/
+        bool check_connection(const uint32_t nIndex, const std::shared_ptr<ProtocolType>& CONNECTION);
+
+
+        /** read_connection
+         *
+         *  Reads from a connection, and processes the packet once complete,
+         *  or hands it to a worker when the server has them. A connection
+         *  isn't read while a worker has its packet, which keeps its packets
+         *  in order.
+         *
+         *  @param[in] nIndex The data thread index of the connection.
+         *  @param[in] CONNECTION The connection to read.
+         *
+         **/
+        void read_connection(const uint32_t nIndex, const std::shared_ptr<ProtocolType>& CONNECTION);
+
+
+        /** count_packet
+         *
+         *  Counts a complete packet for the meters and DDOS protection.
+         *
+         *  @param[in] CONNECTION The connection the packet was read from.
+         *
+         **/
+        void count_packet(const std::shared_ptr<ProtocolType>& CONNECTION);
+
+
+        /** process_packet
+         *
+         *  Processes the complete packet of a connection.
+         *
+         *  @param[in] CONNECTION The connection to process.
+         *
+         *  @return False if the connection is to be disconnected.
+         *
+         **/
+        bool process_packet(const std::shared_ptr<ProtocolType>& CONNECTION);
+
+
+        /** process_connection
+         *
+         *  Processes a packet on a worker, along with the packets already in
+         *  the receive buffer behind it, and then gives the connection back
+         *  to this thread, waking it to read the connection again. A worker
+         *  never removes the connection, it sets the reason to disconnect it
+         *  for this thread to remove it.
+         *
+         *  @param[in] CONNECTION The connection to process.
+         *
+         **/
+        void process_connection(const std::shared_ptr<ProtocolType>& CONNECTION);
+
+
+        /** clear_wake
+         *
+         *  Clears the signals of the wake-up eventfd, once the data thread
+         *  has woken up to them.
+         *
+         **/
+        void clear_wake();
+
+
+        /** watch_connection
+         *
+         *  Adds the socket of a connection to the epoll interest set.
+         *
+         *  @param[in] nIndex The data thread index of the connection.
+         *
+         **/
+        void watch_connection(const uint32_t nIndex);
+
+
+        /** relay_connection
+         *
+         *  Writes a relay to a connection, by its subscriptions.
+         *
+         *  @param[in] CONNECTION The connection to write the relay to.
+         *  @param[in] pRelay The relay message.
+         *
+         **/
+        void relay_connection(const std::shared_ptr<ProtocolType>& CONNECTION,
+                              const std::shared_ptr<const RelayMessage<ProtocolType>>& pRelay);
+
+
         /** remove_connection_with_event
          *
          *  Fires off a Disconnect event with the given disconnect reason
@@ -0,0 +1,82 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_LLP_TEMPLATES_RELAY_H
+#define NEXUS_LLP_TEMPLATES_RELAY_H
+
+#include <Util/templates/datastream.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace LLP
+{
+
+    /** The subscription flag of a relay that has to be filtered by each connection it goes to. **/
+    const uint32_t RELAY_FILTER = (1u << 31);
+
+
+    /** RelayMessage
+     *
+     *  A message to relay, serialized once into the bytes of its packet and
+     *  shared by every data thread and connection it is written to.
+     *
+     *  A connection with all of the subscriptions of the message is written
+     *  the shared bytes, and one with none of them is skipped. Only a
+     *  connection with some of them, or a message flagged RELAY_FILTER,
+     *  goes through RelayFilter and gets a packet of its own.
+     *
+     **/
+    template<class ProtocolType>
+    struct RelayMessage
+    {
+        /** The message type. **/
+        typename ProtocolType::message_t MESSAGE;
+
+
+        /** The data of the message, for connections that filter it. **/
+        DataStream ssData;
+
+
+        /** The subscriptions a connection needs to be relayed the whole message, or RELAY_FILTER. **/
+        uint32_t nSubscriptions;
+
+
+        /** The bytes of the packet of the whole message. **/
+        std::shared_ptr<const std::vector<uint8_t>> pBytes;
+
+
+        /** Constructor. **/
+        RelayMessage(const typename ProtocolType::message_t& message, const DataStream& ssDataIn)
+        : MESSAGE        (message)
+        , ssData         (ssDataIn)
+        , nSubscriptions (0)
+        , pBytes         ( )
+        {
+            /* Get the subscriptions from the data, and rewind it for the connections that filter it. */
+            ssData.Reset();
+            nSubscriptions = ProtocolType::RelaySubscriptions(MESSAGE, ssData);
+            ssData.Reset();
+
+            /* Serialize the packet once. */
+            typename ProtocolType::packet_t PACKET(MESSAGE);
+            PACKET.SetData(ssData);
+
+            pBytes = std::make_shared<const std::vector<uint8_t>>(PACKET.GetBytes());
+        }
+    };
+}
+
+#endif
@@ -36,6 +36,7 @@ namespace LLP
     /* forward declarations */
     class AddressManager;
     class DDOS_Filter;
+    class Executor;
     class InfoAddress;
     typedef struct ssl_st SSL;
 
@@ -130,6 +131,10 @@ namespace LLP
         AddressManager *pAddressManager;
 
 
+        /** Workers for processing packets off of the data threads, nullptr when disabled. **/
+        Executor *pExecutor;
+
+
         /** The sleep time of address manager. **/
         uint32_t nSleepTime;
 
@@ -399,9 +404,10 @@ namespace LLP
         template<typename MessageType, typename... Args>
         void Relay(const MessageType& message, Args&&... args)
         {
-            /* Relay message to each data thread, which will relay message to each connection of each data thread */
-            for(uint16_t nThread = 0; nThread < MAX_THREADS; ++nThread)
-                DATA_THREADS[nThread]->Relay(message, args...);
+            DataStream ssData(SER_NETWORK, MIN_PROTO_VERSION);
+            message_args(ssData, std::forward<Args>(args)...);
+
+            _Relay(message, ssData);
         }
 
 
@@ -413,9 +419,13 @@ namespace LLP
         template<typename MessageType>
         void _Relay(const MessageType& message, const DataStream& ssData)
         {
+            /* Serialize the message once, to be shared by every data thread and connection. */
+            const std::shared_ptr<const RelayMessage<ProtocolType>> pRelay =
+                std::make_shared<const RelayMessage<ProtocolType>>(message, ssData);
+
             /* Relay message to each data thread, which will relay message to each connection of each data thread */
             for(uint16_t nThread = 0; nThread < MAX_THREADS; ++nThread)
-                DATA_THREADS[nThread]->_Relay(message, ssData);
+                DATA_THREADS[nThread]->_Relay(pRelay);
         }
 
 
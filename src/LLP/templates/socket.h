@@ -19,6 +19,8 @@ ________________________________________________________________________________
 #include <LLP/include/base_address.h>
 
 #include <vector>
+#include <deque>
+#include <memory>
 #include <cstdint>
 #include <mutex>
 #include <atomic>
@@ -34,6 +36,14 @@ namespace LLP
     const uint64_t MAX_SEND_BUFFER = 3 * 1024 * 1024; //3MB max send buffer
 
 
+    /** Max segments of the send queue written with one call. **/
+    const uint32_t MAX_SEND_SEGMENTS = 64;
+
+
+    /** Receive buffer size. **/
+    const uint32_t RECV_BUFFER_SIZE = 64 * 1024; //64KB read from the socket at a time
+
+
     /** Socket
      *
      *  Base Template class to handle outgoing / incoming LLP data for both
@@ -68,14 +78,34 @@ namespace LLP
         std::atomic<int32_t> nError;
 
 
-        /** Oversize buffer for large packets. **/
-        std::vector<uint8_t> vBuffer;
+        /** Queue of the data that couldn't be sent yet, as shared segments so large packets aren't copied into it. **/
+        std::deque<std::shared_ptr<const std::vector<uint8_t>>> queueSend;
+
+
+        /** The bytes of the first segment of the send queue that were already sent. **/
+        uint32_t nSendOffset;
+
+
+        /** The bytes waiting in the send queue. **/
+        std::atomic<uint64_t> nBuffered;
 
 
         /** Flag to catch if buffer write failed. **/
         std::atomic<bool> fBufferFull;
 
 
+        /** Bytes read from the socket that haven't been consumed yet. **/
+        std::vector<uint8_t> vRecvBuffer;
+
+
+        /** The first unconsumed byte in the receive buffer. **/
+        uint32_t nRecvBegin;
+
+
+        /** One past the last byte read into the receive buffer. **/
+        uint32_t nRecvEnd;
+
+
     public:
 
 
@@ -152,7 +182,7 @@ namespace LLP
          *
          *  Poll the socket to check for available data
          *
-         *  @return the total bytes available for read
+         *  @return the total bytes available for read, including the receive buffer
          *
          **/
         int32_t Available() const;
@@ -192,6 +222,44 @@ namespace LLP
         int32_t Read(std::vector<int8_t>& vchData, size_t nBytes);
 
 
+        /** Fill
+         *
+         *  Read as much as the socket has into the receive buffer with a
+         *  single call, for packets to be framed out of without a read per
+         *  field. Only the thread reading the connection may use the buffer.
+         *
+         *  @return the total bytes that were read
+         *
+         **/
+        int32_t Fill();
+
+
+        /** Received
+         *
+         *  Get the bytes in the receive buffer that haven't been consumed.
+         *
+         **/
+        uint32_t Received() const;
+
+
+        /** Peek
+         *
+         *  Get the first unconsumed byte in the receive buffer.
+         *
+         **/
+        const uint8_t* Peek() const;
+
+
+        /** Consume
+         *
+         *  Remove bytes from the front of the receive buffer.
+         *
+         *  @param[in] nBytes The total bytes to remove.
+         *
+         **/
+        void Consume(const uint32_t nBytes);
+
+
         /** Write
          *
          *  Write data into the socket buffer non-blocking
@@ -205,9 +273,24 @@ namespace LLP
         int32_t Write(const std::vector<uint8_t>& vData, size_t nBytes);
 
 
+        /** Write
+         *
+         *  Write shared data into the socket buffer non-blocking. Whatever
+         *  can't be sent is queued by reference, so the same data can be
+         *  written to many sockets without being copied for each.
+         *
+         *  @param[in] pData The shared byte vector of data to be written
+         *
+         *  @return the total bytes that were written
+         *
+         **/
+        int32_t Write(const std::shared_ptr<const std::vector<uint8_t>>& pData);
+
+
         /** Flush
          *
-         *  Flushes data out of the overflow buffer
+         *  Flushes data out of the send queue, gathering its segments into
+         *  a single write.
          *
          *  @return the total bytes that were written
          *
@@ -287,6 +370,54 @@ namespace LLP
          **/
         int32_t error_code() const;
 
+
+        /** read_socket
+         *
+         *  Read data from the socket non-blocking, recording any error.
+         *
+         *  @param[out] pData The memory to read into
+         *  @param[in] nBytes The total bytes to read
+         *
+         *  @return the total bytes that were read
+         *
+         **/
+        int32_t read_socket(uint8_t* pData, const size_t nBytes);
+
+
+        /** send_socket
+         *
+         *  Write data to the socket non-blocking, recording any error.
+         *  DATA_MUTEX must be held.
+         *
+         *  @param[in] pData The memory to write from
+         *  @param[in] nBytes The total bytes to write
+         *
+         *  @return the total bytes that were written
+         *
+         **/
+        int32_t send_socket(const uint8_t* pData, const size_t nBytes);
+
+
+        /** queue_send
+         *
+         *  Add a segment to the end of the send queue. DATA_MUTEX must be held.
+         *
+         *  @param[in] pData The shared byte vector to add
+         *  @param[in] nOffset The bytes of it that were already sent
+         *
+         **/
+        void queue_send(const std::shared_ptr<const std::vector<uint8_t>>& pData, const uint32_t nOffset = 0);
+
+
+        /** consume_send
+         *
+         *  Remove sent bytes from the front of the send queue. DATA_MUTEX must be held.
+         *
+         *  @param[in] nBytes The total bytes that were sent
+         *
+         **/
+        void consume_send(uint32_t nBytes);
+
     };
 
 }
@@ -20,6 +20,7 @@ ________________________________________________________________________________
 #include <LLP/include/global.h>
 #include <LLP/include/manager.h>
 #include <LLP/templates/events.h>
+#include <LLP/templates/relay.h>
 
 #include <TAO/API/include/global.h>
 #include <TAO/API/types/sessionmanager.h>
@@ -56,6 +57,7 @@ ________________________________________________________________________________
 #include <Util/include/version.h>
 
 
+#include <algorithm>
 #include <climits>
 #include <memory>
 #include <iomanip>
@@ -1316,6 +1318,11 @@ namespace LLP
                                3000 seems to be the optimal amount to overcome higher-latency connections during sync. */
                             int32_t nBatchSize = config::GetArg("-syncbatchsize", 3000);
 
+                            /* Read the next batch and its transactions ahead on the ledger read-ahead threads while we serve them,
+                               up to the peer's stop block. The walk is sized by our batch size, not by the limits the peer sent. */
+                            if(nLimits > 0 && nBatchSize > 0)
+                                LLD::Ledger->Prefetch(hashStart, static_cast<uint32_t>(nBatchSize), true, hashStop);
+
                             std::vector<TAO::Ledger::BlockState> vStates;
                             while(!fBufferFull.load() && --nLimits >= 0 && hashStart != hashStop && LLD::Ledger->BatchRead(hashStart, "block", vStates, nBatchSize, true))
                             {
@@ -1730,9 +1737,53 @@ namespace LLP
                                 if(!LLD::Ledger->ReadSequence(hashSigchain, nSequence))
                                     nSequence = 0;
 
-                                /* Look back through all events to find those that are not yet processed. */
+                                /* Read the events back a batch at a time from the ordered event index if enabled. */
+                                bool fFound = false;
                                 TAO::Ledger::Transaction tx;
-                                while(LLD::Ledger->ReadEvent(hashSigchain, --nSequence, tx))
+
+                                uint32_t nFirst = 0;
+                                if(LLD::Event && LLD::Event->ReadFirst(hashSigchain, nFirst))
+                                {
+                                    while(!fFound && nSequence > nFirst)
+                                    {
+                                        /* Get the hashes of the batch of events before the last one read. */
+                                        const uint32_t nBegin = std::max(nFirst, nSequence > 100 ? nSequence - 100 : 0);
+
+                                        std::vector<uint512_t> vHashes;
+                                        if(!LLD::Event->ReadEvents(hashSigchain, nBegin, nSequence, vHashes)
+                                        || vHashes.size() != nSequence - nBegin)
+                                            break;
+
+                                        /* Look back through the batch to find those that are not yet processed. */
+                                        for(auto hash = vHashes.rbegin(); hash != vHashes.rend(); ++hash)
+                                        {
+                                            /* Check to see if we have reached the requested start point */
+                                            if(hashStart == *hash)
+                                            {
+                                                fFound = true;
+                                                break;
+                                            }
+
+                                            /* Leave the rest to the ledger if the transaction is missing. */
+                                            if(!LLD::Ledger->ReadTx(*hash, tx))
+                                                break;
+
+                                            /* Insert into container. */
+                                            TAO::Ledger::MerkleTx merkle = TAO::Ledger::MerkleTx(tx);
+                                            merkle.BuildMerkleBranch();
+
+                                            vtx.push_back(merkle);
+                                            --nSequence;
+                                        }
+
+                                        /* Stop on a partial batch, the ledger has the rest. */
+                                        if(nSequence != nBegin)
+                                            break;
+                                    }
+                                }
+
+                                /* Look back through the events not indexed to find those that are not yet processed. */
+                                while(!fFound && LLD::Ledger->ReadEvent(hashSigchain, --nSequence, tx))
                                 {
                                     /* Check to see if we have reached the requested start point */
                                     if(hashStart == tx.GetHash())
@@ -3197,7 +3248,9 @@ namespace LLP
                                 }
 
                                 /* Flush to disk and clear mempool. */
-                                LLD::TxnCommit(TAO::Ledger::FLAGS::BLOCK);
+                                if(!LLD::TxnCommit(TAO::Ledger::FLAGS::BLOCK))
+                                    return debug::error(FUNCTION, "failed to commit tx ", hashTx.SubString());
+
                                 TAO::Ledger::mempool.Remove(hashTx);
 
                                 /* Verbose=3 dumps transaction data. */
@@ -3264,7 +3317,9 @@ namespace LLP
                                     }
 
                                     /* Flush to disk and clear mempool. */
-                                    LLD::TxnCommit(TAO::Ledger::FLAGS::BLOCK);
+                                    if(!LLD::TxnCommit(TAO::Ledger::FLAGS::BLOCK))
+                                        return debug::error(FUNCTION, "failed to commit tx ", hashTx.SubString());
+
                                     TAO::Ledger::mempool.Remove(hashTx);
 
                                     debug::log(0, hashTx.SubString(), " ACCEPTED");
@@ -3592,41 +3647,44 @@ namespace LLP
         if(!INCOMING.Complete())
         {
             /** Handle Reading Packet Length Header. **/
-            if(!INCOMING.Header() && Available() >= 8)
+            if(!INCOMING.Header())
             {
-                std::vector<uint8_t> BYTES(8, 0);
-                if(Read(BYTES, 8) == 8)
+                /* Read what the socket has in one call, then frame the packet out of the receive buffer. */
+                if(Received() < 8)
+                    Fill();
+
+                if(Received() >= 8)
                 {
-                    DataStream ssHeader(BYTES, SER_NETWORK, MIN_PROTO_VERSION);
+                    DataStream ssHeader((const char*)Peek(), (const char*)Peek() + 8, SER_NETWORK, MIN_PROTO_VERSION);
                     ssHeader >> INCOMING;
+                    Consume(8);
 
                     Event(EVENTS::HEADER);
                 }
             }
 
             /** Handle Reading Packet Data. **/
-            uint32_t nAvailable = Available();
-            if(INCOMING.Header() && nAvailable > 0 && !INCOMING.IsNull() && INCOMING.DATA.size() < INCOMING.LENGTH)
+            if(INCOMING.Header() && !INCOMING.IsNull() && INCOMING.DATA.size() < INCOMING.LENGTH)
             {
                 /* The maximum number of bytes to read is th number of bytes specified in the message length,
                    minus any already read on previous reads*/
                 uint32_t nMaxRead = (uint32_t)(INCOMING.LENGTH - INCOMING.DATA.size());
 
-                /* Vector to receve the read bytes. This should be the smaller of the number of bytes currently available or the
-                   maximum amount to read */
-                std::vector<uint8_t> DATA(std::min(nAvailable, nMaxRead), 0);
+                /* Only go to the socket when the buffer doesn't already hold the rest of the packet. */
+                if(Received() < nMaxRead)
+                    Fill();
 
-                /* Read up to the buffer size. */
-                int32_t nRead = Read(DATA, DATA.size());
-
-                /* If something was read, insert it into the packet data.  NOTE: that due to SSL packet framing we could end up
-                   reading less bytes than appear available.  Therefore we only copy the number of bytes actually read */
+                /* Copy straight out of the receive buffer into the packet data. */
+                uint32_t nRead = std::min(Received(), nMaxRead);
                 if(nRead > 0)
-                    INCOMING.DATA.insert(INCOMING.DATA.end(), DATA.begin(), DATA.begin() + nRead);
+                {
+                    INCOMING.DATA.insert(INCOMING.DATA.end(), Peek(), Peek() + nRead);
+                    Consume(nRead);
 
-                /* If the packet is now considered complete, fire the packet complete event */
-                if(INCOMING.Complete())
-                    Event(EVENTS::PACKET, static_cast<uint32_t>(DATA.size()));
+                    /* If the packet is now considered complete, fire the packet complete event */
+                    if(INCOMING.Complete())
+                        Event(EVENTS::PACKET, nRead);
+                }
             }
         }
     }
@@ -4252,6 +4310,122 @@ namespace LLP
     }
 
 
+    /* Get the subscriptions a node needs to be relayed a whole message. */
+    uint32_t TritiumNode::RelaySubscriptions(const uint16_t nMsg, const DataStream& ssData)
+    {
+        /* Switch based on message type */
+        switch(nMsg)
+        {
+            /* Requests depend on the protocol version of the node. */
+            case ACTION::REQUEST :
+            {
+                /* Get the request type */
+                uint8_t nType = 0;
+                ssData >> nType;
+
+                return (nType == TYPES::P2PCONNECTION ? RELAY_FILTER : 0);
+            }
+
+            /* Notifications depend on the subscriptions of the node. */
+            case ACTION::NOTIFY:
+            {
+                uint32_t nSubscriptions = 0;
+                while(!ssData.End())
+                {
+                    /* Get the first notify type. */
+                    uint8_t nType = 0;
+                    ssData >> nType;
+
+                    /* Check for legacy specifier, which only transactions can be relayed whole with. */
+                    bool fLegacy = false;
+                    if(nType == SPECIFIER::LEGACY)
+                    {
+                        fLegacy = true;
+                        ssData >> nType;
+                    }
+
+                    /* Switch based on type, skipping over the index. */
+                    switch(nType)
+                    {
+                        case TYPES::BLOCK:
+                        {
+                            uint1024_t hashBlock;
+                            ssData >> hashBlock;
+
+                            nSubscriptions |= SUBSCRIPTION::BLOCK;
+                            break;
+                        }
+
+                        case TYPES::TRANSACTION:
+                        {
+                            uint512_t hashTx;
+                            ssData >> hashTx;
+
+                            nSubscriptions |= SUBSCRIPTION::TRANSACTION;
+                            break;
+                        }
+
+                        case TYPES::BESTHEIGHT:
+                        {
+                            uint32_t nHeight;
+                            ssData >> nHeight;
+
+                            nSubscriptions |= SUBSCRIPTION::BESTHEIGHT;
+                            break;
+                        }
+
+                        case TYPES::CHECKPOINT:
+                        {
+                            uint1024_t hashCheck;
+                            ssData >> hashCheck;
+
+                            nSubscriptions |= SUBSCRIPTION::CHECKPOINT;
+                            break;
+                        }
+
+                        case TYPES::BESTCHAIN:
+                        {
+                            uint1024_t hashBest;
+                            ssData >> hashBest;
+
+                            nSubscriptions |= SUBSCRIPTION::BESTCHAIN;
+                            break;
+                        }
+
+                        case TYPES::ADDRESS:
+                        {
+                            BaseAddress addr;
+                            ssData >> addr;
+
+                            nSubscriptions |= SUBSCRIPTION::ADDRESS;
+                            break;
+                        }
+
+                        /* Sigchain events and notifications depend on the genesis and addresses of the node. */
+                        default:
+                            return RELAY_FILTER;
+                    }
+
+                    /* RelayFilter drops the legacy specifier on anything but a transaction. */
+                    if(fLegacy && nType != TYPES::TRANSACTION)
+                        return RELAY_FILTER;
+                }
+
+                return nSubscriptions;
+            }
+        }
+
+        return 0;
+    }
+
+
+    /* Get the subscriptions of this node for relayed messages. */
+    uint32_t TritiumNode::Notifications() const
+    {
+        return nNotifications.load();
+    }
+
+
     /* Determine whether a session is connected. */
     bool TritiumNode::SessionActive(const uint64_t nSession)
     {
@@ -415,6 +415,25 @@ namespace LLP
         const DataStream RelayFilter(const uint16_t nMsg, const DataStream& ssData) const;
 
 
+        /** RelaySubscriptions
+         *
+         *  Get the subscriptions a node needs to be relayed a whole message.
+         *
+         *  @return the SUBSCRIPTION flags of the notifications, or RELAY_FILTER if
+         *          the message depends on more of the node than its subscriptions
+         *
+         **/
+        static uint32_t RelaySubscriptions(const uint16_t nMsg, const DataStream& ssData);
+
+
+        /** Notifications
+         *
+         *  Get the subscriptions of this node for relayed messages.
+         *
+         **/
+        uint32_t Notifications() const;
+
+
         /** Auth
          *
          *  Authorize this node to the connected node .
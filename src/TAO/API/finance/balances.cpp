@@ -104,6 +104,9 @@ namespace TAO
             if(!ListRegisters(hashGenesis, vRegisters))
                 throw APIException(-74, "No registers found");
 
+            /* Read the accounts as of one commit, so a block connected part way through isn't half counted. */
+            LLD::ReadView view = LLD::Register->Snapshot();
+
             /* Iterate through each register we own */
             for(const auto& hashRegister : vRegisters)
             {
@@ -113,7 +116,7 @@ namespace TAO
 
                 /* Get the register from the register DB */
                 TAO::Register::Object object;
-                if(!LLD::Register->ReadState(hashRegister, object)) // note we don't include mempool state here as we want the confirmed
+                if(!LLD::Register->ReadState(view, hashRegister, object)) // note we don't include mempool state here as we want the confirmed
                     continue;
 
                 /* Check that this is a non-standard object type so that we can parse it and check the type*/
@@ -235,6 +238,9 @@ namespace TAO
             if(!ListRegisters(hashGenesis, vRegisters))
                 throw APIException(-74, "No registers found");
 
+            /* Read the accounts as of one commit, so a block connected part way through isn't half counted. */
+            LLD::ReadView view = LLD::Register->Snapshot();
+
             /* Iterate through each register we own */
             for(const auto& hashRegister : vRegisters)
             {
@@ -244,7 +250,7 @@ namespace TAO
 
                 /* Get the register from the register DB */
                 TAO::Register::Object object;
-                if(!LLD::Register->ReadState(hashRegister, object)) // note we don't include mempool state here as we want the confirmed
+                if(!LLD::Register->ReadState(view, hashRegister, object)) // note we don't include mempool state here as we want the confirmed
                     continue;
 
                 /* Check that this is a non-standard object type so that we can parse it and check the type*/
@@ -233,6 +233,9 @@ namespace TAO
                standard where clauses to filter the json */
             std::vector<std::string> vIgnore = {"height", "hash"};
 
+            /* Read the blocks ahead while we build their JSON */
+            LLD::Ledger->Prefetch(blockState.GetHash(), nOffset + nLimit);
+
             /* Iterate through blocks until we hit the limit or no more blocks*/
             uint32_t nTotal = 0;
             while(!blockState.IsNull())
@@ -12,6 +12,7 @@
 ____________________________________________________________________________________________*/
 
 #include <LLD/include/global.h>
+#include <LLD/include/metrics.h>
 
 #include <TAO/Ledger/include/constants.h>
 #include <TAO/Ledger/include/chainstate.h>
@@ -22,6 +23,7 @@ ________________________________________________________________________________
 #include <TAO/Register/types/object.h>
 
 #include <TAO/API/system/types/system.h>
+#include <TAO/API/types/exception.h>
 
 /* Global TAO namespace. */
 namespace TAO
@@ -217,6 +219,42 @@ namespace TAO
         }
 
 
+        /* Returns the counters, gauges and latency histograms of every open database */
+        json::json System::DatabaseMetrics(const json::json& params, bool fHelp)
+        {
+            if(fHelp)
+                return std::string("get/dbmetrics [format=json|prometheus]: returns the metrics of every open database");
+
+            /* Check for the format requested. */
+            std::string strFormat = "json";
+            if(params.find("format") != params.end())
+                strFormat = params["format"].get<std::string>();
+
+            /* Return the Prometheus text as a single string for scrapers to unwrap. */
+            if(strFormat == "prometheus")
+                return LLD::Metrics::DumpPrometheus();
+
+            if(strFormat != "json")
+                throw APIException(-310, "Invalid format, expected json or prometheus");
+
+            /* Add the cache hit ratio of each database, for a quick read. */
+            json::json jsonRet = LLD::Metrics::DumpJSON();
+            for(auto it = jsonRet.begin(); it != jsonRet.end(); ++it)
+            {
+                json::json& jsonDatabase = it.value();
+                if(jsonDatabase.find("cache_hits_total") == jsonDatabase.end())
+                    continue;
+
+                const uint64_t nHits   = jsonDatabase["cache_hits_total"].get<uint64_t>();
+                const uint64_t nMisses = jsonDatabase["cache_misses_total"].get<uint64_t>();
+
+                jsonDatabase["cache_hit_ratio"] = (nHits + nMisses) > 0 ? double(nHits) / (nHits + nMisses) : 0.0;
+            }
+
+            return jsonRet;
+        }
+
+
         /* Returns the count of registers of the given type in the register DB */
         uint64_t System::count_registers(const std::string& strType)
         {
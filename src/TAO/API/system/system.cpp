@@ -48,6 +48,7 @@ namespace TAO
         {
             mapFunctions["get/info"]         = Function(std::bind(&System::GetInfo,    this, std::placeholders::_1, std::placeholders::_2));
             mapFunctions["get/metrics"]    = Function(std::bind(&System::Metrics,    this, std::placeholders::_1, std::placeholders::_2));
+            mapFunctions["get/dbmetrics"]    = Function(std::bind(&System::DatabaseMetrics, this, std::placeholders::_1, std::placeholders::_2));
             mapFunctions["stop"]             = Function(std::bind(&System::Stop,    this, std::placeholders::_1, std::placeholders::_2));
             mapFunctions["list/peers"]       = Function(std::bind(&System::ListPeers,    this, std::placeholders::_1, std::placeholders::_2));
             mapFunctions["list/lisp-eids"]   = Function(std::bind(&System::LispEIDs, this, std::placeholders::_1, std::placeholders::_2));
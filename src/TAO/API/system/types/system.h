@@ -139,6 +139,20 @@ namespace TAO
             json::json Metrics(const json::json& params, bool fHelp);
 
 
+            /** DatabaseMetrics
+             *
+             *  Returns the counters, gauges and latency histograms of every open database,
+             *  as JSON or as Prometheus text.
+             *
+             *  @param[in] params The parameters from the API call.
+             *  @param[in] fHelp Trigger for help data.
+             *
+             *  @return The return object in JSON.
+             *
+             **/
+            json::json DatabaseMetrics(const json::json& params, bool fHelp);
+
+
 
         private:
 
@@ -1055,6 +1055,24 @@ namespace TAO
 
             debug::log(3, "BLOCK BEGIN-------------------------------------");
 
+            /* Read all of the block's transactions in one batch, rather than a disk read per transaction. */
+            std::map<uint512_t, TAO::Ledger::Transaction> mapTritium;
+            std::map<uint512_t, Legacy::Transaction> mapLegacy;
+            {
+                std::vector<uint512_t> vTritium;
+                std::vector<uint512_t> vLegacy;
+                for(const auto& proof : vtx)
+                {
+                    if(proof.first == TRANSACTION::TRITIUM)
+                        vTritium.push_back(proof.second);
+                    else if(proof.first == TRANSACTION::LEGACY)
+                        vLegacy.push_back(proof.second);
+                }
+
+                LLD::Ledger->ReadTxs(vTritium, mapTritium);
+                LLD::Legacy->ReadTxs(vLegacy, mapLegacy);
+            }
+
             /* Check through all the transactions. */
             for(const auto& proof : vtx)
             {
@@ -1072,10 +1090,13 @@ namespace TAO
                         return debug::error(FUNCTION, "transaction overwrites not allowed");
 
                     /* Make sure the transaction is on disk. */
-                    TAO::Ledger::Transaction tx;
-                    if(!LLD::Ledger->ReadTx(hash, tx))
+                    auto it = mapTritium.find(hash);
+                    if(it == mapTritium.end())
                         return debug::error(FUNCTION, "transaction not on disk");
 
+                    /* Get a reference of the transaction. */
+                    TAO::Ledger::Transaction& tx = it->second;
+
                     if(config::nVerbose >= 3)
                         tx.print();
 
@@ -1156,11 +1177,14 @@ namespace TAO
                     if(LLD::Ledger->HasIndex(hash))
                         return debug::error(FUNCTION, "transaction overwrites not allowed");
 
-                    /* Make sure the transaction isn't on disk. */
-                    Legacy::Transaction tx;
-                    if(!LLD::Legacy->ReadTx(hash, tx))
+                    /* Make sure the transaction is on disk. */
+                    auto it = mapLegacy.find(hash);
+                    if(it == mapLegacy.end())
                         return debug::error(FUNCTION, "transaction not on disk");
 
+                    /* Get a reference of the transaction. */
+                    Legacy::Transaction& tx = it->second;
+
                     /* Fetch the inputs. */
                     std::map<uint512_t, std::pair<uint8_t, DataStream> > inputs;
                     if(!tx.FetchInputs(inputs))
@@ -1204,26 +1228,28 @@ namespace TAO
             /* Log how much was generated / destroyed. */
             debug::log(TAO::Ledger::ChainState::Synchronizing() ? 1 : 0, FUNCTION, nMint > 0 ? "Generated " : "Destroyed ", std::fixed, (double)nMint / TAO::Ledger::NXS_COIN, " Nexus | Money Supply ", std::fixed, (double)nMoneySupply / TAO::Ledger::NXS_COIN);
 
-            /* Write the updated block state to disk. */
-            if(!LLD::Ledger->WriteBlock(GetHash(), *this))
-                return debug::error(FUNCTION, "failed to update block state");
+            /* Write the updated block state, its height index and the previous block's chain pointer together. */
+            LLD::WriteBatch batch;
+            LLD::Ledger->WriteBlock(GetHash(), *this, batch);
 
             /* Index the block by height if enabled. */
             if(config::GetBoolArg("-indexheight"))
-                LLD::Ledger->IndexBlock(nHeight, GetHash());
+                LLD::Ledger->IndexBlock(nHeight, GetHash(), batch);
 
             /* Update chain pointer for previous block. */
             if(!prev.IsNull())
             {
                 prev.hashNextBlock = GetHash();
-                if(!LLD::Ledger->WriteBlock(prev.GetHash(), prev))
-                    return debug::error(FUNCTION, "failed to update previous block state");
-
-                /* If we just updated hashNextBlock for genesis block, update the in-memory genesis */
-                if(prev.GetHash() == ChainState::Genesis())
-                    ChainState::stateGenesis = prev;
+                LLD::Ledger->WriteBlock(prev.GetHash(), prev, batch);
             }
 
+            if(!LLD::Ledger->Apply(batch))
+                return debug::error(FUNCTION, "failed to update block state");
+
+            /* If we just updated hashNextBlock for genesis block, update the in-memory genesis */
+            if(!prev.IsNull() && prev.GetHash() == ChainState::Genesis())
+                ChainState::stateGenesis = prev;
+
             return true;
         }
 
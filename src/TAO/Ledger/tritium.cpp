@@ -620,6 +620,10 @@ namespace TAO
             /* Start the database transaction. */
             LLD::TxnBegin();
 
+            /* Batch the transactions, to add them to the journal once per database. */
+            LLD::WriteBatch batchLedger;
+            LLD::WriteBatch batchLegacy;
+
             /* Write the transactions. */
             for(const auto& proof : vtx)
             {
@@ -634,9 +638,8 @@ namespace TAO
                     if(!LLD::Ledger->ReadTx(hash, tx, state.fConflicted, FLAGS::MEMPOOL))
                         return debug::error(FUNCTION, "transaction is not in memory pool");
 
-                    /* Write to disk. */
-                    if(!LLD::Ledger->WriteTx(hash, tx))
-                        return debug::error(FUNCTION, "failed to write tx to disk");
+                    /* Add to the batch. */
+                    LLD::Ledger->WriteTx(hash, tx, batchLedger);
                 }
 
                 /* Get the legacy transaction. */
@@ -650,9 +653,8 @@ namespace TAO
                     if(!LLD::Legacy->ReadTx(hash, tx, state.fConflicted, FLAGS::MEMPOOL))
                         return debug::error(FUNCTION, "transaction is not in memory pool");
 
-                    /* Write to disk. */
-                    if(!LLD::Legacy->WriteTx(hash, tx))
-                        return debug::error(FUNCTION, "failed to write tx to disk");
+                    /* Add to the batch. */
+                    LLD::Legacy->WriteTx(hash, tx, batchLegacy);
                 }
 
                 /* Checkpoints DISABLED for now. */
@@ -661,8 +663,14 @@ namespace TAO
             }
 
             /* Add the producer transaction(s) */
-            if(!LLD::Ledger->WriteTx(producer.GetHash(), producer))
-                return debug::error(FUNCTION, "failed to write producer to disk");
+            LLD::Ledger->WriteTx(producer.GetHash(), producer, batchLedger);
+
+            /* Write the batches to disk. */
+            if(!LLD::Ledger->Apply(batchLedger))
+                return debug::error(FUNCTION, "failed to write tx to disk");
+
+            if(!LLD::Legacy->Apply(batchLegacy))
+                return debug::error(FUNCTION, "failed to write tx to disk");
 
             /* Accept the block state. */
             if(!state.Index())
@@ -673,7 +681,8 @@ namespace TAO
             }
 
             /* Commit the transaction to database. */
-            LLD::TxnCommit();
+            if(!LLD::TxnCommit())
+                return debug::error(FUNCTION, "failed to commit block to disk");
 
             /* Check for best chain. */
             if(GetHash() == ChainState::hashBestChain.load())
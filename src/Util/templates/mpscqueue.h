@@ -0,0 +1,156 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_UTIL_TEMPLATES_MPSCQUEUE_H
+#define NEXUS_UTIL_TEMPLATES_MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+
+
+/** MPSCQueue
+ *
+ *  Unbounded lock free queue for many producers and one consumer.
+ *
+ *  Producers push with one atomic exchange and never wait on each other or
+ *  the consumer. Only one thread may pop. A push that is half way done is
+ *  not visible yet, so Empty can briefly be true while a producer is pushing.
+ *
+ **/
+template<typename Type>
+class MPSCQueue
+{
+    /** Node
+     *
+     *  One linked element of the queue.
+     *
+     **/
+    struct Node
+    {
+        /** The next node, set by the producer that pushed it. **/
+        std::atomic<Node*> pnext;
+
+        /** The value held, moved out when popped. **/
+        Type value;
+
+        Node()
+        : pnext (nullptr)
+        , value ( )
+        {
+        }
+
+        Node(Type&& valueIn)
+        : pnext (nullptr)
+        , value (std::move(valueIn))
+        {
+        }
+    };
+
+
+    /** The last node pushed, swapped by producers. **/
+    std::atomic<Node*> phead;
+
+
+    /** The node before the next one to pop, only touched by the consumer. **/
+    Node* ptail;
+
+
+public:
+
+    /** Default Constructor. **/
+    MPSCQueue()
+    : phead (nullptr)
+    , ptail (nullptr)
+    {
+        /* Start with an empty node for the tail to point at. */
+        ptail = new Node();
+        phead.store(ptail);
+    }
+
+
+    /** Copy Constructor. **/
+    MPSCQueue(const MPSCQueue& queue)            = delete;
+
+
+    /** Copy Assignment. **/
+    MPSCQueue& operator=(const MPSCQueue& queue) = delete;
+
+
+    /** Default Destructor. **/
+    ~MPSCQueue()
+    {
+        while(ptail)
+        {
+            Node* pnext = ptail->pnext.load();
+            delete ptail;
+
+            ptail = pnext;
+        }
+    }
+
+
+    /** Push
+     *
+     *  Add a value to the back of the queue. Safe from any thread.
+     *
+     *  @param[in] value The value to add.
+     *
+     **/
+    void Push(Type value)
+    {
+        Node* pnode = new Node(std::move(value));
+
+        /* Claim the head, then link the previous head to the new node. */
+        Node* pprev = phead.exchange(pnode);
+        pprev->pnext.store(pnode);
+    }
+
+
+    /** Pop
+     *
+     *  Take the value at the front of the queue. Consumer thread only.
+     *
+     *  @param[out] value The value taken.
+     *
+     *  @return True if a value was taken, false if the queue was empty.
+     *
+     **/
+    bool Pop(Type& value)
+    {
+        Node* pnext = ptail->pnext.load();
+        if(pnext == nullptr)
+            return false;
+
+        /* The popped node becomes the new empty tail. */
+        value = std::move(pnext->value);
+
+        delete ptail;
+        ptail = pnext;
+
+        return true;
+    }
+
+
+    /** Empty
+     *
+     *  Check if there is a value to pop. Consumer thread only.
+     *
+     **/
+    bool Empty() const
+    {
+        return ptail->pnext.load() == nullptr;
+    }
+};
+
+#endif
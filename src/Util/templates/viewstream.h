@@ -0,0 +1,200 @@
+/*__________________________________________________________________________________________
+
+            (c) Hash(BEGIN(Satoshi[2010]), END(Sunny[2012])) == Videlicet[2014] ++
+
+            (c) Copyright The Nexus Developers 2014 - 2019
+
+            Distributed under the MIT software license, see the accompanying
+            file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+            "ad vocem populi" - To the Voice of the People
+
+____________________________________________________________________________________________*/
+
+#pragma once
+#ifndef NEXUS_UTIL_TEMPLATES_VIEWSTREAM_H
+#define NEXUS_UTIL_TEMPLATES_VIEWSTREAM_H
+
+#include <Util/templates/serialize.h>
+#include <Util/include/debug.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+
+/** ViewStream
+ *
+ *  Read only stream over bytes it does not own, for deserializing records
+ *  in place from a cache or memory mapped buffer without copying them.
+ *  The owner handle keeps the buffer alive for as long as the view is held.
+ *
+ **/
+class ViewStream
+{
+    /** Handle keeping the viewed buffer alive. **/
+    std::shared_ptr<const void> pOwner;
+
+
+    /** The beginning of the viewed bytes. **/
+    const uint8_t* pBegin;
+
+
+    /** The total viewed bytes. **/
+    uint64_t nSize;
+
+
+    /** The current reading position. **/
+    mutable uint64_t nReadPos;
+
+
+    /** The serialization type. **/
+    uint32_t nSerType;
+
+
+    /** The serializtion version **/
+    uint32_t nSerVersion;
+
+
+public:
+
+    /** Default Constructor. **/
+    ViewStream(const uint32_t nSerTypeIn, const uint32_t nSerVersionIn)
+    : pOwner      ( )
+    , pBegin      (nullptr)
+    , nSize       (0)
+    , nReadPos    (0)
+    , nSerType    (nSerTypeIn)
+    , nSerVersion (nSerVersionIn)
+    {
+    }
+
+
+    /** SetView
+     *
+     *  Point the stream at a new buffer and rewind it.
+     *
+     *  @param[in] pOwnerIn Handle keeping the buffer alive, may be empty if the caller guarantees it.
+     *  @param[in] pBeginIn The beginning of the bytes to view.
+     *  @param[in] nSizeIn The total bytes to view.
+     *
+     **/
+    void SetView(const std::shared_ptr<const void>& pOwnerIn, const uint8_t* pBeginIn, const uint64_t nSizeIn)
+    {
+        pOwner   = pOwnerIn;
+        pBegin   = pBeginIn;
+        nSize    = nSizeIn;
+        nReadPos = 0;
+    }
+
+
+    /** SetNull
+     *
+     *  Release the viewed buffer.
+     *
+     **/
+    void SetNull()
+    {
+        SetView(nullptr, nullptr, 0);
+    }
+
+
+    /** IsNull
+     *
+     *  Returns if the stream views no bytes.
+     *
+     **/
+    bool IsNull() const
+    {
+        return nSize == 0;
+    }
+
+
+    /** GetPos
+     *
+     *  Gets the position in the stream.
+     *
+     **/
+    uint64_t GetPos() const
+    {
+        return nReadPos;
+    }
+
+
+    /** End
+     *
+     *  Returns if end of stream is found.
+     *
+     **/
+    bool End() const
+    {
+        return nReadPos >= nSize;
+    }
+
+
+    /** size
+     *
+     *  Get the size of the viewed bytes.
+     *
+     **/
+    uint64_t size() const
+    {
+        return nSize;
+    }
+
+
+    /** data
+     *
+     *  Get the beginning of the viewed bytes.
+     *
+     **/
+    const uint8_t* data() const
+    {
+        return pBegin;
+    }
+
+
+    /** read
+     *
+     *  Reads raw data from the stream.
+     *
+     *  @param[in] pch The pointer to beginning of memory to write.
+     *  @param[in] nBytes The total number of bytes to read.
+     *
+     *  @return Returns a reference to the ViewStream object.
+     *
+     **/
+    const ViewStream& read(char* pch, uint64_t nBytes) const
+    {
+        /* Check size constraints. */
+        if(nReadPos + nBytes > nSize)
+            throw std::runtime_error(debug::safe_printstr(FUNCTION, "reached end of stream ", nReadPos));
+
+        /* Copy the bytes into the object. */
+        std::copy(pBegin + nReadPos, pBegin + nReadPos + nBytes, (uint8_t*)pch);
+
+        /* Iterate the read position. */
+        nReadPos += nBytes;
+
+        return *this;
+    }
+
+
+    /** Operator Overload >>
+     *
+     *  Deserializes data out of the viewed bytes.
+     *
+     *  @param[out] obj The object to de-serialize from the stream.
+     *
+     **/
+    template<typename Type>
+    const ViewStream& operator>>(Type& obj) const
+    {
+        /* Unserialize from the stream. */
+        ::Unserialize(*this, obj, nSerType, nSerVersion);
+        return (*this);
+    }
+};
+
+#endif
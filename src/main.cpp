@@ -142,10 +142,14 @@ int main(int argc, char** argv)
     bool fFailed = config::fShutdown.load();
     if(!fFailed)
     {
-        /* Initialize LLD. */
-        LLD::Initialize();
+        /* Initialize LLD, stopping here if it failed or only had to export. */
+        if(!LLD::Initialize() || config::fShutdown.load())
+            fFailed = true;
+    }
 
 
+    if(!fFailed)
+    {
         /* Initialize ChainState. */
         TAO::Ledger::ChainState::Initialize();
 
@@ -0,0 +1,99 @@
+#include <Util/include/runtime.h>
+#include <Util/include/config.h>
+#include <Util/include/filesystem.h>
+
+#include <LLD/templates/sector.h>
+#include <LLD/templates/batch.h>
+#include <LLD/keychain/hashmap.h>
+#include <LLD/cache/binary_lru.h>
+
+#include <LLD/include/enum.h>
+
+#include <unit/catch2/catch.hpp>
+
+
+typedef LLD::SectorDatabase<LLD::BinaryHashMap, LLD::BinaryLRU> BatchDB;
+
+
+//write records one at a time, or as a batch, returning the microseconds taken
+static uint64_t WriteRecords(BatchDB* db, const uint32_t nRecords, const bool fBatch, const bool fTransaction)
+{
+    runtime::timer timer;
+    timer.Start();
+
+    if(fTransaction)
+        db->TxnBegin();
+
+    if(fBatch)
+    {
+        LLD::WriteBatch batch;
+        for(uint32_t i = 0; i < nRecords; i++)
+            batch.Write(std::make_pair(std::string("record"), i), std::vector<uint8_t>(256, static_cast<uint8_t>(i)), "record");
+
+        db->Apply(batch);
+    }
+    else
+    {
+        for(uint32_t i = 0; i < nRecords; i++)
+            db->Write(std::make_pair(std::string("record"), i), std::vector<uint8_t>(256, static_cast<uint8_t>(i)), "record");
+    }
+
+    if(fTransaction)
+    {
+        db->TxnCheckpoint();
+        db->TxnCommit();
+        db->TxnRelease();
+    }
+
+    return timer.ElapsedMicroseconds();
+}
+
+
+//count the records that read back with the value they were written with
+static uint32_t CountRecords(BatchDB* db, const uint32_t nRecords)
+{
+    uint32_t nFound = 0;
+    for(uint32_t i = 0; i < nRecords; i++)
+    {
+        std::vector<uint8_t> vRecord;
+        if(db->Read(std::make_pair(std::string("record"), i), vRecord) && vRecord == std::vector<uint8_t>(256, static_cast<uint8_t>(i)))
+            ++nFound;
+    }
+
+    return nFound;
+}
+
+
+TEST_CASE( "LLD Write Batch Benchmarks", "[LLD]")
+{
+    debug::log(0, "===== Begin LLD Write Batch Benchmarks =====");
+
+    const uint32_t nRecords = 10000;
+
+    //each combination of single writes or a batch, inside or outside of a transaction
+    for(uint32_t nTransaction = 0; nTransaction < 2; nTransaction++)
+    {
+        for(uint32_t nBatch = 0; nBatch < 2; nBatch++)
+        {
+            const std::string strName = debug::safe_printstr("/bench/batch/", nTransaction ? "txn" : "direct", nBatch ? "_batch" : "_single");
+            filesystem::remove_directories(config::GetDataDir() + strName);
+
+            BatchDB* db = new BatchDB(strName, LLD::FLAGS::CREATE | LLD::FLAGS::FORCE, 256 * 256 * 4, 1024 * 1024);
+
+            const uint64_t nTime = WriteRecords(db, nRecords, nBatch, nTransaction);
+            debug::log(0, ANSI_COLOR_BRIGHT_CYAN, nTransaction ? "Txn::" : "Direct::", nBatch ? "Batch::" : "Single::", ANSI_COLOR_RESET,
+                nRecords, " records in ", nTime, " microseconds (", (uint64_t(nRecords) * 1000000) / std::max(nTime, uint64_t(1)), ") per/s");
+
+            delete db;
+
+            //reopen to check every record reached disk
+            db = new BatchDB(strName, LLD::FLAGS::CREATE | LLD::FLAGS::FORCE, 256 * 256 * 4, 1024 * 1024);
+            debug::log(0, ANSI_COLOR_BRIGHT_CYAN, nTransaction ? "Txn::" : "Direct::", nBatch ? "Batch::" : "Single::", ANSI_COLOR_RESET,
+                CountRecords(db, nRecords), " of ", nRecords, " records read back");
+
+            delete db;
+        }
+    }
+
+    debug::log(0, "===== End LLD Write Batch Benchmarks =====\n");
+}
@@ -2,60 +2,164 @@
 
 #include <LLC/include/random.h>
 
+#include <LLD/cache/binary_clock.h>
 #include <LLD/cache/binary_lru.h>
+#include <LLD/templates/key.h>
 
+#include <LLD/include/enum.h>
 #include <LLD/include/version.h>
 
 #include <Util/templates/datastream.h>
 
 #include <unit/catch2/catch.hpp>
 
+#include <random>
+#include <thread>
 
-TEST_CASE( "Binary LRU Benchmarks", "[LLD]")
+
+//key of a benchmark record
+std::vector<uint8_t> CacheKey(const uint256_t& hash, const uint32_t n)
 {
-    debug::log(0, "===== Begin Binary LRU Benchmarks =====");
+    DataStream ssKey(SER_LLD, LLD::DATABASE_VERSION);
+    ssKey << std::make_pair(std::string("data"), hash + n);
+
+    return ssKey.Bytes();
+}
+
+
+//put/get throughput, then hit rate of a cache read through on miss with a skewed workload
+template<typename CacheType>
+void CacheBench(const std::string& strName)
+{
+    const uint32_t nRecords = 1000000;
+
+    DataStream ssData(SER_LLD, LLD::DATABASE_VERSION);
+    ssData << uint1024_t(4934943);
 
-    //benchmarks
-    LLD::BinaryLRU* cache = new LLD::BinaryLRU();
     uint256_t hash = LLC::GetRand256();
     {
+        CacheType* cache = new CacheType(1024 * 1024 * 256);
+
         runtime::timer timer;
         timer.Start();
 
-        for(int i = 0; i < 1000000; i++)
-        {
-            DataStream ssKey(SER_LLD, LLD::DATABASE_VERSION);
-            ssKey << std::make_pair(std::string("data"), hash + i);
+        for(uint32_t i = 0; i < nRecords; i++)
+            cache->Put(LLD::SectorKey(LLD::STATE::READY, std::vector<uint8_t>(), 0, i, 128), CacheKey(hash, i), ssData.Bytes());
 
-            DataStream ssData(SER_LLD, LLD::DATABASE_VERSION);
-            ssData << uint1024_t(4934943);
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, strName, "::Put::", ANSI_COLOR_RESET, double(nRecords) / nTime, " million records / second");
 
-            cache->Put(ssKey.Bytes(), ssData.Bytes());
-        }
+        timer.Reset();
 
-        uint64_t nTime = timer.ElapsedMicroseconds();
-        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Put::", ANSI_COLOR_RESET, 1000000.0 / nTime, " million records / second");
+        std::vector<uint8_t> vBytes;
+        for(uint32_t i = 0; i < nRecords; i++)
+            cache->Get(CacheKey(hash, i), vBytes);
+
+        nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, strName, "::Get::", ANSI_COLOR_RESET, double(nRecords) / nTime, " million records / second");
+
+        delete cache;
     }
 
 
     {
+        //90% of reads go to 10% of 100k keys, the cache fits 20% of them
+        const uint32_t nKeys  = 100000;
+        const uint32_t nReads = 1000000;
+
+        CacheType* cache = new CacheType(nKeys / 5 * (ssData.size() + 128));
+
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<uint32_t> hot(0, nKeys / 10 - 1);
+        std::uniform_int_distribution<uint32_t> all(0, nKeys - 1);
+        std::uniform_int_distribution<uint32_t> pick(0, 9);
+
         runtime::timer timer;
         timer.Start();
 
-        for(int i = 0; i < 1000000; i++)
+        uint32_t nHits = 0;
+        std::vector<uint8_t> vBytes;
+        for(uint32_t i = 0; i < nReads; i++)
         {
-            DataStream ssKey(SER_LLD, LLD::DATABASE_VERSION);
-            ssKey << std::make_pair(std::string("data"), hash + i);
+            const uint32_t n = (pick(rng) < 9) ? hot(rng) : all(rng);
+
+            std::vector<uint8_t> vKey = CacheKey(hash, n);
+            if(cache->Get(vKey, vBytes))
+                ++nHits;
+            else
+                cache->Put(LLD::SectorKey(LLD::STATE::READY, vKey, 0, n, 128), vKey, ssData.Bytes());
+        }
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, strName, "::HitRate::", ANSI_COLOR_RESET, 100.0 * nHits / nReads, " % in ",
+            double(nReads) / nTime, " million reads / second");
+
+        delete cache;
+    }
+}
 
-            std::vector<uint8_t> vBytes;
 
-            cache->Get(ssKey.Bytes(), vBytes);
+//concurrent get throughput on a cache holding every key
+template<typename CacheType>
+void CacheConcurrentBench(const std::string& strName)
+{
+    const uint32_t nKeys = 100000;
+    const uint32_t nGets = 1000000;
+
+    DataStream ssData(SER_LLD, LLD::DATABASE_VERSION);
+    ssData << uint1024_t(4934943);
+
+    CacheType* cache = new CacheType(1024 * 1024 * 256);
+
+    uint256_t hash = LLC::GetRand256();
+    for(uint32_t i = 0; i < nKeys; i++)
+        cache->Put(LLD::SectorKey(LLD::STATE::READY, std::vector<uint8_t>(), 0, i, 128), CacheKey(hash, i), ssData.Bytes());
+
+    //the same total gets spread over more threads
+    for(uint32_t nThreads = 1; nThreads <= 8; nThreads *= 2)
+    {
+        runtime::timer timer;
+        timer.Start();
+
+        std::vector<std::thread> vThreads;
+        for(uint32_t t = 0; t < nThreads; t++)
+        {
+            vThreads.push_back(std::thread([&, t]()
+            {
+                std::vector<uint8_t> vBytes;
+                for(uint32_t i = t; i < nGets; i += nThreads)
+                    cache->Get(CacheKey(hash, i % nKeys), vBytes);
+            }));
         }
 
+        for(auto& thread : vThreads)
+            thread.join();
+
         uint64_t nTime = timer.ElapsedMicroseconds();
-        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Get::", ANSI_COLOR_RESET, 1000000.0 / nTime, " million records / second");
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, strName, "::Get::", ANSI_COLOR_RESET, nThreads, " threads ", double(nGets) / nTime, " million records / second");
     }
 
+    delete cache;
+}
+
+
+TEST_CASE( "Binary LRU Benchmarks", "[LLD]")
+{
+    debug::log(0, "===== Begin Binary LRU Benchmarks =====");
+
+    CacheBench<LLD::BinaryLRU>("BinaryLRU");
+    CacheBench<LLD::BinaryCLOCK>("BinaryCLOCK");
 
     debug::log(0, "===== End Binary LRU Benchmarks =====\n");
 }
+
+
+TEST_CASE( "Binary LRU Concurrent Get Benchmarks", "[LLD]")
+{
+    debug::log(0, "===== Begin Binary LRU Concurrent Get Benchmarks =====");
+
+    CacheConcurrentBench<LLD::BinaryLRU>("BinaryLRU");
+    CacheConcurrentBench<LLD::BinaryCLOCK>("BinaryCLOCK");
+
+    debug::log(0, "===== End Binary LRU Concurrent Get Benchmarks =====\n");
+}
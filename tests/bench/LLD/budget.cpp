@@ -0,0 +1,107 @@
+#include <Util/include/runtime.h>
+#include <Util/include/config.h>
+#include <Util/include/filesystem.h>
+
+#include <LLC/include/random.h>
+
+#include <LLD/templates/sector.h>
+#include <LLD/keychain/hashmap.h>
+#include <LLD/cache/binary_lru.h>
+#include <LLD/cache/binary_clock.h>
+
+#include <LLD/include/budget.h>
+#include <LLD/include/enum.h>
+
+#include <unit/catch2/catch.hpp>
+
+
+typedef LLD::SectorDatabase<LLD::BinaryHashMap, LLD::BinaryLRU>   BudgetLRU;
+typedef LLD::SectorDatabase<LLD::BinaryHashMap, LLD::BinaryCLOCK> BudgetCLOCK;
+
+
+//read random records of a database, returning the hits of the cache pool
+template<typename DatabaseType>
+static uint64_t ReadRandom(DatabaseType* db, const uint32_t nRecords, const uint32_t nReads)
+{
+    const uint64_t nHits = db->GetMetrics().ToJSON()["cache_hits_total"].template get<uint64_t>();
+
+    std::vector<uint8_t> vRecord;
+    for(uint32_t i = 0; i < nReads; i++)
+        db->Read(std::make_pair(std::string("record"), LLC::GetRandInt(nRecords - 1)), vRecord);
+
+    return db->GetMetrics().ToJSON()["cache_hits_total"].template get<uint64_t>() - nHits;
+}
+
+
+//write records of one kilobyte, reopening to wait for them to reach disk
+template<typename DatabaseType>
+static void WriteRecords(const std::string& strName, const uint32_t nRecords)
+{
+    DatabaseType* db = new DatabaseType(strName, LLD::FLAGS::CREATE | LLD::FLAGS::FORCE, 256 * 256 * 4, 1024 * 1024);
+    for(uint32_t i = 0; i < nRecords; i++)
+        db->Write(std::make_pair(std::string("record"), i), std::vector<uint8_t>(1024, static_cast<uint8_t>(i)));
+
+    delete db;
+}
+
+
+TEST_CASE( "LLD Cache Budget Benchmarks", "[LLD]")
+{
+    debug::log(0, "===== Begin LLD Cache Budget Benchmarks =====");
+
+    //a hot database with sixteen megabytes of records, and a cold one with one
+    const uint32_t nHotRecords  = 16 * 1024;
+    const uint32_t nColdRecords = 1024;
+    const uint32_t nRounds      = 40;
+
+    filesystem::remove_directories(config::GetDataDir() + "/bench/budget");
+    WriteRecords<BudgetLRU>("/bench/budget/hot", nHotRecords);
+    WriteRecords<BudgetCLOCK>("/bench/budget/cold", nColdRecords);
+
+    //the same twenty megabytes, split the wrong way up front, and then shared by a budget
+    for(uint32_t nShared = 0; nShared < 2; nShared++)
+    {
+        if(nShared)
+            LLD::pCacheBudget = new LLD::CacheBudget(20 * 1024 * 1024, 0);
+
+        BudgetLRU*   dbHot  = new BudgetLRU("/bench/budget/hot",    LLD::FLAGS::CREATE | LLD::FLAGS::FORCE, 256 * 256 * 4, 4 * 1024 * 1024);
+        BudgetCLOCK* dbCold = new BudgetCLOCK("/bench/budget/cold", LLD::FLAGS::CREATE | LLD::FLAGS::FORCE, 256 * 256 * 4, 16 * 1024 * 1024);
+
+        runtime::timer timer;
+        timer.Start();
+
+        for(uint32_t nRound = 1; nRound <= nRounds; nRound++)
+        {
+            const uint64_t nHotHits  = ReadRandom(dbHot,  nHotRecords,  nHotRecords);
+            const uint64_t nColdHits = ReadRandom(dbCold, nColdRecords, nColdRecords);
+
+            if(LLD::pCacheBudget)
+                LLD::pCacheBudget->Rebalance();
+
+            //log every tenth round
+            if(nRound % 10 == 0)
+            {
+                debug::log(0, ANSI_COLOR_BRIGHT_CYAN, nShared ? "Shared::" : "Static::", ANSI_COLOR_RESET, "round ", nRound,
+                    " | hot ", dbHot->GetMetrics().ToJSON()["cache_capacity_bytes"].get<uint64_t>() / 1024, " Kb ",
+                    double(nHotHits) * 100 / nHotRecords, "% hits",
+                    " | cold ", dbCold->GetMetrics().ToJSON()["cache_capacity_bytes"].get<uint64_t>() / 1024, " Kb ",
+                    double(nColdHits) * 100 / nColdRecords, "% hits");
+            }
+        }
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, nShared ? "Shared::" : "Static::", ANSI_COLOR_RESET,
+            double(nTime) / (nRounds * (nHotRecords + nColdRecords)), " microseconds / read");
+
+        delete dbHot;
+        delete dbCold;
+
+        if(LLD::pCacheBudget)
+        {
+            delete LLD::pCacheBudget;
+            LLD::pCacheBudget = nullptr;
+        }
+    }
+
+    debug::log(0, "===== End LLD Cache Budget Benchmarks =====\n");
+}
@@ -0,0 +1,106 @@
+#include <Util/include/runtime.h>
+#include <Util/include/config.h>
+#include <Util/include/filesystem.h>
+
+#include <LLC/include/random.h>
+
+#include <LLD/templates/sector.h>
+#include <LLD/keychain/hashmap.h>
+#include <LLD/cache/binary_lru.h>
+
+#include <LLD/include/enum.h>
+
+#include <unit/catch2/catch.hpp>
+
+
+typedef LLD::SectorDatabase<LLD::BinaryHashMap, LLD::BinaryLRU> BulkDB;
+
+
+//count the records of a database that read back as written
+static uint32_t CountRecords(BulkDB* db, const uint256_t& hash, const uint32_t nRecords)
+{
+    uint32_t nFound = 0;
+    for(uint32_t i = 0; i < nRecords; i++)
+    {
+        uint64_t nValue = 0;
+        if(db->Read(std::make_pair(std::string("data"), hash + i), nValue) && nValue == i)
+            ++nFound;
+    }
+
+    return nFound;
+}
+
+
+TEST_CASE( "Sector Database Bulk Export and Import Benchmarks", "[LLD]")
+{
+    debug::log(0, "===== Begin Sector Database Bulk Export and Import Benchmarks =====");
+
+    const uint32_t nRecords = 100000;
+    const uint32_t nBuckets = 256 * 256 * 4;
+
+    //the keys are longer than the hashmap keeps, so they are imported by bucket
+    const uint256_t hash = LLC::GetRand256();
+
+    const std::string strFile = config::GetDataDir() + "/bench/bulk.lldbulk";
+    filesystem::remove_directories(config::GetDataDir() + "/bench/bulk");
+
+    //time the records through the cache writer, reopening to wait for them to reach disk
+    {
+        BulkDB* db = new BulkDB("/bench/bulk/source", LLD::FLAGS::CREATE | LLD::FLAGS::FORCE, nBuckets, 1024 * 1024);
+
+        runtime::timer timer;
+        timer.Start();
+
+        for(uint32_t i = 0; i < nRecords; i++)
+            db->Write(std::make_pair(std::string("data"), hash + i), uint64_t(i));
+
+        delete db;
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Write::", ANSI_COLOR_RESET, nRecords, " records ", double(nTime) / nRecords, " microseconds / record");
+    }
+
+    {
+        BulkDB* db = new BulkDB("/bench/bulk/source", LLD::FLAGS::CREATE | LLD::FLAGS::FORCE, nBuckets, 1024 * 1024);
+
+        runtime::timer timer;
+        timer.Start();
+
+        const bool fExported = db->Export(strFile);
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Export::", ANSI_COLOR_RESET, nRecords, " records ", double(nTime) / nRecords,
+            " microseconds / record", fExported ? "" : " | failed");
+
+        delete db;
+    }
+
+    //import with more keychain threads each time, the keys of a block are split by bucket
+    for(uint32_t nThreads = 1; nThreads <= 4; nThreads *= 2)
+    {
+        const std::string strName = "/bench/bulk/import" + std::to_string(nThreads);
+        BulkDB* db = new BulkDB(strName, LLD::FLAGS::CREATE | LLD::FLAGS::FORCE, nBuckets, 1024 * 1024);
+
+        runtime::timer timer;
+        timer.Start();
+
+        const bool fImported = db->Import(strFile, nThreads);
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+
+        //a second import into the same database is refused
+        const bool fRefused = !db->Import(strFile, nThreads);
+
+        delete db;
+
+        db = new BulkDB(strName, LLD::FLAGS::CREATE | LLD::FLAGS::FORCE, nBuckets, 1024 * 1024);
+        const uint32_t nFound = CountRecords(db, hash, nRecords);
+        delete db;
+
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Import::", ANSI_COLOR_RESET, nThreads, " threads ", nRecords, " records ",
+            double(nTime) / nRecords, " microseconds / record | ", nFound, " read back",
+            fImported ? "" : " | failed", fRefused ? "" : " | second import not refused");
+    }
+
+    debug::log(0, "===== End Sector Database Bulk Export and Import Benchmarks =====\n");
+}
@@ -0,0 +1,107 @@
+#include <Util/include/runtime.h>
+#include <Util/include/args.h>
+#include <Util/include/config.h>
+#include <Util/include/filesystem.h>
+
+#include <LLC/include/random.h>
+
+#include <LLD/templates/sector.h>
+#include <LLD/keychain/hashmap.h>
+#include <LLD/cache/binary_lru.h>
+
+#include <LLD/include/enum.h>
+
+#include <unit/catch2/catch.hpp>
+
+#include <fstream>
+#include <iomanip>
+
+
+typedef LLD::SectorDatabase<LLD::BinaryHashMap, LLD::BinaryLRU> ChecksumDB;
+
+
+//write records, then time disk reads, a scrub, and reads after a byte of the last record is flipped
+static void ChecksumBench(const std::string& strName, const uint8_t nFlags)
+{
+    const uint32_t nRecords = 100000;
+
+    filesystem::remove_directories(config::GetDataDir() + strName);
+
+    //a small cache, so reads go to disk
+    ChecksumDB* db = new ChecksumDB(strName, LLD::FLAGS::CREATE | LLD::FLAGS::FORCE | nFlags, 256 * 256 * 4, 1024 * 64);
+    for(uint32_t i = 0; i < nRecords; i++)
+        db->Write(uint256_t(i), std::vector<uint8_t>(128, static_cast<uint8_t>(i)));
+
+    delete db;
+
+    db = new ChecksumDB(strName, LLD::FLAGS::CREATE | LLD::FLAGS::FORCE | nFlags, 256 * 256 * 4, 1024 * 64);
+    {
+        runtime::timer timer;
+        timer.Start();
+
+        std::vector<uint8_t> vRecord;
+        for(uint32_t i = 0; i < nRecords; i++)
+            db->Read(uint256_t(LLC::GetRandInt(nRecords - 1)), vRecord);
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, strName, " Get::", ANSI_COLOR_RESET, double(nTime) / nRecords, " microseconds / record");
+    }
+
+    if(nFlags & LLD::FLAGS::CHECKSUM)
+    {
+        runtime::timer timer;
+        timer.Start();
+
+        db->Scrub();
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, strName, " Scrub::", ANSI_COLOR_RESET, double(nTime) / nRecords, " microseconds / record");
+    }
+
+    delete db;
+
+    //flip a byte near the end of the first sector file, past the size of the last record
+    {
+        std::fstream stream(debug::safe_printstr(config::GetDataDir(), strName, "/datachain/_block.", std::setfill('0'), std::setw(5), 0),
+            std::ios::in | std::ios::out | std::ios::binary | std::ios::ate);
+
+        const uint64_t nOffset = static_cast<uint64_t>(stream.tellg()) - 4;
+        stream.seekg(nOffset, std::ios::beg);
+
+        char chByte = 0;
+        stream.read(&chByte, 1);
+        stream.seekp(nOffset, std::ios::beg);
+        stream.put(static_cast<char>(chByte ^ 0x20));
+    }
+
+    db = new ChecksumDB(strName, LLD::FLAGS::CREATE | LLD::FLAGS::FORCE | nFlags, 256 * 256 * 4, 1024 * 64);
+    {
+        uint32_t nDamaged = 0;
+        for(uint32_t i = 0; i < nRecords; i++)
+        {
+            std::vector<uint8_t> vRecord;
+            if(!db->Read(uint256_t(i), vRecord) || vRecord != std::vector<uint8_t>(128, static_cast<uint8_t>(i)))
+                ++nDamaged;
+        }
+
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, strName, " Flip::", ANSI_COLOR_RESET, nDamaged, " records read wrong or refused");
+    }
+
+    delete db;
+}
+
+
+TEST_CASE( "LLD Record Checksum Benchmarks", "[LLD]")
+{
+    debug::log(0, "===== Begin LLD Record Checksum Benchmarks =====");
+
+    //scrub only when asked, and as fast as the disk allows
+    config::mapArgs["-lldscrub"]     = "0";
+    config::mapArgs["-lldscrubrate"] = "1073741824";
+
+    ChecksumBench("/bench/plain", 0);
+    ChecksumBench("/bench/checksum", LLD::FLAGS::CHECKSUM);
+    ChecksumBench("/bench/checksum_compressed", LLD::FLAGS::CHECKSUM | LLD::FLAGS::COMPRESS);
+
+    debug::log(0, "===== End LLD Record Checksum Benchmarks =====\n");
+}
@@ -0,0 +1,100 @@
+#include <Util/include/runtime.h>
+#include <Util/include/config.h>
+#include <Util/include/filesystem.h>
+
+#include <LLC/include/random.h>
+
+#include <LLD/templates/sector.h>
+#include <LLD/keychain/hashmap.h>
+#include <LLD/cache/binary_lru.h>
+
+#include <LLD/include/enum.h>
+
+#include <unit/catch2/catch.hpp>
+
+#include <fstream>
+#include <iomanip>
+
+
+typedef LLD::SectorDatabase<LLD::BinaryHashMap, LLD::BinaryLRU> BenchDB;
+
+
+//a record shaped like a register state, a few shared owners and mostly zeroed state
+std::vector<uint8_t> RegisterRecord(const uint256_t& hashOwner, const uint32_t nRecord)
+{
+    DataStream ssRecord(SER_LLD, LLD::DATABASE_VERSION);
+    ssRecord << hashOwner << uint64_t(1560000000 + nRecord) << LLC::GetRand256() << std::vector<uint8_t>(96, 0) << hashOwner;
+
+    return ssRecord.Bytes();
+}
+
+
+//total bytes of the sector files of a database
+uint64_t SectorBytes(const std::string& strName)
+{
+    uint64_t nBytes = 0;
+    for(uint32_t nFile = 0; ; ++nFile)
+    {
+        std::ifstream stream(debug::safe_printstr(config::GetDataDir(), strName, "/datachain/_block.", std::setfill('0'), std::setw(5), nFile), std::ios::binary | std::ios::ate);
+        if(!stream)
+            break;
+
+        nBytes += stream.tellg();
+    }
+
+    return nBytes;
+}
+
+
+//write and read the same records with and without compression
+void CompressBench(const std::string& strName, const uint8_t nFlags)
+{
+    const uint32_t nRecords = 100000;
+
+    filesystem::remove_directories(config::GetDataDir() + strName);
+
+    //a small cache, so reads go to disk
+    BenchDB* db = new BenchDB(strName, LLD::FLAGS::CREATE | LLD::FLAGS::FORCE | nFlags, 256 * 256 * 4, 1024 * 64);
+
+    std::vector<uint256_t> vOwners;
+    for(uint32_t i = 0; i < 16; i++)
+        vOwners.push_back(LLC::GetRand256());
+
+    {
+        runtime::timer timer;
+        timer.Start();
+
+        for(uint32_t i = 0; i < nRecords; i++)
+            db->Write(uint256_t(i), RegisterRecord(vOwners[i % vOwners.size()], i));
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, strName, " Put::", ANSI_COLOR_RESET, double(nTime) / nRecords, " microseconds / record");
+    }
+
+    debug::log(0, ANSI_COLOR_BRIGHT_CYAN, strName, " Disk::", ANSI_COLOR_RESET, SectorBytes(strName), " bytes");
+
+    {
+        runtime::timer timer;
+        timer.Start();
+
+        std::vector<uint8_t> vRecord;
+        for(uint32_t i = 0; i < nRecords; i++)
+            db->Read(uint256_t(LLC::GetRandInt(nRecords - 1)), vRecord);
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, strName, " Get::", ANSI_COLOR_RESET, double(nTime) / nRecords, " microseconds / record");
+    }
+
+    delete db;
+}
+
+
+TEST_CASE( "LLD Compression Benchmarks", "[LLD]")
+{
+    debug::log(0, "===== Begin LLD Compression Benchmarks =====");
+
+    CompressBench("bench/uncompressed", 0);
+    CompressBench("bench/compressed", LLD::FLAGS::COMPRESS);
+
+    debug::log(0, "===== End LLD Compression Benchmarks =====\n");
+}
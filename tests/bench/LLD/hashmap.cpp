@@ -0,0 +1,142 @@
+#include <Util/include/runtime.h>
+#include <Util/include/config.h>
+#include <Util/include/filesystem.h>
+
+#include <LLC/include/random.h>
+
+#include <LLD/keychain/hashmap.h>
+#include <LLD/templates/key.h>
+
+#include <LLD/include/enum.h>
+#include <LLD/include/version.h>
+
+#include <Util/templates/datastream.h>
+
+#include <unit/catch2/catch.hpp>
+
+#include <thread>
+
+
+TEST_CASE( "Binary Hash Map Miss Benchmarks", "[LLD]")
+{
+    debug::log(0, "===== Begin Binary Hash Map Miss Benchmarks =====");
+
+    //small bucket count so that appends build deep file chains
+    const uint32_t nBuckets = 4096;
+    const uint32_t nGets    = 100000;
+
+    uint256_t hash = LLC::GetRand256();
+    for(uint32_t nLayers = 1; nLayers <= 16; nLayers *= 2)
+    {
+        std::string strPath = config::GetDataDir() + "/bench/hashmap/" + std::to_string(nLayers) + "/";
+        filesystem::remove_directories(strPath);
+
+        LLD::BinaryHashMap* hashmap = new LLD::BinaryHashMap(strPath, LLD::FLAGS::APPEND | LLD::FLAGS::CREATE, nBuckets);
+
+        //fill the hashmap to an average depth of nLayers files
+        for(uint32_t i = 0; i < nBuckets * nLayers; i++)
+        {
+            DataStream ssKey(SER_LLD, LLD::DATABASE_VERSION);
+            ssKey << std::make_pair(std::string("data"), hash + i);
+
+            hashmap->Put(LLD::SectorKey(LLD::STATE::READY, ssKey.Bytes(), 0, i, 64));
+        }
+
+        //keys that were never written, which need to check every file in the chain
+        {
+            runtime::timer timer;
+            timer.Start();
+
+            LLD::SectorKey cKey;
+            for(uint32_t i = 0; i < nGets; i++)
+            {
+                DataStream ssKey(SER_LLD, LLD::DATABASE_VERSION);
+                ssKey << std::make_pair(std::string("miss"), hash + i);
+
+                hashmap->Get(ssKey.Bytes(), cKey);
+            }
+
+            uint64_t nTime = timer.ElapsedMicroseconds();
+            debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Miss::", ANSI_COLOR_RESET, nLayers, " files ", double(nTime) / nGets, " microseconds / get");
+        }
+
+        //keys that were written, for comparison
+        {
+            runtime::timer timer;
+            timer.Start();
+
+            LLD::SectorKey cKey;
+            for(uint32_t i = 0; i < nGets; i++)
+            {
+                DataStream ssKey(SER_LLD, LLD::DATABASE_VERSION);
+                ssKey << std::make_pair(std::string("data"), hash + (i % (nBuckets * nLayers)));
+
+                hashmap->Get(ssKey.Bytes(), cKey);
+            }
+
+            uint64_t nTime = timer.ElapsedMicroseconds();
+            debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Hit::", ANSI_COLOR_RESET, nLayers, " files ", double(nTime) / nGets, " microseconds / get");
+        }
+
+        delete hashmap;
+    }
+
+    debug::log(0, "===== End Binary Hash Map Miss Benchmarks =====\n");
+}
+
+
+TEST_CASE( "Binary Hash Map Concurrent Get Benchmarks", "[LLD]")
+{
+    debug::log(0, "===== Begin Binary Hash Map Concurrent Get Benchmarks =====");
+
+    const uint32_t nKeys = 100000;
+    const uint32_t nGets = 400000;
+
+    std::string strPath = config::GetDataDir() + "/bench/hashmap/concurrent/";
+    filesystem::remove_directories(strPath);
+
+    LLD::BinaryHashMap* hashmap = new LLD::BinaryHashMap(strPath, LLD::FLAGS::CREATE | LLD::FLAGS::WRITE, 77773);
+
+    //fill the hashmap
+    uint256_t hash = LLC::GetRand256();
+    for(uint32_t i = 0; i < nKeys; i++)
+    {
+        DataStream ssKey(SER_LLD, LLD::DATABASE_VERSION);
+        ssKey << std::make_pair(std::string("data"), hash + i);
+
+        hashmap->Put(LLD::SectorKey(LLD::STATE::READY, ssKey.Bytes(), 0, i, 64));
+    }
+
+    //the same total gets spread over more threads
+    for(uint32_t nThreads = 1; nThreads <= 8; nThreads *= 2)
+    {
+        runtime::timer timer;
+        timer.Start();
+
+        std::vector<std::thread> vThreads;
+        for(uint32_t t = 0; t < nThreads; t++)
+        {
+            vThreads.push_back(std::thread([&, t]()
+            {
+                LLD::SectorKey cKey;
+                for(uint32_t i = t; i < nGets; i += nThreads)
+                {
+                    DataStream ssKey(SER_LLD, LLD::DATABASE_VERSION);
+                    ssKey << std::make_pair(std::string("data"), hash + (i % nKeys));
+
+                    hashmap->Get(ssKey.Bytes(), cKey);
+                }
+            }));
+        }
+
+        for(auto& thread : vThreads)
+            thread.join();
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Get::", ANSI_COLOR_RESET, nThreads, " threads ", double(nGets) / nTime, " million records / second");
+    }
+
+    delete hashmap;
+
+    debug::log(0, "===== End Binary Hash Map Concurrent Get Benchmarks =====\n");
+}
@@ -0,0 +1,160 @@
+#include <Util/include/runtime.h>
+#include <Util/include/config.h>
+#include <Util/include/filesystem.h>
+
+#include <LLC/include/random.h>
+
+#include <LLD/keychain/hashmap.h>
+#include <LLD/keychain/linearmap.h>
+#include <LLD/templates/key.h>
+
+#include <LLD/include/enum.h>
+#include <LLD/include/version.h>
+
+#include <Util/templates/datastream.h>
+
+#include <unit/catch2/catch.hpp>
+
+#include <fstream>
+#include <iomanip>
+
+
+//the bytes of a file, 0 if it doesn't exist
+static uint64_t FileSize(const std::string& strFile)
+{
+    std::ifstream stream(strFile, std::ios::in | std::ios::binary | std::ios::ate);
+    if(!stream)
+        return 0;
+
+    return static_cast<uint64_t>(stream.tellg());
+}
+
+
+//time gets of keys that were written and keys that never were, and report the average depth of the used buckets
+template<class KeychainType>
+static void TimeKeychain(KeychainType* keychain, const std::string& strName, const uint256_t& hash, const uint32_t nKeys, const uint32_t nGets)
+{
+    uint64_t nDepth = 0;
+    uint32_t nUsed  = 0;
+    for(uint32_t nBucket = 0; nBucket < keychain->TotalBuckets(); ++nBucket)
+    {
+        const uint16_t nBucketDepth = keychain->Depth(nBucket);
+        if(nBucketDepth == 0)
+            continue;
+
+        nDepth += nBucketDepth;
+        ++nUsed;
+    }
+
+    debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Depth::", ANSI_COLOR_RESET, strName, " ", nKeys, " keys ",
+        keychain->TotalBuckets(), " buckets ", nUsed ? double(nDepth) / nUsed : 0.0, " average depth");
+
+    LLD::SectorKey cKey;
+    {
+        runtime::timer timer;
+        timer.Start();
+
+        for(uint32_t i = 0; i < nGets; i++)
+        {
+            DataStream ssKey(SER_LLD, LLD::DATABASE_VERSION);
+            ssKey << std::make_pair(std::string("data"), hash + (i % nKeys));
+
+            keychain->Get(ssKey.Bytes(), cKey);
+        }
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Hit::", ANSI_COLOR_RESET, strName, " ", nKeys, " keys ", double(nTime) / nGets, " microseconds / get");
+    }
+
+    {
+        runtime::timer timer;
+        timer.Start();
+
+        for(uint32_t i = 0; i < nGets; i++)
+        {
+            DataStream ssKey(SER_LLD, LLD::DATABASE_VERSION);
+            ssKey << std::make_pair(std::string("miss"), hash + i);
+
+            keychain->Get(ssKey.Bytes(), cKey);
+        }
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Miss::", ANSI_COLOR_RESET, strName, " ", nKeys, " keys ", double(nTime) / nGets, " microseconds / get");
+    }
+}
+
+
+TEST_CASE( "Binary Linear Map Growth Benchmarks", "[LLD]")
+{
+    debug::log(0, "===== Begin Binary Linear Map Growth Benchmarks =====");
+
+    //both keychains start sized for 4096 keys and are filled far past it
+    const uint32_t nBuckets = 4096;
+    const uint32_t nGets    = 100000;
+
+    uint256_t hash = LLC::GetRand256();
+    for(uint32_t nKeys = nBuckets; nKeys <= nBuckets * 16; nKeys *= 4)
+    {
+        std::string strHashPath   = config::GetDataDir() + "/bench/linearmap/hashmap/" + std::to_string(nKeys) + "/";
+        std::string strLinearPath = config::GetDataDir() + "/bench/linearmap/linear/" + std::to_string(nKeys) + "/";
+        filesystem::remove_directories(strHashPath);
+        filesystem::remove_directories(strLinearPath);
+
+        LLD::BinaryHashMap* hashmap     = new LLD::BinaryHashMap(strHashPath, LLD::FLAGS::CREATE | LLD::FLAGS::WRITE, nBuckets);
+        LLD::BinaryLinearMap* linearmap = new LLD::BinaryLinearMap(strLinearPath, LLD::FLAGS::CREATE | LLD::FLAGS::WRITE, nBuckets);
+
+        //time the writes, the linear map splits a bucket at a time as it fills
+        {
+            runtime::timer timer;
+            timer.Start();
+
+            for(uint32_t i = 0; i < nKeys; i++)
+            {
+                DataStream ssKey(SER_LLD, LLD::DATABASE_VERSION);
+                ssKey << std::make_pair(std::string("data"), hash + i);
+
+                hashmap->Put(LLD::SectorKey(LLD::STATE::READY, ssKey.Bytes(), 0, i, 64));
+            }
+
+            uint64_t nHash = timer.ElapsedMicroseconds();
+            timer.Reset();
+
+            for(uint32_t i = 0; i < nKeys; i++)
+            {
+                DataStream ssKey(SER_LLD, LLD::DATABASE_VERSION);
+                ssKey << std::make_pair(std::string("data"), hash + i);
+
+                linearmap->Put(LLD::SectorKey(LLD::STATE::READY, ssKey.Bytes(), 0, i, 64));
+            }
+
+            uint64_t nLinear = timer.ElapsedMicroseconds();
+            debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Put::", ANSI_COLOR_RESET, nKeys, " keys ",
+                double(nHash) / nKeys, " hashmap / ", double(nLinear) / nKeys, " linear microseconds / put");
+        }
+
+        TimeKeychain(hashmap,   "hashmap", hash, nKeys, nGets);
+        TimeKeychain(linearmap, "linear",  hash, nKeys, nGets);
+
+        delete hashmap;
+        delete linearmap;
+
+        //the bytes each keychain takes on disk for the same keys
+        uint64_t nHashBytes = 0;
+        for(uint32_t nFile = 0; ; ++nFile)
+        {
+            const std::string strFile = debug::safe_printstr(strHashPath, "_hashmap.", std::setfill('0'), std::setw(5), nFile);
+            if(!filesystem::exists(strFile))
+                break;
+
+            nHashBytes += FileSize(strFile);
+        }
+
+        const uint64_t nLinearBytes = FileSize(strLinearPath + "_linearmap.primary")
+                                    + FileSize(strLinearPath + "_linearmap.overflow");
+
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Disk::", ANSI_COLOR_RESET, nKeys, " keys ",
+            nHashBytes, " hashmap / ", nLinearBytes, " linear bytes");
+    }
+
+    debug::log(0, "===== End Binary Linear Map Growth Benchmarks =====\n");
+}
@@ -0,0 +1,112 @@
+#include <Util/include/runtime.h>
+#include <Util/include/config.h>
+#include <Util/include/filesystem.h>
+
+#include <LLC/include/random.h>
+
+#include <LLD/keychain/orderedmap.h>
+#include <LLD/templates/key.h>
+
+#include <LLD/include/enum.h>
+#include <LLD/include/version.h>
+
+#include <Util/templates/datastream.h>
+
+#include <unit/catch2/catch.hpp>
+
+
+//key of an event, the same layout as the event database's index with big-endian sequences
+std::vector<uint8_t> EventKey(const uint256_t& hashAddress, const uint32_t nSequence)
+{
+    const std::vector<uint8_t> vSequence =
+    {
+        static_cast<uint8_t>(nSequence >> 24),
+        static_cast<uint8_t>(nSequence >> 16),
+        static_cast<uint8_t>(nSequence >> 8),
+        static_cast<uint8_t>(nSequence)
+    };
+
+    DataStream ssKey(SER_LLD, LLD::DATABASE_VERSION);
+    ssKey << std::make_pair(std::make_pair(std::string("event"), hashAddress), vSequence);
+
+    return ssKey.Bytes();
+}
+
+
+//the least key past every event of the address
+std::vector<uint8_t> AddressEnd(const uint256_t& hashAddress)
+{
+    DataStream ssKey(SER_LLD, LLD::DATABASE_VERSION);
+    ssKey << std::make_pair(std::string("event"), hashAddress);
+
+    std::vector<uint8_t> vEnd = ssKey.Bytes();
+    while(!vEnd.empty() && vEnd.back() == 0xff)
+        vEnd.pop_back();
+
+    if(!vEnd.empty())
+        ++vEnd.back();
+
+    return vEnd;
+}
+
+
+TEST_CASE( "Binary Ordered Map Range Benchmarks", "[LLD]")
+{
+    debug::log(0, "===== Begin Binary Ordered Map Range Benchmarks =====");
+
+    const uint32_t nAddresses = 10000;
+    const uint32_t nSequences = 100;
+
+    std::string strPath = config::GetDataDir() + "/bench/orderedmap/";
+    filesystem::remove_directories(strPath);
+
+    LLD::BinaryOrderedMap* orderedmap = new LLD::BinaryOrderedMap(strPath, LLD::FLAGS::CREATE | LLD::FLAGS::WRITE);
+
+    //write the events of every address in sequence order, interleaved between addresses
+    uint256_t hash = LLC::GetRand256();
+    {
+        runtime::timer timer;
+        timer.Start();
+
+        for(uint32_t s = 0; s < nSequences; s++)
+            for(uint32_t a = 0; a < nAddresses; a++)
+                orderedmap->Put(LLD::SectorKey(LLD::STATE::READY, EventKey(hash + a, s), 0, a * nSequences + s, 64));
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Put::", ANSI_COLOR_RESET, double(nAddresses * nSequences) / nTime, " million keys / second");
+    }
+
+    //read the events of each address with one point lookup per sequence
+    {
+        runtime::timer timer;
+        timer.Start();
+
+        LLD::SectorKey cKey;
+        for(uint32_t a = 0; a < nAddresses; a++)
+            for(uint32_t s = 0; s < nSequences; s++)
+                orderedmap->Get(EventKey(hash + a, s), cKey);
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Get::", ANSI_COLOR_RESET, double(nTime) / nAddresses, " microseconds / address");
+    }
+
+    //read the events of each address with one range scan over the address prefix
+    {
+        runtime::timer timer;
+        timer.Start();
+
+        std::vector<LLD::SectorKey> vKeys;
+        for(uint32_t a = 0; a < nAddresses; a++)
+        {
+            vKeys.clear();
+            orderedmap->Range(EventKey(hash + a, 0), AddressEnd(hash + a), vKeys, nSequences);
+        }
+
+        uint64_t nTime = timer.ElapsedMicroseconds();
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, "Range::", ANSI_COLOR_RESET, double(nTime) / nAddresses, " microseconds / address");
+    }
+
+    delete orderedmap;
+
+    debug::log(0, "===== End Binary Ordered Map Range Benchmarks =====\n");
+}
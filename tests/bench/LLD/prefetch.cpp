@@ -0,0 +1,116 @@
+#include <Util/include/runtime.h>
+#include <Util/include/args.h>
+#include <Util/include/config.h>
+#include <Util/include/filesystem.h>
+
+#include <LLC/include/random.h>
+
+#include <LLD/include/global.h>
+
+#include <TAO/Ledger/types/state.h>
+#include <TAO/Ledger/types/transaction.h>
+
+#include <unit/catch2/catch.hpp>
+
+
+//write a chain of blocks with their transactions, returning the hash of the first block
+static uint1024_t WriteChain(const uint32_t nBlocks, const uint32_t nTransactions)
+{
+    LLD::LedgerDB* db = new LLD::LedgerDB(LLD::FLAGS::CREATE | LLD::FLAGS::FORCE, 256 * 256 * 4, 16 * 1024 * 1024);
+
+    //the hashes first, each block points at the ones around it
+    std::vector<TAO::Ledger::BlockState> vStates(nBlocks);
+    for(uint32_t i = 0; i < nBlocks; i++)
+    {
+        vStates[i].nVersion      = 7;
+        vStates[i].nHeight       = i + 1;
+        vStates[i].nNonce        = i;
+        vStates[i].hashPrevBlock = (i > 0 ? vStates[i - 1].GetHash() : uint1024_t(0));
+
+        for(uint32_t n = 0; n < nTransactions; n++)
+            vStates[i].vtx.push_back(std::make_pair(TAO::Ledger::TRANSACTION::TRITIUM, LLC::GetRand512()));
+    }
+
+    for(uint32_t i = 0; i < nBlocks; i++)
+    {
+        if(i + 1 < nBlocks)
+            vStates[i].hashNextBlock = vStates[i + 1].GetHash();
+
+        db->WriteBlock(vStates[i].GetHash(), vStates[i]);
+
+        for(const auto& proof : vStates[i].vtx)
+        {
+            TAO::Ledger::Transaction tx;
+            tx.nTimestamp = i;
+
+            db->WriteTx(proof.second, tx);
+        }
+    }
+
+    delete db;
+
+    return vStates[0].GetHash();
+}
+
+
+//walk the chain reading every block and transaction, returning the microseconds taken
+static uint64_t WalkChain(LLD::LedgerDB* db, const uint1024_t& hashStart, const uint32_t nBlocks, const bool fPrefetch)
+{
+    runtime::timer timer;
+    timer.Start();
+
+    if(fPrefetch)
+        db->Prefetch(hashStart, nBlocks);
+
+    TAO::Ledger::BlockState state;
+    db->ReadBlock(hashStart, state);
+
+    for(uint32_t i = 1; i < nBlocks && state.hashNextBlock != 0; i++)
+    {
+        if(!db->ReadBlock(state.hashNextBlock, state))
+            break;
+
+        for(const auto& proof : state.vtx)
+        {
+            TAO::Ledger::Transaction tx;
+            db->ReadTx(proof.second, tx);
+        }
+    }
+
+    return timer.ElapsedMicroseconds();
+}
+
+
+TEST_CASE( "LLD Prefetch Benchmarks", "[LLD]")
+{
+    debug::log(0, "===== Begin LLD Prefetch Benchmarks =====");
+
+    const uint32_t nBlocks       = 5000;
+    const uint32_t nTransactions = 8;
+
+    filesystem::remove_directories(config::GetDataDir() + "/_LEDGER");
+    const uint1024_t hashStart = WriteChain(nBlocks, nTransactions);
+
+    //walk with a cold cache, first on this thread alone and then behind the read-ahead threads
+    for(uint32_t nPrefetch = 0; nPrefetch < 2; nPrefetch++)
+    {
+        config::mapArgs["-lldprefetchthreads"] = (nPrefetch ? "4" : "0");
+
+        LLD::LedgerDB* db = new LLD::LedgerDB(LLD::FLAGS::CREATE | LLD::FLAGS::FORCE, 256 * 256 * 4, 16 * 1024 * 1024);
+
+        const uint64_t nTime = WalkChain(db, hashStart, nBlocks, nPrefetch);
+        const json::json jsonMetrics = db->GetMetrics().ToJSON();
+
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, nPrefetch ? "Prefetch::" : "Serial::", ANSI_COLOR_RESET,
+            nBlocks, " blocks and ", nBlocks * nTransactions, " tx in ", nTime, " microseconds",
+            " | ", jsonMetrics["cache_hits_total"].get<uint64_t>(), " cache hits",
+            " | ", jsonMetrics["prefetch_blocks_total"].get<uint64_t>(), " blocks and ",
+            jsonMetrics["prefetch_tx_total"].get<uint64_t>(), " tx read ahead");
+
+        delete db;
+    }
+
+    config::mapArgs.erase("-lldprefetchthreads");
+
+    debug::log(0, "===== End LLD Prefetch Benchmarks =====\n");
+}
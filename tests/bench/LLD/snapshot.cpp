@@ -0,0 +1,117 @@
+#include <Util/include/runtime.h>
+#include <Util/include/config.h>
+#include <Util/include/filesystem.h>
+
+#include <LLD/templates/sector.h>
+#include <LLD/keychain/hashmap.h>
+#include <LLD/cache/binary_lru.h>
+
+#include <LLD/include/enum.h>
+
+#include <unit/catch2/catch.hpp>
+
+#include <atomic>
+#include <vector>
+#include <thread>
+
+
+typedef LLD::SectorDatabase<LLD::BinaryHashMap, LLD::BinaryLRU> SnapshotDB;
+
+
+//commit transactions that move every record to the next generation, in batches, until told to stop
+static uint64_t CommitGenerations(SnapshotDB* db, const uint32_t nRecords, const uint32_t nBatch, std::atomic<bool>& fStop, uint64_t& nCommits)
+{
+    runtime::timer timer;
+    timer.Start();
+
+    uint64_t nGeneration = 1;
+    while(!fStop.load())
+    {
+        //one generation is several commits in key order, so any commit leaves the keys before it one generation ahead
+        for(uint32_t nStart = 0; nStart < nRecords; nStart += nBatch)
+        {
+            db->TxnBegin();
+            for(uint32_t i = nStart; i < std::min(nStart + nBatch, nRecords); i++)
+                db->Write(std::make_pair(std::string("balance"), i), nGeneration);
+
+            db->TxnCommit();
+            ++nCommits;
+        }
+
+        ++nGeneration;
+    }
+
+    return timer.ElapsedMicroseconds();
+}
+
+
+TEST_CASE( "Sector Database Snapshot Benchmarks", "[LLD]")
+{
+    debug::log(0, "===== Begin Sector Database Snapshot Benchmarks =====");
+
+    const uint32_t nRecords = 20000;
+    const uint32_t nBatch   = 1000;
+    const uint32_t nScans   = 10;
+
+    const std::string strName = "/bench/snapshot";
+    filesystem::remove_directories(config::GetDataDir() + strName);
+
+    SnapshotDB* db = new SnapshotDB(strName, LLD::FLAGS::CREATE | LLD::FLAGS::FORCE, 256 * 256 * 4, 1024 * 64);
+
+    for(uint32_t i = 0; i < nRecords; i++)
+        db->Write(std::make_pair(std::string("balance"), i), uint64_t(0));
+
+    //scan every record while generations are committed, with and without a view
+    for(uint32_t nView = 0; nView < 2; nView++)
+    {
+        std::atomic<bool> fStop(false);
+        uint64_t nCommits = 0;
+        uint64_t nCommitTime = 0;
+
+        std::thread writer([&]() { nCommitTime = CommitGenerations(db, nRecords, nBatch, fStop, nCommits); });
+
+        runtime::timer timer;
+        timer.Start();
+
+        uint32_t nMixed = 0;
+        for(uint32_t nScan = 0; nScan < nScans; nScan++)
+        {
+            //the generation of each key, a scan at a commit boundary never goes up in key order
+            std::vector<uint64_t> vGenerations(nRecords, 0);
+            if(nView)
+            {
+                LLD::ReadView view = db->Snapshot();
+                for(uint32_t i = 0; i < nRecords; i++)
+                    db->Read(view, std::make_pair(std::string("balance"), i), vGenerations[i]);
+            }
+            else
+            {
+                for(uint32_t i = 0; i < nRecords; i++)
+                    db->Read(std::make_pair(std::string("balance"), i), vGenerations[i]);
+            }
+
+            for(uint32_t i = 1; i < nRecords; i++)
+            {
+                if(vGenerations[i] > vGenerations[i - 1] || vGenerations[0] > vGenerations[i] + 1)
+                {
+                    ++nMixed;
+                    break;
+                }
+            }
+        }
+
+        uint64_t nScanTime = timer.ElapsedMicroseconds();
+
+        fStop = true;
+        writer.join();
+
+        debug::log(0, ANSI_COLOR_BRIGHT_CYAN, nView ? "View::" : "Live::", ANSI_COLOR_RESET,
+            double(nScanTime) / (nScans * nRecords), " microseconds / read | ",
+            double(nCommitTime) / std::max(nCommits, uint64_t(1)), " microseconds / commit | ",
+            nMixed, " of ", nScans, " scans didn't match a single commit");
+    }
+
+    delete db;
+
+    debug::log(0, "===== End Sector Database Snapshot Benchmarks =====\n");
+}